@@ -456,6 +456,7 @@ let package = Package(
         "connections/implementation/wifi_hotspot_bwu_test.cc",
         "connections/implementation/analytics/analytics_recorder_test.cc",
         "connections/implementation/analytics/throughput_recorder_test.cc",
+        "connections/implementation/analytics/connection_quality_recorder_test.cc",
         "connections/implementation/mediums/advertisements/data_element_test.cc",
         "connections/implementation/mediums/advertisements/dct_advertisement_test.cc",
         "connections/implementation/mediums/advertisements/advertisement_util_test.cc",
@@ -469,6 +470,7 @@ let package = Package(
         "connections/implementation/mediums/ble_v2/ble_advertisement_header_test.cc",
         "connections/implementation/mediums/ble_v2/ble_utils_test.cc",
         "connections/implementation/mediums/ble_v2/discovered_peripheral_tracker_test.cc",
+        "connections/implementation/mediums/ble_v2/discovered_peripheral_tracker_benchmark.cc",
         "connections/implementation/mediums/ble_v2/instant_on_lost_advertisement_test.cc",
         "connections/implementation/mediums/ble_v2/instant_on_lost_manager_test.cc",
         "connections/implementation/mediums/multiplex/multiplex_frames_test.cc",
@@ -494,6 +496,10 @@ let package = Package(
         "connections/implementation/ble_advertisement_test.cc",
         "connections/implementation/base_endpoint_channel_test.cc",
         "connections/implementation/reconnect_manager_test.cc",
+        "connections/implementation/payload_checkpoint_journal_test.cc",
+        "connections/implementation/payload_compression_test.cc",
+        "connections/implementation/chunk_size_controller_test.cc",
+        "connections/implementation/payload_fan_out_window_test.cc",
         "connections/v3/connections_device_test.cc",
         "connections/v3/connections_device_provider_test.cc",
         "connections/implementation/connections_authentication_transport_test.cc",
@@ -515,6 +521,7 @@ let package = Package(
         "internal/crypto_cros/symmetric_key_unittest.cc",
         "internal/encoding/base85_test.cc",
         "internal/data/leveldb_data_set_test.cc",
+        "internal/data/leveldb_data_set_benchmark.cc",
         "internal/data/memory_data_set_test.cc",
         "internal/flags/nearby_flags_test.cc",
         "internal/proto/analytics/connections_log_test.cc",
@@ -532,6 +539,7 @@ let package = Package(
         "internal/platform/stream_writer_test.cc",
         "internal/platform/count_down_latch_test.cc",
         "internal/platform/pipe_test.cc",
+        "internal/platform/pipe_benchmark.cc",
         "internal/platform/timer_impl_test.cc",
         "internal/platform/task_runner_impl_test.cc",
         "internal/platform/uuid_test.cc",
@@ -552,12 +560,21 @@ let package = Package(
         "internal/platform/ble_test.cc",
         "internal/platform/ble_v2_test.cc",
         "internal/platform/prng_test.cc",
+        "internal/platform/trace_test.cc",
+        "internal/platform/timing_wheel_test.cc",
+        "internal/platform/timing_wheel_benchmark.cc",
+        "internal/platform/timing_wheel_scheduled_executor_test.cc",
+        "internal/platform/mpmc_queue_test.cc",
+        "internal/platform/array_blocking_queue_test.cc",
+        "internal/platform/array_blocking_queue_benchmark.cc",
         "internal/platform/implementation/apple/count_down_latch_test.cc",
         "internal/platform/implementation/apple/condition_variable_test.cc",
         "internal/platform/implementation/apple/mutex_test.cc",
         "internal/platform/implementation/apple/atomic_boolean_test.cc",
         "internal/platform/implementation/apple/atomic_uint32_test.cc",
         "internal/platform/implementation/shared/file_test.cc",
+        "internal/platform/implementation/shared/mapped_file_test.cc",
+        "internal/platform/implementation/shared/mapped_file_benchmark.cc",
         "internal/platform/implementation/wifi_utils_test.cc",
         "internal/platform/atomic_boolean_test.cc",
         "internal/platform/exception_test.cc",
@@ -624,6 +641,9 @@ let package = Package(
         .headerSearchPath("third_party/ukey2/compiled_proto/"),
         .define("NO_WEBRTC"),
         .define("NEARBY_SWIFTPM"),
+      ],
+      linkerSettings: [
+        .linkedLibrary("z"),
       ]
     ),
     .target(
@@ -0,0 +1,78 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CORE_CONNECTION_QUALITY_H_
+#define CORE_CONNECTION_QUALITY_H_
+
+#include <cstdint>
+
+#include "absl/time/time.h"
+#include "proto/connections_enums.pb.h"
+
+namespace nearby {
+namespace connections {
+
+// A snapshot of rolling transfer statistics for a connected endpoint, as
+// returned by Core::GetConnectionQuality().
+struct ConnectionQuality {
+  // The medium the most recent frame was sent or received over.
+  ::location::nearby::proto::connections::Medium medium =
+      ::location::nearby::proto::connections::UNKNOWN_MEDIUM;
+
+  // Round trip time, sampled from KEEP_ALIVE and PAYLOAD_ACK exchanges. A
+  // PAYLOAD_ACK sample also includes the receiver's time to process the last
+  // chunk, so `min_rtt` is the best estimate of the link itself. All zero
+  // until the first sample.
+  absl::Duration latest_rtt = absl::ZeroDuration();
+  absl::Duration smoothed_rtt = absl::ZeroDuration();
+  absl::Duration min_rtt = absl::ZeroDuration();
+
+  // Average throughput over the last few seconds.
+  std::int64_t send_bytes_per_second = 0;
+  std::int64_t receive_bytes_per_second = 0;
+
+  std::int64_t total_bytes_sent = 0;
+  std::int64_t total_bytes_received = 0;
+
+  // Payload bytes before compression, and as they went over the wire. The
+  // two are the same for chunks that weren't compressed.
+  std::int64_t uncompressed_payload_bytes_sent = 0;
+  std::int64_t compressed_payload_bytes_sent = 0;
+  std::int64_t uncompressed_payload_bytes_received = 0;
+  std::int64_t compressed_payload_bytes_received = 0;
+
+  // Time spent on each stage of sending and receiving frames since the
+  // endpoint connected.
+  absl::Duration socket_io_time = absl::ZeroDuration();
+  absl::Duration encryption_time = absl::ZeroDuration();
+  absl::Duration file_io_time = absl::ZeroDuration();
+
+  // The size outgoing payload chunks are currently cut to, and the most the
+  // channel takes at once. Zero until a payload has been sent.
+  int payload_chunk_size = 0;
+  int max_payload_chunk_size = 0;
+
+  // Outgoing payloads queued or in flight to this endpoint.
+  int pending_outgoing_payloads = 0;
+
+  // Frames that could not be written to the endpoint channel. Mediums are
+  // reliable streams, so a failed write is what we see instead of a
+  // retransmit; the payload then fails or resumes over another channel.
+  int failed_writes = 0;
+};
+
+}  // namespace connections
+}  // namespace nearby
+
+#endif  // CORE_CONNECTION_QUALITY_H_
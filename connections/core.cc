@@ -15,6 +15,7 @@
 #include "connections/core.h"
 
 #include <cstdint>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
@@ -24,6 +25,7 @@
 #include "absl/types/span.h"
 #include "connections/advertising_options.h"
 #include "connections/connection_options.h"
+#include "connections/connection_quality.h"
 #include "connections/discovery_options.h"
 #include "connections/implementation/service_controller_router.h"
 #include "connections/implementation/service_id_constants.h"
@@ -207,6 +209,13 @@ void Core::SetCustomSavePath(absl::string_view path, ResultCallback callback) {
   router_->SetCustomSavePath(&client_, path, std::move(callback));
 }
 
+std::optional<ConnectionQuality> Core::GetConnectionQuality(
+    absl::string_view endpoint_id) {
+  std::string id(endpoint_id);
+  if (!client_.IsConnectedToEndpoint(id)) return std::nullopt;
+  return client_.GetConnectionQualityRecorder().GetConnectionQuality(id);
+}
+
 std::string Core::Dump() { return client_.Dump(); }
 
 // V3
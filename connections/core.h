@@ -17,6 +17,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
@@ -25,6 +26,7 @@
 #include "absl/types/span.h"
 #include "connections/advertising_options.h"
 #include "connections/connection_options.h"
+#include "connections/connection_quality.h"
 #include "connections/discovery_options.h"
 #include "connections/implementation/client_proxy.h"
 #include "connections/implementation/service_controller_router.h"
@@ -258,6 +260,13 @@ class Core {
   // Gets the local endpoint generated by Nearby Connections.
   std::string GetLocalEndpointId() { return client_.GetLocalEndpointId(); }
 
+  // Returns rolling transfer statistics for a connected endpoint, or
+  // std::nullopt if we aren't connected to it.
+  //
+  // endpoint_id - The identifier for the remote endpoint.
+  std::optional<ConnectionQuality> GetConnectionQuality(
+      absl::string_view endpoint_id);
+
   std::string Dump();
 
   //******************************* V3 *******************************
@@ -0,0 +1,138 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/aes_gcm_record_layer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "internal/crypto_cros/aead.h"
+#include "internal/crypto_cros/hkdf.h"
+#include "internal/platform/logging.h"
+#include "internal/platform/mutex_lock.h"
+
+namespace nearby {
+namespace connections {
+
+namespace {
+
+// UKEY2 saved session layout: protocol version (1 byte), encode sequence
+// number (4 bytes), decode sequence number (4 bytes), encode key (32 bytes),
+// decode key (32 bytes).
+constexpr size_t kSavedSessionEncodeKeyOffset = 9;
+constexpr size_t kSavedSessionKeyLength = 32;
+constexpr size_t kSavedSessionLength =
+    kSavedSessionEncodeKeyOffset + 2 * kSavedSessionKeyLength;
+
+constexpr char kRecordMarker = '\0';
+constexpr size_t kRecordKeyLength = 32;
+constexpr size_t kNonceLength = 12;
+constexpr absl::string_view kHkdfSalt = "NearbyConnectionsRecordLayer";
+constexpr absl::string_view kHkdfInfo = "AES-256-GCM";
+
+// The nonce is the sequence number, big endian, left padded with zeros.
+std::string MakeNonce(std::uint64_t sequence_number) {
+  std::string nonce(kNonceLength, '\0');
+  for (size_t i = 0; i < sizeof(sequence_number); ++i) {
+    nonce[kNonceLength - 1 - i] =
+        static_cast<char>((sequence_number >> (8 * i)) & 0xFF);
+  }
+  return nonce;
+}
+
+}  // namespace
+
+std::unique_ptr<AesGcmRecordLayer> AesGcmRecordLayer::Create(
+    EncryptionContext& context) {
+  std::unique_ptr<std::string> saved_session = context.SaveSession();
+  if (saved_session == nullptr ||
+      saved_session->size() != kSavedSessionLength) {
+    NEARBY_LOGS(WARNING) << __func__
+                         << ": Unable to read keys from the UKEY2 session.";
+    return nullptr;
+  }
+  absl::string_view session(*saved_session);
+  absl::string_view encode_key =
+      session.substr(kSavedSessionEncodeKeyOffset, kSavedSessionKeyLength);
+  absl::string_view decode_key = session.substr(
+      kSavedSessionEncodeKeyOffset + kSavedSessionKeyLength,
+      kSavedSessionKeyLength);
+  return std::unique_ptr<AesGcmRecordLayer>(new AesGcmRecordLayer(
+      crypto::HkdfSha256(encode_key, kHkdfSalt, kHkdfInfo, kRecordKeyLength),
+      crypto::HkdfSha256(decode_key, kHkdfSalt, kHkdfInfo, kRecordKeyLength)));
+}
+
+bool AesGcmRecordLayer::IsRecord(absl::string_view frame) {
+  return !frame.empty() && frame[0] == kRecordMarker;
+}
+
+AesGcmRecordLayer::AesGcmRecordLayer(std::string write_key,
+                                     std::string read_key)
+    : write_key_(std::move(write_key)), read_key_(std::move(read_key)) {
+  MutexLock lock(&mutex_);
+  write_aead_.Init(&write_key_);
+  read_aead_.Init(&read_key_);
+}
+
+std::optional<std::string> AesGcmRecordLayer::Seal(
+    absl::string_view plaintext) {
+  MutexLock lock(&mutex_);
+  if (write_sequence_number_ == std::numeric_limits<std::uint64_t>::max()) {
+    NEARBY_LOGS(WARNING) << __func__ << ": Record sequence number exhausted.";
+    return std::nullopt;
+  }
+  std::string ciphertext;
+  absl::string_view marker(&kRecordMarker, 1);
+  if (!write_aead_.Seal(plaintext, MakeNonce(write_sequence_number_), marker,
+                        &ciphertext)) {
+    return std::nullopt;
+  }
+  ++write_sequence_number_;
+  std::string record;
+  record.reserve(ciphertext.size() + 1);
+  record.push_back(kRecordMarker);
+  record.append(ciphertext);
+  return record;
+}
+
+std::optional<std::string> AesGcmRecordLayer::Open(absl::string_view record) {
+  if (!IsRecord(record)) return std::nullopt;
+  MutexLock lock(&mutex_);
+  std::string plaintext;
+  if (!read_aead_.Open(record.substr(1), MakeNonce(read_sequence_number_),
+                       record.substr(0, 1), &plaintext)) {
+    return std::nullopt;
+  }
+  ++read_sequence_number_;
+  return plaintext;
+}
+
+void AesGcmRecordLayer::EnableWrites() {
+  MutexLock lock(&mutex_);
+  writes_enabled_ = true;
+}
+
+bool AesGcmRecordLayer::AreWritesEnabled() const {
+  MutexLock lock(&mutex_);
+  return writes_enabled_;
+}
+
+}  // namespace connections
+}  // namespace nearby
@@ -0,0 +1,99 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CORE_INTERNAL_AES_GCM_RECORD_LAYER_H_
+#define CORE_INTERNAL_AES_GCM_RECORD_LAYER_H_
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "securegcm/d2d_connection_context_v1.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/string_view.h"
+#include "internal/crypto_cros/aead.h"
+#include "internal/platform/mutex.h"
+
+namespace nearby {
+namespace connections {
+
+// Seals and opens EndpointChannel frames with AES-256-GCM, as a cheaper
+// alternative to D2DConnectionContextV1 once both sides of a connection have
+// agreed to use it.
+//
+// A record is a one byte type marker followed by the ciphertext and the GCM
+// tag; there is no SecureMessage/DeviceToDeviceMessage wrapping and no
+// explicit sequence number. The nonce is the count of records sealed (or
+// successfully opened) so far in that direction, so both ends must process
+// records in the order they were written.
+//
+// The write and read keys are derived with HKDF from the UKEY2 encode and
+// decode keys of the connection context, so the local write key matches the
+// remote read key and the two directions never share a key/nonce pair.
+//
+// An endpoint's channels share one record layer, the way they share the
+// connection context, so the sequence numbers carry on where they left off
+// when a bandwidth upgrade replaces the channel instead of reusing nonces.
+//
+// Thread safe.
+class AesGcmRecordLayer {
+ public:
+  using EncryptionContext = ::securegcm::D2DConnectionContextV1;
+
+  // Returns nullptr if keys could not be derived from `context`.
+  static std::unique_ptr<AesGcmRecordLayer> Create(EncryptionContext& context);
+
+  // Returns true if `frame` looks like a sealed record rather than an
+  // encoded D2D message or a plaintext OfflineFrame. Both of those are
+  // serialized protos, which can never start with a zero byte.
+  static bool IsRecord(absl::string_view frame);
+
+  AesGcmRecordLayer(const AesGcmRecordLayer&) = delete;
+  AesGcmRecordLayer& operator=(const AesGcmRecordLayer&) = delete;
+
+  // Returns the sealed record, or std::nullopt if the write sequence number is
+  // exhausted.
+  std::optional<std::string> Seal(absl::string_view plaintext)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns the plaintext, or std::nullopt if `record` fails authentication.
+  // The read sequence number only advances on success, so a forged or
+  // corrupted record can be dropped without breaking the stream.
+  std::optional<std::string> Open(absl::string_view record)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Writes are sealed with the record layer from now on, on every channel of
+  // the endpoint, once the remote has agreed to it. Until then they stay
+  // D2D messages, while records from the remote are opened either way.
+  void EnableWrites() ABSL_LOCKS_EXCLUDED(mutex_);
+  bool AreWritesEnabled() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  AesGcmRecordLayer(std::string write_key, std::string read_key);
+
+  const std::string write_key_;
+  const std::string read_key_;
+  mutable Mutex mutex_;
+  crypto::Aead write_aead_ ABSL_GUARDED_BY(mutex_){crypto::Aead::AES_256_GCM};
+  crypto::Aead read_aead_ ABSL_GUARDED_BY(mutex_){crypto::Aead::AES_256_GCM};
+  std::uint64_t write_sequence_number_ ABSL_GUARDED_BY(mutex_) = 0;
+  std::uint64_t read_sequence_number_ ABSL_GUARDED_BY(mutex_) = 0;
+  bool writes_enabled_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+}  // namespace connections
+}  // namespace nearby
+
+#endif  // CORE_INTERNAL_AES_GCM_RECORD_LAYER_H_
@@ -15,6 +15,7 @@
 #include "connections/implementation/analytics/analytics_recorder.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <iterator>
 #include <memory>
@@ -32,6 +33,7 @@
 #include "connections/payload_type.h"
 #include "connections/strategy.h"
 #include "internal/analytics/event_logger.h"
+#include "internal/platform/count_down_latch.h"
 #include "internal/platform/error_code_params.h"
 #include "internal/platform/implementation/system_clock.h"
 #include "internal/platform/logging.h"
@@ -179,6 +181,9 @@ AnalyticsRecorder::AnalyticsRecorder(EventLogger *event_logger,
 }
 
 AnalyticsRecorder::~AnalyticsRecorder() {
+  log_executor_.Shutdown();
+  // Deliver whatever the logging thread didn't get to.
+  FlushPendingLogs();
 }
 
 bool AnalyticsRecorder::IsSessionLogged() {
@@ -186,6 +191,12 @@ bool AnalyticsRecorder::IsSessionLogged() {
   return session_was_logged_;
 }
 
+void AnalyticsRecorder::SetClientSessionLimits(
+    const ClientSessionLimits &limits) {
+  MutexLock lock(&mutex_);
+  client_session_limits_ = limits;
+}
+
 int AnalyticsRecorder::GetLatestUpdateIndexLocked(
     const std::vector<ConnectionsLog::OperationResultWithMedium> &list) {
   int latest_update_index = 0;
@@ -638,8 +649,11 @@ void AnalyticsRecorder::OnConnectionEstablished(
     logical_connection->PhysicalConnectionEstablished(medium, connection_token);
   } else {
     active_connections_.insert(
-        {endpoint_id, std::make_unique<LogicalConnection>(
-                          medium, connection_token, no_record_time_millis_)});
+        {endpoint_id,
+         std::make_unique<LogicalConnection>(
+             medium, connection_token,
+             client_session_limits_.max_payloads_per_connection,
+             no_record_time_millis_)});
   }
 }
 
@@ -677,11 +691,13 @@ void AnalyticsRecorder::OnConnectionClosed(const std::string &endpoint_id,
     // re-established with a new ConnectionRequest.
     auto pair = active_connections_.extract(it);
     std::unique_ptr<LogicalConnection> &logical_connection = pair.mapped();
+    RemoveChunkCounters(endpoint_id);
 
     absl::c_copy(
         logical_connection->GetEstablisedConnections(),
         RepeatedFieldBackInserter(
             current_strategy_session_->mutable_established_connection()));
+    EnforceClientSessionLimitLocked();
   }
 }
 
@@ -697,23 +713,26 @@ void AnalyticsRecorder::OnIncomingPayloadStarted(
     return;
   }
   const std::unique_ptr<LogicalConnection> &logical_connection = it->second;
+  auto chunk_counters = std::make_shared<ChunkCounters>();
   logical_connection->IncomingPayloadStarted(
-      payload_id, PayloadTypeToProtoPayloadType(type), total_size_bytes);
+      payload_id, PayloadTypeToProtoPayloadType(type), total_size_bytes,
+      chunk_counters);
+  UpdateChunkCounters([&](ChunkCountersMap &counters) {
+    counters[endpoint_id].incoming[payload_id] = std::move(chunk_counters);
+  });
 }
 
 void AnalyticsRecorder::OnPayloadChunkReceived(const std::string &endpoint_id,
                                                std::int64_t payload_id,
                                                std::int64_t chunk_size_bytes) {
-  MutexLock lock(&mutex_);
-  if (!CanRecordAnalyticsLocked("OnPayloadChunkReceived")) {
+  std::shared_ptr<ChunkCounters> chunk_counters = FindChunkCounters(
+      endpoint_id, payload_id, /*incoming=*/true);
+  if (chunk_counters == nullptr) {
     return;
   }
-  auto it = active_connections_.find(endpoint_id);
-  if (it == active_connections_.end()) {
-    return;
-  }
-  const std::unique_ptr<LogicalConnection> &logical_connection = it->second;
-  logical_connection->ChunkReceived(payload_id, chunk_size_bytes);
+  chunk_counters->num_bytes_transferred.fetch_add(chunk_size_bytes,
+                                                  std::memory_order_relaxed);
+  chunk_counters->num_chunks.fetch_add(1, std::memory_order_relaxed);
 }
 
 void AnalyticsRecorder::OnIncomingPayloadDone(
@@ -730,6 +749,12 @@ void AnalyticsRecorder::OnIncomingPayloadDone(
   const std::unique_ptr<LogicalConnection> &logical_connection = it->second;
   logical_connection->IncomingPayloadDone(payload_id, status,
                                           operation_result_code);
+  UpdateChunkCounters([&](ChunkCountersMap &counters) {
+    auto it = counters.find(endpoint_id);
+    if (it != counters.end()) {
+      it->second.incoming.erase(payload_id);
+    }
+  });
 }
 
 void AnalyticsRecorder::OnOutgoingPayloadStarted(
@@ -745,24 +770,27 @@ void AnalyticsRecorder::OnOutgoingPayloadStarted(
       continue;
     }
     const std::unique_ptr<LogicalConnection> &logical_connection = it->second;
+    auto chunk_counters = std::make_shared<ChunkCounters>();
     logical_connection->OutgoingPayloadStarted(
-        payload_id, PayloadTypeToProtoPayloadType(type), total_size_bytes);
+        payload_id, PayloadTypeToProtoPayloadType(type), total_size_bytes,
+        chunk_counters);
+    UpdateChunkCounters([&](ChunkCountersMap &counters) {
+      counters[endpoint_id].outgoing[payload_id] = std::move(chunk_counters);
+    });
   }
 }
 
 void AnalyticsRecorder::OnPayloadChunkSent(const std::string &endpoint_id,
                                            std::int64_t payload_id,
                                            std::int64_t chunk_size_bytes) {
-  MutexLock lock(&mutex_);
-  if (!CanRecordAnalyticsLocked("OnPayloadChunkSent")) {
-    return;
-  }
-  auto it = active_connections_.find(endpoint_id);
-  if (it == active_connections_.end()) {
+  std::shared_ptr<ChunkCounters> chunk_counters = FindChunkCounters(
+      endpoint_id, payload_id, /*incoming=*/false);
+  if (chunk_counters == nullptr) {
     return;
   }
-  const std::unique_ptr<LogicalConnection> &logical_connection = it->second;
-  logical_connection->ChunkSent(payload_id, chunk_size_bytes);
+  chunk_counters->num_bytes_transferred.fetch_add(chunk_size_bytes,
+                                                  std::memory_order_relaxed);
+  chunk_counters->num_chunks.fetch_add(1, std::memory_order_relaxed);
 }
 
 void AnalyticsRecorder::OnOutgoingPayloadDone(
@@ -780,6 +808,12 @@ void AnalyticsRecorder::OnOutgoingPayloadDone(
   const std::unique_ptr<LogicalConnection> &logical_connection = it->second;
   logical_connection->OutgoingPayloadDone(payload_id, status,
                                           operation_result_code);
+  UpdateChunkCounters([&](ChunkCountersMap &counters) {
+    auto it = counters.find(endpoint_id);
+    if (it != counters.end()) {
+      it->second.outgoing.erase(payload_id);
+    }
+  });
 }
 
 void AnalyticsRecorder::OnBandwidthUpgradeStarted(
@@ -886,10 +920,7 @@ void AnalyticsRecorder::OnErrorCode(const ErrorCodeParams &params) {
   connections_log.set_version(kVersion);
   connections_log.set_allocated_error_code(error_code.release());
 
-  NEARBY_VLOG(1) << "AnalyticsRecorder LogErrorCode connections_log="
-                 << connections_log.DebugString();  // NOLINT
-
-  event_logger_->Log(connections_log);
+  LogConnectionsLog(std::move(connections_log));
 }
 
 void AnalyticsRecorder::LogStartSession() {
@@ -1034,11 +1065,7 @@ void AnalyticsRecorder::LogClientSessionLocked() {
   connections_log.set_event_type(CLIENT_SESSION);
   connections_log.set_allocated_client_session(client_session_.release());
   connections_log.set_version(kVersion);
-
-  NEARBY_VLOG(1) << "AnalyticsRecorder LogClientSession connections_log="
-                 << connections_log.DebugString();  // NOLINT
-
-  event_logger_->Log(connections_log);
+  LogConnectionsLog(std::move(connections_log));
   client_session_ = nullptr;
 }
 
@@ -1046,11 +1073,123 @@ void AnalyticsRecorder::LogEvent(EventType event_type) {
   ConnectionsLog connections_log;
   connections_log.set_event_type(event_type);
   connections_log.set_version(kVersion);
+  LogConnectionsLog(std::move(connections_log));
+}
+
+void AnalyticsRecorder::LogConnectionsLog(ConnectionsLog connections_log) {
+  bool schedule_flush;
+  {
+    MutexLock lock(&pending_logs_mutex_);
+    // A flush is already on its way for anything queued before.
+    schedule_flush = pending_logs_.empty();
+    pending_logs_.push_back(std::move(connections_log));
+  }
+  if (schedule_flush) {
+    log_executor_.Execute([this]() { FlushPendingLogs(); });
+  }
+}
 
-  NEARBY_VLOG(1) << "AnalyticsRecorder LogEvent connections_log="
-                 << connections_log.DebugString();  // NOLINT
+void AnalyticsRecorder::FlushPendingLogs() {
+  std::vector<ConnectionsLog> logs;
+  {
+    MutexLock lock(&pending_logs_mutex_);
+    logs.swap(pending_logs_);
+  }
+  for (const ConnectionsLog &connections_log : logs) {
+    NEARBY_VLOG(1) << "AnalyticsRecorder LogEvent connections_log="
+                   << connections_log.DebugString();  // NOLINT
+    event_logger_->Log(connections_log);
+  }
+}
+
+void AnalyticsRecorder::Sync() {
+  CountDownLatch latch(1);
+  log_executor_.Execute([&latch]() { latch.CountDown(); });
+  latch.Await();
+}
 
-  event_logger_->Log(connections_log);
+void AnalyticsRecorder::EnforceClientSessionLimitLocked() {
+  if (client_session_ == nullptr) {
+    return;
+  }
+  std::size_t client_session_bytes = client_session_->ByteSizeLong();
+  if (current_strategy_session_ != nullptr) {
+    client_session_bytes += current_strategy_session_->ByteSizeLong();
+  }
+  if (client_session_bytes <=
+      client_session_limits_.max_client_session_bytes) {
+    return;
+  }
+  NEARBY_LOGS(INFO) << "AnalyticsRecorder logging " << client_session_bytes
+                    << " bytes of the client session ahead of LogSession.";
+  auto flushed_session = std::make_unique<ConnectionsLog::ClientSession>();
+  flushed_session->mutable_strategy_session()->Swap(
+      client_session_->mutable_strategy_session());
+  if (current_strategy_session_ != nullptr) {
+    // Everything recorded so far in the current strategy session goes out
+    // too. It carries on with the same strategy and roles.
+    ConnectionsLog::StrategySession *flushed_strategy_session =
+        flushed_session->add_strategy_session();
+    flushed_strategy_session->Swap(current_strategy_session_.get());
+    current_strategy_session_->set_strategy(
+        flushed_strategy_session->strategy());
+    *current_strategy_session_->mutable_role() =
+        flushed_strategy_session->role();
+  }
+  flushed_session->set_partial(true);
+  ConnectionsLog connections_log;
+  connections_log.set_event_type(CLIENT_SESSION);
+  connections_log.set_allocated_client_session(flushed_session.release());
+  connections_log.set_version(kVersion);
+  LogConnectionsLog(std::move(connections_log));
+}
+
+void AnalyticsRecorder::RemoveChunkCounters(const std::string &endpoint_id) {
+  UpdateChunkCounters(
+      [&](ChunkCountersMap &counters) { counters.erase(endpoint_id); });
+}
+
+void AnalyticsRecorder::UpdateChunkCounters(
+    absl::AnyInvocable<void(ChunkCountersMap &)> update) {
+  MutexLock lock(&chunk_counters_mutex_);
+  auto counters =
+      std::make_unique<ChunkCountersMap>(*published_chunk_counters_);
+  update(*counters);
+  std::uint64_t epoch = chunk_counters_epoch_.load();
+  retired_chunk_counters_.emplace_back(epoch,
+                                       std::move(published_chunk_counters_));
+  published_chunk_counters_ = std::move(counters);
+  chunk_counters_.store(published_chunk_counters_.get());
+  // All of these are sequentially consistent: a reader that isn't counted
+  // under the previous epoch by now loads the map just published, and readers
+  // under the current epoch never saw a map retired before it began.
+  if (chunk_counter_readers_[(epoch + 1) % 2].load() == 0) {
+    std::erase_if(retired_chunk_counters_, [epoch](const auto &retired) {
+      return retired.first < epoch;
+    });
+    chunk_counters_epoch_.store(epoch + 1);
+  }
+}
+
+std::shared_ptr<AnalyticsRecorder::ChunkCounters>
+AnalyticsRecorder::FindChunkCounters(const std::string &endpoint_id,
+                                     std::int64_t payload_id,
+                                     bool incoming) const {
+  std::atomic<int> &readers =
+      chunk_counter_readers_[chunk_counters_epoch_.load() % 2];
+  readers.fetch_add(1);
+  const ChunkCountersMap *counters = chunk_counters_.load();
+  std::shared_ptr<ChunkCounters> chunk_counters;
+  auto it = counters->find(endpoint_id);
+  if (it != counters->end()) {
+    const auto &payloads = incoming ? it->second.incoming : it->second.outgoing;
+    auto payload = payloads.find(payload_id);
+    if (payload != payloads.end()) {
+      chunk_counters = payload->second;
+    }
+  }
+  readers.fetch_sub(1);
+  return chunk_counters;
 }
 
 void AnalyticsRecorder::UpdateStrategySessionLocked(
@@ -1078,6 +1217,7 @@ void AnalyticsRecorder::UpdateStrategySessionLocked(
     // Otherwise, we're starting a new Strategy.
     current_strategy_ = strategy;
     FinishStrategySessionLocked();
+    EnforceClientSessionLimitLocked();
     LogEvent(START_STRATEGY_SESSION);
     current_strategy_session_ =
         std::make_unique<ConnectionsLog::StrategySession>();
@@ -1362,6 +1502,7 @@ void AnalyticsRecorder::FinishStrategySessionLocked() {
       const std::unique_ptr<LogicalConnection> &logical_connection =
           item.second;
       logical_connection->CloseAllPhysicalConnections();
+      RemoveChunkCounters(item.first);
       absl::c_copy(
           logical_connection->GetEstablisedConnections(),
           RepeatedFieldBackInserter(
@@ -1423,12 +1564,6 @@ PayloadType AnalyticsRecorder::PayloadTypeToProtoPayloadType(
   }
 }
 
-void AnalyticsRecorder::PendingPayload::AddChunk(
-    std::int64_t chunk_size_bytes) {
-  num_bytes_transferred_ += chunk_size_bytes;
-  num_chunks_++;
-}
-
 ConnectionsLog::Payload AnalyticsRecorder::PendingPayload::GetProtoPayload(
     PayloadStatus status) {
   ConnectionsLog::Payload payload;
@@ -1438,8 +1573,9 @@ ConnectionsLog::Payload AnalyticsRecorder::PendingPayload::GetProtoPayload(
   }
   payload.set_type(type_);
   payload.set_total_size_bytes(total_size_bytes_);
-  payload.set_num_bytes_transferred(num_bytes_transferred_);
-  payload.set_num_chunks(num_chunks_);
+  payload.set_num_bytes_transferred(
+      chunk_counters_->num_bytes_transferred.exchange(0));
+  payload.set_num_chunks(chunk_counters_->num_chunks.exchange(0));
   payload.set_status(status);
 
   auto operation_result_proto =
@@ -1561,20 +1697,12 @@ AnalyticsRecorder::LogicalConnection::GetEstablisedConnections() {
 }
 
 void AnalyticsRecorder::LogicalConnection::IncomingPayloadStarted(
-    std::int64_t payload_id, PayloadType type, std::int64_t total_size_bytes) {
+    std::int64_t payload_id, PayloadType type, std::int64_t total_size_bytes,
+    std::shared_ptr<ChunkCounters> chunk_counters) {
   incoming_payloads_.insert(
-      {payload_id, std::make_unique<PendingPayload>(type, total_size_bytes,
-                                                    no_record_time_millis_)});
-}
-
-void AnalyticsRecorder::LogicalConnection::ChunkReceived(
-    std::int64_t payload_id, std::int64_t size_bytes) {
-  auto it = incoming_payloads_.find(payload_id);
-  if (it == incoming_payloads_.end()) {
-    return;
-  }
-  PendingPayload *pending_payload = it->second.get();
-  pending_payload->AddChunk(size_bytes);
+      {payload_id, std::make_unique<PendingPayload>(
+                       type, total_size_bytes, no_record_time_millis_,
+                       std::move(chunk_counters))});
 }
 
 void AnalyticsRecorder::LogicalConnection::IncomingPayloadDone(
@@ -1591,29 +1719,23 @@ void AnalyticsRecorder::LogicalConnection::IncomingPayloadDone(
         &established_connection = it->second;
     auto it = incoming_payloads_.find(payload_id);
     if (it != incoming_payloads_.end()) {
-      it->second->SetOperationResultCode(operation_result_code);
-      *established_connection->add_received_payload() =
-          it->second->GetProtoPayload(status);
+      if (CanAddPayload(*established_connection)) {
+        it->second->SetOperationResultCode(operation_result_code);
+        *established_connection->add_received_payload() =
+            it->second->GetProtoPayload(status);
+      }
       incoming_payloads_.erase(it);
     }
   }
 }
 
 void AnalyticsRecorder::LogicalConnection::OutgoingPayloadStarted(
-    std::int64_t payload_id, PayloadType type, std::int64_t total_size_bytes) {
+    std::int64_t payload_id, PayloadType type, std::int64_t total_size_bytes,
+    std::shared_ptr<ChunkCounters> chunk_counters) {
   outgoing_payloads_.insert(
-      {payload_id, std::make_unique<PendingPayload>(type, total_size_bytes,
-                                                    no_record_time_millis_)});
-}
-
-void AnalyticsRecorder::LogicalConnection::ChunkSent(std::int64_t payload_id,
-                                                     std::int64_t size_bytes) {
-  auto it = outgoing_payloads_.find(payload_id);
-  if (it == outgoing_payloads_.end()) {
-    return;
-  }
-  PendingPayload *payload = it->second.get();
-  payload->AddChunk(size_bytes);
+      {payload_id, std::make_unique<PendingPayload>(
+                       type, total_size_bytes, no_record_time_millis_,
+                       std::move(chunk_counters))});
 }
 
 void AnalyticsRecorder::LogicalConnection::OutgoingPayloadDone(
@@ -1630,14 +1752,32 @@ void AnalyticsRecorder::LogicalConnection::OutgoingPayloadDone(
         &established_connection = it->second;
     auto it = outgoing_payloads_.find(payload_id);
     if (it != outgoing_payloads_.end()) {
-      it->second->SetOperationResultCode(operation_result_code);
-      *established_connection->add_sent_payload() =
-          it->second->GetProtoPayload(status);
+      if (CanAddPayload(*established_connection)) {
+        it->second->SetOperationResultCode(operation_result_code);
+        *established_connection->add_sent_payload() =
+            it->second->GetProtoPayload(status);
+      }
       outgoing_payloads_.erase(it);
     }
   }
 }
 
+bool AnalyticsRecorder::LogicalConnection::CanAddPayload(
+    const ConnectionsLog::EstablishedConnection &established_connection) {
+  int num_payloads = established_connection.received_payload_size() +
+                     established_connection.sent_payload_size();
+  if (num_payloads < max_payloads_) {
+    return true;
+  }
+  if (!payloads_dropped_) {
+    NEARBY_LOGS(WARNING) << "AnalyticsRecorder recorded " << max_payloads_
+                         << " payloads on this connection, leaving out the "
+                            "rest.";
+    payloads_dropped_ = true;
+  }
+  return false;
+}
+
 void AnalyticsRecorder::LogicalConnection::FinishPhysicalConnection(
     ConnectionsLog::EstablishedConnection *established_connection,
     DisconnectionReason reason, SafeDisconnectionResult result) {
@@ -1652,14 +1792,20 @@ void AnalyticsRecorder::LogicalConnection::FinishPhysicalConnection(
   // Add any not-yet-finished payloads to this EstablishedConnection.
   std::vector<ConnectionsLog::Payload> in_payloads =
       ResolvePendingPayloads(incoming_payloads_, reason);
-  absl::c_move(in_payloads,
-               RepeatedFieldBackInserter(
-                   established_connection->mutable_received_payload()));
+  for (ConnectionsLog::Payload &payload : in_payloads) {
+    if (!CanAddPayload(*established_connection)) {
+      break;
+    }
+    *established_connection->add_received_payload() = std::move(payload);
+  }
   std::vector<ConnectionsLog::Payload> out_payloads =
       ResolvePendingPayloads(outgoing_payloads_, reason);
-  absl::c_move(out_payloads,
-               RepeatedFieldBackInserter(
-                   established_connection->mutable_sent_payload()));
+  for (ConnectionsLog::Payload &payload : out_payloads) {
+    if (!CanAddPayload(*established_connection)) {
+      break;
+    }
+    *established_connection->add_sent_payload() = std::move(payload);
+  }
 }
 
 std::vector<ConnectionsLog::Payload>
@@ -1686,7 +1832,8 @@ AnalyticsRecorder::LogicalConnection::ResolvePendingPayloads(
           {item.first,
            std::make_unique<PendingPayload>(
                pending_payload->type(), pending_payload->total_size_bytes(),
-               no_record_time_millis_, operation_result_code)});
+               no_record_time_millis_, pending_payload->chunk_counters(),
+               operation_result_code)});
     }
   }
   pending_payloads.clear();
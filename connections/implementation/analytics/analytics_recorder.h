@@ -15,6 +15,8 @@
 #ifndef ANALYTICS_ANALYTICS_RECORDER_H_
 #define ANALYTICS_ANALYTICS_RECORDER_H_
 
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -23,6 +25,8 @@
 
 #include "absl/base/thread_annotations.h"
 #include "absl/container/btree_map.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/functional/any_invocable.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
 #include "connections/implementation/analytics/advertising_metadata_params.h"
@@ -34,6 +38,7 @@
 #include "internal/platform/error_code_params.h"
 #include "internal/platform/implementation/system_clock.h"
 #include "internal/platform/mutex.h"
+#include "internal/platform/single_thread_executor.h"
 #include "internal/proto/analytics/connections_log.pb.h"
 #include "proto/connections_enums.pb.h"
 
@@ -42,6 +47,18 @@ namespace analytics {
 
 class AnalyticsRecorder {
  public:
+  // Bounds the analytics held in memory for one client session.
+  struct ClientSessionLimits {
+    // Once the recorded strategy sessions serialize to more than this many
+    // bytes, they are logged in a CLIENT_SESSION event of their own and
+    // dropped from memory. The rest of the session is logged as usual by
+    // LogSession().
+    std::size_t max_client_session_bytes = 256 * 1024;
+    // Payloads recorded per established connection. Later payloads on the
+    // connection are left out of the log.
+    int max_payloads_per_connection = 1000;
+  };
+
   explicit AnalyticsRecorder(::nearby::analytics::EventLogger *event_logger);
   // For testing only.
   AnalyticsRecorder(::nearby::analytics::EventLogger *event_logger,
@@ -225,6 +242,9 @@ class AnalyticsRecorder {
 
   bool IsSessionLogged();
 
+  void SetClientSessionLimits(const ClientSessionLimits &limits)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
   location::nearby::proto::connections::OperationResultCategory
   GetOperationResultCategory(
       location::nearby::proto::connections::OperationResultCode result_code);
@@ -234,29 +254,47 @@ class AnalyticsRecorder {
   void Sync();
 
  private:
+  // Chunk progress of a pending payload. Bumped for every chunk without
+  // taking mutex_, and folded into the payload's proto when the payload is
+  // done or moves to a new medium.
+  struct ChunkCounters {
+    std::atomic<std::int64_t> num_bytes_transferred = 0;
+    std::atomic<int> num_chunks = 0;
+  };
+
+  // The chunk counters of the pending payloads of one endpoint, by payload id.
+  struct EndpointChunkCounters {
+    absl::flat_hash_map<std::int64_t, std::shared_ptr<ChunkCounters>> incoming;
+    absl::flat_hash_map<std::int64_t, std::shared_ptr<ChunkCounters>> outgoing;
+  };
+  using ChunkCountersMap =
+      absl::flat_hash_map<std::string, EndpointChunkCounters>;
+
   // Tracks the chunks and duration of a Payload on a particular medium.
   class PendingPayload {
    public:
     PendingPayload(location::nearby::proto::connections::PayloadType type,
-                   std::int64_t total_size_bytes, bool no_record_time_millis)
+                   std::int64_t total_size_bytes, bool no_record_time_millis,
+                   std::shared_ptr<ChunkCounters> chunk_counters)
         : PendingPayload(type, total_size_bytes, no_record_time_millis,
+                         std::move(chunk_counters),
                          location::nearby::proto::connections::
                              OperationResultCode::DETAIL_UNKNOWN) {}
     PendingPayload(location::nearby::proto::connections::PayloadType type,
                    std::int64_t total_size_bytes, bool no_record_time_millis,
+                   std::shared_ptr<ChunkCounters> chunk_counters,
                    location::nearby::proto::connections::OperationResultCode
                        operation_result_code)
         : start_time_(SystemClock::ElapsedRealtime()),
           type_(type),
           total_size_bytes_(total_size_bytes),
-          num_bytes_transferred_(0),
-          num_chunks_(0),
+          chunk_counters_(std::move(chunk_counters)),
           operation_result_code_(operation_result_code),
           no_record_time_millis_(no_record_time_millis) {}
     ~PendingPayload() = default;
 
-    void AddChunk(std::int64_t chunk_size_bytes);
-
+    // Takes the chunks counted so far, so that the counters start over for
+    // the next medium if the payload moves.
     location::nearby::analytics::proto::ConnectionsLog::Payload GetProtoPayload(
         location::nearby::proto::connections::PayloadStatus status);
 
@@ -266,6 +304,10 @@ class AnalyticsRecorder {
 
     std::int64_t total_size_bytes() const { return total_size_bytes_; }
 
+    const std::shared_ptr<ChunkCounters> &chunk_counters() const {
+      return chunk_counters_;
+    }
+
     void SetOperationResultCode(
         location::nearby::proto::connections::OperationResultCode
             operation_result_code) {
@@ -276,8 +318,7 @@ class AnalyticsRecorder {
     absl::Time start_time_;
     location::nearby::proto::connections::PayloadType type_;
     std::int64_t total_size_bytes_;
-    std::int64_t num_bytes_transferred_;
-    int num_chunks_;
+    std::shared_ptr<ChunkCounters> chunk_counters_;
     location::nearby::proto::connections::OperationResultCode
         operation_result_code_ = location::nearby::proto::connections::
             OperationResultCode::DETAIL_UNKNOWN;
@@ -289,8 +330,10 @@ class AnalyticsRecorder {
    public:
     LogicalConnection(
         location::nearby::proto::connections::Medium initial_medium,
-        const std::string &connection_token, bool no_record_time_millis)
-        : no_record_time_millis_(no_record_time_millis) {
+        const std::string &connection_token, int max_payloads,
+        bool no_record_time_millis)
+        : max_payloads_(max_payloads),
+          no_record_time_millis_(no_record_time_millis) {
       PhysicalConnectionEstablished(initial_medium, connection_token);
     }
     LogicalConnection(const LogicalConnection &) = delete;
@@ -298,7 +341,8 @@ class AnalyticsRecorder {
         : current_medium_(std::move(other.current_medium_)),
           physical_connections_(std::move(other.physical_connections_)),
           incoming_payloads_(std::move(other.incoming_payloads_)),
-          outgoing_payloads_(std::move(other.outgoing_payloads_)) {}
+          outgoing_payloads_(std::move(other.outgoing_payloads_)),
+          max_payloads_(other.max_payloads_) {}
     LogicalConnection &operator=(const LogicalConnection &) = delete;
     LogicalConnection &&operator=(LogicalConnection &&) = delete;
     ~LogicalConnection() = default;
@@ -316,8 +360,8 @@ class AnalyticsRecorder {
     void IncomingPayloadStarted(
         std::int64_t payload_id,
         location::nearby::proto::connections::PayloadType type,
-        std::int64_t total_size_bytes);
-    void ChunkReceived(std::int64_t payload_id, std::int64_t size_bytes);
+        std::int64_t total_size_bytes,
+        std::shared_ptr<ChunkCounters> chunk_counters);
     void IncomingPayloadDone(
         std::int64_t payload_id,
         location::nearby::proto::connections::PayloadStatus status,
@@ -326,8 +370,8 @@ class AnalyticsRecorder {
     void OutgoingPayloadStarted(
         std::int64_t payload_id,
         location::nearby::proto::connections::PayloadType type,
-        std::int64_t total_size_bytes);
-    void ChunkSent(std::int64_t payload_id, std::int64_t size_bytes);
+        std::int64_t total_size_bytes,
+        std::shared_ptr<ChunkCounters> chunk_counters);
     void OutgoingPayloadDone(
         std::int64_t payload_id,
         location::nearby::proto::connections::PayloadStatus status,
@@ -339,6 +383,10 @@ class AnalyticsRecorder {
     GetEstablisedConnections();
 
    private:
+    // Whether another payload fits in the log of `established_connection`.
+    bool CanAddPayload(const location::nearby::analytics::proto::
+                           ConnectionsLog::EstablishedConnection
+                               &established_connection);
     void FinishPhysicalConnection(
         location::nearby::analytics::proto::ConnectionsLog::
             EstablishedConnection *established_connection,
@@ -364,6 +412,8 @@ class AnalyticsRecorder {
         incoming_payloads_;
     absl::btree_map<std::int64_t, std::unique_ptr<PendingPayload>>
         outgoing_payloads_;
+    int max_payloads_;
+    bool payloads_dropped_ = false;
     // For testing only.
     bool no_record_time_millis_ = false;
   };
@@ -376,6 +426,24 @@ class AnalyticsRecorder {
   void LogClientSessionLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   // Callbacks the ConnectionsLog proto byte array data to the EventLogger.
   void LogEvent(location::nearby::proto::connections::EventType event_type);
+  // Queues `connections_log` for the logging thread, which hands everything
+  // queued to the EventLogger in one go.
+  void LogConnectionsLog(
+      location::nearby::analytics::proto::ConnectionsLog connections_log);
+  void FlushPendingLogs() ABSL_LOCKS_EXCLUDED(pending_logs_mutex_);
+  // Logs the strategy sessions recorded so far on their own once they
+  // exceed ClientSessionLimits::max_client_session_bytes.
+  void EnforceClientSessionLimitLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Stops counting chunks for the pending payloads of `endpoint_id`.
+  void RemoveChunkCounters(const std::string &endpoint_id)
+      ABSL_LOCKS_EXCLUDED(chunk_counters_mutex_);
+  // Publishes a copy of the chunk counters map changed by `update`.
+  void UpdateChunkCounters(absl::AnyInvocable<void(ChunkCountersMap &)> update)
+      ABSL_LOCKS_EXCLUDED(chunk_counters_mutex_);
+  // Returns the counters of a pending payload, or nullptr if it isn't counted.
+  std::shared_ptr<ChunkCounters> FindChunkCounters(
+      const std::string &endpoint_id, std::int64_t payload_id,
+      bool incoming) const;
 
   void UpdateStrategySessionLocked(
       connections::Strategy strategy,
@@ -474,6 +542,7 @@ class AnalyticsRecorder {
   absl::Time started_client_session_time_;
   bool session_was_logged_ ABSL_GUARDED_BY(mutex_) = false;
   bool start_client_session_was_logged_ ABSL_GUARDED_BY(mutex_) = false;
+  ClientSessionLimits client_session_limits_ ABSL_GUARDED_BY(mutex_);
 
   // Current StrategySession
   connections::Strategy current_strategy_ ABSL_GUARDED_BY(mutex_) =
@@ -509,6 +578,31 @@ class AnalyticsRecorder {
                   std::unique_ptr<location::nearby::analytics::proto::
                                       ConnectionsLog::BandwidthUpgradeAttempt>>
       bandwidth_upgrade_attempts_ ABSL_GUARDED_BY(mutex_);
+
+  // The chunk counters are only added and removed as payloads start and end,
+  // by copying the map and publishing the copy, so that the calls made for
+  // every chunk read it without taking a mutex. chunk_counters_mutex_
+  // serializes the updates and is acquired after mutex_ when both are held.
+  Mutex chunk_counters_mutex_;
+  std::unique_ptr<const ChunkCountersMap> published_chunk_counters_
+      ABSL_GUARDED_BY(chunk_counters_mutex_) =
+          std::make_unique<const ChunkCountersMap>();
+  std::atomic<const ChunkCountersMap *> chunk_counters_{
+      published_chunk_counters_.get()};
+  // A replaced map is retired with the epoch it was replaced in. Readers count
+  // themselves under the parity of the epoch they started in, so once none is
+  // left under the previous epoch the maps retired before the current one can
+  // be freed and the epoch moves on. Updates never wait for readers.
+  std::atomic<std::uint64_t> chunk_counters_epoch_ = 0;
+  mutable std::atomic<int> chunk_counter_readers_[2] = {};
+  std::vector<std::pair<std::uint64_t, std::unique_ptr<const ChunkCountersMap>>>
+      retired_chunk_counters_ ABSL_GUARDED_BY(chunk_counters_mutex_);
+
+  Mutex pending_logs_mutex_;
+  std::vector<location::nearby::analytics::proto::ConnectionsLog> pending_logs_
+      ABSL_GUARDED_BY(pending_logs_mutex_);
+  // Calls the EventLogger, which might block on I/O, off the callers' threads.
+  SingleThreadExecutor log_executor_;
 };
 
 }  // namespace analytics
@@ -19,6 +19,7 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <thread>  // NOLINT
 #include <vector>
 
 #include "net/proto2/contrib/parse_proto/parse_text_proto.h"
@@ -98,6 +99,7 @@ class FakeEventLogger : public MockEventLogger {
     if (event_type == CLIENT_SESSION) {
       logged_client_session_count_++;
       logged_client_session_ = message.client_session();
+      logged_client_sessions_.push_back(message.client_session());
     }
     if (event_type == ERROR_CODE) {
       error_code_ = message.error_code();
@@ -119,6 +121,10 @@ class FakeEventLogger : public MockEventLogger {
     return logged_client_session_;
   }
 
+  const std::vector<ConnectionsLog::ClientSession>& GetLoggedClientSessions() {
+    return logged_client_sessions_;
+  }
+
   const ConnectionsLog::ErrorCode& GetErrorCode() { return error_code_; }
 
   std::vector<EventType> GetLoggedEventTypes() { return logged_event_types_; }
@@ -138,6 +144,7 @@ class FakeEventLogger : public MockEventLogger {
   CountDownLatch& client_session_done_latch_;
   CountDownLatch* start_client_session_done_latch_ptr_ = nullptr;
   ConnectionsLog::ClientSession logged_client_session_;
+  std::vector<ConnectionsLog::ClientSession> logged_client_sessions_;
   ConnectionsLog::ErrorCode error_code_;
   std::vector<EventType> logged_event_types_;
 };
@@ -1195,7 +1202,7 @@ TEST(AnalyticsRecorderTest, StartListeningForIncomingConnectionsWorks) {
   analytics_recorder.OnBandwidthUpgradeSuccess(endpoint_id_1);
 
   analytics_recorder.LogSession();
-  // ASSERT_TRUE(client_session_done_latch.Await(kDefaultTimeout).result());
+  analytics_recorder.Sync();
 
   ConnectionsLog::ClientSession strategy_session_proto =
       ParseTextProtoOrDie(R"pb(
@@ -2268,6 +2275,120 @@ TEST(AnalyticsRecorderOnConnectionClosedTest,
               EqualsProto(strategy_session_proto));
 }
 
+TEST(AnalyticsRecorderTest, CountsChunksFromConcurrentThreads) {
+  constexpr int kThreads = 4;
+  constexpr int kChunksPerThread = 1000;
+  std::string endpoint_id = "endpoint_id";
+  std::int64_t payload_id = 123456789;
+
+  CountDownLatch client_session_done_latch(1);
+  FakeEventLogger event_logger(client_session_done_latch);
+  AnalyticsRecorder analytics_recorder(&event_logger,
+                                       /*no_record_time_millis=*/true);
+
+  auto advertising_metadata_params =
+      analytics_recorder.BuildAdvertisingMetadataParams();
+  analytics_recorder.OnStartAdvertising(connections::Strategy::kP2pStar,
+                                        /*mediums=*/{BLUETOOTH},
+                                        advertising_metadata_params.get());
+  analytics_recorder.OnConnectionEstablished(endpoint_id, BLUETOOTH,
+                                             "connection_token");
+  analytics_recorder.OnOutgoingPayloadStarted(
+      {endpoint_id}, payload_id, connections::PayloadType::kStream, -1);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; ++i) {
+    threads.emplace_back([&]() {
+      for (int chunk = 0; chunk < kChunksPerThread; ++chunk) {
+        analytics_recorder.OnPayloadChunkSent(endpoint_id, payload_id, 10);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  analytics_recorder.OnOutgoingPayloadDone(endpoint_id, payload_id, SUCCESS,
+                                           OperationResultCode::DETAIL_SUCCESS);
+  analytics_recorder.LogSession();
+  ASSERT_TRUE(client_session_done_latch.Await(kDefaultTimeout).result());
+
+  const ConnectionsLog::Payload& payload = event_logger.GetLoggedClientSession()
+                                               .strategy_session(0)
+                                               .established_connection(0)
+                                               .sent_payload(0);
+  EXPECT_EQ(payload.num_chunks(), kThreads * kChunksPerThread);
+  EXPECT_EQ(payload.num_bytes_transferred(), kThreads * kChunksPerThread * 10);
+}
+
+TEST(AnalyticsRecorderTest, LogsClientSessionEarlyOverMemoryLimit) {
+  CountDownLatch client_session_done_latch(1);
+  FakeEventLogger event_logger(client_session_done_latch);
+  AnalyticsRecorder analytics_recorder(&event_logger,
+                                       /*no_record_time_millis=*/true);
+  analytics_recorder.SetClientSessionLimits({.max_client_session_bytes = 1});
+
+  auto advertising_metadata_params =
+      analytics_recorder.BuildAdvertisingMetadataParams();
+  analytics_recorder.OnStartAdvertising(connections::Strategy::kP2pStar,
+                                        /*mediums=*/{BLUETOOTH},
+                                        advertising_metadata_params.get());
+  analytics_recorder.OnStopAdvertising();
+  // Switching strategies finishes the P2P_STAR session, which goes over the
+  // limit and is logged right away.
+  analytics_recorder.OnStartAdvertising(connections::Strategy::kP2pCluster,
+                                        /*mediums=*/{BLUETOOTH},
+                                        advertising_metadata_params.get());
+  analytics_recorder.Sync();
+  ASSERT_EQ(event_logger.GetLoggedClientSessionCount(), 1);
+  EXPECT_EQ(event_logger.GetLoggedClientSession().strategy_session(0).strategy(),
+            ::location::nearby::proto::connections::P2P_STAR);
+  EXPECT_TRUE(event_logger.GetLoggedClientSession().partial());
+
+  analytics_recorder.LogSession();
+  ASSERT_TRUE(client_session_done_latch.Await(kDefaultTimeout).result());
+
+  // The session logged at the end only holds what came after.
+  ASSERT_EQ(event_logger.GetLoggedClientSessionCount(), 2);
+  const ConnectionsLog::ClientSession& last_session =
+      event_logger.GetLoggedClientSessions().back();
+  ASSERT_EQ(last_session.strategy_session_size(), 1);
+  EXPECT_EQ(last_session.strategy_session(0).strategy(),
+            ::location::nearby::proto::connections::P2P_CLUSTER);
+  EXPECT_FALSE(last_session.partial());
+}
+
+TEST(AnalyticsRecorderTest, CapsPayloadsPerConnection) {
+  std::string endpoint_id = "endpoint_id";
+
+  CountDownLatch client_session_done_latch(1);
+  FakeEventLogger event_logger(client_session_done_latch);
+  AnalyticsRecorder analytics_recorder(&event_logger,
+                                       /*no_record_time_millis=*/true);
+  analytics_recorder.SetClientSessionLimits({.max_payloads_per_connection = 2});
+
+  auto advertising_metadata_params =
+      analytics_recorder.BuildAdvertisingMetadataParams();
+  analytics_recorder.OnStartAdvertising(connections::Strategy::kP2pStar,
+                                        /*mediums=*/{BLUETOOTH},
+                                        advertising_metadata_params.get());
+  analytics_recorder.OnConnectionEstablished(endpoint_id, BLUETOOTH,
+                                             "connection_token");
+  for (std::int64_t payload_id = 1; payload_id <= 3; ++payload_id) {
+    analytics_recorder.OnOutgoingPayloadStarted(
+        {endpoint_id}, payload_id, connections::PayloadType::kBytes, 10);
+    analytics_recorder.OnPayloadChunkSent(endpoint_id, payload_id, 10);
+    analytics_recorder.OnOutgoingPayloadDone(
+        endpoint_id, payload_id, SUCCESS, OperationResultCode::DETAIL_SUCCESS);
+  }
+  analytics_recorder.LogSession();
+  ASSERT_TRUE(client_session_done_latch.Await(kDefaultTimeout).result());
+
+  EXPECT_EQ(event_logger.GetLoggedClientSession()
+                .strategy_session(0)
+                .established_connection(0)
+                .sent_payload_size(),
+            2);
+}
+
 }  // namespace
 }  // namespace analytics
 }  // namespace nearby
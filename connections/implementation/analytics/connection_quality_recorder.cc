@@ -0,0 +1,275 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/analytics/connection_quality_recorder.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "connections/connection_quality.h"
+#include "connections/implementation/analytics/packet_meta_data.h"
+#include "internal/platform/implementation/system_clock.h"
+#include "internal/platform/mutex_lock.h"
+#include "proto/connections_enums.pb.h"
+
+namespace nearby {
+namespace analytics {
+
+namespace {
+
+using ::location::nearby::proto::connections::Medium;
+using ::nearby::connections::ConnectionQuality;
+
+absl::Duration Elapsed(absl::Time start, absl::Time end) {
+  return end > start ? end - start : absl::ZeroDuration();
+}
+
+}  // namespace
+
+ConnectionQualityRecorder::OutgoingPayload::OutgoingPayload(
+    ConnectionQualityRecorder* recorder, std::vector<std::string> endpoint_ids)
+    : recorder_(recorder), endpoint_ids_(std::move(endpoint_ids)) {
+  recorder_->OnOutgoingPayloadsChanged(endpoint_ids_, 1);
+}
+
+ConnectionQualityRecorder::OutgoingPayload::OutgoingPayload(
+    OutgoingPayload&& other)
+    : recorder_(std::exchange(other.recorder_, nullptr)),
+      endpoint_ids_(std::move(other.endpoint_ids_)) {}
+
+ConnectionQualityRecorder::OutgoingPayload::~OutgoingPayload() {
+  if (recorder_ != nullptr) {
+    recorder_->OnOutgoingPayloadsChanged(endpoint_ids_, -1);
+  }
+}
+
+std::shared_ptr<ConnectionQualityRecorder::EndpointStats>
+ConnectionQualityRecorder::FindStats(const std::string& endpoint_id) const {
+  absl::ReaderMutexLock lock(&mutex_);
+  auto it = endpoints_.find(endpoint_id);
+  return it == endpoints_.end() ? nullptr : it->second;
+}
+
+std::shared_ptr<ConnectionQualityRecorder::EndpointStats>
+ConnectionQualityRecorder::FindOrAddStats(const std::string& endpoint_id) {
+  if (std::shared_ptr<EndpointStats> stats = FindStats(endpoint_id)) {
+    return stats;
+  }
+  absl::MutexLock lock(&mutex_);
+  std::shared_ptr<EndpointStats>& stats = endpoints_[endpoint_id];
+  if (stats == nullptr) {
+    stats = std::make_shared<EndpointStats>();
+  }
+  return stats;
+}
+
+void ConnectionQualityRecorder::RateWindow::Add(absl::Time now,
+                                                std::int64_t bytes) {
+  std::int64_t second = absl::ToUnixSeconds(now);
+  Bucket& bucket = buckets_[second % kThroughputWindowSeconds];
+  if (bucket.second != second) {
+    bucket.second = second;
+    bucket.bytes = 0;
+  }
+  bucket.bytes += bytes;
+}
+
+std::int64_t ConnectionQualityRecorder::RateWindow::BytesPerSecond(
+    absl::Time now) const {
+  std::int64_t second = absl::ToUnixSeconds(now);
+  std::int64_t total = 0;
+  for (const Bucket& bucket : buckets_) {
+    if (bucket.second > second - kThroughputWindowSeconds) {
+      total += bucket.bytes;
+    }
+  }
+  return total / kThroughputWindowSeconds;
+}
+
+void ConnectionQualityRecorder::OnFrameSent(
+    const std::string& endpoint_id, Medium medium,
+    const PacketMetaData& packet_meta_data) {
+  AddFrame(endpoint_id, medium, packet_meta_data, /*sent=*/true);
+}
+
+void ConnectionQualityRecorder::OnFrameReceived(
+    const std::string& endpoint_id, Medium medium,
+    const PacketMetaData& packet_meta_data) {
+  AddFrame(endpoint_id, medium, packet_meta_data, /*sent=*/false);
+}
+
+void ConnectionQualityRecorder::AddFrame(
+    const std::string& endpoint_id, Medium medium,
+    const PacketMetaData& packet_meta_data, bool sent) {
+  absl::Time now = SystemClock::ElapsedRealtime();
+  std::shared_ptr<EndpointStats> shared_stats = FindOrAddStats(endpoint_id);
+  EndpointStats& stats = *shared_stats;
+  MutexLock lock(&stats.mutex);
+  ConnectionQuality& quality = stats.quality;
+  quality.medium = medium;
+  if (sent) {
+    stats.send_rate.Add(now, packet_meta_data.packet_size);
+    quality.total_bytes_sent += packet_meta_data.packet_size;
+  } else {
+    stats.receive_rate.Add(now, packet_meta_data.packet_size);
+    quality.total_bytes_received += packet_meta_data.packet_size;
+  }
+  quality.socket_io_time += Elapsed(packet_meta_data.socket_io_start_time,
+                                    packet_meta_data.socket_io_end_time);
+  quality.encryption_time += Elapsed(packet_meta_data.encryption_start_time,
+                                     packet_meta_data.encryption_end_time);
+  quality.file_io_time += Elapsed(packet_meta_data.file_io_start_time,
+                                  packet_meta_data.file_io_end_time);
+}
+
+void ConnectionQualityRecorder::OnWriteFailed(const std::string& endpoint_id) {
+  std::shared_ptr<EndpointStats> stats = FindOrAddStats(endpoint_id);
+  MutexLock lock(&stats->mutex);
+  ++stats->quality.failed_writes;
+}
+
+void ConnectionQualityRecorder::OnPayloadChunkSent(
+    const std::string& endpoint_id, std::int64_t uncompressed_size,
+    std::int64_t compressed_size) {
+  std::shared_ptr<EndpointStats> stats = FindOrAddStats(endpoint_id);
+  MutexLock lock(&stats->mutex);
+  ConnectionQuality& quality = stats->quality;
+  quality.uncompressed_payload_bytes_sent += uncompressed_size;
+  quality.compressed_payload_bytes_sent += compressed_size;
+}
+
+void ConnectionQualityRecorder::OnPayloadChunkReceived(
+    const std::string& endpoint_id, std::int64_t uncompressed_size,
+    std::int64_t compressed_size) {
+  std::shared_ptr<EndpointStats> stats = FindOrAddStats(endpoint_id);
+  MutexLock lock(&stats->mutex);
+  ConnectionQuality& quality = stats->quality;
+  quality.uncompressed_payload_bytes_received += uncompressed_size;
+  quality.compressed_payload_bytes_received += compressed_size;
+}
+
+void ConnectionQualityRecorder::OnPayloadChunkSizeChosen(
+    const std::string& endpoint_id, int chunk_size, int max_chunk_size) {
+  std::shared_ptr<EndpointStats> stats = FindOrAddStats(endpoint_id);
+  MutexLock lock(&stats->mutex);
+  ConnectionQuality& quality = stats->quality;
+  quality.payload_chunk_size = chunk_size;
+  quality.max_payload_chunk_size = max_chunk_size;
+}
+
+void ConnectionQualityRecorder::OnKeepAliveSent(const std::string& endpoint_id,
+                                                std::uint32_t seq_num) {
+  absl::Time now = SystemClock::ElapsedRealtime();
+  std::shared_ptr<EndpointStats> stats = FindOrAddStats(endpoint_id);
+  MutexLock lock(&stats->mutex);
+  stats->keep_alive_seq_num = seq_num;
+  stats->keep_alive_sent_time = now;
+}
+
+void ConnectionQualityRecorder::OnKeepAliveAckReceived(
+    const std::string& endpoint_id, std::uint32_t seq_num) {
+  absl::Time now = SystemClock::ElapsedRealtime();
+  std::shared_ptr<EndpointStats> shared_stats = FindStats(endpoint_id);
+  if (shared_stats == nullptr) return;
+  EndpointStats& stats = *shared_stats;
+  MutexLock lock(&stats.mutex);
+  if (stats.keep_alive_seq_num != seq_num) return;
+  stats.keep_alive_seq_num.reset();
+  AddRttSample(stats, now - stats.keep_alive_sent_time);
+}
+
+void ConnectionQualityRecorder::OnPayloadAckExpected(
+    const std::string& endpoint_id, std::int64_t payload_id) {
+  absl::Time now = SystemClock::ElapsedRealtime();
+  std::shared_ptr<EndpointStats> stats = FindOrAddStats(endpoint_id);
+  MutexLock lock(&stats->mutex);
+  stats->payload_ack_sent_times[payload_id] = now;
+}
+
+void ConnectionQualityRecorder::OnPayloadAckReceived(
+    const std::string& endpoint_id, std::int64_t payload_id) {
+  absl::Time now = SystemClock::ElapsedRealtime();
+  std::shared_ptr<EndpointStats> shared_stats = FindStats(endpoint_id);
+  if (shared_stats == nullptr) return;
+  EndpointStats& stats = *shared_stats;
+  MutexLock lock(&stats.mutex);
+  auto sent = stats.payload_ack_sent_times.find(payload_id);
+  if (sent == stats.payload_ack_sent_times.end()) return;
+  absl::Duration rtt = now - sent->second;
+  stats.payload_ack_sent_times.erase(sent);
+  AddRttSample(stats, rtt);
+}
+
+// Smoothed the same way as TCP's SRTT (RFC 6298), with a gain of 1/8.
+void ConnectionQualityRecorder::AddRttSample(EndpointStats& stats,
+                                             absl::Duration rtt) {
+  ConnectionQuality& quality = stats.quality;
+  quality.latest_rtt = rtt;
+  if (quality.smoothed_rtt == absl::ZeroDuration()) {
+    quality.smoothed_rtt = rtt;
+    quality.min_rtt = rtt;
+    return;
+  }
+  quality.smoothed_rtt = (7 * quality.smoothed_rtt + rtt) / 8;
+  quality.min_rtt = std::min(quality.min_rtt, rtt);
+}
+
+ConnectionQualityRecorder::OutgoingPayload
+ConnectionQualityRecorder::TrackOutgoingPayload(
+    const std::vector<std::string>& endpoint_ids) {
+  return OutgoingPayload(this, endpoint_ids);
+}
+
+void ConnectionQualityRecorder::OnOutgoingPayloadsChanged(
+    const std::vector<std::string>& endpoint_ids, int delta) {
+  for (const std::string& endpoint_id : endpoint_ids) {
+    // Don't bring back an endpoint that was removed while its payloads were
+    // still queued.
+    std::shared_ptr<EndpointStats> stats =
+        delta < 0 ? FindStats(endpoint_id) : FindOrAddStats(endpoint_id);
+    if (stats == nullptr) continue;
+    MutexLock lock(&stats->mutex);
+    int& pending = stats->quality.pending_outgoing_payloads;
+    pending = std::max(0, pending + delta);
+  }
+}
+
+void ConnectionQualityRecorder::OnEndpointRemoved(
+    const std::string& endpoint_id) {
+  absl::MutexLock lock(&mutex_);
+  endpoints_.erase(endpoint_id);
+}
+
+std::optional<ConnectionQuality>
+ConnectionQualityRecorder::GetConnectionQuality(
+    const std::string& endpoint_id) const {
+  absl::Time now = SystemClock::ElapsedRealtime();
+  std::shared_ptr<EndpointStats> stats = FindStats(endpoint_id);
+  if (stats == nullptr) return std::nullopt;
+  MutexLock lock(&stats->mutex);
+  ConnectionQuality quality = stats->quality;
+  quality.send_bytes_per_second = stats->send_rate.BytesPerSecond(now);
+  quality.receive_bytes_per_second = stats->receive_rate.BytesPerSecond(now);
+  return quality;
+}
+
+}  // namespace analytics
+}  // namespace nearby
@@ -0,0 +1,169 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NEARBY_CONNECTIONS_IMPLEMENTATION_ANALYTICS_CONNECTION_QUALITY_RECORDER_H_
+#define NEARBY_CONNECTIONS_IMPLEMENTATION_ANALYTICS_CONNECTION_QUALITY_RECORDER_H_
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "connections/connection_quality.h"
+#include "connections/implementation/analytics/packet_meta_data.h"
+#include "internal/platform/mutex.h"
+#include "proto/connections_enums.pb.h"
+
+namespace nearby {
+namespace analytics {
+
+// Keeps rolling connection quality statistics for every connected endpoint,
+// fed from the EndpointManager read/write paths and the PayloadManager, and
+// read through Core::GetConnectionQuality().
+//
+// Every ClientProxy owns one, so the endpoints of different clients never mix.
+// Each endpoint's statistics have a lock of their own; the lock on the set of
+// endpoints is only taken exclusively to add or remove one.
+class ConnectionQualityRecorder {
+ public:
+  // Throughput is averaged over this many one second buckets.
+  static constexpr int kThroughputWindowSeconds = 5;
+
+  // Counts an outgoing payload towards the queue depth of its endpoints for
+  // as long as it is alive.
+  class OutgoingPayload {
+   public:
+    OutgoingPayload(ConnectionQualityRecorder* recorder,
+                    std::vector<std::string> endpoint_ids);
+    OutgoingPayload(OutgoingPayload&& other);
+    OutgoingPayload& operator=(OutgoingPayload&&) = delete;
+    ~OutgoingPayload();
+
+   private:
+    ConnectionQualityRecorder* recorder_;
+    std::vector<std::string> endpoint_ids_;
+  };
+
+  ConnectionQualityRecorder() = default;
+  ConnectionQualityRecorder(const ConnectionQualityRecorder&) = delete;
+  ConnectionQualityRecorder& operator=(const ConnectionQualityRecorder&) =
+      delete;
+
+  void OnFrameSent(const std::string& endpoint_id,
+                   location::nearby::proto::connections::Medium medium,
+                   const PacketMetaData& packet_meta_data)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+  void OnFrameReceived(const std::string& endpoint_id,
+                       location::nearby::proto::connections::Medium medium,
+                       const PacketMetaData& packet_meta_data)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+  void OnWriteFailed(const std::string& endpoint_id)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Payload chunk bodies, before and after compression.
+  void OnPayloadChunkSent(const std::string& endpoint_id,
+                          std::int64_t uncompressed_size,
+                          std::int64_t compressed_size)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+  void OnPayloadChunkReceived(const std::string& endpoint_id,
+                              std::int64_t uncompressed_size,
+                              std::int64_t compressed_size)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // The chunk size PayloadManager picked for the next chunk to `endpoint_id`.
+  void OnPayloadChunkSizeChosen(const std::string& endpoint_id, int chunk_size,
+                                int max_chunk_size) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // RTT probes. Only the most recent KEEP_ALIVE is tracked, since a new one
+  // isn't sent until the keep-alive interval has passed.
+  void OnKeepAliveSent(const std::string& endpoint_id, std::uint32_t seq_num)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+  void OnKeepAliveAckReceived(const std::string& endpoint_id,
+                              std::uint32_t seq_num)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+  void OnPayloadAckExpected(const std::string& endpoint_id,
+                            std::int64_t payload_id)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+  void OnPayloadAckReceived(const std::string& endpoint_id,
+                            std::int64_t payload_id)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  OutgoingPayload TrackOutgoingPayload(
+      const std::vector<std::string>& endpoint_ids);
+
+  // Drops everything recorded for `endpoint_id`.
+  void OnEndpointRemoved(const std::string& endpoint_id)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns std::nullopt if nothing has been recorded for `endpoint_id`.
+  std::optional<connections::ConnectionQuality> GetConnectionQuality(
+      const std::string& endpoint_id) const ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  // Bytes per second, bucketed by whole seconds of SystemClock time.
+  class RateWindow {
+   public:
+    void Add(absl::Time now, std::int64_t bytes);
+    std::int64_t BytesPerSecond(absl::Time now) const;
+
+   private:
+    struct Bucket {
+      std::int64_t second = -1;
+      std::int64_t bytes = 0;
+    };
+    std::array<Bucket, kThroughputWindowSeconds> buckets_;
+  };
+
+  struct EndpointStats {
+    mutable Mutex mutex;
+    connections::ConnectionQuality quality ABSL_GUARDED_BY(mutex);
+    RateWindow send_rate ABSL_GUARDED_BY(mutex);
+    RateWindow receive_rate ABSL_GUARDED_BY(mutex);
+    std::optional<std::uint32_t> keep_alive_seq_num ABSL_GUARDED_BY(mutex);
+    absl::Time keep_alive_sent_time ABSL_GUARDED_BY(mutex);
+    absl::flat_hash_map<std::int64_t, absl::Time> payload_ack_sent_times
+        ABSL_GUARDED_BY(mutex);
+  };
+
+  // Returns nullptr if nothing has been recorded for `endpoint_id`.
+  std::shared_ptr<EndpointStats> FindStats(const std::string& endpoint_id) const
+      ABSL_LOCKS_EXCLUDED(mutex_);
+  std::shared_ptr<EndpointStats> FindOrAddStats(const std::string& endpoint_id)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  void AddFrame(const std::string& endpoint_id,
+                location::nearby::proto::connections::Medium medium,
+                const PacketMetaData& packet_meta_data, bool sent)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+  static void AddRttSample(EndpointStats& stats, absl::Duration rtt)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(stats.mutex);
+  void OnOutgoingPayloadsChanged(const std::vector<std::string>& endpoint_ids,
+                                 int delta) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  mutable absl::Mutex mutex_;
+  // Shared with whoever is updating an endpoint while it's being removed.
+  absl::flat_hash_map<std::string, std::shared_ptr<EndpointStats>> endpoints_
+      ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace analytics
+}  // namespace nearby
+
+#endif  // NEARBY_CONNECTIONS_IMPLEMENTATION_ANALYTICS_CONNECTION_QUALITY_RECORDER_H_
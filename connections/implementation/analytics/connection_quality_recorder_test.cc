@@ -0,0 +1,200 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/analytics/connection_quality_recorder.h"
+
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "gtest/gtest.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "connections/connection_quality.h"
+#include "connections/implementation/analytics/packet_meta_data.h"
+#include "proto/connections_enums.pb.h"
+
+namespace nearby {
+namespace analytics {
+namespace {
+
+using ::location::nearby::proto::connections::Medium;
+using ::nearby::connections::ConnectionQuality;
+
+constexpr char kEndpointId[] = "ABCD";
+constexpr char kOtherEndpointId[] = "WXYZ";
+
+PacketMetaData MakePacketMetaData(int packet_size) {
+  PacketMetaData packet_meta_data;
+  absl::Time start = absl::UnixEpoch();
+  packet_meta_data.SetPacketSize(packet_size);
+  packet_meta_data.socket_io_start_time = start;
+  packet_meta_data.socket_io_end_time = start + absl::Milliseconds(3);
+  packet_meta_data.encryption_start_time = start;
+  packet_meta_data.encryption_end_time = start + absl::Milliseconds(2);
+  packet_meta_data.file_io_start_time = start;
+  packet_meta_data.file_io_end_time = start + absl::Milliseconds(1);
+  return packet_meta_data;
+}
+
+TEST(ConnectionQualityRecorderTest, UnknownEndpointHasNoQuality) {
+  ConnectionQualityRecorder recorder;
+
+  EXPECT_FALSE(recorder.GetConnectionQuality(kEndpointId).has_value());
+}
+
+TEST(ConnectionQualityRecorderTest, RecordsFrames) {
+  ConnectionQualityRecorder recorder;
+
+  recorder.OnFrameSent(kEndpointId, Medium::BLUETOOTH,
+                       MakePacketMetaData(1000));
+  recorder.OnFrameReceived(kEndpointId, Medium::WIFI_LAN,
+                           MakePacketMetaData(500));
+
+  std::optional<ConnectionQuality> quality =
+      recorder.GetConnectionQuality(kEndpointId);
+  ASSERT_TRUE(quality.has_value());
+  EXPECT_EQ(quality->medium, Medium::WIFI_LAN);
+  EXPECT_EQ(quality->total_bytes_sent, 1000);
+  EXPECT_EQ(quality->total_bytes_received, 500);
+  EXPECT_EQ(quality->send_bytes_per_second,
+            1000 / ConnectionQualityRecorder::kThroughputWindowSeconds);
+  EXPECT_EQ(quality->receive_bytes_per_second,
+            500 / ConnectionQualityRecorder::kThroughputWindowSeconds);
+  EXPECT_EQ(quality->socket_io_time, absl::Milliseconds(6));
+  EXPECT_EQ(quality->encryption_time, absl::Milliseconds(4));
+  EXPECT_EQ(quality->file_io_time, absl::Milliseconds(2));
+  EXPECT_FALSE(recorder.GetConnectionQuality(kOtherEndpointId).has_value());
+}
+
+TEST(ConnectionQualityRecorderTest, KeepAliveAckIsRttSample) {
+  ConnectionQualityRecorder recorder;
+
+  recorder.OnKeepAliveSent(kEndpointId, 7);
+  absl::SleepFor(absl::Milliseconds(10));
+  // An ack for an older KEEP_ALIVE is ignored.
+  recorder.OnKeepAliveAckReceived(kEndpointId, 6);
+  EXPECT_EQ(recorder.GetConnectionQuality(kEndpointId)->latest_rtt,
+            absl::ZeroDuration());
+  recorder.OnKeepAliveAckReceived(kEndpointId, 7);
+
+  std::optional<ConnectionQuality> quality =
+      recorder.GetConnectionQuality(kEndpointId);
+  ASSERT_TRUE(quality.has_value());
+  EXPECT_GE(quality->latest_rtt, absl::Milliseconds(10));
+  EXPECT_EQ(quality->smoothed_rtt, quality->latest_rtt);
+  EXPECT_EQ(quality->min_rtt, quality->latest_rtt);
+}
+
+TEST(ConnectionQualityRecorderTest, PayloadAckIsRttSample) {
+  ConnectionQualityRecorder recorder;
+
+  recorder.OnPayloadAckExpected(kEndpointId, 1);
+  recorder.OnPayloadAckReceived(kEndpointId, 1);
+  absl::Duration first_rtt =
+      recorder.GetConnectionQuality(kEndpointId)->latest_rtt;
+  recorder.OnPayloadAckExpected(kEndpointId, 2);
+  absl::SleepFor(absl::Milliseconds(16));
+  recorder.OnPayloadAckReceived(kEndpointId, 2);
+
+  std::optional<ConnectionQuality> quality =
+      recorder.GetConnectionQuality(kEndpointId);
+  ASSERT_TRUE(quality.has_value());
+  EXPECT_GE(quality->latest_rtt, absl::Milliseconds(16));
+  EXPECT_EQ(quality->min_rtt, first_rtt);
+  EXPECT_EQ(quality->smoothed_rtt, (7 * first_rtt + quality->latest_rtt) / 8);
+}
+
+TEST(ConnectionQualityRecorderTest, TracksPendingOutgoingPayloads) {
+  ConnectionQualityRecorder recorder;
+
+  {
+    ConnectionQualityRecorder::OutgoingPayload first =
+        recorder.TrackOutgoingPayload({kEndpointId, kOtherEndpointId});
+    ConnectionQualityRecorder::OutgoingPayload second =
+        recorder.TrackOutgoingPayload({kEndpointId});
+    ConnectionQualityRecorder::OutgoingPayload moved = std::move(second);
+    EXPECT_EQ(
+        recorder.GetConnectionQuality(kEndpointId)->pending_outgoing_payloads,
+        2);
+    EXPECT_EQ(recorder.GetConnectionQuality(kOtherEndpointId)
+                  ->pending_outgoing_payloads,
+              1);
+  }
+
+  EXPECT_EQ(
+      recorder.GetConnectionQuality(kEndpointId)->pending_outgoing_payloads, 0);
+}
+
+TEST(ConnectionQualityRecorderTest, CountsCompressedPayloadBytes) {
+  ConnectionQualityRecorder recorder;
+
+  recorder.OnPayloadChunkSent(kEndpointId, 1000, 200);
+  recorder.OnPayloadChunkSent(kEndpointId, 500, 500);
+  recorder.OnPayloadChunkReceived(kEndpointId, 800, 100);
+
+  std::optional<ConnectionQuality> quality =
+      recorder.GetConnectionQuality(kEndpointId);
+  ASSERT_TRUE(quality.has_value());
+  EXPECT_EQ(quality->uncompressed_payload_bytes_sent, 1500);
+  EXPECT_EQ(quality->compressed_payload_bytes_sent, 700);
+  EXPECT_EQ(quality->uncompressed_payload_bytes_received, 800);
+  EXPECT_EQ(quality->compressed_payload_bytes_received, 100);
+}
+
+TEST(ConnectionQualityRecorderTest, KeepsLatestChunkSize) {
+  ConnectionQualityRecorder recorder;
+
+  recorder.OnPayloadChunkSizeChosen(kEndpointId, 65536, 65536);
+  recorder.OnPayloadChunkSizeChosen(kEndpointId, 32768, 65536);
+
+  std::optional<ConnectionQuality> quality =
+      recorder.GetConnectionQuality(kEndpointId);
+  ASSERT_TRUE(quality.has_value());
+  EXPECT_EQ(quality->payload_chunk_size, 32768);
+  EXPECT_EQ(quality->max_payload_chunk_size, 65536);
+}
+
+TEST(ConnectionQualityRecorderTest, EndpointRemovalDropsStats) {
+  ConnectionQualityRecorder recorder;
+
+  {
+    ConnectionQualityRecorder::OutgoingPayload payload =
+        recorder.TrackOutgoingPayload({kEndpointId});
+    recorder.OnWriteFailed(kEndpointId);
+    EXPECT_EQ(recorder.GetConnectionQuality(kEndpointId)->failed_writes, 1);
+    recorder.OnEndpointRemoved(kEndpointId);
+  }
+
+  EXPECT_FALSE(recorder.GetConnectionQuality(kEndpointId).has_value());
+}
+
+TEST(ConnectionQualityRecorderTest, RecordersDontShareEndpoints) {
+  ConnectionQualityRecorder recorder;
+  ConnectionQualityRecorder other_recorder;
+
+  recorder.OnWriteFailed(kEndpointId);
+  other_recorder.OnWriteFailed(kEndpointId);
+  other_recorder.OnWriteFailed(kEndpointId);
+  other_recorder.OnEndpointRemoved(kOtherEndpointId);
+
+  EXPECT_EQ(recorder.GetConnectionQuality(kEndpointId)->failed_writes, 1);
+  EXPECT_EQ(other_recorder.GetConnectionQuality(kEndpointId)->failed_writes, 2);
+  other_recorder.OnEndpointRemoved(kEndpointId);
+  EXPECT_TRUE(recorder.GetConnectionQuality(kEndpointId).has_value());
+}
+
+}  // namespace
+}  // namespace analytics
+}  // namespace nearby
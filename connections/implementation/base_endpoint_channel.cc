@@ -19,12 +19,14 @@
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
+#include "connections/implementation/aes_gcm_record_layer.h"
 #include "connections/implementation/analytics/analytics_recorder.h"
 #include "connections/implementation/endpoint_channel_manager.h"
 #include "connections/implementation/flags/nearby_connections_feature_flags.h"
@@ -153,7 +155,19 @@ ExceptionOr<ByteArray> BaseEndpointChannel::Read(
   {
     MutexLock crypto_lock(&crypto_mutex_);
     Exception message_exception{Exception::kInvalidProtocolBuffer};
-    if (IsEncryptionEnabledLocked()) {
+    if (IsEncryptionEnabledLocked() && record_layer_ != nullptr &&
+        AesGcmRecordLayer::IsRecord(result.AsStringView())) {
+      // The remote has switched to the AES-GCM record layer.
+      packet_meta_data.StartEncryption();
+      std::optional<std::string> plaintext =
+          record_layer_->Open(result.AsStringView());
+      packet_meta_data.StopEncryption();
+      if (!plaintext.has_value()) {
+        NEARBY_LOGS(WARNING) << __func__ << ": Unable to open record.";
+        return ExceptionOr<ByteArray>(message_exception);
+      }
+      result = ByteArray(std::move(*plaintext));
+    } else if (IsEncryptionEnabledLocked()) {
       // If encryption is enabled, decode the message.
       std::string input(std::move(result));
       packet_meta_data.StartEncryption();
@@ -227,7 +241,19 @@ Exception BaseEndpointChannel::Write(const ByteArray& data,
     MutexLock lock(&writer_mutex_);
     {
       MutexLock crypto_lock(&crypto_mutex_);
-      if (IsEncryptionEnabledLocked()) {
+      if (IsEncryptionEnabledLocked() && record_layer_ != nullptr &&
+          record_layer_->AreWritesEnabled()) {
+        packet_meta_data.StartEncryption();
+        std::optional<std::string> record =
+            record_layer_->Seal(data.AsStringView());
+        packet_meta_data.StopEncryption();
+        if (!record.has_value()) {
+          NEARBY_LOGS(WARNING) << __func__ << ": Failed to seal record.";
+          return {Exception::kIo};
+        }
+        encrypted_data = ByteArray(std::move(*record));
+        data_to_write = &encrypted_data;
+      } else if (IsEncryptionEnabledLocked()) {
         // If encryption is enabled, encode the message.
         packet_meta_data.StartEncryption();
         std::unique_ptr<std::string> encrypted =
@@ -379,14 +405,27 @@ int BaseEndpointChannel::GetMaxTransmitPacketSize() const {
 }
 
 void BaseEndpointChannel::EnableEncryption(
-    std::shared_ptr<EncryptionContext> context) {
+    std::shared_ptr<EncryptionContext> context,
+    std::shared_ptr<AesGcmRecordLayer> record_layer) {
   MutexLock crypto_lock(&crypto_mutex_);
-  crypto_context_ = context;
+  crypto_context_ = std::move(context);
+  record_layer_ = std::move(record_layer);
 }
 
 void BaseEndpointChannel::DisableEncryption() {
   MutexLock crypto_lock(&crypto_mutex_);
   crypto_context_.reset();
+  record_layer_.reset();
+}
+
+void BaseEndpointChannel::EnableAesGcmRecordLayer() {
+  MutexLock crypto_lock(&crypto_mutex_);
+  if (!IsEncryptionEnabledLocked() || record_layer_ == nullptr) {
+    NEARBY_LOGS(INFO) << __func__ << ": AES-GCM record layer unavailable.";
+    return;
+  }
+  NEARBY_LOGS(INFO) << __func__ << ": Switching writes to AES-GCM records.";
+  record_layer_->EnableWrites();
 }
 
 bool BaseEndpointChannel::IsEncrypted() {
@@ -399,6 +438,15 @@ ExceptionOr<ByteArray> BaseEndpointChannel::TryDecrypt(const ByteArray& data) {
   if (!IsEncryptionEnabledLocked()) {
     return Exception::kFailed;
   }
+  if (record_layer_ != nullptr &&
+      AesGcmRecordLayer::IsRecord(data.AsStringView())) {
+    std::optional<std::string> plaintext =
+        record_layer_->Open(data.AsStringView());
+    if (plaintext.has_value()) {
+      return ExceptionOr<ByteArray>(ByteArray(std::move(*plaintext)));
+    }
+    return Exception::kExecution;
+  }
   std::unique_ptr<std::string> decrypted_data =
       crypto_context_->DecodeMessageFromPeer(data.string_data());
   if (decrypted_data) {
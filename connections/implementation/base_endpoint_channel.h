@@ -24,6 +24,7 @@
 #include "absl/time/time.h"
 #include "connections/implementation/analytics/analytics_recorder.h"
 #include "connections/implementation/analytics/packet_meta_data.h"
+#include "connections/implementation/aes_gcm_record_layer.h"
 #include "connections/implementation/endpoint_channel.h"
 #include "internal/platform/condition_variable.h"
 #include "internal/platform/byte_array.h"
@@ -75,8 +76,11 @@ class BaseEndpointChannel : public EndpointChannel {
   int GetFrequency() const override;
   int GetTryCount() const override;
   int GetMaxTransmitPacketSize() const override;
-  void EnableEncryption(std::shared_ptr<EncryptionContext> context) override;
+  void EnableEncryption(
+      std::shared_ptr<EncryptionContext> context,
+      std::shared_ptr<AesGcmRecordLayer> record_layer) override;
   void DisableEncryption() override;
+  void EnableAesGcmRecordLayer() ABSL_LOCKS_EXCLUDED(crypto_mutex_) override;
   bool IsEncrypted() override;
   ExceptionOr<ByteArray> TryDecrypt(const ByteArray& data) override;
   bool IsPaused() const ABSL_LOCKS_EXCLUDED(is_paused_mutex_) override;
@@ -142,6 +146,12 @@ class BaseEndpointChannel : public EndpointChannel {
   mutable Mutex crypto_mutex_;
   std::shared_ptr<EncryptionContext> crypto_context_
       ABSL_GUARDED_BY(crypto_mutex_) ABSL_PT_GUARDED_BY(crypto_mutex_);
+  // Set alongside `crypto_context_` when we support the AES-GCM record
+  // layer, so records from the remote can be opened as soon as it switches.
+  // Writes are sealed with it instead of `crypto_context_` once its writes
+  // are enabled. Shared with the endpoint's other channels. May be null.
+  std::shared_ptr<AesGcmRecordLayer> record_layer_
+      ABSL_GUARDED_BY(crypto_mutex_);
 
   mutable Mutex is_paused_mutex_;
   ConditionVariable is_paused_cond_{&is_paused_mutex_};
@@ -15,6 +15,7 @@
 #include "connections/implementation/base_endpoint_channel.h"
 
 #include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <string>
@@ -163,6 +164,17 @@ DoDhKeyExchange(BaseEndpointChannel* channel_a,
   return std::make_pair(std::move(context_a), std::move(context_b));
 }
 
+// Reads one length-prefixed frame straight off the wire.
+ByteArray ReadRawFrame(InputStream* input) {
+  ByteArray length_bytes = input->ReadExactly(sizeof(std::int32_t)).result();
+  const char* bytes = length_bytes.data();
+  std::int32_t length = (static_cast<std::int32_t>(bytes[0] & 0xFF) << 24) |
+                        (static_cast<std::int32_t>(bytes[1] & 0xFF) << 16) |
+                        (static_cast<std::int32_t>(bytes[2] & 0xFF) << 8) |
+                        static_cast<std::int32_t>(bytes[3] & 0xFF);
+  return input->ReadExactly(length).result();
+}
+
 TEST(BaseEndpointChannelTest, ConstructorDestructorWorks) {
   auto [input, output] = CreatePipe();
 
@@ -201,8 +213,8 @@ TEST(BaseEndpointChannelTest, TryDecrypt) {
   auto [context_a, context_b] = DoDhKeyExchange(&channel_a, &channel_b);
   ASSERT_NE(context_a, nullptr);
   ASSERT_NE(context_b, nullptr);
-  channel_a.EnableEncryption(context_a);
-  channel_b.EnableEncryption(context_b);
+  channel_a.EnableEncryption(context_a, /*record_layer=*/nullptr);
+  channel_b.EnableEncryption(context_b, /*record_layer=*/nullptr);
   std::unique_ptr<std::string> encrypted_message =
       channel_a.EncodeMessageForTests(kMessage);
 
@@ -221,7 +233,7 @@ TEST(BaseEndpointChannelTest, TryDecryptFailsWhenDecryptionFails) {
   TestEndpointChannel channel_b(pipe_a.first.get(), pipe_b.second.get());
   auto [context_a, context_b] = DoDhKeyExchange(&channel_a, &channel_b);
   ASSERT_NE(context_a, nullptr);
-  channel_a.EnableEncryption(context_a);
+  channel_a.EnableEncryption(context_a, /*record_layer=*/nullptr);
 
   ExceptionOr<ByteArray> result =
       channel_a.TryDecrypt(ByteArray("invalid message"));
@@ -319,8 +331,8 @@ TEST(BaseEndpointChannelTest, EncryptedReadWriteCanNotBeIntercepted) {
   auto [context_a, context_b] = DoDhKeyExchange(&channel_a, &channel_b);
   ASSERT_NE(context_a, nullptr);
   ASSERT_NE(context_b, nullptr);
-  channel_a.EnableEncryption(context_a);
-  channel_b.EnableEncryption(context_b);
+  channel_a.EnableEncryption(context_a, /*record_layer=*/nullptr);
+  channel_b.EnableEncryption(context_b, /*record_layer=*/nullptr);
 
   EXPECT_EQ(channel_a.GetType(), "ENCRYPTED_BLUETOOTH");
   EXPECT_EQ(channel_b.GetType(), "ENCRYPTED_BLUETOOTH");
@@ -432,7 +444,7 @@ TEST(BaseEndpointChannelTest, ReadUnencryptedFrameOnEncryptedChannel) {
   auto [context_a, context_b] = DoDhKeyExchange(&channel_a, &channel_b);
   ASSERT_NE(context_a, nullptr);
   ASSERT_NE(context_b, nullptr);
-  channel_b.EnableEncryption(context_b);
+  channel_b.EnableEncryption(context_b, /*record_layer=*/nullptr);
 
   EXPECT_EQ(channel_a.GetType(), "BLUETOOTH");
   EXPECT_EQ(channel_b.GetType(), "ENCRYPTED_BLUETOOTH");
@@ -456,6 +468,91 @@ TEST(BaseEndpointChannelTest, ReadUnencryptedFrameOnEncryptedChannel) {
   channel_b.Close(DisconnectionReason::REMOTE_DISCONNECTION);
 }
 
+TEST(BaseEndpointChannelTest, WritesAesGcmRecordsOnceEnabled) {
+  absl::string_view kMessage = "message";
+  auto pipe_a = CreatePipe();  // channel_a writes to pipe_a, reads from pipe_b.
+  auto pipe_b = CreatePipe();  // channel_b writes to pipe_b, reads from pipe_a.
+  TestEndpointChannel channel_a(pipe_b.first.get(), pipe_a.second.get());
+  TestEndpointChannel channel_b(pipe_a.first.get(), pipe_b.second.get());
+  auto [context_a, context_b] = DoDhKeyExchange(&channel_a, &channel_b);
+  ASSERT_NE(context_a, nullptr);
+  ASSERT_NE(context_b, nullptr);
+  channel_a.EnableEncryption(context_a, AesGcmRecordLayer::Create(*context_a));
+  channel_b.EnableEncryption(context_b, AesGcmRecordLayer::Create(*context_b));
+
+  // Before the switch, frames are still D2D messages.
+  channel_a.Write(ByteArray(std::string(kMessage)));
+  ByteArray d2d_frame = ReadRawFrame(pipe_a.first.get());
+  EXPECT_NE(d2d_frame.data()[0], '\0');
+  ExceptionOr<ByteArray> result = channel_b.TryDecrypt(d2d_frame);
+  ASSERT_TRUE(result.ok());
+  EXPECT_EQ(result.result().AsStringView(), kMessage);
+
+  channel_a.EnableAesGcmRecordLayer();
+  for (int i = 0; i < 3; ++i) {
+    channel_a.Write(ByteArray(std::string(kMessage)));
+    ByteArray record = ReadRawFrame(pipe_a.first.get());
+    EXPECT_EQ(record.data()[0], '\0');
+    result = channel_b.TryDecrypt(record);
+    ASSERT_TRUE(result.ok());
+    EXPECT_EQ(result.result().AsStringView(), kMessage);
+  }
+
+  // The other direction is unaffected until channel_b switches too.
+  ByteArray tx_message{"data message"};
+  channel_b.Write(tx_message);
+  result = channel_a.Read();
+  ASSERT_TRUE(result.ok());
+  EXPECT_EQ(result.result(), tx_message);
+}
+
+TEST(BaseEndpointChannelTest, TamperedAesGcmRecordIsRejected) {
+  absl::string_view kMessage = "message";
+  auto pipe_a = CreatePipe();  // channel_a writes to pipe_a, reads from pipe_b.
+  auto pipe_b = CreatePipe();  // channel_b writes to pipe_b, reads from pipe_a.
+  TestEndpointChannel channel_a(pipe_b.first.get(), pipe_a.second.get());
+  TestEndpointChannel channel_b(pipe_a.first.get(), pipe_b.second.get());
+  auto [context_a, context_b] = DoDhKeyExchange(&channel_a, &channel_b);
+  ASSERT_NE(context_a, nullptr);
+  ASSERT_NE(context_b, nullptr);
+  channel_a.EnableEncryption(context_a, AesGcmRecordLayer::Create(*context_a));
+  channel_b.EnableEncryption(context_b, AesGcmRecordLayer::Create(*context_b));
+  channel_a.EnableAesGcmRecordLayer();
+
+  channel_a.Write(ByteArray(std::string(kMessage)));
+  std::string record(ReadRawFrame(pipe_a.first.get()));
+  std::string tampered = record;
+  tampered.back() ^= 0x01;
+
+  ExceptionOr<ByteArray> result = channel_b.TryDecrypt(ByteArray(tampered));
+  EXPECT_FALSE(result.ok());
+  EXPECT_EQ(result.exception(), Exception::kExecution);
+
+  // A rejected record doesn't advance the sequence number.
+  result = channel_b.TryDecrypt(ByteArray(record));
+  ASSERT_TRUE(result.ok());
+  EXPECT_EQ(result.result().AsStringView(), kMessage);
+}
+
+TEST(BaseEndpointChannelTest, AesGcmRecordLayerNotUsedWithoutOne) {
+  auto pipe_a = CreatePipe();  // channel_a writes to pipe_a, reads from pipe_b.
+  auto pipe_b = CreatePipe();  // channel_b writes to pipe_b, reads from pipe_a.
+  TestEndpointChannel channel_a(pipe_b.first.get(), pipe_a.second.get());
+  TestEndpointChannel channel_b(pipe_a.first.get(), pipe_b.second.get());
+  auto [context_a, context_b] = DoDhKeyExchange(&channel_a, &channel_b);
+  ASSERT_NE(context_a, nullptr);
+  ASSERT_NE(context_b, nullptr);
+  channel_a.EnableEncryption(context_a, /*record_layer=*/nullptr);
+  channel_b.EnableEncryption(context_b, /*record_layer=*/nullptr);
+  channel_a.EnableAesGcmRecordLayer();
+
+  ByteArray tx_message{"data message"};
+  channel_a.Write(tx_message);
+  ExceptionOr<ByteArray> result = channel_b.Read();
+  ASSERT_TRUE(result.ok());
+  EXPECT_EQ(result.result(), tx_message);
+}
+
 }  // namespace
 }  // namespace connections
 }  // namespace nearby
@@ -68,6 +68,9 @@
 #include "internal/platform/bluetooth_utils.h"
 #include "internal/platform/byte_array.h"
 #include "internal/platform/cancelable_alarm.h"
+#include "internal/platform/cancellation_flag.h"
+#include "internal/platform/cancellation_flag_listener.h"
+#include "internal/platform/condition_variable.h"
 #include "internal/platform/connection_info.h"
 #include "internal/platform/count_down_latch.h"
 #include "internal/platform/exception.h"
@@ -120,6 +123,11 @@ BasePcpHandler::BasePcpHandler(Mediums* mediums,
     : mediums_(mediums),
       endpoint_manager_(endpoint_manager),
       channel_manager_(channel_manager),
+      alarm_executor_(FeatureFlags::GetInstance()
+                              .GetFlags()
+                              .enable_timing_wheel_alarms
+                          ? ScheduledExecutor::TimerBackend::kTimingWheel
+                          : ScheduledExecutor::TimerBackend::kPlatform),
       pcp_(pcp),
       bwu_manager_(bwu_manager) {}
 
@@ -138,6 +146,7 @@ void BasePcpHandler::Shutdown() {
                     << ") is bringing down executors.";
 
   encryption_runner_.Shutdown();
+  connection_race_executor_.Shutdown();
 
   // Stop discovery of Bluetooth Classic.
   mediums_->GetBluetoothClassic().StopAllDiscovery();
@@ -881,19 +890,12 @@ Status BasePcpHandler::RequestConnection(
         if (AppendWebRTCEndpoint(endpoint_id, client->GetDiscoveryOptions()))
           NEARBY_LOGS(INFO) << "Appended Web RTC endpoint.";
 
-        auto discovered_endpoints = GetDiscoveredEndpoints(endpoint_id);
+        ConnectImplResult connect_impl_result =
+            ConnectToDiscoveredEndpoints(client, endpoint_id,
+                                         connection_options);
         std::unique_ptr<EndpointChannel> channel;
-        ConnectImplResult connect_impl_result;
-
-        for (auto connect_endpoint : discovered_endpoints) {
-          if (!MediumSupportedByClientOptions(connect_endpoint->medium,
-                                              connection_options))
-            continue;
-          connect_impl_result = ConnectImpl(client, connect_endpoint);
-          if (connect_impl_result.status.Ok()) {
-            channel = std::move(connect_impl_result.endpoint_channel);
-            break;
-          }
+        if (connect_impl_result.status.Ok()) {
+          channel = std::move(connect_impl_result.endpoint_channel);
         }
 
         Medium channel_medium =
@@ -1023,24 +1025,12 @@ Status BasePcpHandler::RequestConnectionV3(
         if (AppendWebRTCEndpoint(endpoint_id, client->GetDiscoveryOptions()))
           NEARBY_LOGS(INFO) << "Appended Web RTC endpoint.";
 
-        auto discovered_endpoints = GetDiscoveredEndpoints(endpoint_id);
+        ConnectImplResult connect_impl_result =
+            ConnectToDiscoveredEndpoints(client, endpoint_id,
+                                         connection_options);
         std::unique_ptr<EndpointChannel> channel;
-        ConnectImplResult connect_impl_result;
-
-        for (auto connect_endpoint : discovered_endpoints) {
-          if (!MediumSupportedByClientOptions(connect_endpoint->medium,
-                                              connection_options))
-            continue;
-          NEARBY_LOGS(INFO)
-              << "Try to connect with endpoint(id=" << endpoint_id
-              << ") by Medium: "
-              << location::nearby::proto::connections::Medium_Name(
-                     connect_endpoint->medium);
-          connect_impl_result = ConnectImpl(client, connect_endpoint);
-          if (connect_impl_result.status.Ok()) {
-            channel = std::move(connect_impl_result.endpoint_channel);
-            break;
-          }
+        if (connect_impl_result.status.Ok()) {
+          channel = std::move(connect_impl_result.endpoint_channel);
         }
 
         Medium channel_medium =
@@ -1132,6 +1122,157 @@ Status BasePcpHandler::RequestConnectionV3(
   return status;
 }
 
+struct BasePcpHandler::ConnectionRace {
+  Mutex mutex;
+  ConditionVariable cond{&mutex};
+  int in_flight ABSL_GUARDED_BY(mutex) = 0;
+  bool has_winner ABSL_GUARDED_BY(mutex) = false;
+  // The winner, or the most recent failure while there isn't one.
+  ConnectImplResult result ABSL_GUARDED_BY(mutex);
+  // One per attempt started, cancelled once there's a winner.
+  std::vector<std::shared_ptr<CancellationFlag>> cancellation_flags
+      ABSL_GUARDED_BY(mutex);
+};
+
+BasePcpHandler::ConnectImplResult BasePcpHandler::ConnectToDiscoveredEndpoints(
+    ClientProxy* client, const std::string& endpoint_id,
+    const ConnectionOptions& connection_options) {
+  std::vector<std::shared_ptr<DiscoveredEndpoint>> candidates;
+  for (auto& endpoint : GetSharedDiscoveredEndpoints(endpoint_id)) {
+    if (MediumSupportedByClientOptions(endpoint->medium, connection_options)) {
+      candidates.push_back(std::move(endpoint));
+    }
+  }
+  ConnectImplResult result;
+  if (candidates.size() > 1 &&
+      FeatureFlags::GetInstance().GetFlags().enable_connection_racing) {
+    result = RaceConnections(client, endpoint_id, candidates);
+  } else {
+    result = ConnectSerially(client, candidates);
+  }
+  if (result.status.Ok() && !result.bluetooth_mac_address.empty()) {
+    client->SetBluetoothMacAddress(endpoint_id, result.bluetooth_mac_address);
+  }
+  return result;
+}
+
+BasePcpHandler::ConnectImplResult BasePcpHandler::ConnectSerially(
+    ClientProxy* client,
+    const std::vector<std::shared_ptr<DiscoveredEndpoint>>& candidates) {
+  ConnectImplResult connect_impl_result;
+  for (const auto& connect_endpoint : candidates) {
+    NEARBY_LOGS(INFO) << "Try to connect with endpoint(id="
+                      << connect_endpoint->endpoint_id << ") by Medium: "
+                      << location::nearby::proto::connections::Medium_Name(
+                             connect_endpoint->medium);
+    connect_impl_result =
+        ConnectImpl(client, connect_endpoint.get(),
+                    client->GetCancellationFlag(connect_endpoint->endpoint_id));
+    if (connect_impl_result.status.Ok()) {
+      break;
+    }
+  }
+  return connect_impl_result;
+}
+
+BasePcpHandler::ConnectImplResult BasePcpHandler::RaceConnections(
+    ClientProxy* client, const std::string& endpoint_id,
+    const std::vector<std::shared_ptr<DiscoveredEndpoint>>& candidates) {
+  absl::Duration stagger_delay =
+      FeatureFlags::GetInstance().GetFlags().connection_racing_stagger_delay;
+  auto race = std::make_shared<ConnectionRace>();
+  MutexLock lock(&race->mutex);
+  for (const auto& candidate : candidates) {
+    if (race->has_winner) break;
+    NEARBY_LOGS(INFO) << "Racing to connect with endpoint(id=" << endpoint_id
+                      << ") by Medium: "
+                      << location::nearby::proto::connections::Medium_Name(
+                             candidate->medium);
+    ++race->in_flight;
+    auto cancellation_flag = std::make_shared<CancellationFlag>();
+    race->cancellation_flags.push_back(cancellation_flag);
+    // The attempt holds on to `candidate`, since it may still be running when
+    // the endpoint is lost. ConnectImpl() is safe to call off the PCP handler
+    // thread because the mediums synchronize their own state.
+    connection_race_executor_.Execute(
+        "connection-race",
+        [this, client, endpoint_id, race, candidate,
+         cancellation_flag]() ABSL_NO_THREAD_SAFETY_ANALYSIS {
+          absl::Time start_time = SystemClock::ElapsedRealtime();
+          ConnectImplResult result;
+          {
+            // The client cancelling the connection cancels every attempt.
+            CancellationFlag* client_cancellation_flag =
+                client->GetCancellationFlag(endpoint_id);
+            CancellationFlagListener client_cancellation_listener(
+                client_cancellation_flag,
+                [cancellation_flag]() { cancellation_flag->Cancel(); });
+            if (client_cancellation_flag->Cancelled()) {
+              cancellation_flag->Cancel();
+            }
+            result = ConnectImpl(client, candidate.get(),
+                                 cancellation_flag.get());
+          }
+          bool connected =
+              result.status.Ok() && result.endpoint_channel != nullptr;
+          bool lost = false;
+          std::vector<std::shared_ptr<CancellationFlag>> cancelled_attempts;
+          {
+            MutexLock lock(&race->mutex);
+            --race->in_flight;
+            lost = race->has_winner;
+            if (!lost) {
+              race->has_winner = connected;
+              race->result = std::move(result);
+              if (connected) cancelled_attempts.swap(race->cancellation_flags);
+              race->cond.Notify();
+            }
+          }
+          // Cancelling runs the mediums' cancel listeners, so it's done
+          // without holding the race's lock.
+          for (const auto& attempt : cancelled_attempts) {
+            if (attempt != cancellation_flag) attempt->Cancel();
+          }
+          if (!lost) return;
+          if (connected) {
+            NEARBY_LOGS(INFO)
+                << "Closing channel to endpoint(id=" << endpoint_id
+                << ") over Medium: "
+                << location::nearby::proto::connections::Medium_Name(
+                       candidate->medium)
+                << ", another medium connected first.";
+            result.endpoint_channel->Close();
+          }
+          client->GetAnalyticsRecorder().OnOutgoingConnectionAttempt(
+              endpoint_id, location::nearby::proto::connections::INITIAL,
+              candidate->medium,
+              location::nearby::proto::connections::RESULT_CANCELLED,
+              SystemClock::ElapsedRealtime() - start_time,
+              /*connection_token=*/"",
+              /*connection_attempt_metadata_params=*/nullptr);
+        });
+
+    // Give the attempts in flight a head start before trying the next medium,
+    // unless they have all failed already.
+    absl::Time deadline = SystemClock::ElapsedRealtime() + stagger_delay;
+    while (!race->has_winner && race->in_flight > 0) {
+      absl::Duration remaining = deadline - SystemClock::ElapsedRealtime();
+      if (remaining <= absl::ZeroDuration()) break;
+      race->cond.Wait(remaining);
+    }
+  }
+  while (!race->has_winner && race->in_flight > 0) {
+    race->cond.Wait();
+  }
+  if (race->has_winner) {
+    NEARBY_LOGS(INFO) << "Won the connection race to endpoint(id="
+                      << endpoint_id << ") with Medium: "
+                      << location::nearby::proto::connections::Medium_Name(
+                             race->result.endpoint_channel->GetMedium());
+  }
+  return std::move(race->result);
+}
+
 bool BasePcpHandler::MediumSupportedByClientOptions(
     const location::nearby::proto::connections::Medium& medium,
     const ConnectionOptions& connection_options) const {
@@ -1256,13 +1397,23 @@ BasePcpHandler::DiscoveredEndpoint* BasePcpHandler::GetDiscoveredEndpoint(
 std::vector<BasePcpHandler::DiscoveredEndpoint*>
 BasePcpHandler::GetDiscoveredEndpoints(const std::string& endpoint_id) {
   std::vector<BasePcpHandler::DiscoveredEndpoint*> result;
+  for (const auto& endpoint : GetSharedDiscoveredEndpoints(endpoint_id)) {
+    result.push_back(endpoint.get());
+  }
+  return result;
+}
+
+std::vector<std::shared_ptr<BasePcpHandler::DiscoveredEndpoint>>
+BasePcpHandler::GetSharedDiscoveredEndpoints(const std::string& endpoint_id) {
+  std::vector<std::shared_ptr<BasePcpHandler::DiscoveredEndpoint>> result;
   MutexLock lock(&discovered_endpoint_mutex_);
   auto it = discovered_endpoints_.equal_range(endpoint_id);
   for (auto item = it.first; item != it.second; item++) {
-    result.push_back(item->second.get());
+    result.push_back(item->second);
   }
   std::sort(result.begin(), result.end(),
-            [this](DiscoveredEndpoint* a, DiscoveredEndpoint* b) -> bool {
+            [this](const std::shared_ptr<DiscoveredEndpoint>& a,
+                   const std::shared_ptr<DiscoveredEndpoint>& b) -> bool {
               return IsPreferred(*a, *b);
             });
 
@@ -1478,7 +1629,8 @@ Status BasePcpHandler::AcceptConnection(ClientProxy* client,
         Exception write_exception =
             channel->Write(parser::ForConnectionResponse(
                 Status::kSuccess, client->GetLocalOsInfo(),
-                client->GetLocalMultiplexSocketBitmask()));
+                client->GetLocalMultiplexSocketBitmask(),
+                client->GetLocalCapabilityBitmask()));
         if (!write_exception.Ok()) {
           NEARBY_LOGS(INFO)
               << "AcceptConnection: failed to send response: endpoint_id="
@@ -1541,7 +1693,8 @@ Status BasePcpHandler::RejectConnection(ClientProxy* client,
         Exception write_exception =
             channel->Write(parser::ForConnectionResponse(
                 Status::kConnectionRejected, client->GetLocalOsInfo(),
-                client->GetLocalMultiplexSocketBitmask()));
+                client->GetLocalMultiplexSocketBitmask(),
+                client->GetLocalCapabilityBitmask()));
         if (!write_exception.Ok()) {
           NEARBY_LOGS(INFO)
               << "RejectConnection: failed to send response: endpoint_id="
@@ -1625,6 +1778,17 @@ void BasePcpHandler::OnIncomingFrame(
           client->SetRemoteSafeToDisconnectVersion(
               endpoint_id, connection_response.safe_to_disconnect_version());
         }
+        if (connection_response.has_capability_bitmask()) {
+          client->SetRemoteCapabilityBitmask(
+              endpoint_id, connection_response.capability_bitmask());
+        }
+        if (accepted && client->IsAesGcmRecordLayerEnabled(endpoint_id)) {
+          std::shared_ptr<EndpointChannel> channel =
+              channel_manager_->GetChannelForEndpoint(endpoint_id);
+          if (channel != nullptr) {
+            channel->EnableAesGcmRecordLayer();
+          }
+        }
         channel_manager_->UpdateSafeToDisconnectForEndpoint(
             endpoint_id, client->IsSafeToDisconnectEnabled(endpoint_id));
         EvaluateConnectionResult(client, endpoint_id,
@@ -59,10 +59,12 @@
 #include "internal/platform/bluetooth_adapter.h"
 #include "internal/platform/byte_array.h"
 #include "internal/platform/cancelable_alarm.h"
+#include "internal/platform/cancellation_flag.h"
 #include "internal/platform/connection_info.h"
 #include "internal/platform/count_down_latch.h"
 #include "internal/platform/exception.h"
 #include "internal/platform/future.h"
+#include "internal/platform/multi_thread_executor.h"
 #include "internal/platform/mutex.h"
 #include "internal/platform/nsd_service_info.h"
 #include "internal/platform/runnable.h"
@@ -283,6 +285,9 @@ class BasePcpHandler : public PcpHandler,
         operation_result_code = location::nearby::proto::connections::
             OperationResultCode::DETAIL_UNKNOWN;
     std::unique_ptr<EndpointChannel> endpoint_channel;
+    // The remote device's Bluetooth MAC address, if connecting taught us. It's
+    // only saved to the client for the channel that's kept.
+    std::string bluetooth_mac_address;
   };
 
   void Shutdown();
@@ -347,8 +352,11 @@ class BasePcpHandler : public PcpHandler,
                                     const OutOfBandConnectionMetadata& metadata)
       RUN_ON_PCP_HANDLER_THREAD() = 0;
 
+  // Gives up as soon as `cancellation_flag` is cancelled, which happens when
+  // the client cancels the connection or another medium wins the race to it.
   virtual ConnectImplResult ConnectImpl(ClientProxy* client,
-                                        DiscoveredEndpoint* endpoint)
+                                        DiscoveredEndpoint* endpoint,
+                                        CancellationFlag* cancellation_flag)
       RUN_ON_PCP_HANDLER_THREAD() = 0;
 
   virtual StartOperationResult UpdateAdvertisingOptionsImpl(
@@ -389,6 +397,12 @@ class BasePcpHandler : public PcpHandler,
       const std::string& endpoint_id)
       ABSL_LOCKS_EXCLUDED(discovered_endpoint_mutex_);
 
+  // Same as above, but shares ownership of the endpoints so they outlive a
+  // connection attempt that is still running after they were removed.
+  std::vector<std::shared_ptr<BasePcpHandler::DiscoveredEndpoint>>
+  GetSharedDiscoveredEndpoints(const std::string& endpoint_id)
+      ABSL_LOCKS_EXCLUDED(discovered_endpoint_mutex_);
+
   // Returns a vector of discovered endpoints that share a given Medium.
   std::vector<BasePcpHandler::DiscoveredEndpoint*> GetDiscoveredEndpoints(
       location::nearby::proto::connections::Medium medium)
@@ -629,6 +643,29 @@ class BasePcpHandler : public PcpHandler,
   // endpoint id. This is done by CancellationFlag.
   static bool Cancelled(ClientProxy* client, const std::string& endpoint_id);
 
+  struct ConnectionRace;
+
+  // Connects to the discovered endpoints of `endpoint_id` that are allowed by
+  // `connection_options`, in order of decreasing preference, and returns the
+  // first channel to connect, or the last failure.
+  ConnectImplResult ConnectToDiscoveredEndpoints(
+      ClientProxy* client, const std::string& endpoint_id,
+      const ConnectionOptions& connection_options) RUN_ON_PCP_HANDLER_THREAD();
+
+  // Tries the candidates one after another.
+  ConnectImplResult ConnectSerially(
+      ClientProxy* client,
+      const std::vector<std::shared_ptr<DiscoveredEndpoint>>& candidates)
+      RUN_ON_PCP_HANDLER_THREAD();
+
+  // Starts the next candidate whenever the ones in flight haven't connected
+  // within the racing stagger delay. Once one connects, the others are
+  // cancelled, and those that connect anyway have their channel closed.
+  ConnectImplResult RaceConnections(
+      ClientProxy* client, const std::string& endpoint_id,
+      const std::vector<std::shared_ptr<DiscoveredEndpoint>>& candidates)
+      RUN_ON_PCP_HANDLER_THREAD();
+
   void WaitForLatch(const std::string& method_name, CountDownLatch* latch);
   Status WaitForResult(const std::string& method_name, std::int64_t client_id,
                        Future<Status>* future);
@@ -669,9 +706,14 @@ class BasePcpHandler : public PcpHandler,
   void OptionsAllowed(const BooleanMediumSelector& allowed,
                       std::ostringstream& result) const;
 
+  // The most connection attempts to run at once when racing mediums.
+  static constexpr int kMaxConcurrentConnectionAttempts = 3;
+
   AtomicBoolean closed_{false};
   ScheduledExecutor alarm_executor_;
   SingleThreadExecutor serial_executor_;
+  MultiThreadExecutor connection_race_executor_{
+      kMaxConcurrentConnectionAttempts};
   Mutex discovered_endpoint_mutex_;
 
   // A map of endpoint id -> PendingConnectionInfo. Entries in this map imply
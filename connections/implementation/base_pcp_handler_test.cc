@@ -58,6 +58,9 @@
 #include "internal/interop/device.h"
 #include "internal/interop/device_provider.h"
 #include "internal/platform/byte_array.h"
+#include "internal/platform/cancellation_flag.h"
+#include "internal/platform/cancellation_flag_listener.h"
+#include "internal/platform/count_down_latch.h"
 #include "internal/platform/exception.h"
 #include "internal/platform/feature_flags.h"
 #include "internal/platform/future.h"
@@ -236,7 +239,9 @@ class MockPcpHandler : public BasePcpHandler {
                const OutOfBandConnectionMetadata& metadata),
               (override));
   MOCK_METHOD(ConnectImplResult, ConnectImpl,
-              (ClientProxy * client, DiscoveredEndpoint* endpoint), (override));
+              (ClientProxy * client, DiscoveredEndpoint* endpoint,
+               CancellationFlag* cancellation_flag),
+              (override));
   MOCK_METHOD(location::nearby::proto::connections::Medium,
               GetDefaultUpgradeMedium, (), (override));
   MOCK_METHOD(StartOperationResult, UpdateAdvertisingOptionsImpl,
@@ -648,7 +653,8 @@ class BasePcpHandlerTest
     EXPECT_CALL(*pcp_handler, ConnectImpl)
         .WillOnce(Invoke([&channel_a, connect_medium](
                              ClientProxy* client,
-                             MockPcpHandler::DiscoveredEndpoint* endpoint) {
+                             MockPcpHandler::DiscoveredEndpoint* endpoint,
+                             CancellationFlag* cancellation_flag) {
           return MockPcpHandler::ConnectImplResult{
               .medium = connect_medium,
               .status = {Status::kSuccess},
@@ -729,7 +735,8 @@ class BasePcpHandlerTest
         .WillRepeatedly(
             Invoke([&channel_a, connect_medium](
                        ClientProxy* client,
-                       MockPcpHandler::DiscoveredEndpoint* endpoint) {
+                       MockPcpHandler::DiscoveredEndpoint* endpoint,
+                       CancellationFlag* cancellation_flag) {
               return MockPcpHandler::ConnectImplResult{
                   .medium = connect_medium,
                   .status = {Status::kSuccess},
@@ -797,7 +804,8 @@ class BasePcpHandlerTest
     EXPECT_CALL(*pcp_handler, ConnectImpl)
         .WillRepeatedly(
             Invoke([&channel_a](ClientProxy* client,
-                                MockPcpHandler::DiscoveredEndpoint* endpoint) {
+                                MockPcpHandler::DiscoveredEndpoint* endpoint,
+                                CancellationFlag* cancellation_flag) {
               if (endpoint->medium ==
                   location::nearby::proto::connections::WIFI_LAN) {
                 NEARBY_LOGS(INFO) << "Connect with Medium WIFI_LAN failed.";
@@ -1133,6 +1141,238 @@ TEST_F(BasePcpHandlerTest, WifiMediumFailFallBackToBT) {
   env_.Stop();
 }
 
+TEST_F(BasePcpHandlerTest, ConnectionRacingKeepsFirstMediumToConnect) {
+  FeatureFlags::Flags flags = FeatureFlags::GetInstance().GetFlags();
+  flags.enable_connection_racing = true;
+  flags.connection_racing_stagger_delay = absl::Milliseconds(10);
+  FeatureFlags::ScopedFlagsForTesting scoped_flags(flags);
+  env_.Start();
+  std::string service_id{"service"};
+  std::string endpoint_id{"ABCD"};
+  ClientProxy client;
+  Mediums m;
+  EndpointChannelManager ecm;
+  EndpointManager em(&ecm);
+  BwuManager bwu(m, em, ecm, {}, {});
+  MockPcpHandler pcp_handler(&m, &em, &ecm, &bwu);
+  BooleanMediumSelector allowed{
+      .bluetooth = true,
+      .wifi_lan = true,
+  };
+  DiscoveryOptions discovery_options{
+      {
+          Strategy::kP2pCluster,
+          allowed,
+      },
+      false,  // auto_upgrade_bandwidth;
+      false,  // enforce_topology_constraints;
+  };
+  EXPECT_CALL(pcp_handler, StartDiscoveryImpl(&client, service_id, _))
+      .WillOnce(Return(MockPcpHandler::StartOperationResult{
+          .status = {Status::kSuccess},
+          .mediums = allowed.GetMediums(true),
+      }));
+  EXPECT_EQ(pcp_handler.StartDiscovery(&client, service_id, discovery_options,
+                                       GetDiscoveryListener()),
+            Status{Status::kSuccess});
+
+  auto channel_pair = SetupConnection(Medium::BLUETOOTH);
+  auto& channel_a = channel_pair.first;
+  auto& channel_b = channel_pair.second;
+  EXPECT_CALL(*channel_a, CloseImpl).Times(1);
+  EXPECT_CALL(*channel_b, CloseImpl).Times(1);
+  // WIFI_LAN is preferred, but stalls until Bluetooth has won the race.
+  auto [input, output] = CreatePipe();
+  auto wifi_lan_channel = std::make_unique<MockEndpointChannel>(
+      std::move(input), std::move(output));
+  CountDownLatch bluetooth_won(1);
+  CountDownLatch wifi_lan_closed(1);
+  EXPECT_CALL(*wifi_lan_channel, CloseImpl).WillOnce(Invoke([&]() {
+    wifi_lan_closed.CountDown();
+  }));
+  ConnectionRequestInfo info{
+      .endpoint_info = ByteArray{"ABCD"},
+      .listener = connection_listener_,
+  };
+  ConnectionOptions connection_options{
+      .keep_alive_interval_millis =
+          FeatureFlags::GetInstance().GetFlags().keep_alive_interval_millis,
+      .keep_alive_timeout_millis =
+          FeatureFlags::GetInstance().GetFlags().keep_alive_timeout_millis,
+  };
+  EXPECT_CALL(mock_discovery_listener_.endpoint_found_cb, Call);
+  EXPECT_CALL(pcp_handler, CanSendOutgoingConnection)
+      .WillRepeatedly(Return(true));
+  EXPECT_CALL(pcp_handler, GetStrategy)
+      .WillRepeatedly(Return(Strategy::kP2pCluster));
+  EXPECT_CALL(mock_connection_listener_.initiated_cb, Call).Times(1);
+  EXPECT_CALL(mock_connection_listener_.rejected_cb, Call).Times(AtLeast(0));
+  EXPECT_CALL(pcp_handler, ConnectImpl)
+      .WillRepeatedly(Invoke([&](ClientProxy* client,
+                                 MockPcpHandler::DiscoveredEndpoint* endpoint,
+                                 CancellationFlag* cancellation_flag) {
+        if (endpoint->medium == Medium::WIFI_LAN) {
+          bluetooth_won.Await();
+          return MockPcpHandler::ConnectImplResult{
+              .medium = Medium::WIFI_LAN,
+              .status = {Status::kSuccess},
+              .endpoint_channel = std::move(wifi_lan_channel),
+          };
+        }
+        return MockPcpHandler::ConnectImplResult{
+            .medium = endpoint->medium,
+            .status = {Status::kSuccess},
+            .endpoint_channel = std::move(channel_a),
+        };
+      }));
+  for (const auto& discovered_medium : allowed.GetMediums(true)) {
+    pcp_handler.OnEndpointFound(
+        &client,
+        std::make_shared<MockDiscoveredEndpoint>(MockDiscoveredEndpoint{
+            {
+                endpoint_id,
+                info.endpoint_info,
+                service_id,
+                discovered_medium,
+                WebRtcState::kUndefined,
+            },
+            MockContext{nullptr},
+        }));
+  }
+  auto other_client = std::make_unique<ClientProxy>();
+  EncryptionRunner encryption_runner;
+  encryption_runner.StartServer(other_client.get(), endpoint_id,
+                                channel_b.get(), {});
+
+  EXPECT_EQ(pcp_handler.RequestConnection(&client, endpoint_id, info,
+                                          connection_options),
+            Status{Status::kSuccess});
+
+  // The WIFI_LAN channel that connects late is closed.
+  bluetooth_won.CountDown();
+  EXPECT_TRUE(wifi_lan_closed.Await(absl::Seconds(1)).result());
+  channel_b->Close();
+  bwu.Shutdown();
+  pcp_handler.DisconnectFromEndpointManager();
+  env_.Stop();
+}
+
+TEST_F(BasePcpHandlerTest, ConnectionRacingCancelsLosingAttempts) {
+  FeatureFlags::Flags flags = FeatureFlags::GetInstance().GetFlags();
+  flags.enable_connection_racing = true;
+  flags.connection_racing_stagger_delay = absl::Milliseconds(10);
+  FeatureFlags::ScopedFlagsForTesting scoped_flags(flags);
+  env_.Start();
+  std::string service_id{"service"};
+  std::string endpoint_id{"ABCD"};
+  std::string bluetooth_mac_address{"AA:BB:CC:DD:EE:FF"};
+  ClientProxy client;
+  client.AddCancellationFlag(endpoint_id);
+  Mediums m;
+  EndpointChannelManager ecm;
+  EndpointManager em(&ecm);
+  BwuManager bwu(m, em, ecm, {}, {});
+  MockPcpHandler pcp_handler(&m, &em, &ecm, &bwu);
+  BooleanMediumSelector allowed{
+      .bluetooth = true,
+      .wifi_lan = true,
+  };
+  DiscoveryOptions discovery_options{
+      {
+          Strategy::kP2pCluster,
+          allowed,
+      },
+      false,  // auto_upgrade_bandwidth;
+      false,  // enforce_topology_constraints;
+  };
+  EXPECT_CALL(pcp_handler, StartDiscoveryImpl(&client, service_id, _))
+      .WillOnce(Return(MockPcpHandler::StartOperationResult{
+          .status = {Status::kSuccess},
+          .mediums = allowed.GetMediums(true),
+      }));
+  EXPECT_EQ(pcp_handler.StartDiscovery(&client, service_id, discovery_options,
+                                       GetDiscoveryListener()),
+            Status{Status::kSuccess});
+
+  auto channel_pair = SetupConnection(Medium::BLUETOOTH);
+  auto& channel_a = channel_pair.first;
+  auto& channel_b = channel_pair.second;
+  EXPECT_CALL(*channel_a, CloseImpl).Times(1);
+  EXPECT_CALL(*channel_b, CloseImpl).Times(1);
+  CountDownLatch wifi_lan_cancelled(1);
+  ConnectionRequestInfo info{
+      .endpoint_info = ByteArray{"ABCD"},
+      .listener = connection_listener_,
+  };
+  ConnectionOptions connection_options{
+      .keep_alive_interval_millis =
+          FeatureFlags::GetInstance().GetFlags().keep_alive_interval_millis,
+      .keep_alive_timeout_millis =
+          FeatureFlags::GetInstance().GetFlags().keep_alive_timeout_millis,
+  };
+  EXPECT_CALL(mock_discovery_listener_.endpoint_found_cb, Call);
+  EXPECT_CALL(pcp_handler, CanSendOutgoingConnection)
+      .WillRepeatedly(Return(true));
+  EXPECT_CALL(pcp_handler, GetStrategy)
+      .WillRepeatedly(Return(Strategy::kP2pCluster));
+  EXPECT_CALL(mock_connection_listener_.initiated_cb, Call).Times(1);
+  EXPECT_CALL(mock_connection_listener_.rejected_cb, Call).Times(AtLeast(0));
+  EXPECT_CALL(pcp_handler, ConnectImpl)
+      .WillRepeatedly(Invoke([&](ClientProxy* client,
+                                 MockPcpHandler::DiscoveredEndpoint* endpoint,
+                                 CancellationFlag* cancellation_flag) {
+        if (endpoint->medium == Medium::WIFI_LAN) {
+          // WIFI_LAN is preferred, but can't connect until it's cancelled.
+          CountDownLatch cancelled(1);
+          CancellationFlagListener listener(
+              cancellation_flag, [&cancelled]() { cancelled.CountDown(); });
+          if (cancellation_flag->Cancelled() ||
+              cancelled.Await(absl::Seconds(1)).result()) {
+            wifi_lan_cancelled.CountDown();
+          }
+          return MockPcpHandler::ConnectImplResult{
+              .medium = Medium::WIFI_LAN,
+              .status = {Status::kError},
+          };
+        }
+        return MockPcpHandler::ConnectImplResult{
+            .medium = endpoint->medium,
+            .status = {Status::kSuccess},
+            .endpoint_channel = std::move(channel_a),
+            .bluetooth_mac_address = bluetooth_mac_address,
+        };
+      }));
+  for (const auto& discovered_medium : allowed.GetMediums(true)) {
+    pcp_handler.OnEndpointFound(
+        &client,
+        std::make_shared<MockDiscoveredEndpoint>(MockDiscoveredEndpoint{
+            {
+                endpoint_id,
+                info.endpoint_info,
+                service_id,
+                discovered_medium,
+                WebRtcState::kUndefined,
+            },
+            MockContext{nullptr},
+        }));
+  }
+  auto other_client = std::make_unique<ClientProxy>();
+  EncryptionRunner encryption_runner;
+  encryption_runner.StartServer(other_client.get(), endpoint_id,
+                                channel_b.get(), {});
+
+  EXPECT_EQ(pcp_handler.RequestConnection(&client, endpoint_id, info,
+                                          connection_options),
+            Status{Status::kSuccess});
+
+  EXPECT_TRUE(wifi_lan_cancelled.Await(absl::Seconds(1)).result());
+  EXPECT_EQ(client.GetBluetoothMacAddress(endpoint_id), bluetooth_mac_address);
+  channel_b->Close();
+  bwu.Shutdown();
+  pcp_handler.DisconnectFromEndpointManager();
+  env_.Stop();
+}
+
 TEST_P(BasePcpHandlerTest, RequestConnectionChangesState) {
   env_.Start();
   ClientProxy client;
@@ -1342,7 +1582,8 @@ TEST_P(BasePcpHandlerTest, RequestConnectionV3_ConnectImplFailure) {
   EXPECT_CALL(pcp_handler, ConnectImpl)
       .WillRepeatedly(Invoke(
           [connect_medium](ClientProxy* client,
-                           MockPcpHandler::DiscoveredEndpoint* endpoint) {
+                           MockPcpHandler::DiscoveredEndpoint* endpoint,
+                           CancellationFlag* cancellation_flag) {
             return MockPcpHandler::ConnectImplResult{
                 .medium = connect_medium,
                 .status = {Status::kError},
@@ -1418,7 +1659,8 @@ TEST_P(BasePcpHandlerTest, RequestConnection_ConnectImplFailure) {
   EXPECT_CALL(pcp_handler, ConnectImpl)
       .WillRepeatedly(Invoke(
           [connect_medium](ClientProxy* client,
-                           MockPcpHandler::DiscoveredEndpoint* endpoint) {
+                           MockPcpHandler::DiscoveredEndpoint* endpoint,
+                           CancellationFlag* cancellation_flag) {
             return MockPcpHandler::ConnectImplResult{
                 .medium = connect_medium,
                 .status = {Status::kError},
@@ -1594,7 +1836,8 @@ TEST_P(BasePcpHandlerTest, OnIncomingFrameChangesState) {
   NEARBY_LOGS(INFO) << "Simulating remote accept: id=" << endpoint_id;
   OsInfo os_info;
   auto frame = parser::FromBytes(parser::ForConnectionResponse(
-      Status::kSuccess, os_info, /*multiplex_socket_bitmask=*/0));
+      Status::kSuccess, os_info, /*multiplex_socket_bitmask=*/0,
+      /*capability_bitmask=*/0));
   EXPECT_CALL(mock_connection_listener_.bandwidth_changed_cb, Call).Times(1);
   pcp_handler.OnIncomingFrame(frame.result(), endpoint_id, &client,
                               connect_medium, packet_meta_data);
@@ -286,10 +286,16 @@ TEST(BwuManagerBaseTest, InitiateBwu_NeedToSwitchRole_Success) {
 class BwuManagerTestParam : public BwuManagerTest,
                             public ::testing::WithParamInterface<bool> {
  protected:
-  BwuManagerTestParam() {
-    FeatureFlags::GetMutableFlagsForTesting().support_multiple_bwu_mediums =
-        GetParam();
+  BwuManagerTestParam() : scoped_flags_(FlagsForParam()) {}
+
+ private:
+  FeatureFlags::Flags FlagsForParam() const {
+    FeatureFlags::Flags flags = FeatureFlags::GetInstance().GetFlags();
+    flags.support_multiple_bwu_mediums = GetParam();
+    return flags;
   }
+
+  FeatureFlags::ScopedFlagsForTesting scoped_flags_;
 };
 
 TEST_P(BwuManagerTestParam, InitiateBwu_Success) {
@@ -447,7 +453,9 @@ TEST_P(BwuManagerTestParam,
 
 TEST_F(BwuManagerTest,
        InitiateBwu_Revert_OnDisconnect_MultipleEndpoints_FlagEnabled) {
-  FeatureFlags::GetMutableFlagsForTesting().support_multiple_bwu_mediums = true;
+  FeatureFlags::Flags flags = FeatureFlags::GetInstance().GetFlags();
+  flags.support_multiple_bwu_mediums = true;
+  FeatureFlags::ScopedFlagsForTesting scoped_flags(flags);
 
   // Say we have two already upgraded WebRTC connections for the same service.
   CreateInitialEndpoint(&client_, kServiceIdA, kEndpointId1, Medium::BLUETOOTH);
@@ -496,8 +504,9 @@ TEST_F(BwuManagerTest,
 
 TEST_F(BwuManagerTest,
        InitiateBwu_Revert_OnDisconnect_MultipleEndpoints_FlagDisabled) {
-  FeatureFlags::GetMutableFlagsForTesting().support_multiple_bwu_mediums =
-      false;
+  FeatureFlags::Flags flags = FeatureFlags::GetInstance().GetFlags();
+  flags.support_multiple_bwu_mediums = false;
+  FeatureFlags::ScopedFlagsForTesting scoped_flags(flags);
 
   // Say we have two already upgraded WebRTC connections for the same service.
   CreateInitialEndpoint(&client_, kServiceIdA, kEndpointId1, Medium::BLUETOOTH);
@@ -553,7 +562,9 @@ TEST_F(BwuManagerTest,
 
 TEST_F(BwuManagerTest,
        InitiateBwu_Revert_OnDisconnect_MultipleServices_FlagEnabled) {
-  FeatureFlags::GetMutableFlagsForTesting().support_multiple_bwu_mediums = true;
+  FeatureFlags::Flags flags = FeatureFlags::GetInstance().GetFlags();
+  flags.support_multiple_bwu_mediums = true;
+  FeatureFlags::ScopedFlagsForTesting scoped_flags(flags);
 
   // Say we have two already upgraded WLAN connections for different services.
   CreateInitialEndpoint(&client_, kServiceIdA, kEndpointId1, Medium::BLUETOOTH);
@@ -607,8 +618,9 @@ TEST_F(BwuManagerTest,
 
 TEST_F(BwuManagerTest,
        InitiateBwu_Revert_OnDisconnect_MultipleServices_FlagDisabled) {
-  FeatureFlags::GetMutableFlagsForTesting().support_multiple_bwu_mediums =
-      false;
+  FeatureFlags::Flags flags = FeatureFlags::GetInstance().GetFlags();
+  flags.support_multiple_bwu_mediums = false;
+  FeatureFlags::ScopedFlagsForTesting scoped_flags(flags);
 
   // Say we have two already upgraded WLAN connections for different services.
   CreateInitialEndpoint(&client_, kServiceIdA, kEndpointId1, Medium::BLUETOOTH);
@@ -666,7 +678,9 @@ TEST_F(
     BwuManagerTest,
     InitiateBwu_Revert_OnDisconnect_MultipleServicesAndEndpoints_FlagEnabled) {
   // Need support_multiple_bwu_mediums_ to run this test with multiple mediums.
-  FeatureFlags::GetMutableFlagsForTesting().support_multiple_bwu_mediums = true;
+  FeatureFlags::Flags flags = FeatureFlags::GetInstance().GetFlags();
+  flags.support_multiple_bwu_mediums = true;
+  FeatureFlags::ScopedFlagsForTesting scoped_flags(flags);
 
   // Say we have three upgraded connections for two different services and two
   // different mediums.
@@ -815,7 +829,9 @@ TEST_F(
 }
 
 TEST_F(BwuManagerTest, InitiateBwu_Revert_OnUpgradeFailure_FlagEnabled) {
-  FeatureFlags::GetMutableFlagsForTesting().support_multiple_bwu_mediums = true;
+  FeatureFlags::Flags flags = FeatureFlags::GetInstance().GetFlags();
+  flags.support_multiple_bwu_mediums = true;
+  FeatureFlags::ScopedFlagsForTesting scoped_flags(flags);
 
   // Say we have two already upgraded WebRTC connections for service A.
   CreateInitialEndpoint(&client_, kServiceIdA, kEndpointId1, Medium::BLUETOOTH);
@@ -852,8 +868,9 @@ TEST_F(BwuManagerTest, InitiateBwu_Revert_OnUpgradeFailure_FlagEnabled) {
 }
 
 TEST_F(BwuManagerTest, InitiateBwu_Revert_OnUpgradeFailure_FlagDisabled) {
-  FeatureFlags::GetMutableFlagsForTesting().support_multiple_bwu_mediums =
-      false;
+  FeatureFlags::Flags flags = FeatureFlags::GetInstance().GetFlags();
+  flags.support_multiple_bwu_mediums = false;
+  FeatureFlags::ScopedFlagsForTesting scoped_flags(flags);
 
   // Say we have two already upgraded WebRTC connections for service A.
   CreateInitialEndpoint(&client_, kServiceIdA, kEndpointId1, Medium::BLUETOOTH);
@@ -889,7 +906,9 @@ TEST_F(BwuManagerTest, InitiateBwu_Revert_OnUpgradeFailure_FlagDisabled) {
 }
 
 TEST_F(BwuManagerTest, InitiateBwu_Revert_OnDisconnect_WifiDirect) {
-  FeatureFlags::GetMutableFlagsForTesting().support_multiple_bwu_mediums = true;
+  FeatureFlags::Flags flags = FeatureFlags::GetInstance().GetFlags();
+  flags.support_multiple_bwu_mediums = true;
+  FeatureFlags::ScopedFlagsForTesting scoped_flags(flags);
   OfflineFrame frame;
   CreateInitialEndpoint(&client_, kServiceIdA, kEndpointId1, Medium::BLUETOOTH);
 
@@ -922,7 +941,9 @@ TEST_F(BwuManagerTest, InitiateBwu_Revert_OnDisconnect_WifiDirect) {
 }
 
 TEST_F(BwuManagerTest, InitiateBwu_Revert_OnDisconnect_Hotspot) {
-  FeatureFlags::GetMutableFlagsForTesting().support_multiple_bwu_mediums = true;
+  FeatureFlags::Flags flags = FeatureFlags::GetInstance().GetFlags();
+  flags.support_multiple_bwu_mediums = true;
+  FeatureFlags::ScopedFlagsForTesting scoped_flags(flags);
 
   CreateInitialEndpoint(&client_, kServiceIdA, kEndpointId1, Medium::BLUETOOTH);
 
@@ -952,7 +973,9 @@ TEST_F(BwuManagerTest, InitiateBwu_Revert_OnDisconnect_Hotspot) {
 }
 
 TEST_F(BwuManagerTest, InitiateBwu_Revert_OnDisconnect_Wlan) {
-  FeatureFlags::GetMutableFlagsForTesting().support_multiple_bwu_mediums = true;
+  FeatureFlags::Flags flags = FeatureFlags::GetInstance().GetFlags();
+  flags.support_multiple_bwu_mediums = true;
+  FeatureFlags::ScopedFlagsForTesting scoped_flags(flags);
 
   CreateInitialEndpoint(&client_, kServiceIdA, kEndpointId1, Medium::BLUETOOTH);
 
@@ -0,0 +1,113 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/chunk_size_controller.h"
+
+#include <algorithm>
+#include <string>
+
+#include "absl/time/time.h"
+#include "internal/platform/logging.h"
+#include "internal/platform/mutex_lock.h"
+#include "proto/connections_enums.pb.h"
+
+namespace nearby {
+namespace connections {
+
+using ::location::nearby::proto::connections::Medium;
+
+int ChunkSizeController::GetChunkSize(const std::string& endpoint_id,
+                                      Medium medium, int max_chunk_size) {
+  if (max_chunk_size <= 0) {
+    return max_chunk_size;
+  }
+  MutexLock lock(&mutex_);
+  auto it = endpoints_.find(endpoint_id);
+  if (it == endpoints_.end() || it->second.medium != medium ||
+      it->second.max_chunk_size != max_chunk_size) {
+    if (it != endpoints_.end()) {
+      LOG(INFO) << "Chunk size for endpoint_id=" << endpoint_id
+                << " starts over at " << max_chunk_size << " on "
+                << location::nearby::proto::connections::Medium_Name(medium);
+    }
+    // Start where the fixed per-medium size always did; a congested link
+    // brings it down within a few chunks.
+    it = endpoints_
+             .insert_or_assign(endpoint_id,
+                               EndpointState{.medium = medium,
+                                             .max_chunk_size = max_chunk_size,
+                                             .chunk_size = max_chunk_size,
+                                             .target_write_time =
+                                                 GetTargetWriteTime(medium)})
+             .first;
+  }
+  return it->second.chunk_size;
+}
+
+void ChunkSizeController::OnChunkWritten(const std::string& endpoint_id,
+                                         int chunk_size,
+                                         absl::Duration write_time) {
+  MutexLock lock(&mutex_);
+  auto it = endpoints_.find(endpoint_id);
+  if (it == endpoints_.end()) return;
+  EndpointState& state = it->second;
+
+  if (write_time > state.target_write_time) {
+    Decrease(state);
+    NEARBY_VLOG(1) << "Chunk to endpoint_id=" << endpoint_id << " took "
+                   << write_time << ", chunk size down to "
+                   << state.chunk_size;
+    return;
+  }
+  // A short last chunk says nothing about whether a bigger one would fit.
+  if (chunk_size < state.chunk_size) return;
+  int step = std::max(state.max_chunk_size / kIncreaseSteps, 1);
+  state.chunk_size = std::min(state.chunk_size + step, state.max_chunk_size);
+}
+
+void ChunkSizeController::OnWriteFailed(const std::string& endpoint_id) {
+  MutexLock lock(&mutex_);
+  auto it = endpoints_.find(endpoint_id);
+  if (it == endpoints_.end()) return;
+  Decrease(it->second);
+}
+
+void ChunkSizeController::OnEndpointRemoved(const std::string& endpoint_id) {
+  MutexLock lock(&mutex_);
+  endpoints_.erase(endpoint_id);
+}
+
+absl::Duration ChunkSizeController::GetTargetWriteTime(Medium medium) {
+  switch (medium) {
+    case Medium::BLUETOOTH:
+    case Medium::BLE:
+    case Medium::BLE_L2CAP:
+    case Medium::NFC:
+      return absl::Milliseconds(500);
+    case Medium::WEB_RTC:
+    case Medium::WEB_RTC_NON_CELLULAR:
+      // Goes through the internet, with a longer round trip than a local link.
+      return absl::Milliseconds(250);
+    default:
+      return kTargetWriteTime;
+  }
+}
+
+void ChunkSizeController::Decrease(EndpointState& state) {
+  int min_chunk_size = std::min(kMinChunkSize, state.max_chunk_size);
+  state.chunk_size = std::max(state.chunk_size / 2, min_chunk_size);
+}
+
+}  // namespace connections
+}  // namespace nearby
@@ -0,0 +1,91 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CORE_INTERNAL_CHUNK_SIZE_CONTROLLER_H_
+#define CORE_INTERNAL_CHUNK_SIZE_CONTROLLER_H_
+
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/time/time.h"
+#include "internal/platform/mutex.h"
+#include "proto/connections_enums.pb.h"
+
+namespace nearby {
+namespace connections {
+
+// Picks the size of outgoing payload chunks for each endpoint from how long
+// the previous ones took to write.
+//
+// The size grows by a step after every full chunk written within the
+// medium's target write time, and is halved when a write takes longer or
+// fails, so it settles around the largest chunk the link currently moves in
+// that time.
+// It never exceeds the channel's max transmit packet size, and starts over
+// from it when the endpoint moves to another channel after a bandwidth
+// upgrade.
+//
+// Thread safe; payloads of different types are sent from different threads.
+class ChunkSizeController {
+ public:
+  // Chunks aren't made smaller than this, unless the channel's max is.
+  static constexpr int kMinChunkSize = 4 * 1024;
+  // A chunk write to a Wi-Fi class medium that takes longer than this means
+  // the link is congested.
+  static constexpr absl::Duration kTargetWriteTime = absl::Milliseconds(100);
+  // The max chunk size is reached in this many steps from the minimum.
+  static constexpr int kIncreaseSteps = 16;
+
+  // Returns the size of the next chunk to `endpoint_id`, whose channel is over
+  // `medium` and takes at most `max_chunk_size` bytes at once.
+  int GetChunkSize(const std::string& endpoint_id,
+                   location::nearby::proto::connections::Medium medium,
+                   int max_chunk_size) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // `chunk_size` is the size of the chunk before compression.
+  void OnChunkWritten(const std::string& endpoint_id, int chunk_size,
+                      absl::Duration write_time) ABSL_LOCKS_EXCLUDED(mutex_);
+  void OnWriteFailed(const std::string& endpoint_id)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  void OnEndpointRemoved(const std::string& endpoint_id)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns how long a chunk write over `medium` may take before the link
+  // counts as congested. Bluetooth and BLE links are slower and have longer
+  // round trips, so a healthy one would otherwise always look congested and
+  // be held at the minimum chunk size.
+  static absl::Duration GetTargetWriteTime(
+      location::nearby::proto::connections::Medium medium);
+
+ private:
+  struct EndpointState {
+    location::nearby::proto::connections::Medium medium;
+    int max_chunk_size = 0;
+    int chunk_size = 0;
+    absl::Duration target_write_time;
+  };
+
+  static void Decrease(EndpointState& state);
+
+  Mutex mutex_;
+  absl::flat_hash_map<std::string, EndpointState> endpoints_
+      ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace connections
+}  // namespace nearby
+
+#endif  // CORE_INTERNAL_CHUNK_SIZE_CONTROLLER_H_
@@ -0,0 +1,182 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/chunk_size_controller.h"
+
+#include "gtest/gtest.h"
+#include "absl/time/time.h"
+#include "proto/connections_enums.pb.h"
+
+namespace nearby {
+namespace connections {
+namespace {
+
+using ::location::nearby::proto::connections::BLE;
+using ::location::nearby::proto::connections::BLUETOOTH;
+using ::location::nearby::proto::connections::WIFI_LAN;
+
+constexpr char kEndpointId[] = "ABCD";
+constexpr int kMaxChunkSize = 64 * 1024;
+constexpr absl::Duration kFastWrite = absl::Milliseconds(5);
+constexpr absl::Duration kSlowWrite = absl::Seconds(2);
+
+TEST(ChunkSizeControllerTest, StartsAtChannelMax) {
+  ChunkSizeController controller;
+
+  EXPECT_EQ(controller.GetChunkSize(kEndpointId, WIFI_LAN, kMaxChunkSize),
+            kMaxChunkSize);
+}
+
+TEST(ChunkSizeControllerTest, HalvesOnSlowWrite) {
+  ChunkSizeController controller;
+  controller.GetChunkSize(kEndpointId, WIFI_LAN, kMaxChunkSize);
+
+  controller.OnChunkWritten(kEndpointId, kMaxChunkSize, kSlowWrite);
+
+  EXPECT_EQ(controller.GetChunkSize(kEndpointId, WIFI_LAN, kMaxChunkSize),
+            kMaxChunkSize / 2);
+}
+
+TEST(ChunkSizeControllerTest, HalvesOnFailedWrite) {
+  ChunkSizeController controller;
+  controller.GetChunkSize(kEndpointId, WIFI_LAN, kMaxChunkSize);
+
+  controller.OnWriteFailed(kEndpointId);
+
+  EXPECT_EQ(controller.GetChunkSize(kEndpointId, WIFI_LAN, kMaxChunkSize),
+            kMaxChunkSize / 2);
+}
+
+TEST(ChunkSizeControllerTest, NeverGoesBelowMinimum) {
+  ChunkSizeController controller;
+  controller.GetChunkSize(kEndpointId, WIFI_LAN, kMaxChunkSize);
+
+  for (int i = 0; i < 20; ++i) {
+    controller.OnChunkWritten(kEndpointId, 1024, kSlowWrite);
+  }
+
+  EXPECT_EQ(controller.GetChunkSize(kEndpointId, WIFI_LAN, kMaxChunkSize),
+            ChunkSizeController::kMinChunkSize);
+}
+
+TEST(ChunkSizeControllerTest, SmallChannelMaxIsKept) {
+  ChunkSizeController controller;
+  controller.GetChunkSize(kEndpointId, BLUETOOTH, 1980);
+
+  controller.OnChunkWritten(kEndpointId, 1980, kSlowWrite);
+
+  EXPECT_EQ(controller.GetChunkSize(kEndpointId, BLUETOOTH, 1980), 1980);
+}
+
+TEST(ChunkSizeControllerTest, SlowMediumToleratesLongerWrites) {
+  ChunkSizeController controller;
+  controller.GetChunkSize(kEndpointId, BLUETOOTH, kMaxChunkSize);
+  controller.GetChunkSize("EFGH", WIFI_LAN, kMaxChunkSize);
+
+  controller.OnChunkWritten(kEndpointId, kMaxChunkSize,
+                            absl::Milliseconds(300));
+  controller.OnChunkWritten("EFGH", kMaxChunkSize, absl::Milliseconds(300));
+
+  EXPECT_EQ(controller.GetChunkSize(kEndpointId, BLUETOOTH, kMaxChunkSize),
+            kMaxChunkSize);
+  EXPECT_EQ(controller.GetChunkSize("EFGH", WIFI_LAN, kMaxChunkSize),
+            kMaxChunkSize / 2);
+}
+
+TEST(ChunkSizeControllerTest, TargetWriteTimeDependsOnMedium) {
+  EXPECT_EQ(ChunkSizeController::GetTargetWriteTime(WIFI_LAN),
+            ChunkSizeController::kTargetWriteTime);
+  EXPECT_GT(ChunkSizeController::GetTargetWriteTime(BLUETOOTH),
+            ChunkSizeController::kTargetWriteTime);
+  EXPECT_GT(ChunkSizeController::GetTargetWriteTime(BLE),
+            ChunkSizeController::kTargetWriteTime);
+}
+
+TEST(ChunkSizeControllerTest, GrowsBackAdditivelyOnFastWrites) {
+  ChunkSizeController controller;
+  constexpr int kStep = kMaxChunkSize / ChunkSizeController::kIncreaseSteps;
+  controller.GetChunkSize(kEndpointId, WIFI_LAN, kMaxChunkSize);
+  controller.OnChunkWritten(kEndpointId, kMaxChunkSize, kSlowWrite);
+
+  controller.OnChunkWritten(kEndpointId, kMaxChunkSize / 2, kFastWrite);
+  EXPECT_EQ(controller.GetChunkSize(kEndpointId, WIFI_LAN, kMaxChunkSize),
+            kMaxChunkSize / 2 + kStep);
+
+  for (int i = 0; i < ChunkSizeController::kIncreaseSteps; ++i) {
+    controller.OnChunkWritten(kEndpointId, kMaxChunkSize, kFastWrite);
+  }
+  EXPECT_EQ(controller.GetChunkSize(kEndpointId, WIFI_LAN, kMaxChunkSize),
+            kMaxChunkSize);
+}
+
+TEST(ChunkSizeControllerTest, ShortChunkDoesNotGrowSize) {
+  ChunkSizeController controller;
+  controller.GetChunkSize(kEndpointId, WIFI_LAN, kMaxChunkSize);
+  controller.OnChunkWritten(kEndpointId, kMaxChunkSize, kSlowWrite);
+
+  controller.OnChunkWritten(kEndpointId, 100, kFastWrite);
+
+  EXPECT_EQ(controller.GetChunkSize(kEndpointId, WIFI_LAN, kMaxChunkSize),
+            kMaxChunkSize / 2);
+}
+
+TEST(ChunkSizeControllerTest, StartsOverAfterMediumChange) {
+  ChunkSizeController controller;
+  controller.GetChunkSize(kEndpointId, BLUETOOTH, kMaxChunkSize);
+  controller.OnChunkWritten(kEndpointId, kMaxChunkSize, kSlowWrite);
+  controller.OnChunkWritten(kEndpointId, kMaxChunkSize / 2, kSlowWrite);
+
+  EXPECT_EQ(controller.GetChunkSize(kEndpointId, WIFI_LAN, kMaxChunkSize),
+            kMaxChunkSize);
+}
+
+TEST(ChunkSizeControllerTest, FollowsChannelMaxChange) {
+  ChunkSizeController controller;
+  controller.GetChunkSize(kEndpointId, WIFI_LAN, kMaxChunkSize);
+
+  EXPECT_EQ(controller.GetChunkSize(kEndpointId, WIFI_LAN, kMaxChunkSize / 4),
+            kMaxChunkSize / 4);
+}
+
+TEST(ChunkSizeControllerTest, KeepsEndpointsApart) {
+  ChunkSizeController controller;
+  controller.GetChunkSize(kEndpointId, WIFI_LAN, kMaxChunkSize);
+  controller.GetChunkSize("EFGH", WIFI_LAN, kMaxChunkSize);
+
+  controller.OnChunkWritten(kEndpointId, kMaxChunkSize, kSlowWrite);
+
+  EXPECT_EQ(controller.GetChunkSize("EFGH", WIFI_LAN, kMaxChunkSize),
+            kMaxChunkSize);
+}
+
+TEST(ChunkSizeControllerTest, RemovedEndpointStartsOver) {
+  ChunkSizeController controller;
+  controller.GetChunkSize(kEndpointId, WIFI_LAN, kMaxChunkSize);
+  controller.OnChunkWritten(kEndpointId, kMaxChunkSize, kSlowWrite);
+
+  controller.OnEndpointRemoved(kEndpointId);
+
+  EXPECT_EQ(controller.GetChunkSize(kEndpointId, WIFI_LAN, kMaxChunkSize),
+            kMaxChunkSize);
+}
+
+TEST(ChunkSizeControllerTest, PassesThroughMissingChannel) {
+  ChunkSizeController controller;
+
+  EXPECT_EQ(controller.GetChunkSize(kEndpointId, WIFI_LAN, 0), 0);
+}
+
+}  // namespace
+}  // namespace connections
+}  // namespace nearby
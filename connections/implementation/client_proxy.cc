@@ -15,6 +15,7 @@
 #include "connections/implementation/client_proxy.h"
 
 #include <cstdint>
+#include <deque>
 #include <functional>
 #include <ios>
 #include <memory>
@@ -65,6 +66,7 @@
 #include "internal/platform/mutex_lock.h"
 #include "internal/platform/os_name.h"
 #include "internal/platform/prng.h"
+#include "internal/platform/trace.h"
 #include "proto/connections_enums.pb.h"
 
 namespace nearby {
@@ -85,6 +87,13 @@ bool IsFeatureUseStableEndpointIdEnabled() {
       connections::config_package_nearby::nearby_connections_feature::
           kUseStableEndpointId);
 }
+
+constexpr TraceEvent kPayloadReceivedTrace = {
+    "connections", "PayloadReceived", {"payload_id", "type"}};
+constexpr TraceEvent kPayloadProgressTrace = {
+    "connections",
+    "PayloadProgress",
+    {"payload_id", "bytes_transferred", "status"}};
 }  // namespace
 
 ClientProxy::ClientProxy(::nearby::analytics::EventLogger* event_logger)
@@ -386,7 +395,8 @@ void ClientProxy::StartedDiscovery(
         operation_result_with_mediums,
     const DiscoveryOptions& discovery_options) {
   MutexLock lock(&mutex_);
-  discovery_info_ = DiscoveryInfo{service_id, std::move(listener)};
+  discovery_info_ = DiscoveryInfo{
+      service_id, std::make_shared<DiscoveryListener>(std::move(listener))};
   discovery_options_ = discovery_options;
 
   const std::vector<location::nearby::proto::connections::Medium> medium_vector(
@@ -434,6 +444,7 @@ void ClientProxy::OnEndpointFound(
     const std::string& service_id, const std::string& endpoint_id,
     const ByteArray& endpoint_info,
     location::nearby::proto::connections::Medium medium) {
+  ScopedCallbackDelivery delivery(this);
   MutexLock lock(&mutex_);
 
   NEARBY_LOGS(INFO) << "ClientProxy [Endpoint Found]: [enter] id="
@@ -457,13 +468,16 @@ void ClientProxy::OnEndpointFound(
   }
 
   discovered_endpoint_ids_.insert(endpoint_id);
-  discovery_info_.listener.endpoint_found_cb(endpoint_id, endpoint_info,
-                                             service_id);
+  QueueCallback([listener = discovery_info_.listener, endpoint_id,
+                 endpoint_info, service_id]() {
+    listener->endpoint_found_cb(endpoint_id, endpoint_info, service_id);
+  });
   analytics_recorder_->OnEndpointFound(medium);
 }
 
 void ClientProxy::OnEndpointLost(const std::string& service_id,
                                  const std::string& endpoint_id) {
+  ScopedCallbackDelivery delivery(this);
   MutexLock lock(&mutex_);
 
   NEARBY_LOGS(INFO) << "ClientProxy [Endpoint Lost]: [enter] id=" << endpoint_id
@@ -484,7 +498,9 @@ void ClientProxy::OnEndpointLost(const std::string& service_id,
   }
 
   discovered_endpoint_ids_.erase(it);
-  discovery_info_.listener.endpoint_lost_cb(endpoint_id);
+  QueueCallback([listener = discovery_info_.listener, endpoint_id]() {
+    listener->endpoint_lost_cb(endpoint_id);
+  });
 }
 
 void ClientProxy::OnRequestConnection(
@@ -498,6 +514,7 @@ void ClientProxy::OnConnectionInitiated(
     const std::string& endpoint_id, const ConnectionResponseInfo& info,
     const ConnectionOptions& connection_options,
     const ConnectionListener& listener, const std::string& connection_token) {
+  ScopedCallbackDelivery delivery(this);
   MutexLock lock(&mutex_);
 
   // Whether this is incoming or outgoing, the local and remote endpoints both
@@ -511,11 +528,7 @@ void ClientProxy::OnConnectionInitiated(
                            .connection_options = connection_options,
                            .connection_token = connection_token,
                        },
-                       PayloadListener{
-                           .payload_cb = [](absl::string_view, Payload) {},
-                           .payload_progress_cb = [](absl::string_view,
-                                                     PayloadProgressInfo) {},
-                       }));
+                       std::make_shared<PayloadListener>()));
   // Instead of using structured binding which is nice, but banned
   // (can not use c++17 features, until chromium does) we unpack manually.
   auto& pair_iter = result.first;
@@ -530,7 +543,8 @@ void ClientProxy::OnConnectionInitiated(
   //
   // Note: we allow devices to connect to an advertiser even after it stops
   // advertising, so no need to check IsAdvertising() here.
-  item.first.connection_listener.initiated_cb(endpoint_id, info);
+  QueueCallback([initiated_cb = item.first.connection_listener.initiated_cb,
+                 endpoint_id, info]() { initiated_cb(endpoint_id, info); });
 
   if (info.is_incoming_connection) {
     // Add CancellationFlag for advertisers once encryption succeeds.
@@ -543,6 +557,7 @@ void ClientProxy::OnConnectionInitiated(
 
 void ClientProxy::OnConnectionAccepted(const std::string& endpoint_id) {
   NEARBY_LOGS(INFO) << "ClientProxy [ConnectionAccepted]: id=" << endpoint_id;
+  ScopedCallbackDelivery delivery(this);
   MutexLock lock(&mutex_);
 
   if (!HasPendingConnectionToEndpoint(endpoint_id)) {
@@ -555,14 +570,18 @@ void ClientProxy::OnConnectionAccepted(const std::string& endpoint_id) {
   // Notify the client.
   ConnectionPair* item = LookupConnection(endpoint_id);
   if (item != nullptr) {
-    item->first.connection_listener.accepted_cb(endpoint_id);
+    QueueCallback(
+        [accepted_cb = item->first.connection_listener.accepted_cb,
+         endpoint_id]() { accepted_cb(endpoint_id); });
     item->first.status = Connection::kConnected;
+    UpdateConnectedEndpointsSnapshot();
   }
 }
 
 void ClientProxy::OnConnectionRejected(const std::string& endpoint_id,
                                        const Status& status) {
   NEARBY_LOGS(INFO) << "ClientProxy [ConnectionRejected]: id=" << endpoint_id;
+  ScopedCallbackDelivery delivery(this);
   MutexLock lock(&mutex_);
 
   if (!HasPendingConnectionToEndpoint(endpoint_id)) {
@@ -575,21 +594,27 @@ void ClientProxy::OnConnectionRejected(const std::string& endpoint_id,
   // Notify the client.
   const ConnectionPair* item = LookupConnection(endpoint_id);
   if (item != nullptr) {
-    item->first.connection_listener.rejected_cb(endpoint_id, status);
-    OnDisconnected(endpoint_id, false /* notify */);
+    QueueCallback(
+        [rejected_cb = item->first.connection_listener.rejected_cb, endpoint_id,
+         status]() { rejected_cb(endpoint_id, status); });
+    RemoveConnection(endpoint_id, false /* notify */);
   }
 }
 
 void ClientProxy::OnBandwidthChanged(const std::string& endpoint_id,
                                      Medium new_medium) {
   NEARBY_LOGS(INFO) << "ClientProxy [BandwidthChanged]: id=" << endpoint_id;
+  ScopedCallbackDelivery delivery(this);
   MutexLock lock(&mutex_);
 
   ConnectionPair* item = LookupConnection(endpoint_id);
   if (item != nullptr) {
     item->first.connected_medium = new_medium;
-    item->first.connection_listener.bandwidth_changed_cb(endpoint_id,
-                                                         new_medium);
+    QueueCallback([bandwidth_changed_cb =
+                       item->first.connection_listener.bandwidth_changed_cb,
+                   endpoint_id, new_medium]() {
+      bandwidth_changed_cb(endpoint_id, new_medium);
+    });
     NEARBY_LOGS(INFO) << "ClientProxy [reporting onBandwidthChanged]: client="
                       << GetClientId() << "; endpoint_id=" << endpoint_id;
   }
@@ -597,14 +622,26 @@ void ClientProxy::OnBandwidthChanged(const std::string& endpoint_id,
 
 void ClientProxy::OnDisconnected(const std::string& endpoint_id, bool notify) {
   NEARBY_LOGS(INFO) << "ClientProxy [OnDisconnected]: id=" << endpoint_id;
+  ScopedCallbackDelivery delivery(this);
   MutexLock lock(&mutex_);
 
+  RemoveConnection(endpoint_id, notify);
+}
+
+void ClientProxy::RemoveConnection(const std::string& endpoint_id,
+                                   bool notify) {
   const ConnectionPair* item = LookupConnection(endpoint_id);
   if (item != nullptr) {
     if (notify) {
-      item->first.connection_listener.disconnected_cb({endpoint_id});
+      QueueCallback(
+          [disconnected_cb = item->first.connection_listener.disconnected_cb,
+           endpoint_id]() { disconnected_cb(endpoint_id); });
     }
+    bool was_connected = item->first.status == Connection::kConnected;
     connections_.erase(endpoint_id);
+    if (was_connected) {
+      UpdateConnectedEndpointsSnapshot();
+    }
     OnSessionComplete();
   }
 
@@ -617,17 +654,6 @@ void ClientProxy::OnDisconnected(const std::string& endpoint_id, bool notify) {
   }
 }
 
-bool ClientProxy::ConnectionStatusMatches(const std::string& endpoint_id,
-                                          Connection::Status status) const {
-  MutexLock lock(&mutex_);
-
-  const ConnectionPair* item = LookupConnection(endpoint_id);
-  if (item != nullptr) {
-    return item->first.status == status;
-  }
-  return false;
-}
-
 Medium ClientProxy::GetConnectedMedium(const std::string& endpoint_id) const {
   MutexLock lock(&mutex_);
 
@@ -691,7 +717,24 @@ std::string ClientProxy::GetIPAddress(const std::string& endpoint_id) const {
 }
 
 bool ClientProxy::IsConnectedToEndpoint(const std::string& endpoint_id) const {
-  return ConnectionStatusMatches(endpoint_id, Connection::kConnected);
+  std::shared_ptr<const absl::flat_hash_set<std::string>> connected_endpoints;
+  {
+    MutexLock lock(&connected_endpoints_mutex_);
+    connected_endpoints = connected_endpoints_;
+  }
+  return connected_endpoints->contains(endpoint_id);
+}
+
+void ClientProxy::UpdateConnectedEndpointsSnapshot() {
+  auto connected_endpoints =
+      std::make_shared<absl::flat_hash_set<std::string>>();
+  for (const auto& pair : connections_) {
+    if (pair.second.first.status == Connection::kConnected) {
+      connected_endpoints->insert(pair.first);
+    }
+  }
+  MutexLock lock(&connected_endpoints_mutex_);
+  connected_endpoints_ = std::move(connected_endpoints);
 }
 
 std::vector<std::string> ClientProxy::GetMatchingEndpoints(
@@ -717,9 +760,13 @@ std::vector<std::string> ClientProxy::GetPendingConnectedEndpoints() const {
 }
 
 std::vector<std::string> ClientProxy::GetConnectedEndpoints() const {
-  return GetMatchingEndpoints([](const Connection& connection) {
-    return connection.status == Connection::kConnected;
-  });
+  std::shared_ptr<const absl::flat_hash_set<std::string>> connected_endpoints;
+  {
+    MutexLock lock(&connected_endpoints_mutex_);
+    connected_endpoints = connected_endpoints_;
+  }
+  return std::vector<std::string>(connected_endpoints->begin(),
+                                  connected_endpoints->end());
 }
 
 bool ClientProxy::HasOngoingConnection() const {
@@ -805,7 +852,7 @@ void ClientProxy::LocalEndpointAcceptedConnection(
   NEARBY_LOGS(INFO) << "ClientProxy [Local Accepted]: id=" << endpoint_id;
   ConnectionPair* item = LookupConnection(endpoint_id);
   if (item != nullptr) {
-    item->second = std::move(listener);
+    item->second = std::make_shared<PayloadListener>(std::move(listener));
   }
   analytics_recorder_->OnLocalEndpointAccepted(endpoint_id);
 }
@@ -1022,6 +1069,46 @@ bool ClientProxy::IsPayloadReceivedAckEnabled(absl::string_view endpoint_id) {
               .min_nc_version_supports_payload_received_ack);
 }
 
+std::int32_t ClientProxy::GetLocalCapabilityBitmask() const {
+  const FeatureFlags::Flags& flags = FeatureFlags::GetInstance().GetFlags();
+  return (flags.enable_chunked_bytes_payload ? kChunkedBytesPayload : 0) |
+         (flags.enable_aes_gcm_record_layer ? kAesGcmRecordLayer : 0) |
+         (flags.enable_payload_compression ? kPayloadCompression : 0);
+}
+
+void ClientProxy::SetRemoteCapabilityBitmask(
+    absl::string_view endpoint_id, std::int32_t remote_capability_bitmask) {
+  MutexLock lock(&mutex_);
+  ConnectionPair* item = LookupConnection(endpoint_id);
+  if (item != nullptr) {
+    item->first.remote_capability_bitmask = remote_capability_bitmask;
+    NEARBY_LOGS(INFO) << "ClientProxy [SetRemoteCapabilityBitmask]: "
+                      << "endpoint_id=" << endpoint_id
+                      << "; bitmask=" << remote_capability_bitmask;
+  }
+}
+
+bool ClientProxy::IsCapabilityEnabled(absl::string_view endpoint_id,
+                                      CapabilityBitmask capability) const {
+  if ((GetLocalCapabilityBitmask() & capability) == 0) return false;
+  MutexLock lock(&mutex_);
+  const ConnectionPair* item = LookupConnection(endpoint_id);
+  return item != nullptr &&
+         (item->first.remote_capability_bitmask & capability) != 0;
+}
+
+bool ClientProxy::IsChunkedBytesPayloadEnabled(absl::string_view endpoint_id) {
+  return IsCapabilityEnabled(endpoint_id, kChunkedBytesPayload);
+}
+
+bool ClientProxy::IsAesGcmRecordLayerEnabled(absl::string_view endpoint_id) {
+  return IsCapabilityEnabled(endpoint_id, kAesGcmRecordLayer);
+}
+
+bool ClientProxy::IsPayloadCompressionEnabled(absl::string_view endpoint_id) {
+  return IsCapabilityEnabled(endpoint_id, kPayloadCompression);
+}
+
 void ClientProxy::CancelAllEndpoints() {
   for (const auto& item : cancellation_flags_) {
     CancellationFlag* cancellation_flag = item.second.get();
@@ -1033,17 +1120,22 @@ void ClientProxy::CancelAllEndpoints() {
 }
 
 void ClientProxy::OnPayload(const std::string& endpoint_id, Payload payload) {
+  ScopedCallbackDelivery delivery(this);
   MutexLock lock(&mutex_);
 
   if (IsConnectedToEndpoint(endpoint_id)) {
-    const std::pair<ClientProxy::Connection, PayloadListener>* item =
+    const ConnectionPair* item =
         LookupConnection(endpoint_id);
     if (item != nullptr) {
-      NEARBY_LOGS(INFO) << "ClientProxy [reporting onPayloadReceived]: client="
-                        << GetClientId() << "; endpoint_id=" << endpoint_id
-                        << " ; payload {id:" << payload.GetId()
-                        << ", type:" << payload.GetType() << "}";
-      item->second.payload_cb(endpoint_id, std::move(payload));
+      NEARBY_TRACE(kPayloadReceivedTrace, payload.GetId(), payload.GetType());
+      NEARBY_VLOG(1) << "ClientProxy [reporting onPayloadReceived]: client="
+                     << GetClientId() << "; endpoint_id=" << endpoint_id
+                     << " ; payload {id:" << payload.GetId()
+                     << ", type:" << payload.GetType() << "}";
+      QueueCallback([listener = item->second, endpoint_id,
+                     payload = std::move(payload)]() mutable {
+        listener->payload_cb(endpoint_id, std::move(payload));
+      });
     }
   }
 }
@@ -1062,13 +1154,18 @@ ClientProxy::ConnectionPair* ClientProxy::LookupConnection(
 
 void ClientProxy::OnPayloadProgress(const std::string& endpoint_id,
                                     const PayloadProgressInfo& info) {
+  ScopedCallbackDelivery delivery(this);
   MutexLock lock(&mutex_);
 
   if (IsConnectedToEndpoint(endpoint_id)) {
-    std::pair<ClientProxy::Connection, PayloadListener>* item =
+    const ConnectionPair* item =
         LookupConnection(endpoint_id);
     if (item != nullptr) {
-      item->second.payload_progress_cb(endpoint_id, info);
+      NEARBY_TRACE(kPayloadProgressTrace, info.payload_id,
+                   info.bytes_transferred, info.status);
+      QueueCallback([listener = item->second, endpoint_id, info]() {
+        listener->payload_progress_cb(endpoint_id, info);
+      });
 
       if (info.status == PayloadProgressInfo::Status::kInProgress) {
         NEARBY_VLOG(1) << "ClientProxy [reporting onPayloadProgress]: client="
@@ -1093,6 +1190,7 @@ void ClientProxy::RemoveAllEndpoints() {
   // endpoint, in the case when this is called from stopAllEndpoints(). For now,
   // just remove without notifying.
   connections_.clear();
+  UpdateConnectedEndpointsSnapshot();
   cancellation_flags_.clear();
   bluetooth_mac_addresses_.clear();
 
@@ -1122,9 +1220,72 @@ void ClientProxy::AppendConnectionStatus(const std::string& endpoint_id,
                                          Connection::Status status_to_append) {
   ConnectionPair* item = LookupConnection(endpoint_id);
   if (item != nullptr) {
+    bool was_connected = item->first.status == Connection::kConnected;
     item->first.status =
         static_cast<Connection::Status>(item->first.status | status_to_append);
+    if (was_connected && item->first.status != Connection::kConnected) {
+      UpdateConnectedEndpointsSnapshot();
+    }
+  }
+}
+
+thread_local ClientProxy::ScopedCallbackDelivery*
+    ClientProxy::current_callback_delivery_ = nullptr;
+
+ClientProxy::ScopedCallbackDelivery::ScopedCallbackDelivery(
+    ClientProxy* client)
+    : client_(client),
+      outer_(client->FindCallbackDelivery()),
+      previous_(current_callback_delivery_) {
+  current_callback_delivery_ = this;
+}
+
+ClientProxy::ScopedCallbackDelivery::~ScopedCallbackDelivery() {
+  if (outer_ != nullptr || ticket_ == -1) {
+    current_callback_delivery_ = previous_;
+    return;
+  }
+  {
+    MutexLock lock(&client_->callbacks_mutex_);
+    while (client_->delivering_callbacks_ticket_ != ticket_) {
+      client_->callbacks_turn_.Wait();
+    }
+  }
+  // Callbacks that call back into the client may add more to callbacks_.
+  while (!callbacks_.empty()) {
+    absl::AnyInvocable<void()> callback = std::move(callbacks_.front());
+    callbacks_.pop_front();
+    callback();
+  }
+  current_callback_delivery_ = previous_;
+  MutexLock lock(&client_->callbacks_mutex_);
+  ++client_->delivering_callbacks_ticket_;
+  client_->callbacks_turn_.Notify();
+}
+
+ClientProxy::ScopedCallbackDelivery* ClientProxy::FindCallbackDelivery() {
+  for (ScopedCallbackDelivery* delivery = current_callback_delivery_;
+       delivery != nullptr; delivery = delivery->previous_) {
+    if (delivery->client_ == this) {
+      return delivery->outer_ != nullptr ? delivery->outer_ : delivery;
+    }
+  }
+  return nullptr;
+}
+
+void ClientProxy::QueueCallback(absl::AnyInvocable<void()> callback) {
+  ScopedCallbackDelivery* delivery = FindCallbackDelivery();
+  if (delivery == nullptr) {
+    NEARBY_LOGS(ERROR) << "ClientProxy: callback queued outside of a "
+                          "ScopedCallbackDelivery; running it now.";
+    callback();
+    return;
+  }
+  if (delivery->ticket_ == -1) {
+    MutexLock lock(&callbacks_mutex_);
+    delivery->ticket_ = next_callbacks_ticket_++;
   }
+  delivery->callbacks_.push_back(std::move(callback));
 }
 
 AdvertisingOptions ClientProxy::GetAdvertisingOptions() const {
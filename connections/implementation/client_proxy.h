@@ -16,6 +16,7 @@
 #define CORE_INTERNAL_CLIENT_PROXY_H_
 
 #include <cstdint>
+#include <deque>
 #include <memory>
 #include <optional>
 #include <string>
@@ -29,6 +30,7 @@
 #include "connections/connection_options.h"
 #include "connections/discovery_options.h"
 #include "connections/implementation/analytics/analytics_recorder.h"
+#include "connections/implementation/analytics/connection_quality_recorder.h"
 #include "connections/implementation/proto/offline_wire_formats.pb.h"
 #include "connections/listeners.h"
 #include "connections/medium_selector.h"
@@ -44,6 +46,7 @@
 #include "internal/platform/byte_array.h"
 #include "internal/platform/cancelable_alarm.h"
 #include "internal/platform/cancellation_flag.h"
+#include "internal/platform/condition_variable.h"
 #include "internal/platform/error_code_recorder.h"
 #include "internal/platform/mutex.h"
 // Prefer using absl:: versions of a set and a map; they tend to be more
@@ -80,6 +83,9 @@ class ClientProxy final {
   analytics::AnalyticsRecorder& GetAnalyticsRecorder() const {
     return *analytics_recorder_;
   }
+  analytics::ConnectionQualityRecorder& GetConnectionQualityRecorder() const {
+    return *connection_quality_recorder_;
+  }
 
   std::string GetConnectionToken(const std::string& endpoint_id);
   std::optional<std::string> GetBluetoothMacAddress(
@@ -199,7 +205,8 @@ class ClientProxy final {
   std::int32_t GetApFrequency(const std::string& endpoint_id) const;
   // Returns IP Address in 4 bytes format for this endpoint.
   std::string GetIPAddress(const std::string& endpoint_id) const;
-  // Returns true if it's safe to send payloads to this endpoint.
+  // Returns true if it's safe to send payloads to this endpoint. Served from
+  // a snapshot, so it doesn't wait for a busy ClientProxy.
   bool IsConnectedToEndpoint(const std::string& endpoint_id) const;
   // Returns all endpoints that can safely be sent payloads.
   std::vector<std::string> GetConnectedEndpoints() const;
@@ -320,6 +327,19 @@ class ClientProxy final {
   bool IsSafeToDisconnectEnabled(absl::string_view endpoint_id);
   bool IsAutoReconnectEnabled(absl::string_view endpoint_id);
   bool IsPayloadReceivedAckEnabled(absl::string_view endpoint_id);
+  // Returns the optional features the local device supports.
+  std::int32_t GetLocalCapabilityBitmask() const;
+  // Sets the optional features the remote device supports.
+  void SetRemoteCapabilityBitmask(absl::string_view endpoint_id,
+                                  std::int32_t remote_capability_bitmask);
+  // Returns true if both sides can reassemble BYTES payloads that are sent in
+  // more than one chunk.
+  bool IsChunkedBytesPayloadEnabled(absl::string_view endpoint_id);
+  // Returns true if both sides can open frames sealed with the AES-GCM record
+  // layer.
+  bool IsAesGcmRecordLayerEnabled(absl::string_view endpoint_id);
+  // Returns true if both sides can inflate compressed payload chunks.
+  bool IsPayloadCompressionEnabled(absl::string_view endpoint_id);
 
   // Returns the multiplex socket supports status for local device.
   std::int32_t GetLocalMultiplexSocketBitmask() const;
@@ -367,6 +387,13 @@ class ClientProxy final {
     kWifiLanMultiplexEnabled = 1 << 3,
   };
 
+  /** Bitmask for optional features negotiated in the connection response. */
+  enum CapabilityBitmask : uint32_t {
+    kChunkedBytesPayload = 1 << 0,
+    kAesGcmRecordLayer = 1 << 1,
+    kPayloadCompression = 1 << 2,
+  };
+
  private:
   struct Connection {
     // Status: may be either:
@@ -399,8 +426,12 @@ class ClientProxy final {
     std::optional<location::nearby::connections::OsInfo> os_info;
     std::int32_t safe_to_disconnect_version;
     std::int32_t remote_multiplex_socket_bitmask;
+    std::int32_t remote_capability_bitmask = 0;
   };
-  using ConnectionPair = std::pair<Connection, PayloadListener>;
+  // The payload listener is shared with the callbacks queued for delivery, so
+  // it outlives a disconnect that happens before they run.
+  using ConnectionPair =
+      std::pair<Connection, std::shared_ptr<PayloadListener>>;
 
   struct AdvertisingInfo {
     std::string service_id;
@@ -411,7 +442,7 @@ class ClientProxy final {
 
   struct DiscoveryInfo {
     std::string service_id;
-    DiscoveryListener listener;
+    std::shared_ptr<DiscoveryListener> listener;
     void Clear() { service_id.clear(); }
     bool IsEmpty() const { return service_id.empty(); }
   };
@@ -438,10 +469,58 @@ class ClientProxy final {
 
   const ConnectionPair* LookupConnection(absl::string_view endpoint_id) const;
   ConnectionPair* LookupConnection(absl::string_view endpoint_id);
-  bool ConnectionStatusMatches(const std::string& endpoint_id,
-                               Connection::Status status) const;
+  // Returns true if both sides set `capability` in their capability bitmask.
+  bool IsCapabilityEnabled(absl::string_view endpoint_id,
+                           CapabilityBitmask capability) const;
   std::vector<std::string> GetMatchingEndpoints(
       absl::AnyInvocable<bool(const Connection&)> pred) const;
+  // Republishes the snapshot of connected endpoints from connections_. Must
+  // be called with mutex_ held whenever a connection enters or leaves the
+  // kConnected state.
+  void UpdateConnectedEndpointsSnapshot();
+  // Removes the endpoint's connection with mutex_ held, queueing the
+  // disconnected callback if `notify` is true.
+  void RemoveConnection(const std::string& endpoint_id, bool notify);
+
+  // Delivers the callbacks queued in its scope when it ends, on the thread
+  // that queued them. Declare it ahead of the MutexLock so that delivery
+  // happens after mutex_ is released.
+  //
+  // Each scope that queues callbacks takes a ticket, in the order of the
+  // events that trigger them, and waits for the scopes with earlier tickets
+  // to finish delivering before it starts. A scope opened on a thread that's
+  // already in one for the same client, e.g. by a callback calling back into
+  // the client, hands its callbacks to the outer scope, which runs them after
+  // the callback in progress.
+  class ScopedCallbackDelivery {
+   public:
+    explicit ScopedCallbackDelivery(ClientProxy* client);
+    ~ScopedCallbackDelivery();
+    ScopedCallbackDelivery(const ScopedCallbackDelivery&) = delete;
+    ScopedCallbackDelivery& operator=(const ScopedCallbackDelivery&) = delete;
+
+   private:
+    friend class ClientProxy;
+
+    ClientProxy* const client_;
+    // The scope this one hands its callbacks to, or nullptr.
+    ScopedCallbackDelivery* const outer_;
+    // The innermost scope on this thread when this one was opened.
+    ScopedCallbackDelivery* const previous_;
+    std::deque<absl::AnyInvocable<void()>> callbacks_;
+    std::int64_t ticket_ = -1;
+  };
+
+  // The innermost ScopedCallbackDelivery on this thread, of any client.
+  static thread_local ScopedCallbackDelivery* current_callback_delivery_;
+
+  // Returns the calling thread's scope that callbacks for this client go to,
+  // or nullptr.
+  ScopedCallbackDelivery* FindCallbackDelivery();
+  // Queues a client callback in the calling thread's ScopedCallbackDelivery
+  // for this client. Must be called with mutex_ held.
+  void QueueCallback(absl::AnyInvocable<void()> callback);
+
   std::string GenerateLocalEndpointId();
 
   void ScheduleClearCachedEndpointIdAlarm();
@@ -511,6 +590,21 @@ class ClientProxy final {
   // Maps endpoint_id to endpoint connection state.
   absl::flat_hash_map<std::string, ConnectionPair> connections_;
 
+  // The endpoints in connections_ with status kConnected. Replaced, never
+  // modified, under mutex_, so readers only take the leaf
+  // connected_endpoints_mutex_ long enough to copy the pointer.
+  mutable Mutex connected_endpoints_mutex_;
+  std::shared_ptr<const absl::flat_hash_set<std::string>>
+      connected_endpoints_ =
+          std::make_shared<const absl::flat_hash_set<std::string>>();
+
+  // The tickets of ScopedCallbackDelivery: the next one to hand out, and the
+  // one whose callbacks are delivered now or next.
+  Mutex callbacks_mutex_;
+  ConditionVariable callbacks_turn_{&callbacks_mutex_};
+  std::int64_t next_callbacks_ticket_ = 0;
+  std::int64_t delivering_callbacks_ticket_ = 0;
+
   // Maps endpoint_id to Bluetooth Mac Addresses.
   absl::flat_hash_map<std::string, std::string> bluetooth_mac_addresses_;
 
@@ -533,6 +627,10 @@ class ClientProxy final {
   // An analytics logger with |EventLogger| provided by client, which is default
   // nullptr as no-op.
   std::unique_ptr<analytics::AnalyticsRecorder> analytics_recorder_;
+  // Quality of the connections to this client's endpoints.
+  std::unique_ptr<analytics::ConnectionQualityRecorder>
+      connection_quality_recorder_ =
+          std::make_unique<analytics::ConnectionQualityRecorder>();
   std::unique_ptr<ErrorCodeRecorder> error_code_recorder_;
   // Local device OS information.
   location::nearby::connections::OsInfo local_os_info_;
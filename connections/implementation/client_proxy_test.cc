@@ -18,6 +18,7 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <thread>  // NOLINT
 #include <utility>
 #include <vector>
 
@@ -54,6 +55,7 @@
 #include "internal/platform/medium_environment.h"
 #include "internal/platform/mutex.h"
 #include "internal/platform/mutex_lock.h"
+#include "internal/platform/single_thread_executor.h"
 #include "proto/connections_enums.pb.h"
 
 namespace nearby {
@@ -65,6 +67,7 @@ using ::location::nearby::connections::OsInfo;
 using ::location::nearby::proto::connections::CLIENT_SESSION;
 using ::location::nearby::proto::connections::START_CLIENT_SESSION;
 using ::location::nearby::proto::connections::STOP_CLIENT_SESSION;
+using ::testing::ElementsAre;
 using ::testing::MockFunction;
 using ::testing::StrictMock;
 
@@ -379,6 +382,13 @@ class ClientProxyTest : public ::testing::TestWithParam<FeatureFlags::Flags> {
 
   ClientProxy* client2() { return client2_.get(); }
 
+  // Analytics reach the EventLogger on the recorder's logging thread.
+  int GetCompleteClientSessionCount(ClientProxy* client,
+                                    FakeEventLogger& event_logger) {
+    client->GetAnalyticsRecorder().Sync();
+    return event_logger.GetCompleteClientSessionCount();
+  }
+
   void FastForward(absl::Duration duration) {
     (*env_.GetSimulatedClock())
         ->FastForward(
@@ -730,6 +740,125 @@ TEST_F(ClientProxyTest, OnPayloadProgressChangesState) {
   OnPayloadProgress(client2(), advertising_endpoint);
 }
 
+TEST_F(ClientProxyTest, SlowPayloadCallbackDoesNotBlockQueries) {
+  Endpoint advertising_endpoint =
+      StartAdvertising(client1(), advertising_connection_listener_);
+  StartDiscovery(client2(), GetDiscoveryListener());
+  OnDiscoveryEndpointFound(client2(), advertising_endpoint);
+  OnDiscoveryConnectionInitiated(client2(), advertising_endpoint);
+  CountDownLatch payload_received(1);
+  CountDownLatch release_callback(1);
+  client2()->LocalEndpointAcceptedConnection(
+      advertising_endpoint.id,
+      {
+          .payload_cb =
+              [&](absl::string_view, Payload) {
+                payload_received.CountDown();
+                release_callback.Await();
+              },
+      });
+  OnDiscoveryConnectionRemoteAccepted(client2(), advertising_endpoint);
+  OnDiscoveryConnectionAccepted(client2(), advertising_endpoint);
+  SingleThreadExecutor executor;
+
+  executor.Execute([&]() {
+    client2()->OnPayload(advertising_endpoint.id, Payload(payload_bytes_));
+  });
+  ASSERT_TRUE(payload_received.Await(absl::Seconds(1)).result());
+
+  // The callback is still running, but doesn't hold the client's state.
+  EXPECT_TRUE(client2()->IsConnectedToEndpoint(advertising_endpoint.id));
+  EXPECT_THAT(client2()->GetConnectedEndpoints(),
+              ElementsAre(advertising_endpoint.id));
+  EXPECT_EQ(client2()->GetConnectedMedium(advertising_endpoint.id),
+            Medium::UNKNOWN_MEDIUM);
+  release_callback.CountDown();
+}
+
+TEST_F(ClientProxyTest, CallbacksAreDeliveredInOrderByTheirOwnThreads) {
+  Endpoint advertising_endpoint =
+      StartAdvertising(client1(), advertising_connection_listener_);
+  StartDiscovery(client2(), GetDiscoveryListener());
+  OnDiscoveryEndpointFound(client2(), advertising_endpoint);
+  OnDiscoveryConnectionInitiated(client2(), advertising_endpoint);
+  CountDownLatch payload_received(1);
+  CountDownLatch release_callback(1);
+  CountDownLatch progress_received(1);
+  Mutex mutex;
+  std::vector<std::string> events;
+  std::thread::id progress_thread;
+  std::thread::id progress_cb_thread;
+  client2()->LocalEndpointAcceptedConnection(
+      advertising_endpoint.id,
+      {
+          .payload_cb =
+              [&](absl::string_view, Payload) {
+                payload_received.CountDown();
+                release_callback.Await();
+                MutexLock lock(&mutex);
+                events.push_back("payload");
+              },
+          .payload_progress_cb =
+              [&](absl::string_view, const PayloadProgressInfo&) {
+                MutexLock lock(&mutex);
+                events.push_back("progress");
+                progress_cb_thread = std::this_thread::get_id();
+                progress_received.CountDown();
+              },
+      });
+  OnDiscoveryConnectionRemoteAccepted(client2(), advertising_endpoint);
+  OnDiscoveryConnectionAccepted(client2(), advertising_endpoint);
+  SingleThreadExecutor payload_executor;
+  payload_executor.Execute([&]() {
+    client2()->OnPayload(advertising_endpoint.id, Payload(payload_bytes_));
+  });
+  ASSERT_TRUE(payload_received.Await(absl::Seconds(1)).result());
+
+  // The progress waits for the payload callback that is still running, then
+  // is delivered by the thread that reported it.
+  SingleThreadExecutor progress_executor;
+  progress_executor.Execute([&]() {
+    {
+      MutexLock lock(&mutex);
+      progress_thread = std::this_thread::get_id();
+    }
+    client2()->OnPayloadProgress(advertising_endpoint.id, {});
+  });
+  absl::SleepFor(absl::Milliseconds(50));
+  {
+    MutexLock lock(&mutex);
+    EXPECT_TRUE(events.empty());
+  }
+  release_callback.CountDown();
+
+  ASSERT_TRUE(progress_received.Await(absl::Seconds(1)).result());
+  MutexLock lock(&mutex);
+  EXPECT_THAT(events, ElementsAre("payload", "progress"));
+  EXPECT_EQ(progress_cb_thread, progress_thread);
+}
+
+TEST_F(ClientProxyTest, CallbackCanDisconnectEndpoint) {
+  Endpoint advertising_endpoint =
+      StartAdvertising(client1(), advertising_connection_listener_);
+  StartDiscovery(client2(), GetDiscoveryListener());
+  OnDiscoveryEndpointFound(client2(), advertising_endpoint);
+  OnDiscoveryConnectionInitiated(client2(), advertising_endpoint);
+  OnDiscoveryConnectionLocalAccepted(client2(), advertising_endpoint);
+  OnDiscoveryConnectionRemoteAccepted(client2(), advertising_endpoint);
+  EXPECT_CALL(mock_discovery_connection_.accepted_cb, Call)
+      .WillOnce([&](const std::string& endpoint_id) {
+        EXPECT_TRUE(client2()->IsConnectedToEndpoint(endpoint_id));
+        client2()->OnDisconnected(endpoint_id, /*notify=*/true);
+        EXPECT_FALSE(client2()->IsConnectedToEndpoint(endpoint_id));
+      });
+  EXPECT_CALL(mock_discovery_connection_.disconnected_cb, Call).Times(1);
+
+  client2()->OnConnectionAccepted(advertising_endpoint.id);
+
+  EXPECT_FALSE(client2()->IsConnectedToEndpoint(advertising_endpoint.id));
+  EXPECT_TRUE(client2()->GetConnectedEndpoints().empty());
+}
+
 TEST_F(ClientProxyTest,
        EndpointIdCacheWhenHighVizAdvertisementAgainImmediately) {
   BooleanMediumSelector booleanMediumSelector;
@@ -1218,7 +1347,7 @@ TEST_F(ClientProxyTest, NotLogSessionForStoppedAdvertisingWithConnection) {
 
   // After
   StopAdvertising(client1());  // No Advertising
-  EXPECT_EQ(event_logger1_.GetCompleteClientSessionCount(), 0);
+  EXPECT_EQ(GetCompleteClientSessionCount(client1(), event_logger1_), 0);
 }
 
 TEST_F(ClientProxyTest,
@@ -1231,11 +1360,11 @@ TEST_F(ClientProxyTest,
       advertising_endpoint.id));             // No Connections
   EXPECT_FALSE(client1()->IsDiscovering());  // No Discovery
   EXPECT_TRUE(client1()->IsAdvertising());   // Advertising
-  EXPECT_EQ(event_logger1_.GetCompleteClientSessionCount(), 0);
+  EXPECT_EQ(GetCompleteClientSessionCount(client1(), event_logger1_), 0);
 
   // After
   StopAdvertising(client1());
-  EXPECT_GT(event_logger1_.GetCompleteClientSessionCount(), 0);
+  EXPECT_GT(GetCompleteClientSessionCount(client1(), event_logger1_), 0);
 }
 
 TEST_F(ClientProxyTest, NotLogSessionForStoppedDiscoveryWithConnection) {
@@ -1253,7 +1382,7 @@ TEST_F(ClientProxyTest, NotLogSessionForStoppedDiscoveryWithConnection) {
 
   // After
   StopDiscovery(client2());
-  EXPECT_EQ(event_logger2_.GetCompleteClientSessionCount(), 0);
+  EXPECT_EQ(GetCompleteClientSessionCount(client2(), event_logger2_), 0);
 }
 
 TEST_F(ClientProxyTest,
@@ -1271,7 +1400,7 @@ TEST_F(ClientProxyTest,
 
   // After
   StopDiscovery(client2());
-  EXPECT_GT(event_logger2_.GetCompleteClientSessionCount(), 0);
+  EXPECT_GT(GetCompleteClientSessionCount(client2(), event_logger2_), 0);
 }
 
 TEST_F(ClientProxyTest, LogSessionOnDisconnectedWithOneConnection) {
@@ -1289,7 +1418,7 @@ TEST_F(ClientProxyTest, LogSessionOnDisconnectedWithOneConnection) {
 
   // After
   OnDiscoveryConnectionDisconnected(client2(), advertising_endpoint);
-  EXPECT_GT(event_logger2_.GetCompleteClientSessionCount(), 0);
+  EXPECT_GT(GetCompleteClientSessionCount(client2(), event_logger2_), 0);
 }
 
 TEST_F(ClientProxyTest,
@@ -1305,7 +1434,7 @@ TEST_F(ClientProxyTest,
 
   // After
   client2()->OnDisconnected(advertising_endpoint.id, /*notify=*/false);
-  EXPECT_EQ(event_logger2_.GetCompleteClientSessionCount(), 0);
+  EXPECT_EQ(GetCompleteClientSessionCount(client2(), event_logger2_), 0);
 }
 
 TEST_F(ClientProxyTest, NotLogSessionOnDisconnectedWhenMoreThanOneConnection) {
@@ -1332,7 +1461,7 @@ TEST_F(ClientProxyTest, NotLogSessionOnDisconnectedWhenMoreThanOneConnection) {
 
   // After
   client2()->OnDisconnected(advertising_endpoint_1.id, /*notify=*/false);
-  EXPECT_EQ(event_logger2_.GetCompleteClientSessionCount(), 0);
+  EXPECT_EQ(GetCompleteClientSessionCount(client2(), event_logger2_), 0);
 }
 
 TEST_F(ClientProxyTest,
@@ -1353,7 +1482,7 @@ TEST_F(ClientProxyTest,
   OnDiscoveryConnectionDisconnected(client2(), advertising_endpoint);
   // Since we are no longer checking IsDiscovering(), we complete sessions now
   // solely based on advertising.
-  EXPECT_EQ(event_logger2_.GetCompleteClientSessionCount(), 1);
+  EXPECT_EQ(GetCompleteClientSessionCount(client2(), event_logger2_), 1);
 }
 
 TEST_F(ClientProxyTest, LogSessionForResetClientProxy) {
@@ -1363,14 +1492,14 @@ TEST_F(ClientProxyTest, LogSessionForResetClientProxy) {
   OnDiscoveryEndpointFound(client2(), advertising_endpoint);
   OnDiscoveryConnectionInitiated(client2(), advertising_endpoint);
 
-  EXPECT_EQ(event_logger1_.GetCompleteClientSessionCount(), 0);
+  EXPECT_EQ(GetCompleteClientSessionCount(client1(), event_logger1_), 0);
   client1()->Reset();
   // TODO(b/290936886): Why are there more than one complete sessions?
-  EXPECT_GT(event_logger1_.GetCompleteClientSessionCount(), 0);
+  EXPECT_GT(GetCompleteClientSessionCount(client1(), event_logger1_), 0);
 
-  EXPECT_EQ(event_logger2_.GetCompleteClientSessionCount(), 0);
+  EXPECT_EQ(GetCompleteClientSessionCount(client2(), event_logger2_), 0);
   client2()->Reset();
-  EXPECT_GT(event_logger2_.GetCompleteClientSessionCount(), 0);
+  EXPECT_GT(GetCompleteClientSessionCount(client2(), event_logger2_), 0);
 }
 
 TEST_F(ClientProxyTest, GetLocalInfoCorrect) {
@@ -1409,6 +1538,69 @@ TEST_F(ClientProxyTest, SetRemoteInfoCorrect) {
       nearby_connections_version);
 }
 
+TEST_F(ClientProxyTest, ChunkedBytesPayloadNeedsBothSides) {
+  FeatureFlags::Flags flags;
+  flags.enable_chunked_bytes_payload = true;
+  MediumEnvironment::Instance().SetFeatureFlags(flags);
+  Endpoint advertising_endpoint =
+      StartAdvertising(client1(), advertising_connection_listener_);
+  OnAdvertisingConnectionInitiated(client1(), advertising_endpoint);
+  // A high safe-to-disconnect version alone doesn't enable it.
+  client1()->SetRemoteSafeToDisconnectVersion(advertising_endpoint.id, 100);
+  EXPECT_FALSE(
+      client1()->IsChunkedBytesPayloadEnabled(advertising_endpoint.id));
+
+  client1()->SetRemoteCapabilityBitmask(advertising_endpoint.id,
+                                        ClientProxy::kChunkedBytesPayload);
+  EXPECT_TRUE(client1()->IsChunkedBytesPayloadEnabled(advertising_endpoint.id));
+
+  flags.enable_chunked_bytes_payload = false;
+  MediumEnvironment::Instance().SetFeatureFlags(flags);
+  EXPECT_FALSE(
+      client1()->IsChunkedBytesPayloadEnabled(advertising_endpoint.id));
+}
+
+TEST_F(ClientProxyTest, CapabilitiesAreNegotiatedSeparately) {
+  FeatureFlags::Flags flags;
+  flags.enable_chunked_bytes_payload = true;
+  flags.enable_aes_gcm_record_layer = true;
+  MediumEnvironment::Instance().SetFeatureFlags(flags);
+  Endpoint advertising_endpoint =
+      StartAdvertising(client1(), advertising_connection_listener_);
+  OnAdvertisingConnectionInitiated(client1(), advertising_endpoint);
+
+  client1()->SetRemoteCapabilityBitmask(advertising_endpoint.id,
+                                        ClientProxy::kAesGcmRecordLayer);
+
+  EXPECT_TRUE(client1()->IsAesGcmRecordLayerEnabled(advertising_endpoint.id));
+  EXPECT_FALSE(
+      client1()->IsChunkedBytesPayloadEnabled(advertising_endpoint.id));
+  MediumEnvironment::Instance().SetFeatureFlags(FeatureFlags::Flags());
+}
+
+TEST_F(ClientProxyTest, PayloadCompressionNeedsBothSides) {
+  FeatureFlags::Flags flags;
+  flags.enable_payload_compression = true;
+  MediumEnvironment::Instance().SetFeatureFlags(flags);
+  Endpoint advertising_endpoint =
+      StartAdvertising(client1(), advertising_connection_listener_);
+  OnAdvertisingConnectionInitiated(client1(), advertising_endpoint);
+  // A high safe-to-disconnect version alone doesn't enable it.
+  client1()->SetRemoteSafeToDisconnectVersion(advertising_endpoint.id, 100);
+  EXPECT_FALSE(
+      client1()->IsPayloadCompressionEnabled(advertising_endpoint.id));
+
+  client1()->SetRemoteCapabilityBitmask(advertising_endpoint.id,
+                                        ClientProxy::kPayloadCompression);
+  EXPECT_TRUE(client1()->IsPayloadCompressionEnabled(advertising_endpoint.id));
+
+  flags.enable_payload_compression = false;
+  MediumEnvironment::Instance().SetFeatureFlags(flags);
+  EXPECT_FALSE(
+      client1()->IsPayloadCompressionEnabled(advertising_endpoint.id));
+  MediumEnvironment::Instance().SetFeatureFlags(FeatureFlags::Flags());
+}
+
 // Test ClientProxy::AddCancellationFlag, where if a flag is already in the map,
 // uncancel it. This addresses the case when users use NS to share/receive a
 // file, then cancel in the middle because the wrong file was selected, and then
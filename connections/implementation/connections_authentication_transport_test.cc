@@ -65,9 +65,12 @@ class MockEndpointChannel : public EndpointChannel {
   MOCK_METHOD(int, GetFrequency, (), (const, override));
   MOCK_METHOD(int, GetTryCount, (), (const, override));
   MOCK_METHOD(int, GetMaxTransmitPacketSize, (), (const, override));
-  MOCK_METHOD(void, EnableEncryption, (std::shared_ptr<EncryptionContext>),
+  MOCK_METHOD(void, EnableEncryption,
+              (std::shared_ptr<EncryptionContext>,
+               std::shared_ptr<AesGcmRecordLayer>),
               (override));
   MOCK_METHOD(void, DisableEncryption, (), (override));
+  MOCK_METHOD(void, EnableAesGcmRecordLayer, (), (override));
   MOCK_METHOD(bool, IsEncrypted, (), (override));
   MOCK_METHOD(ExceptionOr<ByteArray>, TryDecrypt, (const ByteArray& data),
               (override));
@@ -92,8 +92,11 @@ class FakeEndpointChannel : public EndpointChannel {
   std::string GetName() const override { return "fake-channel"; }
   Medium GetMedium() const override { return Medium::BLE; }
   int GetMaxTransmitPacketSize() const override { return 512; }
-  void EnableEncryption(std::shared_ptr<EncryptionContext> context) override {}
+  void EnableEncryption(
+      std::shared_ptr<EncryptionContext> context,
+      std::shared_ptr<AesGcmRecordLayer> record_layer) override {}
   void DisableEncryption() override {}
+  void EnableAesGcmRecordLayer() override {}
   bool IsEncrypted() override { return false; }
   ExceptionOr<ByteArray> TryDecrypt(const ByteArray& data) override {
     return Exception::kFailed;
@@ -21,6 +21,7 @@
 
 #include "securegcm/d2d_connection_context_v1.h"
 #include "absl/time/time.h"
+#include "connections/implementation/aes_gcm_record_layer.h"
 #include "connections/implementation/analytics/analytics_recorder.h"
 #include "connections/implementation/analytics/packet_meta_data.h"
 #include "internal/platform/byte_array.h"
@@ -96,12 +97,23 @@ class EndpointChannel {
   // transport.
   virtual int GetMaxTransmitPacketSize() const = 0;
 
-  // Enables encryption on the EndpointChannel.
-  virtual void EnableEncryption(std::shared_ptr<EncryptionContext> context) = 0;
+  // Enables encryption on the EndpointChannel. `record_layer` is the
+  // endpoint's AES-GCM record layer, shared by all its channels, or null if
+  // it doesn't have one.
+  virtual void EnableEncryption(
+      std::shared_ptr<EncryptionContext> context,
+      std::shared_ptr<AesGcmRecordLayer> record_layer) = 0;
 
   // Disables encryption on the EndpointChannel.
   virtual void DisableEncryption() = 0;
 
+  // Seals subsequent writes with the AES-GCM record layer instead of the
+  // encryption context, once the remote endpoint has advertised support for
+  // it. Channels that later replace this one share the record layer, so they
+  // keep writing records. No-op if encryption is not enabled or there is no
+  // record layer.
+  virtual void EnableAesGcmRecordLayer() = 0;
+
   // Returns true if EndpointChannel is encrypted.
   virtual bool IsEncrypted() = 0;
 
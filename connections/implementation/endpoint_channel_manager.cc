@@ -19,10 +19,12 @@
 #include <utility>
 
 #include "absl/time/time.h"
+#include "connections/implementation/aes_gcm_record_layer.h"
 #include "connections/implementation/client_proxy.h"
 #include "connections/implementation/endpoint_channel.h"
 #include "connections/implementation/offline_frames.h"
 #include "internal/platform/condition_variable.h"
+#include "internal/platform/feature_flags.h"
 #include "internal/platform/implementation/system_clock.h"
 #include "internal/platform/logging.h"
 #include "internal/platform/mutex.h"
@@ -166,7 +168,8 @@ bool EndpointChannelManager::ChannelState::EncryptChannel(
     EndpointChannelManager::ChannelState::EndpointData* endpoint) {
   if (endpoint != nullptr && endpoint->channel != nullptr &&
       endpoint->context != nullptr) {
-    endpoint->channel->EnableEncryption(endpoint->context);
+    endpoint->channel->EnableEncryption(endpoint->context,
+                                        endpoint->record_layer);
     return true;
   }
   return false;
@@ -198,7 +201,15 @@ void EndpointChannelManager::ChannelState::UpdateEncryptionContextForEndpoint(
     const std::string& endpoint_id,
     std::unique_ptr<EncryptionContext> context) {
   // Create EndpointData instance, if necessary, and populate crypto context.
-  endpoints_[endpoint_id].context = std::move(context);
+  EndpointData& endpoint = endpoints_[endpoint_id];
+  endpoint.context = std::move(context);
+  endpoint.record_layer.reset();
+  // If we don't advertise the AES-GCM record layer, the remote never switches
+  // to it, so don't bother deriving keys.
+  if (endpoint.context != nullptr &&
+      FeatureFlags::GetInstance().GetFlags().enable_aes_gcm_record_layer) {
+    endpoint.record_layer = AesGcmRecordLayer::Create(*endpoint.context);
+  }
 }
 
 void EndpointChannelManager::ChannelState::UpdateSafeToDisconnectForEndpoint(
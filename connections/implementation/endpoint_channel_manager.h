@@ -142,6 +142,11 @@ class EndpointChannelManager final {
 
       std::shared_ptr<EndpointChannel> channel;
       std::shared_ptr<EncryptionContext> context;
+      // Derived from `context` when we support the AES-GCM record layer, and
+      // handed to every channel of the endpoint along with it, so a channel
+      // that replaces another carries on with its sequence numbers and keeps
+      // writing records if it did. May be null.
+      std::shared_ptr<AesGcmRecordLayer> record_layer;
       DisconnectionReason disconnect_reason =
           DisconnectionReason::UNKNOWN_DISCONNECTION_REASON;
       bool safe_to_disconnect_enabled = false;
@@ -170,7 +175,8 @@ class EndpointChannelManager final {
     void UpdateChannelForEndpoint(const std::string& endpoint_id,
                                   std::unique_ptr<EndpointChannel> channel);
 
-    // Stores a new EncryptionContext for the endpoint.
+    // Stores a new EncryptionContext for the endpoint, and the record layer
+    // derived from it.
     // Prevoius one is destroyed, if it existed.
     void UpdateEncryptionContextForEndpoint(
         const std::string& endpoint_id,
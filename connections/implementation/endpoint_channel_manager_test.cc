@@ -19,6 +19,7 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "securegcm/ukey2_handshake.h"
 #include "gmock/gmock.h"
@@ -27,6 +28,7 @@
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
+#include "connections/implementation/aes_gcm_record_layer.h"
 #include "connections/implementation/base_endpoint_channel.h"
 #include "connections/implementation/client_proxy.h"
 #include "connections/implementation/encryption_runner.h"
@@ -34,6 +36,7 @@
 #include "internal/platform/byte_array.h"
 #include "internal/platform/count_down_latch.h"
 #include "internal/platform/exception.h"
+#include "internal/platform/feature_flags.h"
 #include "internal/platform/input_stream.h"
 #include "internal/platform/logging.h"
 #include "internal/platform/multi_thread_executor.h"
@@ -107,6 +110,23 @@ std::function<void(const ByteArray&)> MakeDataMonitor(absl::string_view label,
   };
 }
 
+// Splits what a data pump saw into the frames BaseEndpointChannel wrote, each
+// a 4 byte big endian length followed by the frame.
+std::vector<std::string> SplitFrames(absl::string_view stream) {
+  std::vector<std::string> frames;
+  while (stream.size() >= 4) {
+    size_t length = (static_cast<size_t>(stream[0] & 0xFF) << 24) |
+                    (static_cast<size_t>(stream[1] & 0xFF) << 16) |
+                    (static_cast<size_t>(stream[2] & 0xFF) << 8) |
+                    static_cast<size_t>(stream[3] & 0xFF);
+    stream.remove_prefix(4);
+    if (stream.size() < length) break;
+    frames.emplace_back(stream.substr(0, length));
+    stream.remove_prefix(length);
+  }
+  return frames;
+}
+
 std::pair<std::unique_ptr<EncryptionContext>,
           std::unique_ptr<EncryptionContext>>
 DoDhKeyExchange(BaseEndpointChannel* channel_a,
@@ -317,6 +337,151 @@ TEST(BaseEndpointChannelManagerTest, ReplaceChannelNoEncrypted) {
         std::string(kEndpointId), DisconnectionReason::REMOTE_DISCONNECTION,
         ConnectionsLog::EstablishedConnection::SAFE_DISCONNECTION);}
 
+TEST(BaseEndpointChannelManagerTest, ReplacedChannelCarriesOnWithRecords) {
+  FeatureFlags::Flags flags = FeatureFlags::GetInstance().GetFlags();
+  flags.enable_aes_gcm_record_layer = true;
+  FeatureFlags::ScopedFlagsForTesting scoped_flags(flags);
+  // Setup test communication environment: a Bluetooth link first, then a
+  // Wi-Fi LAN link it's upgraded to. Data pump "a" carries what endpoint "a"
+  // writes to endpoint "b", and data pump "b" the other way.
+  absl::Mutex mutex;
+  std::string capture_a;
+  std::string capture_b;
+  std::string upgraded_capture_a;
+  std::string upgraded_capture_b;
+  ClientProxy proxy_a;
+  ClientProxy proxy_b;
+  auto client_a = CreatePipe();
+  auto client_b = CreatePipe();
+  auto server_a = CreatePipe();
+  auto server_b = CreatePipe();
+  auto upgraded_client_a = CreatePipe();
+  auto upgraded_client_b = CreatePipe();
+  auto upgraded_server_a = CreatePipe();
+  auto upgraded_server_b = CreatePipe();
+  auto channel_a = std::make_unique<MockEndpointChannel>(server_a.first.get(),
+                                                         client_a.second.get());
+  auto channel_b = std::make_unique<MockEndpointChannel>(server_b.first.get(),
+                                                         client_b.second.get());
+  auto upgraded_channel_a = std::make_unique<MockEndpointChannel>(
+      upgraded_server_a.first.get(), upgraded_client_a.second.get());
+  auto upgraded_channel_b = std::make_unique<MockEndpointChannel>(
+      upgraded_server_b.first.get(), upgraded_client_b.second.get());
+  auto channel_a_raw = channel_a.get();
+  auto channel_b_raw = channel_b.get();
+  auto upgraded_channel_a_raw = upgraded_channel_a.get();
+  auto upgraded_channel_b_raw = upgraded_channel_b.get();
+  for (auto* channel : {channel_a_raw, channel_b_raw}) {
+    ON_CALL(*channel, GetMedium).WillByDefault([]() {
+      return Medium::BLUETOOTH;
+    });
+  }
+  for (auto* channel : {upgraded_channel_a_raw, upgraded_channel_b_raw}) {
+    ON_CALL(*channel, GetMedium).WillByDefault([]() {
+      return Medium::WIFI_LAN;
+    });
+  }
+
+  MultiThreadExecutor executor(4);
+  executor.Execute(
+      MakeDataPump(kPumpA, client_a.first.get(), server_b.second.get(),
+                   MakeDataMonitor(kMonitorA, &capture_a, &mutex)));
+  executor.Execute(
+      MakeDataPump(kPumpB, client_b.first.get(), server_a.second.get(),
+                   MakeDataMonitor(kMonitorB, &capture_b, &mutex)));
+  executor.Execute(MakeDataPump(
+      kPumpA, upgraded_client_a.first.get(), upgraded_server_b.second.get(),
+      MakeDataMonitor(kMonitorA, &upgraded_capture_a, &mutex)));
+  executor.Execute(MakeDataPump(
+      kPumpB, upgraded_client_b.first.get(), upgraded_server_a.second.get(),
+      MakeDataMonitor(kMonitorB, &upgraded_capture_b, &mutex)));
+
+  // Run DH key exchange; setup encryption contexts for channels.
+  auto context = DoDhKeyExchange(channel_a.get(), channel_b.get());
+  ASSERT_NE(context.first, nullptr);
+  ASSERT_NE(context.second, nullptr);
+  // Opens what "a" writes with "b"'s keys, from the first record on, to
+  // check the nonces "a" seals them with.
+  std::unique_ptr<EncryptionContext> reference_context =
+      EncryptionContext::FromSavedSession(*context.second->SaveSession());
+  ASSERT_NE(reference_context, nullptr);
+  std::unique_ptr<AesGcmRecordLayer> reference =
+      AesGcmRecordLayer::Create(*reference_context);
+  ASSERT_NE(reference, nullptr);
+
+  EndpointChannelManager ecm_a;
+  ecm_a.EncryptChannelForEndpoint(std::string(kEndpointId),
+                                  std::move(context.first));
+  ecm_a.RegisterChannelForEndpoint(&proxy_a, std::string(kEndpointId),
+                                   std::move(channel_a));
+  EndpointChannelManager ecm_b;
+  ecm_b.EncryptChannelForEndpoint(std::string(kEndpointId),
+                                  std::move(context.second));
+  ecm_b.RegisterChannelForEndpoint(&proxy_b, std::string(kEndpointId),
+                                   std::move(channel_b));
+  channel_a_raw->EnableAesGcmRecordLayer();
+  channel_b_raw->EnableAesGcmRecordLayer();
+
+  ByteArray tx_message{"data message"};
+  for (int i = 0; i < 2; ++i) {
+    channel_a_raw->Write(tx_message);
+    ExceptionOr<ByteArray> rx_message = channel_b_raw->Read();
+    ASSERT_TRUE(rx_message.ok());
+    EXPECT_EQ(rx_message.result(), tx_message);
+  }
+
+  // Upgrade: the old channels are closed and the new ones take over.
+  channel_a_raw->Close(DisconnectionReason::UPGRADED);
+  channel_b_raw->Close(DisconnectionReason::UPGRADED);
+  ecm_a.ReplaceChannelForEndpoint(&proxy_a, std::string(kEndpointId),
+                                  std::move(upgraded_channel_a), true);
+  ecm_b.ReplaceChannelForEndpoint(&proxy_b, std::string(kEndpointId),
+                                  std::move(upgraded_channel_b), true);
+  EXPECT_EQ(upgraded_channel_a_raw->GetType(), "ENCRYPTED_WIFI_LAN");
+
+  for (int i = 0; i < 2; ++i) {
+    upgraded_channel_a_raw->Write(tx_message);
+    ExceptionOr<ByteArray> rx_message = upgraded_channel_b_raw->Read();
+    ASSERT_TRUE(rx_message.ok());
+    EXPECT_EQ(rx_message.result(), tx_message);
+  }
+  upgraded_channel_b_raw->Write(tx_message);
+  ExceptionOr<ByteArray> rx_message = upgraded_channel_a_raw->Read();
+  ASSERT_TRUE(rx_message.ok());
+  EXPECT_EQ(rx_message.result(), tx_message);
+
+  // Verify expectations: "a" wrote records on both channels, and their
+  // sequence numbers carried on across the upgrade.
+  std::vector<std::string> records;
+  {
+    absl::MutexLock lock(&mutex);
+    for (const std::string* capture : {&capture_a, &upgraded_capture_a}) {
+      for (std::string& frame : SplitFrames(*capture)) {
+        if (AesGcmRecordLayer::IsRecord(frame)) {
+          records.push_back(std::move(frame));
+        }
+      }
+    }
+    EXPECT_EQ(SplitFrames(upgraded_capture_a).size(), 2);
+  }
+  ASSERT_EQ(records.size(), 4);
+  for (const std::string& record : records) {
+    std::optional<std::string> plaintext = reference->Open(record);
+    ASSERT_TRUE(plaintext.has_value());
+    EXPECT_EQ(*plaintext, std::string(tx_message));
+  }
+
+  // Shutdown test environment.
+  upgraded_channel_a_raw->Close(DisconnectionReason::LOCAL_DISCONNECTION);
+  upgraded_channel_b_raw->Close(DisconnectionReason::REMOTE_DISCONNECTION);
+  ecm_a.UnregisterChannelForEndpoint(
+      std::string(kEndpointId), DisconnectionReason::LOCAL_DISCONNECTION,
+      ConnectionsLog::EstablishedConnection::SAFE_DISCONNECTION);
+  ecm_b.UnregisterChannelForEndpoint(
+      std::string(kEndpointId), DisconnectionReason::REMOTE_DISCONNECTION,
+      ConnectionsLog::EstablishedConnection::SAFE_DISCONNECTION);
+}
+
 }  // namespace
 }  // namespace connections
 }  // namespace nearby
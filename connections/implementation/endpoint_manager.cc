@@ -24,6 +24,7 @@
 #include "absl/functional/any_invocable.h"
 #include "absl/time/time.h"
 #include "connections/connection_options.h"
+#include "connections/implementation/analytics/connection_quality_recorder.h"
 #include "connections/implementation/analytics/packet_meta_data.h"
 #include "connections/implementation/analytics/throughput_recorder.h"
 #include "connections/implementation/client_proxy.h"
@@ -45,6 +46,7 @@
 #include "internal/platform/mutex_lock.h"
 #include "internal/platform/runnable.h"
 #include "internal/platform/single_thread_executor.h"
+#include "internal/platform/trace.h"
 #include "internal/proto/analytics/connections_log.pb.h"
 #include "proto/connections_enums.pb.h"
 
@@ -69,6 +71,13 @@ constexpr absl::Time kInvalidTimestamp = absl::InfinitePast();
 // The maximum time we will wait for the encryption setup during negotiating a
 // connection.
 constexpr absl::Duration kDecryptRetryTimeout = absl::Seconds(3);
+
+constexpr TraceEvent kFrameReceivedTrace = {
+    "connections", "FrameReceived", {"frame_type", "size", "medium"}};
+constexpr TraceEvent kKeepAliveReceivedTrace = {
+    "connections", "KeepAliveReceived", {"seq_num", "ack"}};
+constexpr TraceEvent kKeepAliveSentTrace = {
+    "connections", "KeepAliveSent", {"seq_num"}};
 }  // namespace
 
 class EndpointManager::LockedFrameProcessor {
@@ -241,6 +250,8 @@ ExceptionOr<bool> EndpointManager::HandleData(
       LOG(INFO) << "Stop reading on read-time exception: " << bytes.exception();
       return ExceptionOr<bool>(bytes.exception());
     }
+    client->GetConnectionQualityRecorder().OnFrameReceived(
+        endpoint_id, endpoint_channel->GetMedium(), packet_meta_data);
     ExceptionOr<OfflineFrame> wrapped_frame = parser::FromBytes(bytes.result());
     if (!wrapped_frame.ok() && try_decrypting) {
       // Workaround for a race condition where the remote party has sent an
@@ -275,6 +286,8 @@ ExceptionOr<bool> EndpointManager::HandleData(
 
     // Route the incoming offlineFrame to its registered processor.
     V1Frame::FrameType frame_type = parser::GetFrameType(frame);
+    NEARBY_TRACE(kFrameReceivedTrace, frame_type, bytes.result().size(),
+                 endpoint_channel->GetMedium());
     LockedFrameProcessor frame_processor = GetFrameProcessor(frame_type);
     if (!frame_processor) {
       // report messages without handlers, except KEEP_ALIVE, which has
@@ -285,10 +298,15 @@ ExceptionOr<bool> EndpointManager::HandleData(
         uint32_t seq_num =
             keep_alive_frame.has_seq_num() ? keep_alive_frame.seq_num() : 0;
 
-        LOG(INFO) << "Received a KEEP_ALIVE frame (ack:" << ack
-                  << ",seq:" << seq_num << ") from endpoint " << endpoint_id
-                  << " on channel " << endpoint_channel->GetType()
-                  << (ack ? "" : " and reply a KEEP_ALIVE ACK frame.");
+        NEARBY_TRACE(kKeepAliveReceivedTrace, seq_num, ack);
+        VLOG(1) << "Received a KEEP_ALIVE frame (ack:" << ack
+                << ",seq:" << seq_num << ") from endpoint " << endpoint_id
+                << " on channel " << endpoint_channel->GetType()
+                << (ack ? "" : " and reply a KEEP_ALIVE ACK frame.");
+        if (ack) {
+          client->GetConnectionQualityRecorder().OnKeepAliveAckReceived(
+              endpoint_id, seq_num);
+        }
         if (!ack && !endpoint_channel->IsPaused()) {
           Exception write_exception = endpoint_channel->Write(
               parser::ForKeepAlive(/*ack=*/true, /*seq_num=*/seq_num));
@@ -373,7 +391,9 @@ void EndpointManager::ProcessDisconnectionFrame(
 }
 
 ExceptionOr<bool> EndpointManager::HandleKeepAlive(
-    EndpointChannel* endpoint_channel, absl::Duration keep_alive_interval,
+    const std::string& endpoint_id, ClientProxy* client_proxy,
+    EndpointChannel* endpoint_channel,
+    absl::Duration keep_alive_interval,
     absl::Duration keep_alive_timeout, Mutex* keep_alive_waiter_mutex,
     ConditionVariable* keep_alive_waiter) {
   // Check if it has been too long since we received a frame from our endpoint.
@@ -406,9 +426,12 @@ ExceptionOr<bool> EndpointManager::HandleKeepAlive(
                  << seq_num << ") on channel " << endpoint_channel->GetType();
       return ExceptionOr<bool>(write_exception);
     }
+    client_proxy->GetConnectionQualityRecorder().OnKeepAliveSent(endpoint_id,
+                                                                 seq_num);
     duration_until_write_keep_alive = keep_alive_interval;
-    LOG(INFO) << "Sent a KEEP_ALIVE frame (ack:false, seq_num:" << seq_num
-              << ") on channel " << endpoint_channel->GetType();
+    NEARBY_TRACE(kKeepAliveSentTrace, seq_num);
+    VLOG(1) << "Sent a KEEP_ALIVE frame (ack:false, seq_num:" << seq_num
+            << ") on channel " << endpoint_channel->GetType();
   }
 
   absl::Duration wait_for =
@@ -615,12 +638,14 @@ void EndpointManager::RegisterEndpoint(
                                  ConditionVariable* keep_alive_waiter) {
               EndpointChannelLoopRunnable(
                   "KeepAliveManager", client, endpoint_id,
-                  [this, keep_alive_interval, keep_alive_timeout,
-                   keep_alive_waiter_mutex,
+                  [this, client, endpoint_id, keep_alive_interval,
+                   keep_alive_timeout, keep_alive_waiter_mutex,
                    keep_alive_waiter](EndpointChannel* channel) {
-                    return HandleKeepAlive(
-                        channel, keep_alive_interval, keep_alive_timeout,
-                        keep_alive_waiter_mutex, keep_alive_waiter);
+                    return HandleKeepAlive(endpoint_id, client, channel,
+                                           keep_alive_interval,
+                                           keep_alive_timeout,
+                                           keep_alive_waiter_mutex,
+                                           keep_alive_waiter);
                   });
             });
         LOG(INFO) << "Registering endpoint " << endpoint_id
@@ -659,7 +684,19 @@ int EndpointManager::GetMaxTransmitPacketSize(const std::string& endpoint_id) {
   return channel->GetMaxTransmitPacketSize();
 }
 
+location::nearby::proto::connections::Medium EndpointManager::GetMedium(
+    const std::string& endpoint_id) {
+  std::shared_ptr<EndpointChannel> channel =
+      channel_manager_->GetChannelForEndpoint(endpoint_id);
+  if (channel == nullptr) {
+    return location::nearby::proto::connections::UNKNOWN_MEDIUM;
+  }
+
+  return channel->GetMedium();
+}
+
 std::vector<std::string> EndpointManager::SendPayloadChunk(
+    ClientProxy* client,
     const PayloadTransferFrame::PayloadHeader& payload_header,
     const PayloadTransferFrame::PayloadChunk& payload_chunk,
     const std::vector<std::string>& endpoint_ids,
@@ -668,7 +705,7 @@ std::vector<std::string> EndpointManager::SendPayloadChunk(
       parser::ForDataPayloadTransfer(payload_header, payload_chunk);
 
   return SendTransferFrameBytes(
-      endpoint_ids, bytes, payload_header.id(),
+      client, endpoint_ids, bytes, payload_header.id(),
       /*offset=*/payload_chunk.offset(),
       /*packet_type=*/
       PayloadTransferFrame::PacketType_Name(PayloadTransferFrame::DATA),
@@ -736,14 +773,14 @@ void EndpointManager::DiscardEndpoint(ClientProxy* client,
 }
 
 std::vector<std::string> EndpointManager::SendControlMessage(
-    const PayloadTransferFrame::PayloadHeader& header,
+    ClientProxy* client, const PayloadTransferFrame::PayloadHeader& header,
     const PayloadTransferFrame::ControlMessage& control,
     const std::vector<std::string>& endpoint_ids) {
   ByteArray bytes = parser::ForControlPayloadTransfer(header, control);
   PacketMetaData packet_meta_data;
 
   return SendTransferFrameBytes(
-      endpoint_ids, bytes, header.id(),
+      client, endpoint_ids, bytes, header.id(),
       /*offset=*/control.offset(),
       /*packet_type=*/
       PayloadTransferFrame::PacketType_Name(PayloadTransferFrame::CONTROL),
@@ -800,6 +837,7 @@ void EndpointManager::RemoveEndpoint(ClientProxy* client,
     LOG(INFO) << "Removed endpoint for endpoint " << endpoint_id;
   }
   RemoveEndpointState(endpoint_id);
+  client->GetConnectionQualityRecorder().OnEndpointRemoved(endpoint_id);
 }
 
 bool EndpointManager::ApplySafeToDisconnect(const std::string& endpoint_id,
@@ -922,12 +960,13 @@ CountDownLatch EndpointManager::NotifyFrameProcessorsOnEndpointDisconnect(
 }
 
 std::vector<std::string> EndpointManager::SendPayloadAck(
-    std::int64_t payload_id, const std::vector<std::string>& endpoint_ids) {
+    ClientProxy* client, std::int64_t payload_id,
+    const std::vector<std::string>& endpoint_ids) {
   ByteArray bytes = parser::ForPayloadAckPayloadTransfer(payload_id);
   PacketMetaData packet_meta_data;
 
   return SendTransferFrameBytes(
-      endpoint_ids, bytes, payload_id,
+      client, endpoint_ids, bytes, payload_id,
       /* offset= */ -1,
       /*packet_type=*/
       PayloadTransferFrame::PacketType_Name(PayloadTransferFrame::PAYLOAD_ACK),
@@ -935,7 +974,8 @@ std::vector<std::string> EndpointManager::SendPayloadAck(
 }
 
 std::vector<std::string> EndpointManager::SendTransferFrameBytes(
-    const std::vector<std::string>& endpoint_ids, const ByteArray& bytes,
+    ClientProxy* client, const std::vector<std::string>& endpoint_ids,
+    const ByteArray& bytes,
     std::int64_t payload_id, std::int64_t offset,
     const std::string& packet_type, PacketMetaData& packet_meta_data) {
   std::vector<std::string> failed_endpoint_ids;
@@ -959,9 +999,12 @@ std::vector<std::string> EndpointManager::SendTransferFrameBytes(
     Exception write_exception = channel->Write(bytes, packet_meta_data);
     if (!write_exception.Ok()) {
       failed_endpoint_ids.push_back(endpoint_id);
+      client->GetConnectionQualityRecorder().OnWriteFailed(endpoint_id);
       LOG(INFO) << "Failed to send packet; endpoint_id=" << endpoint_id;
       continue;
     }
+    client->GetConnectionQualityRecorder().OnFrameSent(
+        endpoint_id, channel->GetMedium(), packet_meta_data);
     analytics::ThroughputRecorderContainer::GetInstance()
         .GetTPRecorder(payload_id, PayloadDirection::OUTGOING_PAYLOAD)
         ->OnFrameSent(channel->GetMedium(), packet_meta_data);
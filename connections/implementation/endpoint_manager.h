@@ -38,6 +38,7 @@
 #include "internal/platform/count_down_latch.h"
 #include "internal/platform/runnable.h"
 #include "internal/platform/single_thread_executor.h"
+#include "proto/connections_enums.pb.h"
 
 namespace nearby {
 namespace connections {
@@ -125,10 +126,16 @@ class EndpointManager {
   // transport.
   int GetMaxTransmitPacketSize(const std::string& endpoint_id);
 
+  // Returns the medium of the endpoint's current channel, which changes after
+  // a bandwidth upgrade.
+  location::nearby::proto::connections::Medium GetMedium(
+      const std::string& endpoint_id);
+
   // Returns the list of endpoints to which sending this chunk failed.
   //
   // Invoked from the PayloadManager's sendPayload() method.
   std::vector<std::string> SendPayloadChunk(
+      ClientProxy* client,
       const location::nearby::connections::PayloadTransferFrame::PayloadHeader&
           payload_header,
       const location::nearby::connections::PayloadTransferFrame::PayloadChunk&
@@ -136,6 +143,7 @@ class EndpointManager {
       const std::vector<std::string>& endpoint_ids,
       analytics::PacketMetaData& packet_meta_data);
   std::vector<std::string> SendControlMessage(
+      ClientProxy* client,
       const location::nearby::connections::PayloadTransferFrame::PayloadHeader&
           payload_header,
       const location::nearby::connections::PayloadTransferFrame::ControlMessage&
@@ -144,7 +152,8 @@ class EndpointManager {
   // Receiver sends this frame when all the packets are received. Returns the
   // list of endpoints to which sending this frame failed.
   std::vector<std::string> SendPayloadAck(
-      std::int64_t payload_id, const std::vector<std::string>& endpoint_ids);
+      ClientProxy* client, std::int64_t payload_id,
+      const std::vector<std::string>& endpoint_ids);
   // Called when we internally want to get rid of the endpoint, without the
   // client directly telling us to. For example...
   //    a) We failed to read from the endpoint in its dedicated reader thread.
@@ -235,7 +244,9 @@ class EndpointManager {
                                ClientProxy* client_proxy,
                                EndpointChannel* endpoint_channel);
 
-  ExceptionOr<bool> HandleKeepAlive(EndpointChannel* endpoint_channel,
+  ExceptionOr<bool> HandleKeepAlive(const std::string& endpoint_id,
+                                    ClientProxy* client_proxy,
+                                    EndpointChannel* endpoint_channel,
                                     absl::Duration keep_alive_interval,
                                     absl::Duration keep_alive_timeout,
                                     Mutex* keep_alive_waiter_mutex,
@@ -282,7 +293,7 @@ class EndpointManager {
       const std::string& endpoint_id, DisconnectionReason reason);
 
   std::vector<std::string> SendTransferFrameBytes(
-      const std::vector<std::string>& endpoint_ids,
+      ClientProxy* client, const std::vector<std::string>& endpoint_ids,
       const ByteArray& payload_transfer_frame_bytes, std::int64_t payload_id,
       std::int64_t offset, const std::string& packet_type,
       analytics::PacketMetaData& packet_meta_data);
@@ -88,8 +88,11 @@ class MockEndpointChannel : public EndpointChannel {
   MOCK_METHOD(Medium, GetMedium, (), (const, override));
   MOCK_METHOD(int, GetMaxTransmitPacketSize, (), (const, override));
   MOCK_METHOD(void, EnableEncryption,
-              (std::shared_ptr<EncryptionContext> context), (override));
+              (std::shared_ptr<EncryptionContext> context,
+               std::shared_ptr<AesGcmRecordLayer> record_layer),
+              (override));
   MOCK_METHOD(void, DisableEncryption, (), (override));
+  MOCK_METHOD(void, EnableAesGcmRecordLayer, (), (override));
   MOCK_METHOD(bool, IsPaused, (), (const, override));
   MOCK_METHOD(bool, IsEncrypted, (), (override));
   MOCK_METHOD(ExceptionOr<ByteArray>, TryDecrypt, (const ByteArray& data),
@@ -347,10 +350,12 @@ TEST_F(EndpointManagerTest, SendControlMessageAndPayloadAckWorks) {
 
   RegisterEndpoint(std::move(endpoint_channel), false);
   auto failed_ids_1 =
-      em_.SendControlMessage(header, control, std::vector{endpoint_id_});
+      em_.SendControlMessage(client_.get(), header, control,
+                             std::vector{endpoint_id_});
   EXPECT_EQ(failed_ids_1, std::vector<std::string>{});
   auto failed_ids_2 =
-      em_.SendPayloadAck(header.id(), std::vector<std::string>{endpoint_id_});
+      em_.SendPayloadAck(client_.get(), header.id(),
+                         std::vector<std::string>{endpoint_id_});
   EXPECT_EQ(failed_ids_2, std::vector<std::string>{});
   NEARBY_LOGS(INFO) << "Will unregister endpoint now";
   em_.UnregisterEndpoint(client_.get(), endpoint_id_);
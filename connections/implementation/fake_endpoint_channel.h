@@ -87,8 +87,11 @@ class FakeEndpointChannel : public EndpointChannel {
   std::string GetName() const override { return "fake-channel-" + service_id_; }
   Medium GetMedium() const override { return medium_; }
   int GetMaxTransmitPacketSize() const override { return 512; }
-  void EnableEncryption(std::shared_ptr<EncryptionContext> context) override {}
+  void EnableEncryption(
+      std::shared_ptr<EncryptionContext> context,
+      std::shared_ptr<AesGcmRecordLayer> record_layer) override {}
   void DisableEncryption() override {}
+  void EnableAesGcmRecordLayer() override {}
   bool IsEncrypted() override { return false; }
   ExceptionOr<ByteArray> TryDecrypt(const ByteArray& data) override {
     return Exception::kFailed;
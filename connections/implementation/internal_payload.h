@@ -92,10 +92,43 @@ class InternalPayload {
   // @return the offset really skipped
   virtual ExceptionOr<size_t> SkipToOffset(size_t offset) = 0;
 
+  // Returns how many bytes of an incoming Payload were already received in
+  // an earlier, interrupted transfer, or 0 if it has to start from scratch.
+  //
+  // The sender is asked to continue from there; it may or may not do so.
+  virtual std::int64_t GetResumeOffset() const { return 0; }
+
+  // Returns the PayloadHash of the bytes counted by GetResumeOffset(), for
+  // the sender to check against its own.
+  virtual std::uint64_t GetResumeHash() const { return 0; }
+
+  // Returns the PayloadHash of the first `length` bytes of an outgoing
+  // Payload, without moving past them, to check what a receiver kept of it.
+  virtual ExceptionOr<std::uint64_t> GetPrefixHash(std::int64_t length) {
+    return {Exception::kIo};
+  }
+
+  // Makes the first `offset` bytes of an incoming Payload available before
+  // the chunk at `offset` is attached. A no-op unless the sender skipped the
+  // bytes we reported by GetResumeOffset().
+  virtual Exception FillTo(std::int64_t offset) {
+    return {Exception::kSuccess};
+  }
+
   // Cleans up any resources used by this Payload. Called when we're stopping
   // early, e.g. after being cancelled or having no more recipients left.
   virtual void Close() {}
 
+  // Called before Close() when the transfer of an incoming Payload was cut
+  // off rather than cancelled, so what was received so far may be kept for
+  // a later transfer to resume from. It's dropped otherwise.
+  virtual void KeepForResume() {}
+
+  // Returns true if the Payload only becomes usable once its last chunk has
+  // been attached, so it must not be handed to the client when the first
+  // chunk arrives.
+  virtual bool IsDeliveredOnCompletion() const { return false; }
+
  protected:
   Payload payload_;
   // We're caching the payload ID here because the backing payload will be
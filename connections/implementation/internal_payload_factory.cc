@@ -14,20 +14,27 @@
 
 #include "connections/implementation/internal_payload_factory.h"
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <filesystem>  // NOLINT(build/c++17)
 #include <memory>
+#include <optional>
 #include <string>
+#include <system_error>  // NOLINT
 #include <utility>
 
 #include "absl/strings/str_cat.h"
 #include "connections/implementation/internal_payload.h"
+#include "connections/implementation/payload_checkpoint_journal.h"
 #include "connections/implementation/proto/offline_wire_formats.pb.h"
 #include "connections/payload.h"
 #include "connections/payload_type.h"
 #include "internal/platform/byte_array.h"
 #include "internal/platform/exception.h"
 #include "internal/platform/expected.h"
+#include "internal/platform/feature_flags.h"
 #include "internal/platform/file.h"
 #include "internal/platform/implementation/platform.h"
 #include "internal/platform/input_stream.h"
@@ -43,12 +50,17 @@ namespace {
 using ::location::nearby::connections::PayloadTransferFrame;
 using ::location::nearby::proto::connections::OperationResultCode;
 
+// Returns true if we advertise support for receiving chunked BYTES payloads.
+bool IsChunkedBytesPayloadSupported() {
+  return FeatureFlags::GetInstance().GetFlags().enable_chunked_bytes_payload;
+}
+
 class BytesInternalPayload : public InternalPayload {
  public:
   explicit BytesInternalPayload(Payload payload)
       : InternalPayload(std::move(payload)),
         total_size_(payload_.AsBytes().size()),
-        detached_only_chunk_(false) {}
+        detached_all_chunks_(false) {}
 
   location::nearby::connections::PayloadTransferFrame::PayloadHeader::
       PayloadType
@@ -59,15 +71,29 @@ class BytesInternalPayload : public InternalPayload {
 
   std::int64_t GetTotalSize() const override { return total_size_; }
 
-  // Relinquishes ownership of the payload_; retrieves and returns the stored
-  // ByteArray.
+  // If the stored ByteArray fits in `chunk_size`, relinquishes ownership of
+  // the payload_ and returns it whole. Otherwise returns the next `chunk_size`
+  // bytes of it.
   ByteArray DetachNextChunk(int chunk_size) override {
-    if (detached_only_chunk_) {
+    if (detached_all_chunks_) {
       return {};
     }
 
-    detached_only_chunk_ = true;
-    return std::move(payload_).AsBytes();
+    if (next_chunk_offset_ == 0 &&
+        (chunk_size <= 0 || total_size_ <= chunk_size)) {
+      detached_all_chunks_ = true;
+      return std::move(payload_).AsBytes();
+    }
+
+    const ByteArray& bytes = payload_.AsBytes();
+    size_t next_chunk_size = std::min(static_cast<size_t>(chunk_size),
+                                      bytes.size() - next_chunk_offset_);
+    ByteArray next_chunk(bytes.data() + next_chunk_offset_, next_chunk_size);
+    next_chunk_offset_ += next_chunk_size;
+    if (next_chunk_offset_ >= bytes.size()) {
+      detached_all_chunks_ = true;
+    }
+    return next_chunk;
   }
 
   // Does nothing.
@@ -85,7 +111,62 @@ class BytesInternalPayload : public InternalPayload {
   // moved to another owner during the lifetime of an incoming
   // InternalPayload.
   const std::int64_t total_size_;
-  bool detached_only_chunk_;
+  size_t next_chunk_offset_ = 0;
+  bool detached_all_chunks_;
+};
+
+// An incoming BYTES payload that the sender split into several chunks. The
+// chunks are assembled into one buffer preallocated from the total size in the
+// payload header, and the Payload is only handed out once it is complete.
+class IncomingChunkedBytesInternalPayload : public InternalPayload {
+ public:
+  IncomingChunkedBytesInternalPayload(Payload::Id payload_id,
+                                      std::int64_t total_size)
+      : InternalPayload(Payload(payload_id, ByteArray())),
+        buffer_(static_cast<size_t>(total_size)),
+        total_size_(total_size) {}
+
+  PayloadTransferFrame::PayloadHeader::PayloadType GetType() const override {
+    return PayloadTransferFrame::PayloadHeader::BYTES;
+  }
+
+  std::int64_t GetTotalSize() const override { return total_size_; }
+
+  ByteArray DetachNextChunk(int chunk_size) override { return {}; }
+
+  Exception AttachNextChunk(const ByteArray& chunk) override {
+    if (chunk.Empty()) {
+      if (received_size_ != total_size_) {
+        LOG(WARNING) << "Incoming bytes payload " << this << " ended after "
+                     << received_size_ << " of " << total_size_ << " bytes.";
+        return {Exception::kIo};
+      }
+      payload_ = Payload(payload_id_, std::move(buffer_));
+      return {Exception::kSuccess};
+    }
+
+    if (static_cast<std::int64_t>(chunk.size()) >
+        total_size_ - received_size_) {
+      LOG(WARNING) << "Incoming bytes payload " << this
+                   << " overflows its total size " << total_size_;
+      return {Exception::kIo};
+    }
+    std::memcpy(buffer_.data() + received_size_, chunk.data(), chunk.size());
+    received_size_ += chunk.size();
+    return {Exception::kSuccess};
+  }
+
+  ExceptionOr<size_t> SkipToOffset(size_t offset) override {
+    LOG(WARNING) << "Bytes payload does not support offsets";
+    return {Exception::kIo};
+  }
+
+  bool IsDeliveredOnCompletion() const override { return true; }
+
+ private:
+  ByteArray buffer_;
+  const std::int64_t total_size_;
+  std::int64_t received_size_ = 0;
 };
 
 class OutgoingStreamInternalPayload : public InternalPayload {
@@ -191,6 +272,9 @@ class IncomingStreamInternalPayload : public InternalPayload {
   std::unique_ptr<OutputStream> output_;
 };
 
+// Bytes read at once while hashing what a receiver kept of an outgoing file.
+constexpr std::int64_t kPrefixReadSize = 1024 * 1024;
+
 class OutgoingFileInternalPayload : public InternalPayload {
  public:
   explicit OutgoingFileInternalPayload(Payload payload)
@@ -231,6 +315,29 @@ class OutgoingFileInternalPayload : public InternalPayload {
     return {Exception::kIo};
   }
 
+  ExceptionOr<std::uint64_t> GetPrefixHash(std::int64_t length) override {
+    InputFile* file = payload_.AsFile();
+    if (!file || file->GetFilePath().empty() || length > total_size_) {
+      return {Exception::kIo};
+    }
+    // Read through a file of its own, so what's sent next isn't disturbed.
+    InputFile prefix(file->GetFilePath(), total_size_);
+    PayloadHash hash;
+    std::int64_t hashed = 0;
+    while (hashed < length) {
+      ExceptionOr<ByteArray> bytes =
+          prefix.Read(std::min(kPrefixReadSize, length - hashed));
+      if (!bytes.ok() || bytes.result().Empty()) {
+        prefix.Close();
+        return {Exception::kIo};
+      }
+      hash.Update(bytes.result().AsStringView());
+      hashed += bytes.result().size();
+    }
+    prefix.Close();
+    return ExceptionOr<std::uint64_t>(hash.Get());
+  }
+
   ExceptionOr<size_t> SkipToOffset(size_t offset) override {
     LOG(INFO) << "SkipToOffset " << offset;
     InputFile* file = payload_.AsFile();
@@ -262,6 +369,11 @@ class OutgoingFileInternalPayload : public InternalPayload {
   std::int64_t total_size_;
 };
 
+// Bytes received between two checkpoints of an incoming file.
+constexpr std::int64_t kCheckpointInterval = 8 * 1024 * 1024;
+// Bytes copied at once from a kept partial file.
+constexpr std::int64_t kPartialFileCopySize = 1024 * 1024;
+
 class IncomingFileInternalPayload : public InternalPayload {
  public:
   IncomingFileInternalPayload(Payload payload, OutputFile output_file,
@@ -270,6 +382,22 @@ class IncomingFileInternalPayload : public InternalPayload {
         output_file_(std::move(output_file)),
         total_size_(total_size) {}
 
+  // Checkpoints the file at `file_path` in `journal`. If `resume_from` is
+  // set, it's an earlier checkpoint whose bytes are kept in the journal, to
+  // be copied back in when the sender skips them.
+  IncomingFileInternalPayload(
+      Payload payload, OutputFile output_file, std::int64_t total_size,
+      std::string file_path, std::unique_ptr<PayloadCheckpointJournal> journal,
+      std::optional<PayloadCheckpoint> resume_from)
+      : InternalPayload(std::move(payload)),
+        output_file_(std::move(output_file)),
+        total_size_(total_size),
+        file_path_(std::move(file_path)),
+        journal_(std::move(journal)),
+        resume_from_(std::move(resume_from)),
+        resume_offset_(resume_from_.has_value() ? resume_from_->offset : 0),
+        resume_hash_(resume_from_.has_value() ? resume_from_->hash : 0) {}
+
   location::nearby::connections::PayloadTransferFrame::PayloadHeader::
       PayloadType
       GetType() const override {
@@ -285,10 +413,15 @@ class IncomingFileInternalPayload : public InternalPayload {
     if (chunk.Empty()) {
       // Received null last chunk for incoming payload.
       output_file_.Close();
+      if (journal_ != nullptr) {
+        finished_ = true;
+        DropPartialFile();
+        journal_->Remove(payload_id_);
+      }
       return {Exception::kSuccess};
     }
 
-    return output_file_.Write(chunk);
+    return Write(chunk);
   }
 
   ExceptionOr<size_t> SkipToOffset(size_t offset) override {
@@ -296,13 +429,205 @@ class IncomingFileInternalPayload : public InternalPayload {
     return {Exception::kIo};
   }
 
-  void Close() override { output_file_.Close(); }
+  std::int64_t GetResumeOffset() const override { return resume_offset_; }
+
+  std::uint64_t GetResumeHash() const override { return resume_hash_; }
+
+  Exception FillTo(std::int64_t offset) override {
+    if (offset <= written_) {
+      return {Exception::kSuccess};
+    }
+    if (!resume_from_.has_value() || offset != resume_from_->offset) {
+      LOG(ERROR) << "Incoming file Payload " << payload_id_
+                 << " skipped from " << written_ << " to " << offset;
+      return {Exception::kIo};
+    }
+
+    InputFile partial_file(resume_from_->file_path, resume_from_->total_size);
+    ExceptionOr<size_t> skipped = partial_file.Skip(written_);
+    Exception result = {Exception::kIo};
+    if (skipped.ok() && static_cast<std::int64_t>(skipped.result()) ==
+                            written_) {
+      result = {Exception::kSuccess};
+    }
+    while (result.Ok() && written_ < offset) {
+      ExceptionOr<ByteArray> bytes = partial_file.Read(
+          std::min(kPartialFileCopySize, offset - written_));
+      if (!bytes.ok() || bytes.result().Empty()) {
+        result = {Exception::kIo};
+        break;
+      }
+      result = Write(bytes.result());
+    }
+    partial_file.Close();
+    if (result.Raised()) {
+      LOG(ERROR) << "Failed to copy the partial file of incoming Payload "
+                 << payload_id_;
+      return result;
+    }
+
+    // What we've written now has to be what the sender skipped. If the file
+    // changed in between, the checkpoint is stale; start over next time.
+    if (hash_.Get() != resume_from_->hash) {
+      LOG(ERROR) << "Partial file of incoming Payload " << payload_id_
+                 << " doesn't match its checkpoint";
+      finished_ = true;
+      DropPartialFile();
+      return {Exception::kIo};
+    }
+    LOG(INFO) << "Incoming file Payload " << payload_id_ << " resumed at "
+              << offset;
+    DropPartialFile();
+    return {Exception::kSuccess};
+  }
+
+  void KeepForResume() override { keep_for_resume_ = journal_ != nullptr; }
+
+  void Close() override {
+    output_file_.Close();
+    if (journal_ == nullptr || finished_) {
+      return;
+    }
+    finished_ = true;
+    if (!keep_for_resume_) {
+      DropPartialFile();
+      journal_->Remove(payload_id_);
+      return;
+    }
+    // Until the partial file is merged back in, it holds more than we do.
+    if (resume_from_.has_value() || written_ == 0) {
+      return;
+    }
+    // Move what we got out of the way of the client, who drops the file of a
+    // failed transfer.
+    std::string partial_path = journal_->GetPartialFilePath(payload_id_);
+    std::error_code error;
+    std::filesystem::rename(std::filesystem::u8path(file_path_),
+                            std::filesystem::u8path(partial_path), error);
+    if (error || !journal_->Save({.payload_id = payload_id_,
+                                  .file_path = partial_path,
+                                  .total_size = total_size_,
+                                  .offset = written_,
+                                  .hash = hash_.Get()})) {
+      LOG(WARNING) << "Failed to keep the partial file of incoming Payload "
+                   << payload_id_ << ": " << error.message();
+      std::filesystem::remove(std::filesystem::u8path(partial_path), error);
+      journal_->Remove(payload_id_);
+      return;
+    }
+    LOG(INFO) << "Kept " << written_ << " bytes of incoming file Payload "
+              << payload_id_ << " to resume from";
+  }
 
  private:
+  Exception Write(const ByteArray& chunk) {
+    Exception result = output_file_.Write(chunk);
+    if (result.Raised() || journal_ == nullptr) {
+      return result;
+    }
+    hash_.Update(chunk.AsStringView());
+    written_ += chunk.size();
+    // A sender that doesn't resume sends everything again.
+    if (resume_from_.has_value() && written_ > resume_offset_) {
+      DropPartialFile();
+    }
+    if (written_ - checkpointed_ >= kCheckpointInterval) {
+      SaveCheckpoint();
+    }
+    return result;
+  }
+
+  // Records how far we got, in case we don't get to move the file into the
+  // journal, e.g. on a crash.
+  void SaveCheckpoint() {
+    if (resume_from_.has_value()) {
+      return;
+    }
+    // Only what has left our buffers can be resumed from.
+    if (output_file_.Flush().Raised()) {
+      return;
+    }
+    journal_->Save({.payload_id = payload_id_,
+                    .file_path = file_path_,
+                    .total_size = total_size_,
+                    .offset = written_,
+                    .hash = hash_.Get()});
+    checkpointed_ = written_;
+  }
+
+  // Removes the bytes kept from an earlier transfer, along with their
+  // checkpoint.
+  void DropPartialFile() {
+    if (!resume_from_.has_value()) {
+      return;
+    }
+    std::error_code error;
+    std::filesystem::remove(std::filesystem::u8path(resume_from_->file_path),
+                            error);
+    journal_->Remove(payload_id_);
+    resume_from_.reset();
+  }
+
   OutputFile output_file_;
   const std::int64_t total_size_;
+
+  // Only set while checkpoints are kept.
+  const std::string file_path_;
+  const std::unique_ptr<PayloadCheckpointJournal> journal_;
+  std::optional<PayloadCheckpoint> resume_from_;
+  const std::int64_t resume_offset_ = 0;
+  const std::uint64_t resume_hash_ = 0;
+  std::int64_t written_ = 0;
+  std::int64_t checkpointed_ = 0;
+  // No more checkpoints once the file is complete, or known to be bad.
+  bool finished_ = false;
+  bool keep_for_resume_ = false;
+  PayloadHash hash_;
 };
 
+// Returns the checkpoint of an earlier, interrupted transfer of the incoming
+// file Payload `payload_id`, with the bytes it received moved into the
+// journal, out of the way of the new output file.
+std::optional<PayloadCheckpoint> SetAsidePartialFile(
+    const PayloadCheckpointJournal& journal, Payload::Id payload_id,
+    std::int64_t total_size) {
+  journal.RemoveExpired(PayloadCheckpointJournal::kMaxAge);
+  std::optional<PayloadCheckpoint> checkpoint = journal.Load(payload_id);
+  if (!checkpoint.has_value()) {
+    return std::nullopt;
+  }
+  std::error_code error;
+  std::filesystem::path partial_path =
+      std::filesystem::u8path(checkpoint->file_path);
+  std::uintmax_t partial_size = std::filesystem::file_size(partial_path, error);
+  if (error || checkpoint->total_size != total_size ||
+      checkpoint->offset <= 0 || checkpoint->offset >= total_size ||
+      partial_size < static_cast<std::uintmax_t>(checkpoint->offset)) {
+    LOG(INFO) << "Dropping the stale checkpoint of incoming file Payload "
+              << payload_id;
+    journal.Remove(payload_id);
+    return std::nullopt;
+  }
+
+  // A checkpoint that still points at the output file was left by a crash.
+  std::string set_aside_path = journal.GetPartialFilePath(payload_id);
+  if (checkpoint->file_path != set_aside_path) {
+    std::filesystem::rename(partial_path,
+                            std::filesystem::u8path(set_aside_path), error);
+    if (error) {
+      LOG(WARNING) << "Failed to set aside the partial file of incoming file "
+                   << "Payload " << payload_id << ": " << error.message();
+      journal.Remove(payload_id);
+      return std::nullopt;
+    }
+    checkpoint->file_path = set_aside_path;
+    journal.Save(*checkpoint);
+  }
+  LOG(INFO) << "Incoming file Payload " << payload_id << " has "
+            << checkpoint->offset << " bytes from an earlier transfer";
+  return checkpoint;
+}
+
 }  // namespace
 
 using ::nearby::api::ImplementationPlatform;
@@ -362,6 +687,23 @@ ErrorOr<std::unique_ptr<InternalPayload>> CreateIncomingInternalPayload(
   const Payload::Id payload_id = frame.payload_header().id();
   switch (frame.payload_header().type()) {
     case PayloadTransferFrame::PayloadHeader::BYTES: {
+      // A sender only chunks BYTES payloads if we advertised support for it,
+      // and then announces more bytes in the header than it puts in the first
+      // chunk.
+      std::int64_t total_size = frame.payload_header().total_size();
+      if (IsChunkedBytesPayloadSupported() &&
+          total_size >
+              static_cast<std::int64_t>(frame.payload_chunk().body().size())) {
+        if (total_size > FeatureFlags::GetInstance()
+                             .GetFlags()
+                             .max_chunked_bytes_payload_length) {
+          LOG(ERROR) << "Incoming bytes payload " << payload_id
+                     << " is too large: " << total_size;
+          return {Error(OperationResultCode::DETAIL_UNKNOWN)};
+        }
+        return {std::make_unique<IncomingChunkedBytesInternalPayload>(
+            payload_id, total_size)};
+      }
       return {std::make_unique<BytesInternalPayload>(
           Payload(payload_id, ByteArray(frame.payload_chunk().body())))};
     }
@@ -419,15 +761,29 @@ ErrorOr<std::unique_ptr<InternalPayload>> CreateIncomingInternalPayload(
             Payload(payload_id, InputFile(payload_id, total_size)),
             std::move(output_file), total_size)};
       } else {
+        std::unique_ptr<PayloadCheckpointJournal> journal;
+        std::optional<PayloadCheckpoint> resume_from;
+        if (FeatureFlags::GetInstance().GetFlags().enable_payload_checkpoints) {
+          journal = std::make_unique<PayloadCheckpointJournal>(
+              PayloadCheckpointJournal::GetDefaultDirectory());
+          resume_from = SetAsidePartialFile(*journal, payload_id, total_size);
+        }
         OutputFile output_file(file_path);
         if (!output_file.IsValid()) {
           LOG(ERROR) << "Output file payload path is not valid: " << file_path;
           return {Error(OperationResultCode::IO_FILE_OPENING_ERROR)};
         }
+        if (journal == nullptr) {
+          return {std::make_unique<IncomingFileInternalPayload>(
+              Payload(payload_id, parent_folder, file_name,
+                      InputFile(file_path, total_size)),
+              std::move(output_file), total_size)};
+        }
         return {std::make_unique<IncomingFileInternalPayload>(
             Payload(payload_id, parent_folder, file_name,
                     InputFile(file_path, total_size)),
-            std::move(output_file), total_size)};
+            std::move(output_file), total_size, file_path, std::move(journal),
+            std::move(resume_from))};
       }
     }
     default:
@@ -16,18 +16,25 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <filesystem>  // NOLINT(build/c++17)
+#include <fstream>
 #include <memory>
+#include <optional>
+#include <sstream>
 #include <string>
 #include <utility>
 
 #include "gtest/gtest.h"
+#include "absl/strings/string_view.h"
 #include "connections/implementation/internal_payload.h"
+#include "connections/implementation/payload_checkpoint_journal.h"
 #include "connections/implementation/proto/offline_wire_formats.pb.h"
 #include "connections/payload.h"
 #include "connections/payload_type.h"
 #include "internal/platform/byte_array.h"
 #include "internal/platform/exception.h"
 #include "internal/platform/expected.h"
+#include "internal/platform/feature_flags.h"
 #include "internal/platform/file.h"
 #include "internal/platform/pipe.h"
 
@@ -51,6 +58,41 @@ TEST(InternalPayloadFactoryTest, CanCreateInternalPayloadFromBytePayload) {
   EXPECT_EQ(payload.AsBytes(), ByteArray(kText));
 }
 
+TEST(InternalPayloadFactoryTest, BytePayloadWithinChunkSizeIsDetachedWhole) {
+  ErrorOr<std::unique_ptr<InternalPayload>> result =
+      CreateOutgoingInternalPayload(Payload{ByteArray(kText)});
+  ASSERT_FALSE(result.has_error());
+  std::unique_ptr<InternalPayload> internal_payload = std::move(result.value());
+
+  EXPECT_EQ(internal_payload->DetachNextChunk(/*chunk_size=*/64),
+            ByteArray(kText));
+  EXPECT_TRUE(internal_payload->DetachNextChunk(/*chunk_size=*/64).Empty());
+}
+
+TEST(InternalPayloadFactoryTest, BytePayloadLargerThanChunkSizeIsChunked) {
+  ErrorOr<std::unique_ptr<InternalPayload>> result =
+      CreateOutgoingInternalPayload(Payload{ByteArray(kText)});
+  ASSERT_FALSE(result.has_error());
+  std::unique_ptr<InternalPayload> internal_payload = std::move(result.value());
+
+  EXPECT_EQ(internal_payload->DetachNextChunk(4), ByteArray("data"));
+  EXPECT_EQ(internal_payload->DetachNextChunk(4), ByteArray(" chu"));
+  EXPECT_EQ(internal_payload->DetachNextChunk(4), ByteArray("nk"));
+  EXPECT_TRUE(internal_payload->DetachNextChunk(4).Empty());
+  EXPECT_EQ(internal_payload->GetTotalSize(), sizeof(kText) - 1);
+}
+
+TEST(InternalPayloadFactoryTest, BytePayloadWithZeroChunkSizeIsDetachedWhole) {
+  ErrorOr<std::unique_ptr<InternalPayload>> result =
+      CreateOutgoingInternalPayload(Payload{ByteArray(kText)});
+  ASSERT_FALSE(result.has_error());
+  std::unique_ptr<InternalPayload> internal_payload = std::move(result.value());
+
+  EXPECT_EQ(internal_payload->DetachNextChunk(/*chunk_size=*/0),
+            ByteArray(kText));
+  EXPECT_TRUE(internal_payload->DetachNextChunk(/*chunk_size=*/0).Empty());
+}
+
 TEST(InternalPayloadFactoryTest, CanCreateInternalPayloadFromStreamPayload) {
   auto [input, output] = CreatePipe();
   ErrorOr<std::unique_ptr<InternalPayload>> result =
@@ -105,6 +147,55 @@ TEST(InternalPayloadFactoryTest, CanCreateInternalPayloadFromByteMessage) {
   EXPECT_EQ(payload.AsBytes(), ByteArray(kText));
 }
 
+TEST(InternalPayloadFactoryTest, CanAssembleChunkedByteMessage) {
+  FeatureFlags::Flags flags = FeatureFlags::GetInstance().GetFlags();
+  flags.enable_chunked_bytes_payload = true;
+  FeatureFlags::ScopedFlagsForTesting scoped_flags(flags);
+  PayloadTransferFrame frame;
+  frame.set_packet_type(PayloadTransferFrame::DATA);
+  auto& header = *frame.mutable_payload_header();
+  header.set_type(PayloadTransferFrame::PayloadHeader::BYTES);
+  header.set_id(12345);
+  header.set_total_size(sizeof(kText) - 1);
+  frame.mutable_payload_chunk()->set_offset(0);
+  frame.mutable_payload_chunk()->set_body("data");
+  ErrorOr<std::unique_ptr<InternalPayload>> result =
+      CreateIncomingInternalPayload(frame, "");
+  ASSERT_FALSE(result.has_error());
+  std::unique_ptr<InternalPayload> internal_payload = std::move(result.value());
+  EXPECT_TRUE(internal_payload->IsDeliveredOnCompletion());
+
+  EXPECT_TRUE(internal_payload->AttachNextChunk(ByteArray("data")).Ok());
+  EXPECT_TRUE(internal_payload->AttachNextChunk(ByteArray(" chunk")).Ok());
+  EXPECT_TRUE(internal_payload->AttachNextChunk(ByteArray()).Ok());
+  Payload payload = internal_payload->ReleasePayload();
+  EXPECT_EQ(payload.GetType(), PayloadType::kBytes);
+  EXPECT_EQ(payload.GetId(), 12345);
+  EXPECT_EQ(payload.AsBytes(), ByteArray(kText));
+}
+
+TEST(InternalPayloadFactoryTest, ChunkedByteMessageRejectsOverflow) {
+  FeatureFlags::Flags flags = FeatureFlags::GetInstance().GetFlags();
+  flags.enable_chunked_bytes_payload = true;
+  FeatureFlags::ScopedFlagsForTesting scoped_flags(flags);
+  PayloadTransferFrame frame;
+  frame.set_packet_type(PayloadTransferFrame::DATA);
+  auto& header = *frame.mutable_payload_header();
+  header.set_type(PayloadTransferFrame::PayloadHeader::BYTES);
+  header.set_id(12345);
+  header.set_total_size(6);
+  frame.mutable_payload_chunk()->set_body("data");
+  ErrorOr<std::unique_ptr<InternalPayload>> result =
+      CreateIncomingInternalPayload(frame, "");
+  ASSERT_FALSE(result.has_error());
+  std::unique_ptr<InternalPayload> internal_payload = std::move(result.value());
+
+  EXPECT_TRUE(internal_payload->AttachNextChunk(ByteArray("data")).Ok());
+  EXPECT_TRUE(internal_payload->AttachNextChunk(ByteArray("data")).Raised());
+  // The last chunk arrives before all the announced bytes did.
+  EXPECT_TRUE(internal_payload->AttachNextChunk(ByteArray()).Raised());
+}
+
 TEST(InternalPayloadFactoryTest, CanCreateInternalPayloadFromStreamMessage) {
   PayloadTransferFrame frame;
   std::string path = "C:\\Downloads";
@@ -271,6 +362,189 @@ TEST(InternalPayloadFactoryTest,
   EXPECT_EQ(contents_after_skip, ByteArray("6789"));
 }
 
+TEST(InternalPayloadFactoryTest, GetPrefixHash_FilePayload_KeepsOffset) {
+  ByteArray contents("0123456789");
+  Payload::Id payload_id = Payload::GenerateId();
+  CreateFileWithContents(payload_id, contents);
+  ErrorOr<std::unique_ptr<InternalPayload>> internal_payload_result =
+      CreateOutgoingInternalPayload(
+          Payload{payload_id, InputFile(payload_id, contents.size())});
+  ASSERT_FALSE(internal_payload_result.has_error());
+  std::unique_ptr<InternalPayload> internal_payload =
+      std::move(internal_payload_result.value());
+  PayloadHash expected;
+  expected.Update("0123");
+
+  ExceptionOr<std::uint64_t> result = internal_payload->GetPrefixHash(4);
+
+  ASSERT_TRUE(result.ok());
+  EXPECT_EQ(result.result(), expected.Get());
+  EXPECT_FALSE(internal_payload->GetPrefixHash(11).ok());
+  EXPECT_EQ(internal_payload->DetachNextChunk(512), contents);
+}
+
+// Receives "hello world!" as payload 77, into the Downloads folder, with
+// checkpoints turned on.
+class InternalPayloadFactoryResumeTest : public ::testing::Test {
+ protected:
+  static constexpr char kDirectory[] = "/tmp/Downloads/resume";
+
+  InternalPayloadFactoryResumeTest() {
+    FeatureFlags::Flags flags = FeatureFlags::GetInstance().GetFlags();
+    flags.enable_payload_checkpoints = true;
+    scoped_flags_.emplace(flags);
+  }
+
+  void SetUp() override {
+    std::filesystem::remove_all(kDirectory);
+    std::filesystem::create_directories(kDirectory);
+    std::filesystem::create_directories(
+        PayloadCheckpointJournal::GetDefaultDirectory());
+    RemoveFromJournal();
+  }
+
+  void TearDown() override { RemoveFromJournal(); }
+
+  void RemoveFromJournal() {
+    journal_.Remove(77);
+    std::filesystem::remove(journal_.GetPartialFilePath(77));
+  }
+
+  // Leaves "hello " kept from an earlier transfer, checkpointed with the hash
+  // of `kept`.
+  void KeepHello(absl::string_view kept) {
+    std::ofstream(journal_.GetPartialFilePath(77)) << "hello ";
+    PayloadHash hash;
+    hash.Update(kept);
+    EXPECT_TRUE(journal_.Save({.payload_id = 77,
+                               .file_path = journal_.GetPartialFilePath(77),
+                               .total_size = 12,
+                               .offset = 6,
+                               .hash = hash.Get()}));
+  }
+
+  std::unique_ptr<InternalPayload> CreatePayload() {
+    PayloadTransferFrame frame;
+    frame.set_packet_type(PayloadTransferFrame::DATA);
+    auto& header = *frame.mutable_payload_header();
+    header.set_type(PayloadTransferFrame::PayloadHeader::FILE);
+    header.set_id(77);
+    header.set_total_size(12);
+    header.set_file_name("resume.bin");
+    ErrorOr<std::unique_ptr<InternalPayload>> result =
+        CreateIncomingInternalPayload(frame, kDirectory);
+    EXPECT_FALSE(result.has_error());
+    return std::move(result.value());
+  }
+
+  std::optional<FeatureFlags::ScopedFlagsForTesting> scoped_flags_;
+  PayloadCheckpointJournal journal_{
+      PayloadCheckpointJournal::GetDefaultDirectory()};
+};
+
+TEST_F(InternalPayloadFactoryResumeTest, IncomingFilePayloadResumes) {
+  KeepHello("hello ");
+  std::unique_ptr<InternalPayload> internal_payload = CreatePayload();
+  ASSERT_NE(internal_payload, nullptr);
+  Payload payload = internal_payload->ReleasePayload();
+  std::string file_path = payload.AsFile()->GetFilePath();
+
+  EXPECT_EQ(internal_payload->GetResumeOffset(), 6);
+  EXPECT_EQ(internal_payload->GetResumeHash(), journal_.Load(77)->hash);
+  EXPECT_TRUE(internal_payload->FillTo(6).Ok());
+  EXPECT_TRUE(internal_payload->AttachNextChunk(ByteArray("world!")).Ok());
+  EXPECT_TRUE(internal_payload->AttachNextChunk(ByteArray()).Ok());
+
+  std::ifstream file(file_path);
+  std::stringstream contents;
+  contents << file.rdbuf();
+  EXPECT_EQ(contents.str(), "hello world!");
+  EXPECT_FALSE(std::filesystem::exists(journal_.GetPartialFilePath(77)));
+  EXPECT_FALSE(journal_.Load(77).has_value());
+}
+
+TEST_F(InternalPayloadFactoryResumeTest,
+       IncomingFilePayloadRejectsChangedFile) {
+  KeepHello("HELLO ");
+  std::unique_ptr<InternalPayload> internal_payload = CreatePayload();
+  ASSERT_NE(internal_payload, nullptr);
+
+  EXPECT_TRUE(internal_payload->FillTo(6).Raised());
+  internal_payload->Close();
+
+  EXPECT_FALSE(journal_.Load(77).has_value());
+  EXPECT_FALSE(std::filesystem::exists(journal_.GetPartialFilePath(77)));
+}
+
+TEST_F(InternalPayloadFactoryResumeTest,
+       IncomingFilePayloadIgnoresCheckpointOfOtherSize) {
+  std::ofstream(journal_.GetPartialFilePath(77)) << "hello ";
+  journal_.Save({.payload_id = 77,
+                 .file_path = journal_.GetPartialFilePath(77),
+                 .total_size = 100,
+                 .offset = 6});
+
+  std::unique_ptr<InternalPayload> internal_payload = CreatePayload();
+  ASSERT_NE(internal_payload, nullptr);
+
+  EXPECT_EQ(internal_payload->GetResumeOffset(), 0);
+  EXPECT_FALSE(journal_.Load(77).has_value());
+}
+
+TEST_F(InternalPayloadFactoryResumeTest,
+       InterruptedIncomingFilePayloadIsKeptOutOfDownloads) {
+  std::unique_ptr<InternalPayload> internal_payload = CreatePayload();
+  ASSERT_NE(internal_payload, nullptr);
+  Payload payload = internal_payload->ReleasePayload();
+  std::string file_path = payload.AsFile()->GetFilePath();
+
+  EXPECT_TRUE(internal_payload->AttachNextChunk(ByteArray("hello ")).Ok());
+  internal_payload->KeepForResume();
+  internal_payload->Close();
+
+  std::optional<PayloadCheckpoint> checkpoint = journal_.Load(77);
+  ASSERT_TRUE(checkpoint.has_value());
+  EXPECT_EQ(checkpoint->file_path, journal_.GetPartialFilePath(77));
+  EXPECT_EQ(checkpoint->offset, 6);
+  EXPECT_TRUE(std::filesystem::exists(journal_.GetPartialFilePath(77)));
+  EXPECT_FALSE(std::filesystem::exists(file_path));
+
+  // The next transfer of it picks up from there.
+  internal_payload = CreatePayload();
+  ASSERT_NE(internal_payload, nullptr);
+  EXPECT_EQ(internal_payload->GetResumeOffset(), 6);
+}
+
+TEST_F(InternalPayloadFactoryResumeTest,
+       CanceledIncomingFilePayloadIsNotKept) {
+  std::unique_ptr<InternalPayload> internal_payload = CreatePayload();
+  ASSERT_NE(internal_payload, nullptr);
+
+  EXPECT_TRUE(internal_payload->AttachNextChunk(ByteArray("hello ")).Ok());
+  internal_payload->Close();
+
+  EXPECT_FALSE(journal_.Load(77).has_value());
+  EXPECT_FALSE(std::filesystem::exists(journal_.GetPartialFilePath(77)));
+}
+
+TEST_F(InternalPayloadFactoryResumeTest,
+       IncomingFilePayloadKeepsNothingWithCheckpointsOff) {
+  FeatureFlags::Flags flags = FeatureFlags::GetInstance().GetFlags();
+  flags.enable_payload_checkpoints = false;
+  FeatureFlags::ScopedFlagsForTesting scoped_flags(flags);
+  KeepHello("hello ");
+  std::unique_ptr<InternalPayload> internal_payload = CreatePayload();
+  ASSERT_NE(internal_payload, nullptr);
+
+  EXPECT_EQ(internal_payload->GetResumeOffset(), 0);
+  EXPECT_TRUE(internal_payload->AttachNextChunk(ByteArray("hello ")).Ok());
+  internal_payload->KeepForResume();
+  internal_payload->Close();
+
+  EXPECT_EQ(journal_.Load(77)->offset, 6);
+  EXPECT_EQ(journal_.Load(77)->total_size, 12);
+}
+
 }  // namespace
 }  // namespace connections
 }  // namespace nearby
@@ -15,6 +15,8 @@
 #include "connections/implementation/mediums/ble_v2/discovered_peripheral_tracker.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <iterator>
 #include <memory>
 #include <optional>
@@ -23,6 +25,7 @@
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/hash/hash.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/escaping.h"
 #include "absl/time/time.h"
@@ -49,6 +52,7 @@
 #include "internal/platform/logging.h"
 #include "internal/platform/multi_thread_executor.h"
 #include "internal/platform/mutex_lock.h"
+#include "internal/platform/trace.h"
 #include "internal/platform/uuid.h"
 
 using ::nearby::api::ble_v2::BleAdvertisementData;
@@ -59,6 +63,20 @@ namespace mediums {
 namespace {
 constexpr int kGattThreadCount = 1;
 constexpr absl::Duration kInstantLostAdvertisementTimeout = absl::Seconds(60);
+
+constexpr TraceEvent kScanResultTrace = {
+    "ble", "ProcessFoundBleAdvertisement", {"service_data_count"}};
+constexpr TraceEvent kDuplicateScanResultTrace = {"ble",
+                                                  "DuplicateScanResult"};
+constexpr TraceEvent kIgnoredScanResultTrace = {"ble", "IgnoredScanResult",
+                                                {"reason"}};
+
+// Reasons for kIgnoredScanResultTrace.
+enum class IgnoredScanResultReason {
+  kNotTracking = 0,
+  kInvalid = 1,
+  kWaitForExtendedAdvertisement = 2,
+};
 }  // namespace
 
 DiscoveredPeripheralTracker::DiscoveredPeripheralTracker(
@@ -116,6 +134,7 @@ void DiscoveredPeripheralTracker::StartTracking(
 
   // Remove stale data from any previous sessions.
   ClearDataForServiceId(service_id);
+  InvalidateScanResults();
 }
 
 void DiscoveredPeripheralTracker::StopTracking(const std::string& service_id) {
@@ -124,33 +143,58 @@ void DiscoveredPeripheralTracker::StopTracking(const std::string& service_id) {
   dct_service_id_hash_to_service_id_map_.erase(
       advertisements::ble::DctAdvertisement::ComputeServiceIdHash(service_id));
   service_id_infos_.erase(service_id);
+  InvalidateScanResults();
 }
 
 void DiscoveredPeripheralTracker::ProcessFoundBleAdvertisement(
     BleV2Peripheral peripheral, BleAdvertisementData advertisement_data,
     AdvertisementFetcher advertisement_fetcher) {
+  // Scanners report the same advertisement many times a second. Drop repeats
+  // that can't change anything before contending for the lock.
+  std::optional<std::uint64_t> scan_result_key =
+      GetScanResultKey(peripheral, advertisement_data);
+  if (scan_result_key.has_value() && IsDuplicateScanResult(*scan_result_key)) {
+    NEARBY_TRACE(kDuplicateScanResultTrace);
+    return;
+  }
+
+  TraceScope trace(kScanResultTrace, advertisement_data.service_data.size());
   MutexLock lock(&mutex_);
+  if (HandleFoundBleAdvertisement(std::move(peripheral),
+                                  std::move(advertisement_data),
+                                  std::move(advertisement_fetcher)) &&
+      scan_result_key.has_value()) {
+    RememberScanResult(*scan_result_key);
+  }
+}
 
+bool DiscoveredPeripheralTracker::HandleFoundBleAdvertisement(
+    BleV2Peripheral peripheral, BleAdvertisementData advertisement_data,
+    AdvertisementFetcher advertisement_fetcher) {
   if (service_id_infos_.empty()) {
-    LOG(INFO) << "Ignoring BLE advertisement header because we are not "
-                 "tracking any service IDs.";
-    return;
+    NEARBY_TRACE(kIgnoredScanResultTrace,
+                 IgnoredScanResultReason::kNotTracking);
+    VLOG(1) << "Ignoring BLE advertisement header because we are not "
+               "tracking any service IDs.";
+    return true;
   }
 
   if (!peripheral.IsValid() || advertisement_data.service_data.empty()) {
-    LOG(INFO) << "Ignoring BLE advertisement header because the peripheral is "
-                 "invalid or the given service data is empty.";
-    return;
+    NEARBY_TRACE(kIgnoredScanResultTrace, IgnoredScanResultReason::kInvalid);
+    VLOG(1) << "Ignoring BLE advertisement header because the peripheral is "
+               "invalid or the given service data is empty.";
+    return false;
   }
 
   if (HandleOnLostAdvertisementLocked(advertisement_data)) {
-    return;
+    return false;
   }
 
   if (IsSkippableGattAdvertisement(advertisement_data)) {
-    LOG(INFO)
-        << "Ignore GATT advertisement and wait for extended advertisement.";
-    return;
+    NEARBY_TRACE(kIgnoredScanResultTrace,
+                 IgnoredScanResultReason::kWaitForExtendedAdvertisement);
+    VLOG(1) << "Ignore GATT advertisement and wait for extended advertisement.";
+    return true;
   }
 
   if (IsLegacyDeviceAdvertisementData(advertisement_data)) {
@@ -161,8 +205,9 @@ void DiscoveredPeripheralTracker::ProcessFoundBleAdvertisement(
         itor.second.discovered_peripheral_callback
             .legacy_device_discovered_cb();
       }
+      return false;
     }
-    return;
+    return true;
   }
 
   if (advertisement_data.service_data.contains(bleutils::kDctServiceUuid)) {
@@ -170,14 +215,71 @@ void DiscoveredPeripheralTracker::ProcessFoundBleAdvertisement(
         HandleDctAdvertisement(advertisement_data);
 
     if (!dct_advertisement_data.has_value()) {
-      return;
+      return true;
     }
     advertisement_data = std::move(*dct_advertisement_data);
   }
 
   HandleAdvertisement(peripheral, advertisement_data);
-  HandleAdvertisementHeader(peripheral, advertisement_data,
-                            std::move(advertisement_fetcher));
+  return HandleAdvertisementHeader(peripheral, advertisement_data,
+                                   std::move(advertisement_fetcher));
+}
+
+std::optional<std::uint64_t> DiscoveredPeripheralTracker::GetScanResultKey(
+    const BleV2Peripheral& peripheral,
+    const BleAdvertisementData& advertisement_data) {
+  const FeatureFlags::Flags& flags = FeatureFlags::GetInstance().GetFlags();
+  if (!flags.enable_scan_result_dedup ||
+      flags.scan_result_dedup_window <= absl::ZeroDuration()) {
+    return std::nullopt;
+  }
+  std::optional<api::ble_v2::BlePeripheral::UniqueId> unique_id =
+      peripheral.GetUniqueId();
+  if (!unique_id.has_value()) {
+    return std::nullopt;
+  }
+
+  // `service_data` is unordered, so combine the entries in a way that doesn't
+  // depend on iteration order.
+  std::uint64_t service_data_hash = 0;
+  for (const auto& [uuid, data] : advertisement_data.service_data) {
+    service_data_hash += absl::HashOf(uuid, data);
+  }
+  return absl::HashOf(*unique_id, peripheral.GetPsm(), peripheral.GetId(),
+                      advertisement_data.is_extended_advertisement,
+                      advertisement_data.service_data.size(),
+                      service_data_hash);
+}
+
+std::uint64_t DiscoveredPeripheralTracker::GetScanResultTag(
+    std::uint64_t scan_result_key) const {
+  // Results remembered in an earlier window never match, so a repeat is
+  // fully processed again at least once per window.
+  std::int64_t window =
+      absl::ToUnixNanos(SystemClock::ElapsedRealtime()) /
+      absl::ToInt64Nanoseconds(
+          FeatureFlags::GetInstance().GetFlags().scan_result_dedup_window);
+  std::uint64_t tag = absl::HashOf(
+      scan_result_key,
+      scan_result_generation_.load(std::memory_order_acquire), window);
+  // Zero marks an empty slot.
+  return tag == 0 ? 1 : tag;
+}
+
+bool DiscoveredPeripheralTracker::IsDuplicateScanResult(
+    std::uint64_t scan_result_key) const {
+  return scan_result_tags_[scan_result_key % kScanResultTableSize].load(
+             std::memory_order_acquire) == GetScanResultTag(scan_result_key);
+}
+
+void DiscoveredPeripheralTracker::RememberScanResult(
+    std::uint64_t scan_result_key) {
+  scan_result_tags_[scan_result_key % kScanResultTableSize].store(
+      GetScanResultTag(scan_result_key), std::memory_order_release);
+}
+
+void DiscoveredPeripheralTracker::InvalidateScanResults() {
+  scan_result_generation_.fetch_add(1, std::memory_order_acq_rel);
 }
 
 bool DiscoveredPeripheralTracker::HandleOnLostAdvertisementLocked(
@@ -270,6 +372,10 @@ void DiscoveredPeripheralTracker::ProcessLostGattAdvertisements() {
     }
   }
 
+  // Advertisements that are still around have to be recorded as found again
+  // in the next lost period.
+  InvalidateScanResults();
+
   LOG(INFO) << __func__ << ": Lost " << lost_count
             << " GATT advertisements due to peripheral timeout.";
 }
@@ -309,6 +415,7 @@ void DiscoveredPeripheralTracker::ClearGattAdvertisement(
   if (gai_it == gatt_advertisement_infos_.end()) {
     return;
   }
+  InvalidateScanResults();
   auto item = gatt_advertisement_infos_.extract(gai_it);
   GattAdvertisementInfo& gatt_advertisement_info = item.mapped();
 
@@ -475,6 +582,7 @@ BleAdvertisementHeader DiscoveredPeripheralTracker::HandleRawGattAdvertisements(
 
         LOG(INFO) << "Found new GATT advertisement : "
                   << gatt_advertisement.ToReadableString();
+        InvalidateScanResults();
         sii_it->second.discovered_peripheral_callback.peripheral_discovered_cb(
             std::move(discovered_peripheral), service_id,
             gatt_advertisement.GetData(),
@@ -495,6 +603,7 @@ BleAdvertisementHeader DiscoveredPeripheralTracker::HandleRawGattAdvertisements(
       // stale now.
       advertisement_read_results_.erase(old_advertisement_header);
       gatt_advertisements_.erase(old_advertisement_header);
+      InvalidateScanResults();
     }
 
     GattAdvertisementInfo gatt_advertisement_info = {
@@ -507,8 +616,11 @@ BleAdvertisementHeader DiscoveredPeripheralTracker::HandleRawGattAdvertisements(
 
   // Insert the list of read GATT advertisements for this advertisement
   // header.
-  gatt_advertisements_.insert(
-      {new_advertisement_header, std::move(ble_advertisement_set)});
+  if (gatt_advertisements_
+          .insert({new_advertisement_header, std::move(ble_advertisement_set)})
+          .second) {
+    InvalidateScanResults();
+  }
   return new_advertisement_header;
 }
 
@@ -679,7 +791,7 @@ DiscoveredPeripheralTracker::HandleDctAdvertisement(
   return new_advertisement_data;
 }
 
-void DiscoveredPeripheralTracker::HandleAdvertisementHeader(
+bool DiscoveredPeripheralTracker::HandleAdvertisementHeader(
     BleV2Peripheral peripheral,
     const nearby::api::ble_v2::BleAdvertisementData& advertisement_data,
     AdvertisementFetcher advertisement_fetcher) {
@@ -688,7 +800,7 @@ void DiscoveredPeripheralTracker::HandleAdvertisementHeader(
       ExtractAdvertisementHeaderBytes(advertisement_data));
   if (!advertisement_header.IsValid()) {
     VLOG(1) << "Failed to deserialize BLE advertisement header. Ignoring.";
-    return;
+    return true;
   }
 
   // Check if the advertisement header contains a service ID we're tracking.
@@ -698,11 +810,12 @@ void DiscoveredPeripheralTracker::HandleAdvertisementHeader(
                    advertisement_header.GetAdvertisementHash().AsStringView())
             << " because it does not contain any service IDs "
                "we're interested in.";
-    return;
+    return true;
   }
 
   // Report a nearby legacy device is found when advertisement header doesn't
   // support extended advertisement.
+  bool settled = true;
   if (NearbyFlags::GetInstance().GetBoolFlag(
           config_package_nearby::nearby_connections_feature::
               kDisableBluetoothClassicScanning)) {
@@ -711,11 +824,13 @@ void DiscoveredPeripheralTracker::HandleAdvertisementHeader(
         item.second.discovered_peripheral_callback
             .legacy_device_discovered_cb();
       }
+      settled = false;
     }
   }
 
   // Determine whether or not we need to read a fresh GATT advertisement.
   if (ShouldReadRawAdvertisementFromServer(advertisement_header)) {
+    settled = false;
     // Determine whether or not we need to read a fresh GATT advertisement.
     if (NearbyFlags::GetInstance().GetBoolFlag(
             config_package_nearby::nearby_connections_feature::
@@ -728,7 +843,7 @@ void DiscoveredPeripheralTracker::HandleAdvertisementHeader(
       if (!fetching_advertisements_.insert(advertisement_header).second) {
         VLOG(1) << ": Ignore the advertisement header due to it "
                    "is already in fetching.";
-        return;
+        return false;
       }
 
       if (executor_ == nullptr) {
@@ -742,7 +857,7 @@ void DiscoveredPeripheralTracker::HandleAdvertisementHeader(
             FetchRawAdvertisementsInThread(peripheral, advertisement_header,
                                            std::move(advertisement_fetcher));
           });
-      return;
+      return false;
     } else {
       std::vector<const ByteArray*> gatt_advertisement_bytes_list =
           FetchRawAdvertisements(peripheral, advertisement_header,
@@ -759,6 +874,16 @@ void DiscoveredPeripheralTracker::HandleAdvertisementHeader(
   // should now be up-to-date. With this information, do some general
   // housekeeping.
   UpdateCommonStateForFoundBleAdvertisement(advertisement_header);
+
+  // A read that failed recently is retried once its backoff expires, so only
+  // a successful read makes repeats of this header redundant.
+  if (settled) {
+    const auto it = advertisement_read_results_.find(advertisement_header);
+    settled = it != advertisement_read_results_.end() &&
+              it->second->EvaluateRetryStatus() ==
+                  AdvertisementReadResult::RetryStatus::kPreviouslySucceeded;
+  }
+  return settled;
 }
 
 ByteArray DiscoveredPeripheralTracker::ExtractAdvertisementHeaderBytes(
@@ -903,6 +1028,7 @@ void DiscoveredPeripheralTracker::FetchRawAdvertisementsInThread(
 
     auto it = advertisement_read_results_.insert_or_assign(advertisement_header,
                                                            std::move(result));
+    InvalidateScanResults();
     std::vector<const ByteArray*> gatt_advertisement_bytes_list =
         it.first->second->GetAdvertisements();
 
@@ -984,6 +1110,7 @@ void DiscoveredPeripheralTracker::AddInstantLostAdvertisement(
   lost_advertisment_infos_[std::string(
       advertisement_header.GetAdvertisementHash())] =
       SystemClock::ElapsedRealtime();
+  InvalidateScanResults();
 }
 
 void DiscoveredPeripheralTracker::RemoveExpiredInstantLostAdvertisements() {
@@ -1007,6 +1134,9 @@ void DiscoveredPeripheralTracker::RemoveExpiredInstantLostAdvertisements() {
   }
 
   last_lost_info_update_time_ = now;
+  if (count > 0) {
+    InvalidateScanResults();
+  }
   LOG(INFO) << "Removed " << count << " expired lost advertisements.";
 }
 
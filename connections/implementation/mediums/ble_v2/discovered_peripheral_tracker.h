@@ -16,6 +16,9 @@
 #define CORE_INTERNAL_MEDIUMS_BLE_V2_DISCOVERED_PERIPHERAL_TRACKER_H_
 
 #include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <string>
@@ -145,6 +148,35 @@ class DiscoveredPeripheralTracker {
     BleV2Peripheral peripheral;
   };
 
+  // Scan results that were fully processed recently are remembered in a
+  // small lock-free table, so that repeats of them can be dropped without
+  // taking `mutex_`. Entries are tagged with the state generation and are
+  // invalidated by bumping it whenever tracker state changes in a way that
+  // could change the outcome of processing a repeat. That includes every
+  // ProcessLostGattAdvertisements() pass, so the first repeat in each lost
+  // period still takes the full path and marks the peripheral as found.
+  static constexpr std::size_t kScanResultTableSize = 256;
+
+  // Identifies a scan result by its peripheral and service data. Returns
+  // std::nullopt if deduplication is disabled or the peripheral has no id.
+  static std::optional<std::uint64_t> GetScanResultKey(
+      const BleV2Peripheral& peripheral,
+      const api::ble_v2::BleAdvertisementData& advertisement_data);
+  std::uint64_t GetScanResultTag(std::uint64_t scan_result_key) const;
+  bool IsDuplicateScanResult(std::uint64_t scan_result_key) const;
+  void RememberScanResult(std::uint64_t scan_result_key)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void InvalidateScanResults() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Does the work of ProcessFoundBleAdvertisement(). Returns true if a repeat
+  // of the same scan result would have no effect until the state generation
+  // changes.
+  bool HandleFoundBleAdvertisement(
+      BleV2Peripheral peripheral,
+      api::ble_v2::BleAdvertisementData advertisement_data,
+      AdvertisementFetcher advertisement_fetcher)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
   // Clears stale data from any previous sessions.
   void ClearDataForServiceId(const std::string& service_id)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
@@ -217,8 +249,9 @@ class DiscoveredPeripheralTracker {
       const api::ble_v2::BleAdvertisementData& advertisement_data)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
-  // Handles the advertisement header for regular advertisement.
-  void HandleAdvertisementHeader(
+  // Handles the advertisement header for regular advertisement. Returns true
+  // if there's nothing left to do for the header, i.e. no GATT read is due.
+  bool HandleAdvertisementHeader(
       BleV2Peripheral peripheral,
       const api::ble_v2::BleAdvertisementData& advertisement_data,
       AdvertisementFetcher advertisement_fetcher)
@@ -289,6 +322,11 @@ class DiscoveredPeripheralTracker {
   Mutex mutex_;
   bool is_extended_advertisement_available_;
 
+  // Only changed while holding `mutex_`, but read without it.
+  std::atomic<std::uint64_t> scan_result_generation_ = 0;
+  std::array<std::atomic<std::uint64_t>, kScanResultTableSize>
+      scan_result_tags_ = {};
+
   // ------------ SERVICE ID MAPS ------------
   // Entries in these maps all follow the same lifecycle. Entries are added in
   // StartTracking, and removed in StopTracking.
@@ -0,0 +1,153 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "absl/strings/str_cat.h"
+#include "connections/implementation/mediums/ble_v2/advertisement_read_result.h"
+#include "connections/implementation/mediums/ble_v2/ble_advertisement.h"
+#include "connections/implementation/mediums/ble_v2/ble_advertisement_header.h"
+#include "connections/implementation/mediums/ble_v2/discovered_peripheral_tracker.h"
+#include "connections/implementation/pcp.h"
+#include "internal/platform/ble_v2.h"
+#include "internal/platform/bluetooth_adapter.h"
+#include "internal/platform/byte_array.h"
+#include "internal/platform/feature_flags.h"
+#include "internal/platform/implementation/ble_v2.h"
+#include "internal/platform/medium_environment.h"
+#include "internal/platform/uuid.h"
+
+namespace nearby {
+namespace connections {
+namespace mediums {
+namespace {
+
+constexpr char kServiceId[] = "A";
+constexpr char kFastAdvertisementServiceUuid[] = "FE2C";
+
+// A scanner in a crowded room: `peripherals` devices each keep reporting the
+// same fast advertisement, and every report reaches the tracker.
+class ScanStorm {
+ public:
+  ScanStorm(int peripherals, bool dedup) {
+    MediumEnvironment::Instance().Start();
+    MediumEnvironment::Instance().SetFeatureFlags(
+        {.enable_scan_result_dedup = dedup});
+    medium_ = std::make_unique<BleV2Medium>(adapter_);
+    tracker_.StartTracking(kServiceId, /*include_dct_advertisement=*/false,
+                           Pcp::kP2pPointToPoint, {},
+                           Uuid(kFastAdvertisementServiceUuid));
+    for (int i = 0; i < peripherals; ++i) {
+      api::ble_v2::BleAdvertisementData advertisement_data{};
+      advertisement_data.service_data.insert(
+          {Uuid(kFastAdvertisementServiceUuid),
+           ByteArray(BleAdvertisement(
+               BleAdvertisement::Version::kV2,
+               BleAdvertisement::SocketVersion::kV2,
+               /*service_id_hash=*/ByteArray{},
+               ByteArray(absl::StrCat("endpoint-", i)),
+               /*device_token=*/ByteArray{},
+               BleAdvertisementHeader::kDefaultPsmValue))});
+      scan_results_.push_back(
+          {BleV2Peripheral(*medium_, /*unique_id=*/i + 1),
+           std::move(advertisement_data)});
+    }
+  }
+
+  ~ScanStorm() {
+    MediumEnvironment::Instance().SetFeatureFlags({});
+    MediumEnvironment::Instance().Stop();
+  }
+
+  void Report(int i) {
+    const ScanResult& scan_result = scan_results_[i % scan_results_.size()];
+    tracker_.ProcessFoundBleAdvertisement(
+        scan_result.peripheral, scan_result.advertisement_data,
+        [](BleV2Peripheral, int, int, const std::vector<std::string>&,
+           AdvertisementReadResult&) {});
+  }
+
+  void ProcessLost() { tracker_.ProcessLostGattAdvertisements(); }
+
+ private:
+  struct ScanResult {
+    BleV2Peripheral peripheral;
+    api::ble_v2::BleAdvertisementData advertisement_data;
+  };
+
+  BluetoothAdapter adapter_;
+  std::unique_ptr<BleV2Medium> medium_;
+  DiscoveredPeripheralTracker tracker_;
+  std::vector<ScanResult> scan_results_;
+};
+
+void BM_ScanStorm(benchmark::State& state) {
+  ScanStorm storm(state.range(0), /*dedup=*/state.range(1) != 0);
+  int i = 0;
+  for (auto _ : state) {
+    storm.Report(i++);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ScanStorm)
+    ->ArgNames({"peripherals", "dedup"})
+    ->ArgsProduct({{16, 256}, {0, 1}});
+
+// Same storm, with the lost alarm firing every `reports_per_lost_period`
+// reports, so each period starts with a full pass per peripheral.
+void BM_ScanStormWithLostAlarm(benchmark::State& state) {
+  constexpr int kReportsPerLostPeriod = 4096;
+  ScanStorm storm(state.range(0), /*dedup=*/state.range(1) != 0);
+  int i = 0;
+  for (auto _ : state) {
+    storm.Report(i++);
+    if (i % kReportsPerLostPeriod == 0) {
+      storm.ProcessLost();
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ScanStormWithLostAlarm)
+    ->ArgNames({"peripherals", "dedup"})
+    ->ArgsProduct({{16, 256}, {0, 1}});
+
+// Scan callbacks arriving on several threads at once, which is where skipping
+// the tracker lock pays off most.
+ScanStorm* shared_storm = nullptr;
+
+void BM_ConcurrentScanStorm(benchmark::State& state) {
+  if (state.thread_index() == 0) {
+    shared_storm = new ScanStorm(/*peripherals=*/64,
+                                 /*dedup=*/state.range(0) != 0);
+  }
+  int i = state.thread_index();
+  for (auto _ : state) {
+    shared_storm->Report(i++);
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0) {
+    delete shared_storm;
+    shared_storm = nullptr;
+  }
+}
+BENCHMARK(BM_ConcurrentScanStorm)->ArgName("dedup")->Arg(0)->Arg(1)->Threads(4);
+
+}  // namespace
+}  // namespace mediums
+}  // namespace connections
+}  // namespace nearby
@@ -965,6 +965,61 @@ TEST_P(DiscoveredPeripheralTrackerTest,
   EXPECT_FALSE(lost_latch.Await(kWaitDuration).result());
 }
 
+TEST_P(DiscoveredPeripheralTrackerTest,
+       RepeatedScanResultsKeepPeripheralFound) {
+  std::vector<std::string> service_ids = {std::string(kServiceIdA)};
+  ByteArray advertisement_header_bytes = CreateBleAdvertisementHeader(
+      GenerateRandomAdvertisementHash(), service_ids);
+  ByteArray advertisement_bytes = CreateBleAdvertisement(
+      std::string(kServiceIdA), ByteArray(std::string(kData)),
+      ByteArray(std::string(kDeviceToken)));
+  CountDownLatch found_latch(1);
+  CountDownLatch lost_latch(1);
+  CountDownLatch fetch_latch(1);
+  std::atomic<int> found_count = 0;
+
+  discovered_peripheral_tracker_.StartTracking(
+      std::string(kServiceIdA), false, Pcp::kP2pPointToPoint,
+      {
+          .peripheral_discovered_cb =
+              [&found_count, &found_latch](
+                  BleV2Peripheral peripheral, const std::string& service_id,
+                  const ByteArray& advertisement_bytes,
+                  bool fast_advertisement) {
+                found_count++;
+                found_latch.CountDown();
+              },
+          .peripheral_lost_cb =
+              [&lost_latch](
+                  BleV2Peripheral peripheral, const std::string& service_id,
+                  const ByteArray& advertisement_bytes,
+                  bool fast_advertisement) { lost_latch.CountDown(); },
+      },
+      {});
+
+  api::ble_v2::BleAdvertisementData advertisement_data{};
+  advertisement_data.service_data.insert(
+      {bleutils::kCopresenceServiceUuid, advertisement_header_bytes});
+
+  FindAdvertisement(advertisement_data, {advertisement_bytes}, fetch_latch);
+  fetch_latch.Await(kWaitDuration);
+  EXPECT_TRUE(found_latch.Await(kWaitDuration).result());
+
+  // Scanners report the same advertisement many times per lost period. The
+  // repeats must still keep the peripheral from being reported lost.
+  for (int i = 0; i < 10; i++) {
+    for (int j = 0; j < 5; j++) {
+      FindAdvertisement(advertisement_data, {advertisement_bytes},
+                        fetch_latch);
+    }
+    discovered_peripheral_tracker_.ProcessLostGattAdvertisements();
+  }
+
+  EXPECT_EQ(found_count, 1);
+  EXPECT_EQ(GetFetchAdvertisementCallbackCount(), 1);
+  EXPECT_FALSE(lost_latch.Await(kWaitDuration).result());
+}
+
 TEST_P(DiscoveredPeripheralTrackerTest, LostPeripheralForAdvertisementLost) {
   std::vector<std::string> service_ids = {std::string(kServiceIdA)};
   ByteArray advertisement_header_bytes = CreateBleAdvertisementHeader(
@@ -18,6 +18,7 @@
 #include <optional>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
@@ -41,6 +42,8 @@ namespace {
 using ::location::nearby::mediums::ConnectionResponseFrame;
 
 constexpr absl::string_view kFakeSalt = "RECEIVER_CONDIMENT";
+// Frames the writer thread takes off the queue to write with a single flush.
+constexpr size_t kMaxFramesPerFlush = 16;
 }  // namespace
 
 // Implementation for class MultiplexOutputStream
@@ -217,10 +220,11 @@ void MultiplexOutputStream::MultiplexWriter::EnqueueToSend(
 
 void MultiplexOutputStream::MultiplexWriter::StartWriting() {
   NEARBY_LOGS(INFO) << "Writing loop started.";
+  std::vector<EnqueuedFrame> enqueued_frames;
   while (true) {
-    auto enqueued_frame = data_queue_.TryTake();
-    if (enqueued_frame != std::nullopt) {
-      Write(enqueued_frame.value());
+    if (data_queue_.DrainTo(enqueued_frames, kMaxFramesPerFlush) > 0) {
+      Write(enqueued_frames);
+      enqueued_frames.clear();
       continue;
     }
     {
@@ -247,23 +251,33 @@ void MultiplexOutputStream::MultiplexWriter::StartWriting() {
 }
 
 void MultiplexOutputStream::MultiplexWriter::Write(
-    EnqueuedFrame& enqueued_frame) {
+    std::vector<EnqueuedFrame>& enqueued_frames) {
   MutexLock lock(&writer_mutex_);
-  if (!physical_writer_
-           ->Write(Base64Utils::IntToBytes(enqueued_frame.data_.size()))
-           .Ok()) {
-    enqueued_frame.future_->SetException({Exception::kIo});
-    return;
-  };
-  if (!physical_writer_->Write(enqueued_frame.data_).Ok()) {
-    enqueued_frame.future_->SetException({Exception::kIo});
-    return;
-  };
-  if (!physical_writer_->Flush().Ok()) {
-    enqueued_frame.future_->SetException({Exception::kIo});
-    return;
-  };
-  enqueued_frame.future_->Set(true);
+  // Once a write fails, the frames after it aren't written: the stream may
+  // hold part of the failed frame, so anything following it would be misread.
+  bool write_failed = false;
+  for (EnqueuedFrame& enqueued_frame : enqueued_frames) {
+    if (write_failed ||
+        !physical_writer_
+             ->Write(Base64Utils::IntToBytes(enqueued_frame.data_.size()))
+             .Ok() ||
+        !physical_writer_->Write(enqueued_frame.data_).Ok()) {
+      write_failed = true;
+      enqueued_frame.future_->SetException({Exception::kIo});
+      enqueued_frame.future_ = nullptr;
+    }
+  }
+  bool flushed = physical_writer_->Flush().Ok();
+  for (EnqueuedFrame& enqueued_frame : enqueued_frames) {
+    if (enqueued_frame.future_ == nullptr) {
+      continue;
+    }
+    if (flushed) {
+      enqueued_frame.future_->Set(true);
+    } else {
+      enqueued_frame.future_->SetException({Exception::kIo});
+    }
+  }
 }
 
 void MultiplexOutputStream::MultiplexWriter::Close() {
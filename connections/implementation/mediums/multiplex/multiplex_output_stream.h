@@ -17,6 +17,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_map.h"
@@ -104,7 +105,7 @@ class MultiplexOutputStream {
   class EnqueuedFrame {
    public:
     EnqueuedFrame(Future<bool>* future, ByteArray data)
-        : future_(future), data_(data) {}
+        : future_(future), data_(std::move(data)) {}
     ~EnqueuedFrame() = default;
 
     Future<bool>* future_;
@@ -126,8 +127,10 @@ class MultiplexOutputStream {
     // Starts the writer thread.
     void StartWriting();
 
-    // Writes the enqueued frame.
-    void Write(EnqueuedFrame& enqueued_frame);
+    // Writes the enqueued frames, flushing the physical writer once for all
+    // of them. Stops at the first frame that fails to be written, failing it
+    // and the frames after it.
+    void Write(std::vector<EnqueuedFrame>& enqueued_frames);
 
     Mutex writer_mutex_;
     OutputStream* physical_writer_ ABSL_PT_GUARDED_BY(writer_mutex_);
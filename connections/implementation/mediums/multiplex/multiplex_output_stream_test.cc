@@ -14,6 +14,7 @@
 
 #include "connections/implementation/mediums/multiplex/multiplex_output_stream.h"
 
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -51,6 +52,36 @@ using ::location::nearby::mediums::ConnectionResponseFrame;
 using ::location::nearby::mediums::MultiplexControlFrame;
 using ::location::nearby::mediums::MultiplexFrame;
 
+// Holds the first write until released, and fails every write from
+// `first_failed_write` on, counting from 1.
+class FailingOutputStream : public OutputStream {
+ public:
+  explicit FailingOutputStream(int first_failed_write)
+      : first_failed_write_(first_failed_write) {}
+
+  Exception Write(const ByteArray& data) override {
+    int write = ++num_writes_;
+    if (write == 1) {
+      first_write_started_.CountDown();
+      release_first_write_.Await();
+    }
+    return write >= first_failed_write_ ? Exception{Exception::kIo}
+                                         : Exception{Exception::kSuccess};
+  }
+  Exception Flush() override { return {Exception::kSuccess}; }
+  Exception Close() override { return {Exception::kSuccess}; }
+
+  void AwaitFirstWrite() { first_write_started_.Await(); }
+  void ReleaseFirstWrite() { release_first_write_.CountDown(); }
+  int num_writes() const { return num_writes_; }
+
+ private:
+  const int first_failed_write_;
+  std::atomic<int> num_writes_ = 0;
+  CountDownLatch first_write_started_{1};
+  CountDownLatch release_first_write_{1};
+};
+
 class MultiplexOutputStreamTest : public ::testing::Test {
  protected:
   ExceptionOr<MultiplexFrame> ReadFrame() {
@@ -247,6 +278,40 @@ TEST_F(MultiplexOutputStreamTest, CreateTwoVirtualStreams_SendData) {
   multiplex_output_stream_->Shutdown();
 }
 
+TEST_F(MultiplexOutputStreamTest, StopsWritingAtFirstFailedFrame) {
+  // The size of the second frame is the third write.
+  FailingOutputStream failing_writer(/*first_failed_write=*/3);
+  multiplex_output_stream_ =
+      std::make_unique<MultiplexOutputStream>(&failing_writer, enabled_);
+  auto virtual_output_stream =
+      multiplex_output_stream_->CreateVirtualOutputStream(
+          std::string(kServiceId_1), std::string(kSalt_1));
+
+  const ByteArray data("abcdefg");
+  MultiThreadExecutor executor(3);
+  CountDownLatch latch(3);
+  executor.Execute([&]() {
+    EXPECT_TRUE(virtual_output_stream->Write(data).Ok());
+    latch.CountDown();
+  });
+  failing_writer.AwaitFirstWrite();
+  // Both frames are queued while the first one is being written, so they're
+  // written as one batch.
+  for (int i = 0; i < 2; ++i) {
+    executor.Execute([&]() {
+      EXPECT_FALSE(virtual_output_stream->Write(data).Ok());
+      latch.CountDown();
+    });
+  }
+  absl::SleepFor(absl::Milliseconds(100));
+  failing_writer.ReleaseFirstWrite();
+  EXPECT_TRUE(latch.Await(absl::Milliseconds(5000)).result());
+
+  // Nothing is written after the failed write.
+  EXPECT_EQ(failing_writer.num_writes(), 3);
+  multiplex_output_stream_->Shutdown();
+}
+
 }  // namespace multiplex
 }  // namespace mediums
 }  // namespace connections
@@ -181,7 +181,8 @@ ByteArray ForConnectionRequestPresence(
 }
 
 ByteArray ForConnectionResponse(std::int32_t status, const OsInfo& os_info,
-                                std::int32_t multiplex_socket_bitmask) {
+                                std::int32_t multiplex_socket_bitmask,
+                                std::int32_t capability_bitmask) {
   OfflineFrame frame;
 
   frame.set_version(OfflineFrame::V1);
@@ -202,6 +203,7 @@ ByteArray ForConnectionResponse(std::int32_t status, const OsInfo& os_info,
       NearbyFlags::GetInstance().GetInt64Flag(
           config_package_nearby::nearby_connections_feature::
               kSafeToDisconnectVersion));
+  sub_frame->set_capability_bitmask(capability_bitmask);
 
   return ToBytes(std::move(frame));
 }
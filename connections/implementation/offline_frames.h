@@ -55,7 +55,7 @@ ByteArray ForConnectionRequestPresence(
     const ConnectionInfo& connection_info);
 ByteArray ForConnectionResponse(
     std::int32_t status, const location::nearby::connections::OsInfo& os_info,
-    std::int32_t multiplex_socket_bitmask);
+    std::int32_t multiplex_socket_bitmask, std::int32_t capability_bitmask);
 
 // Builds Payload transfer messages.
 ByteArray ForDataPayloadTransfer(
@@ -289,6 +289,7 @@ TEST(OfflineFramesTest, CanGenerateConnectionResponse) {
         os_info { type: LINUX }
         multiplex_socket_bitmask: 0x01
         safe_to_disconnect_version: 5
+        capability_bitmask: 0x01
       >
     >)pb";
 
@@ -299,7 +300,8 @@ TEST(OfflineFramesTest, CanGenerateConnectionResponse) {
           kSafeToDisconnectVersion,
       5);
   ByteArray bytes =
-      ForConnectionResponse(1, os_info, /*multiplex_socket_bitmask=*/0x01);
+      ForConnectionResponse(1, os_info, /*multiplex_socket_bitmask=*/0x01,
+                            /*capability_bitmask=*/0x01);
   auto response = FromBytes(bytes);
   ASSERT_TRUE(response.ok());
   OfflineFrame message = response.result();
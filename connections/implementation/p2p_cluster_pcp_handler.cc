@@ -1465,7 +1465,8 @@ Status P2pClusterPcpHandler::InjectEndpointImpl(
 }
 
 BasePcpHandler::ConnectImplResult P2pClusterPcpHandler::ConnectImpl(
-    ClientProxy* client, BasePcpHandler::DiscoveredEndpoint* endpoint) {
+    ClientProxy* client, BasePcpHandler::DiscoveredEndpoint* endpoint,
+    CancellationFlag* cancellation_flag) {
   if (!endpoint) {
     return BasePcpHandler::ConnectImplResult{
         .status = {Status::kError},
@@ -1475,7 +1476,8 @@ BasePcpHandler::ConnectImplResult P2pClusterPcpHandler::ConnectImpl(
     case BLUETOOTH: {
       auto* bluetooth_endpoint = down_cast<BluetoothEndpoint*>(endpoint);
       if (bluetooth_endpoint) {
-        return BluetoothConnectImpl(client, bluetooth_endpoint);
+        return BluetoothConnectImpl(client, bluetooth_endpoint,
+                                    cancellation_flag);
       }
       break;
     }
@@ -1485,13 +1487,14 @@ BasePcpHandler::ConnectImplResult P2pClusterPcpHandler::ConnectImpl(
                   kEnableBleV2)) {
         auto* ble_v2_endpoint = down_cast<BleV2Endpoint*>(endpoint);
         if (ble_v2_endpoint) {
-          return BleV2ConnectImpl(client, ble_v2_endpoint);
+          return BleV2ConnectImpl(client, ble_v2_endpoint,
+                                  cancellation_flag);
         }
 
       } else {
         auto* ble_endpoint = down_cast<BleEndpoint*>(endpoint);
         if (ble_endpoint) {
-          return BleConnectImpl(client, ble_endpoint);
+          return BleConnectImpl(client, ble_endpoint, cancellation_flag);
         }
       }
       break;
@@ -1499,14 +1502,15 @@ BasePcpHandler::ConnectImplResult P2pClusterPcpHandler::ConnectImpl(
     case WIFI_LAN: {
       auto* wifi_lan_endpoint = down_cast<WifiLanEndpoint*>(endpoint);
       if (wifi_lan_endpoint) {
-        return WifiLanConnectImpl(client, wifi_lan_endpoint);
+        return WifiLanConnectImpl(client, wifi_lan_endpoint,
+                                  cancellation_flag);
       }
       break;
     }
     case AWDL: {
       auto* awdl_endpoint = down_cast<AwdlEndpoint*>(endpoint);
       if (awdl_endpoint) {
-        return AwdlConnectImpl(client, awdl_endpoint);
+        return AwdlConnectImpl(client, awdl_endpoint, cancellation_flag);
       }
       break;
     }
@@ -2396,15 +2400,15 @@ void P2pClusterPcpHandler::StartBluetoothDiscoveryWithPause(
 }
 
 BasePcpHandler::ConnectImplResult P2pClusterPcpHandler::BluetoothConnectImpl(
-    ClientProxy* client, BluetoothEndpoint* endpoint) {
+    ClientProxy* client, BluetoothEndpoint* endpoint,
+    CancellationFlag* cancellation_flag) {
   VLOG(1) << "Client " << client->GetClientId()
           << " is attempting to connect to endpoint(id="
           << endpoint->endpoint_id << ") over Bluetooth Classic.";
   BluetoothDevice& device = endpoint->bluetooth_device;
 
   ErrorOr<BluetoothSocket> bluetooth_socket_result = bluetooth_medium_.Connect(
-      device, endpoint->service_id,
-      client->GetCancellationFlag(endpoint->endpoint_id));
+      device, endpoint->service_id, cancellation_flag);
   if (bluetooth_socket_result.has_error()) {
     LOG(ERROR)
         << "In BluetoothConnectImpl(), failed to connect to Bluetooth device "
@@ -2422,12 +2426,12 @@ BasePcpHandler::ConnectImplResult P2pClusterPcpHandler::BluetoothConnectImpl(
   VLOG(1) << "Client" << client->GetClientId()
           << " created Bluetooth endpoint channel to endpoint(id="
           << endpoint->endpoint_id << ").";
-  client->SetBluetoothMacAddress(endpoint->endpoint_id, device.GetMacAddress());
   return BasePcpHandler::ConnectImplResult{
       .medium = BLUETOOTH,
       .status = {Status::kSuccess},
       .operation_result_code = OperationResultCode::DETAIL_SUCCESS,
-      .endpoint_channel = std::move(channel)};
+      .endpoint_channel = std::move(channel),
+      .bluetooth_mac_address = device.GetMacAddress()};
 }
 
 void P2pClusterPcpHandler::BleConnectionAcceptedHandler(
@@ -2648,7 +2652,8 @@ ErrorOr<Medium> P2pClusterPcpHandler::StartBleScanning(
 }
 
 BasePcpHandler::ConnectImplResult P2pClusterPcpHandler::BleConnectImpl(
-    ClientProxy* client, BleEndpoint* endpoint) {
+    ClientProxy* client, BleEndpoint* endpoint,
+    CancellationFlag* cancellation_flag) {
   VLOG(1) << "Client " << client->GetClientId()
           << " is attempting to connect to endpoint(id="
           << endpoint->endpoint_id << ") over BLE.";
@@ -2656,8 +2661,7 @@ BasePcpHandler::ConnectImplResult P2pClusterPcpHandler::BleConnectImpl(
   BlePeripheral& peripheral = endpoint->ble_peripheral;
 
   ErrorOr<BleSocket> ble_socket_result =
-      ble_medium_.Connect(peripheral, endpoint->service_id,
-                          client->GetCancellationFlag(endpoint->endpoint_id));
+      ble_medium_.Connect(peripheral, endpoint->service_id, cancellation_flag);
   if (ble_socket_result.has_error()) {
     LOG(ERROR) << "In BleConnectImpl(), failed to connect to BLE device "
                << peripheral.GetName()
@@ -2961,7 +2965,8 @@ ErrorOr<Medium> P2pClusterPcpHandler::StartBleV2Scanning(
 }
 
 BasePcpHandler::ConnectImplResult P2pClusterPcpHandler::BleV2ConnectImpl(
-    ClientProxy* client, BleV2Endpoint* endpoint) {
+    ClientProxy* client, BleV2Endpoint* endpoint,
+    CancellationFlag* cancellation_flag) {
   BleV2Peripheral& peripheral = endpoint->ble_peripheral;
 
   VLOG(1) << "Client " << client->GetClientId()
@@ -2973,9 +2978,8 @@ BasePcpHandler::ConnectImplResult P2pClusterPcpHandler::BleV2ConnectImpl(
       peripheral.GetPsm() !=
           mediums::BleAdvertisementHeader::kDefaultPsmValue) {
     ErrorOr<BleL2capSocket> ble_l2cap_socket_result =
-        ble_v2_medium_.ConnectOverL2cap(
-            endpoint->service_id, peripheral,
-            client->GetCancellationFlag(endpoint->endpoint_id));
+        ble_v2_medium_.ConnectOverL2cap(endpoint->service_id, peripheral,
+                                        cancellation_flag);
     if (!ble_l2cap_socket_result.has_error()) {
       LOG(INFO) << "In BleV2ConnectImpl(), connected to Ble L2CAP device "
                 << absl::BytesToHexString(peripheral.GetId().data())
@@ -2998,8 +3002,7 @@ BasePcpHandler::ConnectImplResult P2pClusterPcpHandler::BleV2ConnectImpl(
   }
 
   ErrorOr<BleV2Socket> ble_socket_result = ble_v2_medium_.Connect(
-      endpoint->service_id, peripheral,
-      client->GetCancellationFlag(endpoint->endpoint_id));
+      endpoint->service_id, peripheral, cancellation_flag);
   if (ble_socket_result.has_error()) {
     LOG(ERROR) << "In BleV2ConnectImpl(), failed to connect to BLE device "
                << absl::BytesToHexString(peripheral.GetId().data())
@@ -3293,13 +3296,14 @@ ErrorOr<Medium> P2pClusterPcpHandler::StartWifiLanDiscovery(
 }
 
 BasePcpHandler::ConnectImplResult P2pClusterPcpHandler::AwdlConnectImpl(
-    ClientProxy* client, AwdlEndpoint* endpoint) {
+    ClientProxy* client, AwdlEndpoint* endpoint,
+    CancellationFlag* cancellation_flag) {
   LOG(INFO) << "Client " << client->GetClientId()
             << " is attempting to connect to endpoint(id="
             << endpoint->endpoint_id << ") over Awdl.";
   ErrorOr<AwdlSocket> socket_result =
       awdl_medium_.Connect(endpoint->service_id, endpoint->service_info,
-                           client->GetCancellationFlag(endpoint->endpoint_id));
+                           cancellation_flag);
   if (socket_result.has_error()) {
     LOG(ERROR) << "In AwdlConnectImpl(), failed to connect to service "
                << endpoint->service_info.GetServiceName()
@@ -3329,13 +3333,13 @@ BasePcpHandler::ConnectImplResult P2pClusterPcpHandler::AwdlConnectImpl(
 }
 
 BasePcpHandler::ConnectImplResult P2pClusterPcpHandler::WifiLanConnectImpl(
-    ClientProxy* client, WifiLanEndpoint* endpoint) {
+    ClientProxy* client, WifiLanEndpoint* endpoint,
+    CancellationFlag* cancellation_flag) {
   LOG(INFO) << "Client " << client->GetClientId()
             << " is attempting to connect to endpoint(id="
             << endpoint->endpoint_id << ") over WifiLan.";
   ErrorOr<WifiLanSocket> socket_result = wifi_lan_medium_.Connect(
-      endpoint->service_id, endpoint->service_info,
-      client->GetCancellationFlag(endpoint->endpoint_id));
+      endpoint->service_id, endpoint->service_info, cancellation_flag);
   if (socket_result.has_error()) {
     LOG(ERROR) << "In WifiLanConnectImpl(), failed to connect to service "
                << endpoint->service_info.GetServiceName()
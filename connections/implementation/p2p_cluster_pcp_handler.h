@@ -114,8 +114,8 @@ class P2pClusterPcpHandler : public BasePcpHandler {
 
   // @PCPHandlerThread
   BasePcpHandler::ConnectImplResult ConnectImpl(
-      ClientProxy* client,
-      BasePcpHandler::DiscoveredEndpoint* endpoint) override;
+      ClientProxy* client, BasePcpHandler::DiscoveredEndpoint* endpoint,
+      CancellationFlag* cancellation_flag) override;
 
   // @PCPHandlerThread
   BasePcpHandler::StartOperationResult StartListeningForIncomingConnectionsImpl(
@@ -215,7 +215,8 @@ class P2pClusterPcpHandler : public BasePcpHandler {
                       OperationResultWithMedium>& operation_result_with_mediums,
       int update_index);
   BasePcpHandler::ConnectImplResult BluetoothConnectImpl(
-      ClientProxy* client, BluetoothEndpoint* endpoint);
+      ClientProxy* client, BluetoothEndpoint* endpoint,
+      CancellationFlag* cancellation_flag);
 
   // Ble
   bool IsRecognizedBleEndpoint(const std::string& service_id,
@@ -240,8 +241,9 @@ class P2pClusterPcpHandler : public BasePcpHandler {
   ErrorOr<location::nearby::proto::connections::Medium> StartBleScanning(
       ClientProxy* client, const std::string& service_id,
       const std::string& fast_advertisement_service_uuid);
-  BasePcpHandler::ConnectImplResult BleConnectImpl(ClientProxy* client,
-                                                   BleEndpoint* endpoint);
+  BasePcpHandler::ConnectImplResult BleConnectImpl(
+      ClientProxy* client, BleEndpoint* endpoint,
+      CancellationFlag* cancellation_flag);
 
   // BleV2
   bool IsRecognizedBleV2Endpoint(absl::string_view service_id,
@@ -279,8 +281,9 @@ class P2pClusterPcpHandler : public BasePcpHandler {
   ErrorOr<location::nearby::proto::connections::Medium> StartBleV2Scanning(
       ClientProxy* client, const std::string& service_id,
       const DiscoveryOptions& discovery_options);
-  BasePcpHandler::ConnectImplResult BleV2ConnectImpl(ClientProxy* client,
-                                                     BleV2Endpoint* endpoint);
+  BasePcpHandler::ConnectImplResult BleV2ConnectImpl(
+      ClientProxy* client, BleV2Endpoint* endpoint,
+      CancellationFlag* cancellation_flag);
   // Awdl
   void AwdlServiceDiscoveredHandler(ClientProxy* client,
                                     NsdServiceInfo service_info,
@@ -293,8 +296,9 @@ class P2pClusterPcpHandler : public BasePcpHandler {
                                      NearbyDevice::Type device_type,
                                      const std::string& service_id,
                                      AwdlSocket socket);
-  BasePcpHandler::ConnectImplResult AwdlConnectImpl(ClientProxy* client,
-                                                    AwdlEndpoint* endpoint);
+  BasePcpHandler::ConnectImplResult AwdlConnectImpl(
+      ClientProxy* client, AwdlEndpoint* endpoint,
+      CancellationFlag* cancellation_flag);
   ErrorOr<location::nearby::proto::connections::Medium> StartAwdlAdvertising(
       ClientProxy* client, const std::string& service_id,
       const std::string& local_endpoint_id,
@@ -325,7 +329,8 @@ class P2pClusterPcpHandler : public BasePcpHandler {
   ErrorOr<location::nearby::proto::connections::Medium> StartWifiLanDiscovery(
       ClientProxy* client, const std::string& service_id);
   BasePcpHandler::ConnectImplResult WifiLanConnectImpl(
-      ClientProxy* client, WifiLanEndpoint* endpoint);
+      ClientProxy* client, WifiLanEndpoint* endpoint,
+      CancellationFlag* cancellation_flag);
 
   Awdl& awdl_medium_;
   BluetoothRadio& bluetooth_radio_;
@@ -0,0 +1,196 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/payload_checkpoint_journal.h"
+
+#include <algorithm>
+#include <chrono>  // NOLINT(build/c++11)
+#include <cstdint>
+#include <cstring>
+#include <filesystem>  // NOLINT(build/c++17)
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <system_error>  // NOLINT
+#include <vector>
+
+#include "absl/base/config.h"
+#include "absl/numeric/bits.h"
+#include "absl/numeric/int128.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "internal/platform/device_info_impl.h"
+#include "internal/platform/logging.h"
+
+namespace nearby {
+namespace connections {
+
+namespace {
+constexpr std::uint64_t kMultiplier = 0x9e3779b97f4a7c15;
+constexpr char kRelativeDirectory[] = "Google/Nearby/Connections/checkpoints";
+
+// Folds the 128-bit product of `a` and `b` into 64 bits.
+std::uint64_t Mix(std::uint64_t a, std::uint64_t b) {
+  absl::uint128 product = absl::uint128(a) * b;
+  return absl::Uint128Low64(product) ^ absl::Uint128High64(product);
+}
+
+// Reads a little-endian word, whatever the byte order of the host.
+std::uint64_t LoadWord(const char* data) {
+  std::uint64_t word;
+  std::memcpy(&word, data, sizeof(word));
+#ifdef ABSL_IS_BIG_ENDIAN
+  word = absl::byteswap(word);
+#endif
+  return word;
+}
+}  // namespace
+
+void PayloadHash::Update(absl::string_view data) {
+  size_ += data.size();
+  if (tail_size_ > 0) {
+    int taken = std::min<int>(kWordSize - tail_size_, data.size());
+    std::memcpy(tail_ + tail_size_, data.data(), taken);
+    tail_size_ += taken;
+    data.remove_prefix(taken);
+    if (tail_size_ < kWordSize) {
+      return;
+    }
+    state_ = Mix(state_ ^ LoadWord(tail_), kMultiplier);
+    tail_size_ = 0;
+  }
+  while (data.size() >= kWordSize) {
+    state_ = Mix(state_ ^ LoadWord(data.data()), kMultiplier);
+    data.remove_prefix(kWordSize);
+  }
+  std::memcpy(tail_, data.data(), data.size());
+  tail_size_ = data.size();
+}
+
+std::uint64_t PayloadHash::Get() const {
+  char last_word[kWordSize] = {};
+  std::memcpy(last_word, tail_, tail_size_);
+  // The size tells apart inputs that only differ by trailing zeros.
+  return Mix(Mix(state_ ^ LoadWord(last_word), kMultiplier) ^ size_,
+             kMultiplier);
+}
+
+std::string PayloadCheckpointJournal::GetDefaultDirectory() {
+  return (DeviceInfoImpl().GetAppDataPath() / kRelativeDirectory).string();
+}
+
+// A checkpoint is a single line, "<id> <total size> <offset> <hash> <path>".
+// The path goes last since it may contain spaces, and the trailing newline
+// tells a complete line from a torn one.
+bool PayloadCheckpointJournal::Save(const PayloadCheckpoint& checkpoint) const {
+  std::error_code error;
+  std::filesystem::create_directories(std::filesystem::u8path(directory_),
+                                      error);
+  std::string path = GetPath(checkpoint.payload_id);
+  std::string temp_path = absl::StrCat(path, ".tmp");
+  {
+    std::ofstream file(std::filesystem::u8path(temp_path),
+                       std::ios::binary | std::ios::trunc);
+    file << checkpoint.payload_id << " " << checkpoint.total_size << " "
+         << checkpoint.offset << " " << checkpoint.hash << " "
+         << checkpoint.file_path << "\n";
+    file.close();
+    if (file.fail()) {
+      LOG(WARNING) << "Failed to write the checkpoint of payload "
+                   << checkpoint.payload_id << " to " << temp_path;
+      std::filesystem::remove(std::filesystem::u8path(temp_path), error);
+      return false;
+    }
+  }
+  std::filesystem::rename(std::filesystem::u8path(temp_path),
+                          std::filesystem::u8path(path), error);
+  if (error) {
+    LOG(WARNING) << "Failed to save the checkpoint of payload "
+                 << checkpoint.payload_id << ": " << error.message();
+    return false;
+  }
+  return true;
+}
+
+std::optional<PayloadCheckpoint> PayloadCheckpointJournal::Load(
+    Payload::Id payload_id) const {
+  std::ifstream file(std::filesystem::u8path(GetPath(payload_id)),
+                     std::ios::binary);
+  if (!file.is_open()) {
+    return std::nullopt;
+  }
+  std::string line((std::istreambuf_iterator<char>(file)),
+                   std::istreambuf_iterator<char>());
+  if (line.empty() || line.back() != '\n') {
+    LOG(WARNING) << "Ignoring a torn checkpoint of payload " << payload_id;
+    return std::nullopt;
+  }
+  line.pop_back();
+
+  std::vector<absl::string_view> fields =
+      absl::StrSplit(line, absl::MaxSplits(' ', 4));
+  PayloadCheckpoint checkpoint;
+  if (fields.size() != 5 ||
+      !absl::SimpleAtoi(fields[0], &checkpoint.payload_id) ||
+      !absl::SimpleAtoi(fields[1], &checkpoint.total_size) ||
+      !absl::SimpleAtoi(fields[2], &checkpoint.offset) ||
+      !absl::SimpleAtoi(fields[3], &checkpoint.hash) || fields[4].empty() ||
+      checkpoint.payload_id != payload_id) {
+    LOG(WARNING) << "Ignoring a malformed checkpoint of payload "
+                 << payload_id;
+    return std::nullopt;
+  }
+  checkpoint.file_path = std::string(fields[4]);
+  return checkpoint;
+}
+
+void PayloadCheckpointJournal::Remove(Payload::Id payload_id) const {
+  std::error_code error;
+  std::filesystem::remove(std::filesystem::u8path(GetPath(payload_id)), error);
+}
+
+std::string PayloadCheckpointJournal::GetPartialFilePath(
+    Payload::Id payload_id) const {
+  return absl::StrCat(directory_, "/", payload_id, ".partial");
+}
+
+void PayloadCheckpointJournal::RemoveExpired(absl::Duration max_age) const {
+  std::filesystem::file_time_type oldest =
+      std::filesystem::file_time_type::clock::now() -
+      absl::ToChronoSeconds(max_age);
+  std::error_code error;
+  for (const std::filesystem::directory_entry& entry :
+       std::filesystem::directory_iterator(std::filesystem::u8path(directory_),
+                                           error)) {
+    std::error_code entry_error;
+    if (!entry.is_regular_file(entry_error) ||
+        entry.last_write_time(entry_error) >= oldest || entry_error) {
+      continue;
+    }
+    LOG(INFO) << "Removing expired " << entry.path().filename().string()
+              << " from the payload checkpoints";
+    std::filesystem::remove(entry.path(), entry_error);
+  }
+}
+
+std::string PayloadCheckpointJournal::GetPath(Payload::Id payload_id) const {
+  return absl::StrCat(directory_, "/", payload_id, ".checkpoint");
+}
+
+}  // namespace connections
+}  // namespace nearby
@@ -0,0 +1,112 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CORE_INTERNAL_PAYLOAD_CHECKPOINT_JOURNAL_H_
+#define CORE_INTERNAL_PAYLOAD_CHECKPOINT_JOURNAL_H_
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "connections/payload.h"
+
+namespace nearby {
+namespace connections {
+
+// How far an incoming file payload got before its transfer was interrupted.
+struct PayloadCheckpoint {
+  Payload::Id payload_id = 0;
+  // Where the received bytes are kept.
+  std::string file_path;
+  std::int64_t total_size = 0;
+  // The first `offset` bytes of the payload have been flushed to `file_path`.
+  std::int64_t offset = 0;
+  // PayloadHash::Get() over those bytes.
+  std::uint64_t hash = 0;
+};
+
+// Hashes the bytes of a payload as they go by, so a file can be hashed chunk
+// by chunk however it's split. It takes the bytes 8 at a time, with a 64x64 to
+// 128 bit multiply each, to keep up with the transfer.
+//
+// The sender and the receiver of a payload both compute it, so it can't
+// change without breaking resumption between versions.
+class PayloadHash {
+ public:
+  void Update(absl::string_view data);
+
+  // Returns the hash of every byte passed to Update() so far.
+  std::uint64_t Get() const;
+
+ private:
+  static constexpr int kWordSize = 8;
+
+  std::uint64_t state_ = 0x243f6a8885a308d3;
+  std::uint64_t size_ = 0;
+  // The bytes after the last full word.
+  char tail_[kWordSize] = {};
+  int tail_size_ = 0;
+};
+
+// Records the checkpoints of incoming file payloads, one small file per
+// payload in `directory`, so a transfer that's sent again after a disconnect
+// can continue where the last one left off. The bytes kept for it are moved
+// into the same directory, which only holds files of ours, and everything
+// in there is reclaimed once it's older than kMaxAge.
+//
+// A checkpoint is written to a temporary file and renamed over the previous
+// one, so a crash leaves either the old or the new checkpoint behind, never a
+// torn one. Not thread safe; each payload is only touched by the thread
+// receiving it.
+class PayloadCheckpointJournal {
+ public:
+  // How long an interrupted transfer can be resumed.
+  static constexpr absl::Duration kMaxAge = absl::Hours(24);
+
+  explicit PayloadCheckpointJournal(std::string directory)
+      : directory_(std::move(directory)) {}
+
+  // Returns the app-private directory checkpoints are kept in.
+  static std::string GetDefaultDirectory();
+
+  // Returns false if the checkpoint couldn't be written.
+  bool Save(const PayloadCheckpoint& checkpoint) const;
+
+  // Returns the checkpoint saved for `payload_id`, or std::nullopt if there's
+  // none or it can't be read.
+  std::optional<PayloadCheckpoint> Load(Payload::Id payload_id) const;
+
+  void Remove(Payload::Id payload_id) const;
+
+  // Returns where the bytes received for `payload_id` are kept between
+  // transfers.
+  std::string GetPartialFilePath(Payload::Id payload_id) const;
+
+  // Removes every checkpoint and kept file last written more than `max_age`
+  // ago.
+  void RemoveExpired(absl::Duration max_age) const;
+
+ private:
+  std::string GetPath(Payload::Id payload_id) const;
+
+  const std::string directory_;
+};
+
+}  // namespace connections
+}  // namespace nearby
+
+#endif  // CORE_INTERNAL_PAYLOAD_CHECKPOINT_JOURNAL_H_
@@ -0,0 +1,183 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/payload_checkpoint_journal.h"
+
+#include <chrono>  // NOLINT(build/c++11)
+#include <cstdint>
+#include <filesystem>  // NOLINT(build/c++17)
+#include <fstream>
+#include <optional>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+
+namespace nearby {
+namespace connections {
+namespace {
+
+class PayloadCheckpointJournalTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    directory_ = absl::StrCat(
+        ::testing::TempDir(), "/",
+        ::testing::UnitTest::GetInstance()->current_test_info()->name());
+    std::filesystem::remove_all(directory_);
+  }
+
+  std::string directory_;
+};
+
+TEST_F(PayloadCheckpointJournalTest, LoadsSavedCheckpoint) {
+  PayloadCheckpointJournal journal(directory_);
+  PayloadCheckpoint checkpoint{.payload_id = 42,
+                               .file_path = "/downloads/my file.bin",
+                               .total_size = 1000,
+                               .offset = 600,
+                               .hash = 0xfedcba9876543210};
+
+  ASSERT_TRUE(journal.Save(checkpoint));
+  std::optional<PayloadCheckpoint> loaded = journal.Load(42);
+
+  ASSERT_TRUE(loaded.has_value());
+  EXPECT_EQ(loaded->payload_id, 42);
+  EXPECT_EQ(loaded->file_path, "/downloads/my file.bin");
+  EXPECT_EQ(loaded->total_size, 1000);
+  EXPECT_EQ(loaded->offset, 600);
+  EXPECT_EQ(loaded->hash, 0xfedcba9876543210);
+}
+
+TEST_F(PayloadCheckpointJournalTest, LaterCheckpointReplacesEarlierOne) {
+  PayloadCheckpointJournal journal(directory_);
+  PayloadCheckpoint checkpoint{
+      .payload_id = 42, .file_path = "/a", .total_size = 1000, .offset = 100};
+
+  ASSERT_TRUE(journal.Save(checkpoint));
+  checkpoint.offset = 200;
+  ASSERT_TRUE(journal.Save(checkpoint));
+
+  ASSERT_TRUE(journal.Load(42).has_value());
+  EXPECT_EQ(journal.Load(42)->offset, 200);
+}
+
+TEST_F(PayloadCheckpointJournalTest, KeepsPayloadsApart) {
+  PayloadCheckpointJournal journal(directory_);
+
+  ASSERT_TRUE(journal.Save({.payload_id = 1, .file_path = "/a", .offset = 1}));
+  ASSERT_TRUE(journal.Save({.payload_id = 2, .file_path = "/b", .offset = 2}));
+  journal.Remove(1);
+
+  EXPECT_FALSE(journal.Load(1).has_value());
+  ASSERT_TRUE(journal.Load(2).has_value());
+  EXPECT_EQ(journal.Load(2)->file_path, "/b");
+}
+
+TEST_F(PayloadCheckpointJournalTest, MissingCheckpointIsNotFound) {
+  PayloadCheckpointJournal journal(directory_);
+
+  EXPECT_FALSE(journal.Load(42).has_value());
+  journal.Remove(42);
+}
+
+TEST_F(PayloadCheckpointJournalTest, IgnoresTornCheckpoint) {
+  PayloadCheckpointJournal journal(directory_);
+  ASSERT_TRUE(journal.Save({.payload_id = 42, .file_path = "/a"}));
+  std::string path = absl::StrCat(directory_, "/42.checkpoint");
+  std::ofstream(path, std::ios::trunc) << "42 1000 600";
+
+  EXPECT_FALSE(journal.Load(42).has_value());
+}
+
+TEST_F(PayloadCheckpointJournalTest, IgnoresMalformedCheckpoint) {
+  PayloadCheckpointJournal journal(directory_);
+  ASSERT_TRUE(journal.Save({.payload_id = 42, .file_path = "/a"}));
+  std::string path = absl::StrCat(directory_, "/42.checkpoint");
+  std::ofstream(path, std::ios::trunc) << "42 1000 six hundred /a\n";
+
+  EXPECT_FALSE(journal.Load(42).has_value());
+}
+
+TEST_F(PayloadCheckpointJournalTest, RemovesExpiredFiles) {
+  PayloadCheckpointJournal journal(directory_);
+  ASSERT_TRUE(journal.Save({.payload_id = 1, .file_path = "/a", .offset = 1}));
+  ASSERT_TRUE(journal.Save({.payload_id = 2, .file_path = "/b", .offset = 2}));
+  std::ofstream(journal.GetPartialFilePath(1)) << "kept";
+  std::filesystem::file_time_type two_days_ago =
+      std::filesystem::file_time_type::clock::now() - std::chrono::hours(48);
+  std::filesystem::last_write_time(absl::StrCat(directory_, "/1.checkpoint"),
+                                   two_days_ago);
+  std::filesystem::last_write_time(journal.GetPartialFilePath(1),
+                                   two_days_ago);
+
+  journal.RemoveExpired(absl::Hours(24));
+
+  EXPECT_FALSE(journal.Load(1).has_value());
+  EXPECT_FALSE(std::filesystem::exists(journal.GetPartialFilePath(1)));
+  EXPECT_TRUE(journal.Load(2).has_value());
+}
+
+TEST_F(PayloadCheckpointJournalTest, RemovingExpiredFilesOfNoDirectoryIsNoOp) {
+  PayloadCheckpointJournal journal(directory_);
+
+  journal.RemoveExpired(absl::Hours(24));
+
+  EXPECT_FALSE(std::filesystem::exists(directory_));
+}
+
+std::uint64_t HashOf(absl::string_view data) {
+  PayloadHash hash;
+  hash.Update(data);
+  return hash.Get();
+}
+
+TEST(PayloadHashTest, DoesNotDependOnHowTheBytesAreSplit) {
+  std::string data = "the quick brown fox jumps over the lazy dog";
+  std::uint64_t whole = HashOf(data);
+
+  for (int split = 0; split <= data.size(); ++split) {
+    PayloadHash hash;
+    hash.Update(absl::string_view(data).substr(0, split));
+    hash.Update(absl::string_view(data).substr(split));
+    EXPECT_EQ(hash.Get(), whole) << "split at " << split;
+  }
+  PayloadHash byte_by_byte;
+  for (char c : data) {
+    byte_by_byte.Update(absl::string_view(&c, 1));
+  }
+  EXPECT_EQ(byte_by_byte.Get(), whole);
+}
+
+TEST(PayloadHashTest, TellsDifferentBytesApart) {
+  EXPECT_NE(HashOf("hello world"), HashOf("hello World"));
+  EXPECT_NE(HashOf("hello world"), HashOf("hello worl"));
+  EXPECT_NE(HashOf("12345678"), HashOf(std::string("12345678\0", 9)));
+  EXPECT_NE(HashOf(""), HashOf(std::string(8, '\0')));
+  // A flipped top bit of one word isn't lost in the next ones.
+  std::string data(64, 'a');
+  std::string flipped = data;
+  flipped[7] ^= 0x80;
+  EXPECT_NE(HashOf(data), HashOf(flipped));
+}
+
+TEST(PayloadHashTest, IsStable) {
+  // Both ends of a transfer have to agree on it.
+  EXPECT_EQ(HashOf("hello world"), 0x199132d51de32dbe);
+}
+
+}  // namespace
+}  // namespace connections
+}  // namespace nearby
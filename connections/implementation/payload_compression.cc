@@ -0,0 +1,174 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/payload_compression.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "internal/platform/byte_array.h"
+#include "internal/platform/logging.h"
+#include "zlib.h"
+
+namespace nearby {
+namespace connections {
+
+namespace {
+// Raw deflate: the chunks carry no zlib header or checksum of their own, the
+// frames they travel in are already checked.
+constexpr int kWindowBits = -15;
+constexpr int kMemLevel = 8;
+// Room added to the output buffer whenever it fills up.
+constexpr size_t kOutputSlack = 64;
+
+// Bluetooth Classic and BLE are well below the first threshold, Wi-Fi well
+// above the second.
+constexpr std::int64_t kSlowLinkBytesPerSecond = 1024 * 1024;
+constexpr std::int64_t kFastLinkBytesPerSecond = 10 * 1024 * 1024;
+}  // namespace
+
+std::unique_ptr<PayloadCompressor> PayloadCompressor::Create() {
+  std::unique_ptr<PayloadCompressor> compressor(new PayloadCompressor());
+  compressor->level_ = GetLevelForLinkSpeed(0);
+  if (deflateInit2(&compressor->stream_, compressor->level_, Z_DEFLATED,
+                   kWindowBits, kMemLevel, Z_DEFAULT_STRATEGY) != Z_OK) {
+    LOG(WARNING) << "Failed to set up payload compression";
+    return nullptr;
+  }
+  return compressor;
+}
+
+PayloadCompressor::~PayloadCompressor() { deflateEnd(&stream_); }
+
+int PayloadCompressor::GetLevelForLinkSpeed(
+    std::int64_t link_bytes_per_second) {
+  if (link_bytes_per_second <= 0) return 3;
+  if (link_bytes_per_second < kSlowLinkBytesPerSecond) return 6;
+  if (link_bytes_per_second < kFastLinkBytesPerSecond) return 3;
+  return 1;
+}
+
+std::optional<ByteArray> PayloadCompressor::Compress(
+    const ByteArray& chunk, std::int64_t link_bytes_per_second) {
+  if (!enabled_ || chunk.Empty()) {
+    return std::nullopt;
+  }
+
+  std::string output(deflateBound(&stream_, chunk.size()) + kOutputSlack,
+                     '\0');
+  stream_.next_out = reinterpret_cast<Bytef*>(output.data());
+  stream_.avail_out = output.size();
+
+  int level = GetLevelForLinkSpeed(link_bytes_per_second);
+  if (level != level_) {
+    // Changed before the chunk is handed over, so deflateParams() has no
+    // pending input to compress at the old level. Everything before was
+    // flushed, so this only changes how the data from here on is compressed.
+    stream_.avail_in = 0;
+    if (deflateParams(&stream_, level, Z_DEFAULT_STRATEGY) == Z_OK) {
+      level_ = level;
+    }
+  }
+  stream_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(chunk.data()));
+  stream_.avail_in = chunk.size();
+
+  // A sync flush is done once deflate() leaves room in the output buffer.
+  while (true) {
+    int result = deflate(&stream_, Z_SYNC_FLUSH);
+    if (result != Z_OK && result != Z_BUF_ERROR) {
+      LOG(WARNING) << "Payload compression failed: " << result;
+      enabled_ = false;
+      return std::nullopt;
+    }
+    if (stream_.avail_out > 0) break;
+    size_t used = output.size();
+    output.resize(used + chunk.size() / 4 + kOutputSlack);
+    stream_.next_out = reinterpret_cast<Bytef*>(output.data() + used);
+    stream_.avail_out = output.size() - used;
+  }
+  output.resize(output.size() - stream_.avail_out);
+
+  if (!sampled_) {
+    sampled_ = true;
+    if (output.size() > chunk.size() * kMaxSampleRatio) {
+      // Nothing compressed has been sent, so dropping the stream here is
+      // fine.
+      NEARBY_VLOG(1) << "Payload doesn't compress, " << chunk.size()
+                     << " bytes became " << output.size();
+      enabled_ = false;
+      return std::nullopt;
+    }
+  }
+  return ByteArray(std::move(output));
+}
+
+std::unique_ptr<PayloadDecompressor> PayloadDecompressor::Create() {
+  std::unique_ptr<PayloadDecompressor> decompressor(new PayloadDecompressor());
+  if (inflateInit2(&decompressor->stream_, kWindowBits) != Z_OK) {
+    LOG(WARNING) << "Failed to set up payload decompression";
+    return nullptr;
+  }
+  return decompressor;
+}
+
+PayloadDecompressor::~PayloadDecompressor() { inflateEnd(&stream_); }
+
+std::optional<ByteArray> PayloadDecompressor::Decompress(
+    const ByteArray& chunk, std::int64_t max_size) {
+  if (failed_) {
+    return std::nullopt;
+  }
+
+  // Text usually inflates 4-10x; grow from the low end.
+  std::string output(
+      std::min<std::int64_t>(max_size, chunk.size() * 4 + kOutputSlack), '\0');
+  stream_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(chunk.data()));
+  stream_.avail_in = chunk.size();
+  stream_.next_out = reinterpret_cast<Bytef*>(output.data());
+  stream_.avail_out = output.size();
+
+  while (true) {
+    int result = inflate(&stream_, Z_SYNC_FLUSH);
+    if (result != Z_OK && result != Z_BUF_ERROR) {
+      LOG(WARNING) << "Payload decompression failed: " << result;
+      failed_ = true;
+      return std::nullopt;
+    }
+    if (stream_.avail_in == 0 && stream_.avail_out > 0) break;
+    if (result == Z_BUF_ERROR && stream_.avail_out > 0) {
+      // No progress possible with room left: the chunk is truncated.
+      failed_ = true;
+      return std::nullopt;
+    }
+    size_t used = output.size();
+    if (static_cast<std::int64_t>(used) >= max_size) {
+      LOG(WARNING) << "Payload chunk inflates past " << max_size << " bytes";
+      failed_ = true;
+      return std::nullopt;
+    }
+    output.resize(std::min<std::int64_t>(max_size, used * 2));
+    stream_.next_out = reinterpret_cast<Bytef*>(output.data() + used);
+    stream_.avail_out = output.size() - used;
+  }
+  output.resize(output.size() - stream_.avail_out);
+  return ByteArray(std::move(output));
+}
+
+}  // namespace connections
+}  // namespace nearby
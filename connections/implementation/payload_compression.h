@@ -0,0 +1,103 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CORE_INTERNAL_PAYLOAD_COMPRESSION_H_
+#define CORE_INTERNAL_PAYLOAD_COMPRESSION_H_
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+#include "internal/platform/byte_array.h"
+#include "zlib.h"
+
+namespace nearby {
+namespace connections {
+
+// Compresses the chunks of an outgoing payload.
+//
+// The chunks of a payload form a single raw deflate stream, so a chunk can
+// refer back to the ones before it, and every compressed chunk ends on a sync
+// flush so the receiver can inflate it as soon as it arrives. Chunks that
+// aren't compressed bypass the stream, which lets compression stop at any
+// chunk boundary.
+//
+// Not thread safe; a payload is sent from a single thread.
+class PayloadCompressor {
+ public:
+  // The first chunk has to shrink at least this much for the rest of the
+  // payload to be compressed, so already compressed files (images, videos,
+  // archives) are sent as they are after a single chunk.
+  static constexpr double kMaxSampleRatio = 0.9;
+
+  // Returns nullptr if zlib fails to set up.
+  static std::unique_ptr<PayloadCompressor> Create();
+
+  PayloadCompressor(const PayloadCompressor&) = delete;
+  PayloadCompressor& operator=(const PayloadCompressor&) = delete;
+  ~PayloadCompressor();
+
+  // Returns `chunk` compressed, or std::nullopt if it has to be sent as it
+  // is. `link_bytes_per_second` is the measured speed of the slowest
+  // recipient's link, or 0 if it isn't known yet; slower links get more
+  // effort spent on compression.
+  std::optional<ByteArray> Compress(const ByteArray& chunk,
+                                    std::int64_t link_bytes_per_second);
+
+  // False once compression has been given up on for the rest of the payload.
+  bool IsEnabled() const { return enabled_; }
+
+  // The zlib level the last chunk was compressed at.
+  int GetLevel() const { return level_; }
+
+  // The zlib level used for a link of the given speed.
+  static int GetLevelForLinkSpeed(std::int64_t link_bytes_per_second);
+
+ private:
+  PayloadCompressor() = default;
+
+  z_stream stream_ = {};
+  int level_ = 0;
+  bool sampled_ = false;
+  bool enabled_ = true;
+};
+
+// Inflates the chunks of an incoming payload that the sender compressed with
+// PayloadCompressor. Not thread safe; a payload is received on a single
+// thread.
+class PayloadDecompressor {
+ public:
+  // Returns nullptr if zlib fails to set up.
+  static std::unique_ptr<PayloadDecompressor> Create();
+
+  PayloadDecompressor(const PayloadDecompressor&) = delete;
+  PayloadDecompressor& operator=(const PayloadDecompressor&) = delete;
+  ~PayloadDecompressor();
+
+  // Returns the inflated `chunk`, or std::nullopt if it's corrupt or
+  // inflates to more than `max_size` bytes.
+  std::optional<ByteArray> Decompress(const ByteArray& chunk,
+                                      std::int64_t max_size);
+
+ private:
+  PayloadDecompressor() = default;
+
+  z_stream stream_ = {};
+  bool failed_ = false;
+};
+
+}  // namespace connections
+}  // namespace nearby
+
+#endif  // CORE_INTERNAL_PAYLOAD_COMPRESSION_H_
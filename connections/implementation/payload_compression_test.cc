@@ -0,0 +1,169 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/payload_compression.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "internal/platform/byte_array.h"
+
+namespace nearby {
+namespace connections {
+namespace {
+
+constexpr std::int64_t kMaxChunkSize = 1024 * 1024;
+
+ByteArray MakeText(int records, int first_id = 0) {
+  std::string text;
+  for (int i = first_id; i < first_id + records; ++i) {
+    absl::StrAppend(&text, "{\"id\": ", i,
+                    ", \"name\": \"endpoint\", \"state\": \"connected\"}\n");
+  }
+  return ByteArray(std::move(text));
+}
+
+ByteArray MakeRandom(int size) {
+  std::mt19937 random(7);
+  std::string bytes(size, '\0');
+  for (char& c : bytes) c = static_cast<char>(random());
+  return ByteArray(std::move(bytes));
+}
+
+TEST(PayloadCompressionTest, RoundTripsChunks) {
+  std::unique_ptr<PayloadCompressor> compressor = PayloadCompressor::Create();
+  std::unique_ptr<PayloadDecompressor> decompressor =
+      PayloadDecompressor::Create();
+  ASSERT_NE(compressor, nullptr);
+  ASSERT_NE(decompressor, nullptr);
+
+  for (int i = 0; i < 4; ++i) {
+    ByteArray chunk = MakeText(500, i * 500);
+    std::optional<ByteArray> compressed = compressor->Compress(chunk, 0);
+    ASSERT_TRUE(compressed.has_value());
+    EXPECT_LT(compressed->size(), chunk.size() / 4);
+
+    std::optional<ByteArray> decompressed =
+        decompressor->Decompress(*compressed, kMaxChunkSize);
+    ASSERT_TRUE(decompressed.has_value());
+    EXPECT_EQ(*decompressed, chunk);
+  }
+}
+
+TEST(PayloadCompressionTest, LaterChunksReferToEarlierOnes) {
+  std::unique_ptr<PayloadCompressor> compressor = PayloadCompressor::Create();
+  ASSERT_NE(compressor, nullptr);
+  ByteArray chunk = MakeRandom(1000);
+  // A compressible prefix gets the stream past sampling.
+  ASSERT_TRUE(compressor->Compress(MakeText(100), 0).has_value());
+
+  std::optional<ByteArray> first = compressor->Compress(chunk, 0);
+  std::optional<ByteArray> second = compressor->Compress(chunk, 0);
+
+  ASSERT_TRUE(first.has_value());
+  ASSERT_TRUE(second.has_value());
+  EXPECT_LT(second->size(), first->size() / 10);
+}
+
+TEST(PayloadCompressionTest, SkipsIncompressiblePayload) {
+  std::unique_ptr<PayloadCompressor> compressor = PayloadCompressor::Create();
+  ASSERT_NE(compressor, nullptr);
+
+  EXPECT_FALSE(compressor->Compress(MakeRandom(4096), 0).has_value());
+  EXPECT_FALSE(compressor->IsEnabled());
+  EXPECT_FALSE(compressor->Compress(MakeText(100), 0).has_value());
+}
+
+TEST(PayloadCompressionTest, AdaptsLevelMidStream) {
+  std::unique_ptr<PayloadCompressor> compressor = PayloadCompressor::Create();
+  std::unique_ptr<PayloadDecompressor> decompressor =
+      PayloadDecompressor::Create();
+  ASSERT_NE(compressor, nullptr);
+  ASSERT_NE(decompressor, nullptr);
+  const std::int64_t kLinkSpeeds[] = {0, 100 * 1024, 50 * 1024 * 1024,
+                                      2 * 1024 * 1024};
+
+  for (int i = 0; i < 4; ++i) {
+    ByteArray chunk = MakeText(300, i * 300);
+    std::optional<ByteArray> compressed =
+        compressor->Compress(chunk, kLinkSpeeds[i]);
+    ASSERT_TRUE(compressed.has_value());
+    std::optional<ByteArray> decompressed =
+        decompressor->Decompress(*compressed, kMaxChunkSize);
+    ASSERT_TRUE(decompressed.has_value());
+    EXPECT_EQ(*decompressed, chunk);
+  }
+}
+
+TEST(PayloadCompressionTest, ChangesLevelBeforeTakingTheChunk) {
+  std::unique_ptr<PayloadCompressor> compressor = PayloadCompressor::Create();
+  std::unique_ptr<PayloadDecompressor> decompressor =
+      PayloadDecompressor::Create();
+  ASSERT_NE(compressor, nullptr);
+  ASSERT_NE(decompressor, nullptr);
+  ByteArray first = MakeText(3000);
+  ByteArray second = MakeText(3000, 3000);
+
+  std::optional<ByteArray> compressed =
+      compressor->Compress(first, 80 * 1024 * 1024);
+  ASSERT_TRUE(compressed.has_value());
+  EXPECT_EQ(compressor->GetLevel(), 1);
+  EXPECT_EQ(decompressor->Decompress(*compressed, kMaxChunkSize), first);
+  compressed = compressor->Compress(second, 200 * 1024);
+  ASSERT_TRUE(compressed.has_value());
+  EXPECT_EQ(compressor->GetLevel(), 6);
+  EXPECT_EQ(decompressor->Decompress(*compressed, kMaxChunkSize), second);
+}
+
+TEST(PayloadCompressionTest, PicksLevelForLinkSpeed) {
+  EXPECT_EQ(PayloadCompressor::GetLevelForLinkSpeed(0), 3);
+  EXPECT_EQ(PayloadCompressor::GetLevelForLinkSpeed(200 * 1024), 6);
+  EXPECT_EQ(PayloadCompressor::GetLevelForLinkSpeed(4 * 1024 * 1024), 3);
+  EXPECT_EQ(PayloadCompressor::GetLevelForLinkSpeed(80 * 1024 * 1024), 1);
+}
+
+TEST(PayloadCompressionTest, RejectsChunkInflatingPastMaxSize) {
+  std::unique_ptr<PayloadCompressor> compressor = PayloadCompressor::Create();
+  std::unique_ptr<PayloadDecompressor> decompressor =
+      PayloadDecompressor::Create();
+  ASSERT_NE(compressor, nullptr);
+  ASSERT_NE(decompressor, nullptr);
+  ByteArray chunk(std::string(100000, 'a'));
+  std::optional<ByteArray> compressed = compressor->Compress(chunk, 0);
+  ASSERT_TRUE(compressed.has_value());
+
+  EXPECT_FALSE(decompressor->Decompress(*compressed, 99999).has_value());
+  // The stream can't be trusted after that.
+  EXPECT_FALSE(
+      decompressor->Decompress(*compressed, kMaxChunkSize).has_value());
+}
+
+TEST(PayloadCompressionTest, RejectsCorruptChunk) {
+  std::unique_ptr<PayloadDecompressor> decompressor =
+      PayloadDecompressor::Create();
+  ASSERT_NE(decompressor, nullptr);
+
+  EXPECT_FALSE(
+      decompressor->Decompress(ByteArray(std::string(64, '\xff')), 1024)
+          .has_value());
+}
+
+}  // namespace
+}  // namespace connections
+}  // namespace nearby
@@ -0,0 +1,119 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/payload_fan_out_window.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "internal/platform/mutex_lock.h"
+
+namespace nearby {
+namespace connections {
+
+PayloadFanOutWindow::PayloadFanOutWindow(std::int64_t max_bytes,
+                                         int num_writers)
+    : max_bytes_(max_bytes), next_index_(num_writers, 0) {}
+
+bool PayloadFanOutWindow::Push(std::shared_ptr<const FanOutChunk> chunk) {
+  MutexLock lock(&mutex_);
+  while (!aborted_ && HasWriters() && !chunks_.empty() &&
+         bytes_ >= max_bytes_) {
+    cond_.Wait();
+  }
+  if (aborted_ || !HasWriters()) {
+    return false;
+  }
+  bytes_ += chunk->payload_chunk.body().size();
+  chunks_.push_back(std::move(chunk));
+  cond_.Notify();
+  return true;
+}
+
+void PayloadFanOutWindow::Close() {
+  MutexLock lock(&mutex_);
+  closed_ = true;
+  cond_.Notify();
+}
+
+void PayloadFanOutWindow::Abort() {
+  MutexLock lock(&mutex_);
+  aborted_ = true;
+  first_index_ += chunks_.size();
+  chunks_.clear();
+  bytes_ = 0;
+  cond_.Notify();
+}
+
+std::shared_ptr<const FanOutChunk> PayloadFanOutWindow::Next(int writer) {
+  MutexLock lock(&mutex_);
+  std::int64_t index = next_index_[writer];
+  if (index == kRemoved) {
+    return nullptr;
+  }
+  while (!aborted_ && !closed_ &&
+         index >= first_index_ + static_cast<std::int64_t>(chunks_.size())) {
+    cond_.Wait();
+  }
+  if (aborted_ ||
+      index >= first_index_ + static_cast<std::int64_t>(chunks_.size())) {
+    return nullptr;
+  }
+  std::shared_ptr<const FanOutChunk> chunk = chunks_[index - first_index_];
+  next_index_[writer] = index + 1;
+  DropConsumedChunks();
+  return chunk;
+}
+
+void PayloadFanOutWindow::RemoveWriter(int writer) {
+  MutexLock lock(&mutex_);
+  next_index_[writer] = kRemoved;
+  DropConsumedChunks();
+  // The reader may be waiting on this writer, or on there being any.
+  cond_.Notify();
+}
+
+bool PayloadFanOutWindow::IsAborted() {
+  MutexLock lock(&mutex_);
+  return aborted_;
+}
+
+void PayloadFanOutWindow::DropConsumedChunks() {
+  std::int64_t min_index = first_index_ + chunks_.size();
+  for (std::int64_t index : next_index_) {
+    if (index != kRemoved) {
+      min_index = std::min(min_index, index);
+    }
+  }
+  bool dropped = false;
+  while (first_index_ < min_index) {
+    bytes_ -= chunks_.front()->payload_chunk.body().size();
+    chunks_.pop_front();
+    ++first_index_;
+    dropped = true;
+  }
+  if (dropped) {
+    cond_.Notify();
+  }
+}
+
+bool PayloadFanOutWindow::HasWriters() const {
+  return std::any_of(next_index_.begin(), next_index_.end(),
+                     [](std::int64_t index) { return index != kRemoved; });
+}
+
+}  // namespace connections
+}  // namespace nearby
@@ -0,0 +1,106 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CORE_INTERNAL_PAYLOAD_FAN_OUT_WINDOW_H_
+#define CORE_INTERNAL_PAYLOAD_FAN_OUT_WINDOW_H_
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "connections/implementation/analytics/packet_meta_data.h"
+#include "connections/implementation/proto/offline_wire_formats.pb.h"
+#include "internal/platform/condition_variable.h"
+#include "internal/platform/mutex.h"
+
+namespace nearby {
+namespace connections {
+
+// A chunk of an outgoing payload, read once and shared by the writers of all
+// its recipients.
+struct FanOutChunk {
+  location::nearby::connections::PayloadTransferFrame::PayloadChunk
+      payload_chunk;
+  // Where the chunk starts in the payload, and its size before compression.
+  std::int64_t offset = 0;
+  std::int64_t size = 0;
+  // The time spent reading the chunk.
+  analytics::PacketMetaData packet_meta_data;
+};
+
+// The chunks of a payload that's sent to several endpoints at once, between
+// the thread reading them and one writer per recipient.
+//
+// Every writer goes through the chunks in order at its own pace. A chunk is
+// dropped once every writer still around is past it, and the reader is held
+// back while the chunks kept for the slowest writer add up to `max_bytes`, so
+// a fast recipient can run that far ahead of a slow one.
+//
+// Thread safe.
+class PayloadFanOutWindow {
+ public:
+  PayloadFanOutWindow(std::int64_t max_bytes, int num_writers);
+
+  // Adds the next chunk, blocking while the window is full. A chunk is always
+  // let into an empty window, however big it is. Returns false, dropping the
+  // chunk, if every writer is gone or the window was aborted.
+  bool Push(std::shared_ptr<const FanOutChunk> chunk)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // No more chunks are coming; writers get the ones already pushed.
+  void Close() ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Drops every chunk and wakes everyone up, e.g. when the payload can't be
+  // read any further.
+  void Abort() ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns the next chunk for `writer`, blocking until it's pushed. Returns
+  // nullptr once the window is closed and `writer` has had every chunk, or
+  // once it's aborted.
+  std::shared_ptr<const FanOutChunk> Next(int writer)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // `writer` won't ask for chunks anymore, e.g. after its endpoint failed.
+  void RemoveWriter(int writer) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Whether Abort() was called.
+  bool IsAborted() ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  static constexpr std::int64_t kRemoved = -1;
+
+  // Drops the chunks no writer needs anymore.
+  void DropConsumedChunks() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  bool HasWriters() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const std::int64_t max_bytes_;
+  Mutex mutex_;
+  ConditionVariable cond_{&mutex_};
+  // chunks_[i] is the chunk with index first_index_ + i.
+  std::deque<std::shared_ptr<const FanOutChunk>> chunks_
+      ABSL_GUARDED_BY(mutex_);
+  std::int64_t first_index_ ABSL_GUARDED_BY(mutex_) = 0;
+  std::int64_t bytes_ ABSL_GUARDED_BY(mutex_) = 0;
+  // The index of the chunk each writer gets next, or kRemoved.
+  std::vector<std::int64_t> next_index_ ABSL_GUARDED_BY(mutex_);
+  bool closed_ ABSL_GUARDED_BY(mutex_) = false;
+  bool aborted_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+}  // namespace connections
+}  // namespace nearby
+
+#endif  // CORE_INTERNAL_PAYLOAD_FAN_OUT_WINDOW_H_
@@ -0,0 +1,164 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/payload_fan_out_window.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+
+#include "gtest/gtest.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace nearby {
+namespace connections {
+namespace {
+
+std::shared_ptr<const FanOutChunk> MakeChunk(std::int64_t offset,
+                                             std::int64_t size) {
+  auto chunk = std::make_shared<FanOutChunk>();
+  chunk->payload_chunk.set_offset(offset);
+  chunk->payload_chunk.set_body(std::string(size, 'x'));
+  chunk->offset = offset;
+  chunk->size = size;
+  return chunk;
+}
+
+TEST(PayloadFanOutWindowTest, EveryWriterGetsEveryChunkInOrder) {
+  PayloadFanOutWindow window(/*max_bytes=*/1000, /*num_writers=*/2);
+
+  ASSERT_TRUE(window.Push(MakeChunk(0, 10)));
+  ASSERT_TRUE(window.Push(MakeChunk(10, 10)));
+  window.Close();
+
+  for (int writer = 0; writer < 2; ++writer) {
+    std::shared_ptr<const FanOutChunk> chunk = window.Next(writer);
+    ASSERT_NE(chunk, nullptr);
+    EXPECT_EQ(chunk->offset, 0);
+    chunk = window.Next(writer);
+    ASSERT_NE(chunk, nullptr);
+    EXPECT_EQ(chunk->offset, 10);
+    EXPECT_EQ(window.Next(writer), nullptr);
+  }
+}
+
+TEST(PayloadFanOutWindowTest, WritersShareChunks) {
+  PayloadFanOutWindow window(/*max_bytes=*/1000, /*num_writers=*/2);
+
+  ASSERT_TRUE(window.Push(MakeChunk(0, 10)));
+
+  EXPECT_EQ(window.Next(0).get(), window.Next(1).get());
+}
+
+TEST(PayloadFanOutWindowTest, AdmitsOversizedChunkIntoEmptyWindow) {
+  PayloadFanOutWindow window(/*max_bytes=*/10, /*num_writers=*/1);
+
+  EXPECT_TRUE(window.Push(MakeChunk(0, 100)));
+}
+
+TEST(PayloadFanOutWindowTest, SlowestWriterHoldsBackReader) {
+  PayloadFanOutWindow window(/*max_bytes=*/20, /*num_writers=*/2);
+  ASSERT_TRUE(window.Push(MakeChunk(0, 10)));
+  ASSERT_TRUE(window.Push(MakeChunk(10, 10)));
+  // The fast writer is through both chunks, the slow one hasn't started.
+  window.Next(0);
+  window.Next(0);
+
+  std::atomic<bool> pushed = false;
+  std::thread reader([&]() {
+    EXPECT_TRUE(window.Push(MakeChunk(20, 10)));
+    pushed = true;
+  });
+  absl::SleepFor(absl::Milliseconds(50));
+  EXPECT_FALSE(pushed);
+
+  ASSERT_NE(window.Next(1), nullptr);
+  reader.join();
+  EXPECT_TRUE(pushed);
+  std::shared_ptr<const FanOutChunk> chunk = window.Next(0);
+  ASSERT_NE(chunk, nullptr);
+  EXPECT_EQ(chunk->offset, 20);
+}
+
+TEST(PayloadFanOutWindowTest, RemovedWriterNoLongerHoldsBackReader) {
+  PayloadFanOutWindow window(/*max_bytes=*/10, /*num_writers=*/2);
+  ASSERT_TRUE(window.Push(MakeChunk(0, 10)));
+  window.Next(0);
+
+  std::thread reader([&]() { EXPECT_TRUE(window.Push(MakeChunk(10, 10))); });
+  absl::SleepFor(absl::Milliseconds(10));
+  window.RemoveWriter(1);
+  reader.join();
+
+  std::shared_ptr<const FanOutChunk> chunk = window.Next(0);
+  ASSERT_NE(chunk, nullptr);
+  EXPECT_EQ(chunk->offset, 10);
+  EXPECT_EQ(window.Next(1), nullptr);
+}
+
+TEST(PayloadFanOutWindowTest, PushFailsWithoutWriters) {
+  PayloadFanOutWindow window(/*max_bytes=*/10, /*num_writers=*/2);
+  ASSERT_TRUE(window.Push(MakeChunk(0, 10)));
+
+  std::thread reader([&]() { EXPECT_FALSE(window.Push(MakeChunk(10, 10))); });
+  window.RemoveWriter(0);
+  window.RemoveWriter(1);
+  reader.join();
+}
+
+TEST(PayloadFanOutWindowTest, WriterWaitsForNextChunk) {
+  PayloadFanOutWindow window(/*max_bytes=*/100, /*num_writers=*/1);
+
+  std::thread writer([&]() {
+    std::shared_ptr<const FanOutChunk> chunk = window.Next(0);
+    ASSERT_NE(chunk, nullptr);
+    EXPECT_EQ(chunk->offset, 0);
+    EXPECT_EQ(window.Next(0), nullptr);
+  });
+  absl::SleepFor(absl::Milliseconds(10));
+  ASSERT_TRUE(window.Push(MakeChunk(0, 10)));
+  window.Close();
+  writer.join();
+}
+
+TEST(PayloadFanOutWindowTest, AbortWakesWritersAndReader) {
+  PayloadFanOutWindow window(/*max_bytes=*/10, /*num_writers=*/2);
+  ASSERT_TRUE(window.Push(MakeChunk(0, 10)));
+
+  std::thread reader([&]() { EXPECT_FALSE(window.Push(MakeChunk(10, 10))); });
+  absl::SleepFor(absl::Milliseconds(10));
+  EXPECT_FALSE(window.IsAborted());
+  window.Abort();
+  reader.join();
+
+  EXPECT_TRUE(window.IsAborted());
+  EXPECT_EQ(window.Next(0), nullptr);
+  EXPECT_EQ(window.Next(1), nullptr);
+}
+
+TEST(PayloadFanOutWindowTest, CloseIsNotAbort) {
+  PayloadFanOutWindow window(/*max_bytes=*/10, /*num_writers=*/1);
+
+  window.Close();
+
+  EXPECT_FALSE(window.IsAborted());
+  EXPECT_EQ(window.Next(0), nullptr);
+}
+
+}  // namespace
+}  // namespace connections
+}  // namespace nearby
@@ -19,6 +19,7 @@
 #include <cstdint>
 #include <limits>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
@@ -30,6 +31,8 @@
 #include "absl/strings/str_format.h"
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
+#include "connections/connection_quality.h"
+#include "connections/implementation/analytics/connection_quality_recorder.h"
 #include "connections/implementation/analytics/packet_meta_data.h"
 #include "connections/implementation/analytics/throughput_recorder.h"
 #include "connections/implementation/client_proxy.h"
@@ -38,6 +41,7 @@
 #include "connections/implementation/flags/nearby_connections_feature_flags.h"
 #include "connections/implementation/internal_payload.h"
 #include "connections/implementation/internal_payload_factory.h"
+#include "connections/implementation/payload_compression.h"
 #include "connections/implementation/proto/offline_wire_formats.pb.h"
 #include "connections/listeners.h"
 #include "connections/medium_selector.h"
@@ -51,8 +55,10 @@
 #include "internal/platform/expected.h"
 #include "internal/platform/feature_flags.h"
 #include "internal/platform/logging.h"
+#include "internal/platform/multi_thread_executor.h"
 #include "internal/platform/mutex_lock.h"
 #include "internal/platform/single_thread_executor.h"
+#include "internal/platform/system_clock.h"
 #include "proto/connections_enums.pb.h"
 
 namespace nearby {
@@ -66,12 +72,74 @@ using ::location::nearby::proto::connections::Medium;
 using ::location::nearby::proto::connections::OperationResultCode;
 using ::location::nearby::proto::connections::PayloadStatus;
 using PacketMetaData = ::nearby::analytics::PacketMetaData;
+using ::nearby::analytics::ConnectionQualityRecorder;
 using ::nearby::analytics::ThroughputRecorderContainer;
 using PayloadDirection = ::nearby::connections::PayloadDirection;
 
 constexpr absl::Duration kMinTransferUpdateInterval = absl::Milliseconds(50);
+// The most chunks of a payload sent to several endpoints at once take up
+// while waiting for the slower recipients.
+constexpr std::int64_t kFanOutWindowBytes = 4 * 1024 * 1024;
+
+// The send rate of the slowest of `endpoint_ids` that has one yet, or 0.
+std::int64_t GetLinkBytesPerSecond(
+    ClientProxy* client, const std::vector<std::string>& endpoint_ids) {
+  std::int64_t slowest = 0;
+  for (const std::string& endpoint_id : endpoint_ids) {
+    std::optional<ConnectionQuality> quality =
+        client->GetConnectionQualityRecorder().GetConnectionQuality(
+            endpoint_id);
+    if (quality.has_value() && quality->send_bytes_per_second > 0 &&
+        (slowest == 0 || quality->send_bytes_per_second < slowest)) {
+      slowest = quality->send_bytes_per_second;
+    }
+  }
+  return slowest;
+}
+
+// Replaces the body of a compressed chunk with what it inflates to. An
+// uncompressed chunk would have had to fit in a frame, and in what's left of
+// the payload.
+bool InflateChunk(PayloadDecompressor& decompressor,
+                  const PayloadTransferFrame::PayloadHeader& payload_header,
+                  PayloadTransferFrame::PayloadChunk& payload_chunk) {
+  std::int64_t max_size =
+      FeatureFlags::GetInstance().GetFlags().connection_max_frame_length;
+  if (payload_header.total_size() >= 0) {
+    max_size = std::min(max_size,
+                        payload_header.total_size() - payload_chunk.offset());
+  }
+  std::optional<ByteArray> body = decompressor.Decompress(
+      ByteArray(std::move(*payload_chunk.mutable_body())), max_size);
+  if (!body.has_value()) {
+    return false;
+  }
+  payload_chunk.set_body(std::string(std::move(*body)));
+  return true;
+}
 }  // namespace
 
+std::int64_t PayloadManager::GetVerifiedResumeOffset(
+    PendingPayload& pending_payload, const std::string& endpoint_id) {
+  std::optional<PendingPayload::ResumeRequest> request =
+      pending_payload.TakeResumeRequest(endpoint_id);
+  if (!request.has_value()) {
+    return 0;
+  }
+  // The receiver may have kept the bytes of a different file that was sent
+  // with the same payload ID.
+  ExceptionOr<std::uint64_t> prefix_hash =
+      pending_payload.GetInternalPayload()->GetPrefixHash(request->offset);
+  if (!prefix_hash.ok() || prefix_hash.result() != request->prefix_hash) {
+    LOG(WARNING) << "PayloadManager not resuming payload_id="
+                 << pending_payload.GetInternalPayload()->GetId()
+                 << " at offset " << request->offset << " for endpoint_id="
+                 << endpoint_id << " since it kept other bytes";
+    return 0;
+  }
+  return request->offset;
+}
+
 bool PayloadManager::SendPayloadLoop(
     ClientProxy* client, PendingPayload& pending_payload,
     PayloadTransferFrame::PayloadHeader& payload_header,
@@ -136,13 +204,40 @@ bool PayloadManager::SendPayloadLoop(
                    << pending_payload.GetInternalPayload()->GetId();
     next_chunk_offset = real_offset.GetResult();
   }
+  // A receiver that kept part of this payload from an earlier, interrupted
+  // transfer asks us to skip what it has. That's only possible when it's the
+  // only recipient left.
+  if (resume_offset == 0 && available_endpoint_ids.size() == 1) {
+    std::int64_t kept_offset =
+        GetVerifiedResumeOffset(pending_payload, available_endpoint_ids[0]);
+    if (kept_offset > next_chunk_offset) {
+      ExceptionOr<size_t> skipped =
+          pending_payload.GetInternalPayload()->SkipToOffset(
+              kept_offset - next_chunk_offset);
+      if (!skipped.ok()) {
+        LOG(WARNING) << "PayloadManager failed to skip to offset "
+                     << kept_offset << " on payload_id "
+                     << pending_payload.GetInternalPayload()->GetId();
+        HandleFinishedOutgoingPayload(
+            client, available_endpoint_ids, payload_header, next_chunk_offset,
+            OperationResultCode::IO_FILE_READING_ERROR,
+            PayloadStatus::LOCAL_ERROR);
+        return false;
+      }
+      LOG(INFO) << "PayloadManager resuming payload_id="
+                << pending_payload.GetInternalPayload()->GetId()
+                << " at offset " << kept_offset;
+      next_chunk_offset = kept_offset;
+    }
+  }
   for (const auto& endpoint_id : available_endpoint_ids) {
     pending_payload.SetOffsetForEndpoint(endpoint_id, next_chunk_offset);
   }
 
   // This will block if there is no data to transfer.
   // It will resume when new data arrives, or if Close() is called.
-  int chunk_size = GetOptimalChunkSize(available_endpoint_ids);
+  int chunk_size =
+      GetOutgoingChunkSize(client, pending_payload, available_endpoint_ids);
   packet_meta_data.StartFileIo();
   ByteArray next_chunk =
       pending_payload.GetInternalPayload()->DetachNextChunk(chunk_size);
@@ -166,10 +261,26 @@ bool PayloadManager::SendPayloadLoop(
   // used to decide if the received chunk is the initial payload chunk.
   // In other cases, the offset should only be used in both side logs when error
   // happened.
-  PayloadTransferFrame::PayloadChunk payload_chunk(CreatePayloadChunk(
+  PayloadTransferFrame::PayloadChunk payload_chunk(CreateOutgoingPayloadChunk(
+      client, pending_payload, available_endpoint_ids,
       next_chunk_offset - resume_offset, std::move(next_chunk), index));
+  absl::Time write_start_time = SystemClock::ElapsedRealtime();
   const EndpointIds& failed_endpoint_ids = endpoint_manager_->SendPayloadChunk(
-      payload_header, payload_chunk, available_endpoint_ids, packet_meta_data);
+      client, payload_header, payload_chunk, available_endpoint_ids,
+      packet_meta_data);
+  // The chunk is written to its recipients one after the other, and the next
+  // one waits for all of them, so each is held to the time of the whole
+  // write.
+  absl::Duration write_time = SystemClock::ElapsedRealtime() - write_start_time;
+  for (const auto& endpoint_id : available_endpoint_ids) {
+    if (std::find(failed_endpoint_ids.begin(), failed_endpoint_ids.end(),
+                  endpoint_id) == failed_endpoint_ids.end()) {
+      chunk_size_controller_.OnChunkWritten(endpoint_id, next_chunk_size,
+                                            write_time);
+    } else {
+      chunk_size_controller_.OnWriteFailed(endpoint_id);
+    }
+  }
   // Check whether at least one endpoint failed.
   if (!failed_endpoint_ids.empty()) {
     LOG(INFO) << "Payload xfer: endpoints failed: payload_id="
@@ -181,6 +292,16 @@ bool PayloadManager::SendPayloadLoop(
             PayloadStatus::ENDPOINT_IO_ERROR);
   }
   bool is_last_chunk = IsLastChunk(payload_chunk);
+  if (is_last_chunk) {
+    for (const auto& endpoint_id : available_endpoint_ids) {
+      if (std::find(failed_endpoint_ids.begin(), failed_endpoint_ids.end(),
+                    endpoint_id) == failed_endpoint_ids.end() &&
+          IsPayloadReceivedAckEnabled(client, endpoint_id, pending_payload)) {
+        client->GetConnectionQualityRecorder().OnPayloadAckExpected(
+            endpoint_id, payload_header.id());
+      }
+    }
+  }
   // Check whether at least one endpoint succeeded -- if they all failed,
   // we'll just go right back to the top of the loop and break out when
   // availableEndpointIds is re-synced and found to be empty at that point.
@@ -194,9 +315,12 @@ bool PayloadManager::SendPayloadLoop(
           continue;
         }
 
-        HandleSuccessfulOutgoingChunk(
-            client, endpoint_id, payload_header, payload_chunk.flags(),
-            payload_chunk.offset(), payload_chunk.body().size());
+        // Progress counts the payload's own bytes, not the compressed ones.
+        HandleSuccessfulOutgoingChunk(client, endpoint_id, payload_header,
+                                      payload_chunk.flags(),
+                                      payload_chunk.offset(), next_chunk_size);
+        client->GetConnectionQualityRecorder().OnPayloadChunkSent(
+            endpoint_id, next_chunk_size, payload_chunk.body().size());
       }
     }
     NEARBY_VLOG(1) << "PayloadManager done sending chunk at offset "
@@ -220,6 +344,196 @@ bool PayloadManager::SendPayloadLoop(
   return true;
 }
 
+void PayloadManager::SendPayloadFanOut(
+    ClientProxy* client, PendingPayload& pending_payload,
+    const PayloadTransferFrame::PayloadHeader& payload_header,
+    size_t resume_offset) {
+  EndpointIds endpoint_ids =
+      EndpointsToEndpointIds(pending_payload.GetEndpoints());
+  int num_writers = endpoint_ids.size();
+  PayloadFanOutWindow window(kFanOutWindowBytes, num_writers);
+
+  // Every stop of the reader short of the last chunk ends in the window being
+  // closed or aborted; the writers tell their endpoints why.
+  std::int64_t next_chunk_offset = 0;
+  if (resume_offset > 0) {
+    ExceptionOr<size_t> real_offset =
+        pending_payload.GetInternalPayload()->SkipToOffset(resume_offset);
+    if (!real_offset.ok()) {
+      LOG(WARNING) << "PayloadManager failed to skip offset " << resume_offset
+                   << " on payload_id " << payload_header.id();
+      window.Abort();
+    } else {
+      next_chunk_offset = real_offset.GetResult();
+    }
+  }
+
+  // The writers get threads of their own for the length of the payload
+  // rather than coming from a shared pool: a chunk is only dropped once
+  // every writer has taken it, so a writer left waiting in a pool's queue
+  // would stall the others as soon as the window fills. Only file and stream
+  // payloads come here, which take far longer to send than a few threads
+  // take to start.
+  CountDownLatch writers_done(num_writers);
+  AtomicBoolean delivered{false};
+  MultiThreadExecutor writers(num_writers);
+  for (int writer = 0; writer < num_writers; ++writer) {
+    writers.Execute("fan-out-writer", [&, writer,
+                                       start_offset = next_chunk_offset]() {
+      if (RunFanOutWriter(client, pending_payload, payload_header,
+                          endpoint_ids[writer], writer, start_offset,
+                          window)) {
+        delivered.Set(true);
+      }
+      window.RemoveWriter(writer);
+      writers_done.CountDown();
+    });
+  }
+
+  for (int index = 0; !window.IsAborted() && !shutdown_.Get(); ++index) {
+    EndpointIds available_endpoint_ids = EndpointsToEndpointIds(
+        GetAvailableAndUnavailableEndpoints(pending_payload).first);
+    if (available_endpoint_ids.empty() ||
+        pending_payload.IsLocallyCanceled()) {
+      break;
+    }
+    int chunk_size =
+        GetOutgoingChunkSize(client, pending_payload, available_endpoint_ids);
+    auto chunk = std::make_shared<FanOutChunk>();
+    chunk->packet_meta_data.StartFileIo();
+    ByteArray next_chunk =
+        pending_payload.GetInternalPayload()->DetachNextChunk(chunk_size);
+    chunk->packet_meta_data.StopFileIo();
+    if (shutdown_.Get()) break;
+    std::int64_t next_chunk_size = next_chunk.size();
+    if (!next_chunk_size &&
+        pending_payload.GetInternalPayload()->GetTotalSize() > 0 &&
+        pending_payload.GetInternalPayload()->GetTotalSize() <
+            next_chunk_offset) {
+      LOG(INFO) << "Payload xfer failed: payload_id=" << payload_header.id();
+      window.Abort();
+      break;
+    }
+
+    chunk->payload_chunk = CreateOutgoingPayloadChunk(
+        client, pending_payload, available_endpoint_ids,
+        next_chunk_offset - resume_offset, std::move(next_chunk), index);
+    chunk->offset = next_chunk_offset;
+    chunk->size = next_chunk_size;
+    if (!window.Push(std::move(chunk))) break;
+    next_chunk_offset += next_chunk_size;
+    if (!next_chunk_size) break;
+  }
+  window.Close();
+  writers_done.Await();
+
+  if (delivered.Get()) {
+    LOG(INFO) << "Payload xfer done: payload_id=" << payload_header.id()
+              << "; size=" << next_chunk_offset;
+    ThroughputRecorderContainer::GetInstance()
+        .GetTPRecorder(payload_header.id(), PayloadDirection::OUTGOING_PAYLOAD)
+        ->MarkAsSuccess();
+  }
+}
+
+bool PayloadManager::RunFanOutWriter(
+    ClientProxy* client, PendingPayload& pending_payload,
+    const PayloadTransferFrame::PayloadHeader& payload_header,
+    const std::string& endpoint_id, int writer, std::int64_t offset,
+    PayloadFanOutWindow& window) {
+  while (!shutdown_.Get()) {
+    std::shared_ptr<const FanOutChunk> chunk = window.Next(writer);
+    if (chunk == nullptr) {
+      // The reader stopped before the last chunk.
+      if (window.IsAborted()) {
+        HandleFinishedOutgoingPayload(
+            client, {endpoint_id}, payload_header, offset,
+            OperationResultCode::IO_FILE_READING_ERROR,
+            PayloadStatus::LOCAL_ERROR);
+      } else {
+        IsFanOutEndpointActive(client, pending_payload, payload_header,
+                               endpoint_id, offset);
+      }
+      return false;
+    }
+    const PayloadTransferFrame::PayloadChunk& payload_chunk =
+        chunk->payload_chunk;
+    offset = chunk->offset;
+
+    if (!IsFanOutEndpointActive(client, pending_payload, payload_header,
+                                endpoint_id, offset)) {
+      return false;
+    }
+    pending_payload.SetOffsetForEndpoint(endpoint_id, offset);
+
+    PacketMetaData packet_meta_data = chunk->packet_meta_data;
+    absl::Time write_start_time = SystemClock::ElapsedRealtime();
+    if (!endpoint_manager_
+             ->SendPayloadChunk(client, payload_header, payload_chunk,
+                                {endpoint_id}, packet_meta_data)
+             .empty()) {
+      LOG(INFO) << "Payload xfer: endpoint failed: payload_id="
+                << payload_header.id() << "; endpoint_id=" << endpoint_id;
+      chunk_size_controller_.OnWriteFailed(endpoint_id);
+      HandleFinishedOutgoingPayload(
+          client, {endpoint_id}, payload_header, offset,
+          OperationResultCode::CONNECTIVITY_GENERIC_WRITING_CHANNEL_IO_ERROR,
+          PayloadStatus::ENDPOINT_IO_ERROR);
+      return false;
+    }
+    chunk_size_controller_.OnChunkWritten(
+        endpoint_id, chunk->size,
+        SystemClock::ElapsedRealtime() - write_start_time);
+
+    bool is_last_chunk = IsLastChunk(payload_chunk);
+    if (is_last_chunk &&
+        IsPayloadReceivedAckEnabled(client, endpoint_id, pending_payload)) {
+      client->GetConnectionQualityRecorder().OnPayloadAckExpected(
+          endpoint_id, payload_header.id());
+    }
+    if (!WaitForReceivedAck(client, endpoint_id, pending_payload,
+                            payload_header, offset, is_last_chunk)) {
+      return false;
+    }
+    HandleSuccessfulOutgoingChunk(client, endpoint_id, payload_header,
+                                  payload_chunk.flags(), payload_chunk.offset(),
+                                  chunk->size);
+    client->GetConnectionQualityRecorder().OnPayloadChunkSent(
+        endpoint_id, chunk->size, payload_chunk.body().size());
+    if (is_last_chunk) return true;
+    offset += chunk->size;
+  }
+  return false;
+}
+
+bool PayloadManager::IsFanOutEndpointActive(
+    ClientProxy* client, PendingPayload& pending_payload,
+    const PayloadTransferFrame::PayloadHeader& payload_header,
+    const std::string& endpoint_id, std::int64_t offset) {
+  auto* endpoint_info = pending_payload.GetEndpoint(endpoint_id);
+  // Already told, e.g. by a PAYLOAD_ERROR it sent us.
+  if (endpoint_info == nullptr) return false;
+  if (pending_payload.IsLocallyCanceled()) {
+    LOG(INFO) << "Aborting send of payload_id=" << payload_header.id()
+              << " to endpoint_id=" << endpoint_id << " at offset " << offset
+              << " since it is marked canceled.";
+    HandleFinishedOutgoingPayload(
+        client, {endpoint_id}, payload_header, offset,
+        OperationResultCode::CLIENT_CANCELLATION_LOCAL_CANCEL_PAYLOAD,
+        PayloadStatus::LOCAL_CANCELLATION);
+    return false;
+  }
+  EndpointInfo::Status status = endpoint_info->status.Get();
+  if (status != EndpointInfo::Status::kAvailable) {
+    HandleFinishedOutgoingPayload(
+        client, {endpoint_id}, payload_header, offset,
+        EndpointInfoStatusToOperationResultCode(status),
+        EndpointInfoStatusToPayloadStatus(status));
+    return false;
+  }
+  return true;
+}
+
 std::pair<PayloadManager::Endpoints, PayloadManager::Endpoints>
 PayloadManager::GetAvailableAndUnavailableEndpoints(
     const PendingPayload& pending_payload) {
@@ -450,9 +764,15 @@ void PayloadManager::SendPayload(ClientProxy* client,
 
   Payload::Id payload_id =
       CreateOutgoingPayload(std::move(payload), endpoint_ids);
+  // Counts towards the endpoints' queue depth until the job is done with.
+  ConnectionQualityRecorder::OutgoingPayload queued_payload =
+      client->GetConnectionQualityRecorder().TrackOutgoingPayload(
+          endpoint_ids);
   executor->Execute("send-payload", [this, client, endpoint_ids, payload_id,
                                      payload_type, resume_offset,
-                                     payload_total_size]() {
+                                     payload_total_size,
+                                     queued_payload =
+                                         std::move(queued_payload)]() {
     if (shutdown_.Get()) return;
     PendingPayloadHandle pending_payload = GetPayload(payload_id);
     if (!pending_payload) {
@@ -486,6 +806,14 @@ void PayloadManager::SendPayload(ClientProxy* client,
     ThroughputRecorderContainer::GetInstance()
         .GetTPRecorder(payload_id, PayloadDirection::OUTGOING_PAYLOAD)
         ->Start(payload_type, PayloadDirection::OUTGOING_PAYLOAD);
+    // Bytes payloads take a chunk or a few, so a slow endpoint barely holds
+    // the others back and isn't worth the writer threads.
+    if (endpoint_ids.size() > 1 && payload_type != PayloadType::kBytes &&
+        FeatureFlags::GetInstance().GetFlags().enable_payload_fan_out) {
+      SendPayloadFanOut(client, *pending_payload, payload_header,
+                        resume_offset);
+      should_continue = false;
+    }
     while (should_continue && !shutdown_.Get()) {
       should_continue =
           SendPayloadLoop(client, *pending_payload, payload_header,
@@ -573,7 +901,7 @@ void PayloadManager::OnIncomingFrame(OfflineFrame& offline_frame,
       LOG(INFO) << "[safe-to-disconnect][PAYLOAD_RECEIVED_ACK] sender "
                    "received payload ack from "
                 << from_endpoint_id;
-      ProcessPayloadAckPacket(from_endpoint_id, frame);
+      ProcessPayloadAckPacket(to_client, from_endpoint_id, frame);
       break;
     default:
       LOG(WARNING) << "PayloadManager: invalid frame; remote endpoint: self="
@@ -591,6 +919,7 @@ void PayloadManager::OnEndpointDisconnect(ClientProxy* client,
     barrier.CountDown();
     return;
   }
+  chunk_size_controller_.OnEndpointRemoved(endpoint_id);
   RunOnStatusUpdateThread(
       "payload-manager-on-disconnect",
       [this, client, endpoint_id, barrier,
@@ -611,8 +940,13 @@ void PayloadManager::OnEndpointDisconnect(ClientProxy* client,
           std::int64_t payload_total_size =
               pending_payload->GetInternalPayload()->GetTotalSize();
 
-          // If no endpoints are left for this payload, close it.
+          // If no endpoints are left for this payload, close it. What we got
+          // of an incoming one may be resumed from, unless we hung up.
           if (pending_payload->GetEndpoints().empty()) {
+            if (pending_payload->IsIncoming() &&
+                reason != DisconnectionReason::LOCAL_DISCONNECTION) {
+              pending_payload->GetInternalPayload()->KeepForResume();
+            }
             pending_payload->Close();
           }
           // Create the payload transfer update.
@@ -744,11 +1078,23 @@ SingleThreadExecutor* PayloadManager::GetOutgoingPayloadExecutor(
   }
 }
 
-int PayloadManager::GetOptimalChunkSize(EndpointIds endpoint_ids) {
+int PayloadManager::GetOptimalChunkSize(ClientProxy* client,
+                                        EndpointIds endpoint_ids) {
+  bool is_adaptive =
+      FeatureFlags::GetInstance().GetFlags().enable_adaptive_chunk_size;
   int minChunkSize = std::numeric_limits<int>::max();
   for (const auto& endpoint_id : endpoint_ids) {
-    minChunkSize = std::min(
-        minChunkSize, endpoint_manager_->GetMaxTransmitPacketSize(endpoint_id));
+    int max_chunk_size =
+        endpoint_manager_->GetMaxTransmitPacketSize(endpoint_id);
+    int chunk_size = max_chunk_size;
+    if (is_adaptive) {
+      chunk_size = chunk_size_controller_.GetChunkSize(
+          endpoint_id, endpoint_manager_->GetMedium(endpoint_id),
+          max_chunk_size);
+      client->GetConnectionQualityRecorder().OnPayloadChunkSizeChosen(
+          endpoint_id, chunk_size, max_chunk_size);
+    }
+    minChunkSize = std::min(minChunkSize, chunk_size);
   }
   return minChunkSize;
 }
@@ -775,6 +1121,46 @@ PayloadTransferFrame::PayloadHeader PayloadManager::CreatePayloadHeader(
   return payload_header;
 }
 
+int PayloadManager::GetOutgoingChunkSize(ClientProxy* client,
+                                         PendingPayload& pending_payload,
+                                         const EndpointIds& endpoint_ids) {
+  if (pending_payload.GetInternalPayload()->GetType() ==
+          PayloadTransferFrame::PayloadHeader::BYTES &&
+      !IsChunkedBytesPayloadEnabled(client, endpoint_ids)) {
+    // Older receivers expect a BYTES payload in a single chunk.
+    return 0;
+  }
+  return GetOptimalChunkSize(client, endpoint_ids);
+}
+
+PayloadTransferFrame::PayloadChunk PayloadManager::CreateOutgoingPayloadChunk(
+    ClientProxy* client, PendingPayload& pending_payload,
+    const EndpointIds& endpoint_ids, std::int64_t payload_chunk_offset,
+    ByteArray payload_chunk_body, int index) {
+  // Whether a payload goes compressed is settled on its first chunk, when it
+  // knows all its recipients.
+  if (index == 0 &&
+      pending_payload.GetInternalPayload()->GetType() !=
+          PayloadTransferFrame::PayloadHeader::STREAM &&
+      IsPayloadCompressionEnabled(client, endpoint_ids)) {
+    pending_payload.SetCompressor(PayloadCompressor::Create());
+  }
+  std::optional<ByteArray> compressed_body;
+  if (pending_payload.GetCompressor() != nullptr) {
+    compressed_body = pending_payload.GetCompressor()->Compress(
+        payload_chunk_body, GetLinkBytesPerSecond(client, endpoint_ids));
+  }
+
+  PayloadTransferFrame::PayloadChunk payload_chunk(CreatePayloadChunk(
+      payload_chunk_offset, std::move(payload_chunk_body), index));
+  if (compressed_body.has_value()) {
+    payload_chunk.set_body(std::string(std::move(*compressed_body)));
+    payload_chunk.set_flags(payload_chunk.flags() |
+                            PayloadTransferFrame::PayloadChunk::COMPRESSED);
+  }
+  return payload_chunk;
+}
+
 PayloadTransferFrame::PayloadChunk PayloadManager::CreatePayloadChunk(
     std::int64_t payload_chunk_offset, ByteArray payload_chunk_body,
     int index) {
@@ -908,7 +1294,7 @@ void PayloadManager::SendClientCallbacksForFinishedIncomingPayload(
 }
 
 void PayloadManager::SendControlMessage(
-    const EndpointIds& endpoint_ids,
+    ClientProxy* client, const EndpointIds& endpoint_ids,
     const PayloadTransferFrame::PayloadHeader& payload_header,
     std::int64_t num_bytes_successfully_transferred,
     PayloadTransferFrame::ControlMessage::EventType event_type) {
@@ -916,8 +1302,8 @@ void PayloadManager::SendControlMessage(
   control_message.set_event(event_type);
   control_message.set_offset(num_bytes_successfully_transferred);
 
-  endpoint_manager_->SendControlMessage(payload_header, control_message,
-                                        endpoint_ids);
+  endpoint_manager_->SendControlMessage(client, payload_header,
+                                        control_message, endpoint_ids);
 }
 
 void PayloadManager::SendPayloadReceivedAck(ClientProxy* client,
@@ -930,8 +1316,8 @@ void PayloadManager::SendPayloadReceivedAck(ClientProxy* client,
   }
 
   send_payload_ack_executor_.Execute(
-      "send_payload_ack", [this, &pending_payload, endpoint_id]() {
-        endpoint_manager_->SendPayloadAck(pending_payload.GetId(),
+      "send_payload_ack", [this, client, &pending_payload, endpoint_id]() {
+        endpoint_manager_->SendPayloadAck(client, pending_payload.GetId(),
                                           {endpoint_id});
         LOG(INFO) << "[safe-to-disconnect] Send "
                      "PAYLOAD_RECEIVED_ACK frame to: "
@@ -1048,6 +1434,22 @@ bool PayloadManager::IsPayloadReceivedAckEnabled(
               PayloadHeader::BYTES);
 }
 
+bool PayloadManager::IsPayloadCompressionEnabled(
+    ClientProxy* client, const EndpointIds& endpoint_ids) {
+  for (const auto& endpoint_id : endpoint_ids) {
+    if (!client->IsPayloadCompressionEnabled(endpoint_id)) return false;
+  }
+  return true;
+}
+
+bool PayloadManager::IsChunkedBytesPayloadEnabled(
+    ClientProxy* client, const EndpointIds& endpoint_ids) {
+  for (const auto& endpoint_id : endpoint_ids) {
+    if (!client->IsChunkedBytesPayloadEnabled(endpoint_id)) return false;
+  }
+  return true;
+}
+
 void PayloadManager::HandleFinishedOutgoingPayload(
     ClientProxy* client, const EndpointIds& finished_endpoint_ids,
     const PayloadTransferFrame::PayloadHeader& payload_header,
@@ -1060,7 +1462,7 @@ void PayloadManager::HandleFinishedOutgoingPayload(
 
   switch (status) {
     case PayloadStatus::LOCAL_ERROR:
-      SendControlMessage(finished_endpoint_ids, payload_header,
+      SendControlMessage(client, finished_endpoint_ids, payload_header,
                          num_bytes_successfully_transferred,
                          PayloadTransferFrame::ControlMessage::PAYLOAD_ERROR);
       break;
@@ -1068,7 +1470,7 @@ void PayloadManager::HandleFinishedOutgoingPayload(
       LOG(INFO) << "Sending PAYLOAD_CANCEL to receiver side; payload_id="
                 << payload_header.id();
       SendControlMessage(
-          finished_endpoint_ids, payload_header,
+          client, finished_endpoint_ids, payload_header,
           num_bytes_successfully_transferred,
           PayloadTransferFrame::ControlMessage::PAYLOAD_CANCELED);
       break;
@@ -1103,12 +1505,12 @@ void PayloadManager::HandleFinishedIncomingPayload(
 
   switch (status) {
     case PayloadStatus::LOCAL_ERROR:
-      SendControlMessage({endpoint_id}, payload_header, offset_bytes,
+      SendControlMessage(client, {endpoint_id}, payload_header, offset_bytes,
                          PayloadTransferFrame::ControlMessage::PAYLOAD_ERROR);
       break;
     case PayloadStatus::LOCAL_CANCELLATION:
       SendControlMessage(
-          {endpoint_id}, payload_header, offset_bytes,
+          client, {endpoint_id}, payload_header, offset_bytes,
           PayloadTransferFrame::ControlMessage::PAYLOAD_CANCELED);
       break;
     default:
@@ -1277,6 +1679,16 @@ void PayloadManager::HandleSuccessfulIncomingChunk(
           return;
         }
 
+        // The client only learns about a payload that's delivered on
+        // completion from the OnPayload() queued with the last chunk, so it
+        // has no use for progress on the chunks before it.
+        if (!is_last_chunk &&
+            pending_payload->GetInternalPayload()->IsDeliveredOnCompletion()) {
+          client->GetAnalyticsRecorder().OnPayloadChunkReceived(
+              endpoint_id, payload_header.id(), payload_chunk_body_size);
+          return;
+        }
+
         PayloadProgressInfo update{
             payload_header.id(),
             is_last_chunk ? PayloadProgressInfo::Status::kSuccess
@@ -1319,14 +1731,33 @@ void PayloadManager::ProcessDataPacket(
     LOG(WARNING) << "Denying payload with ID 0 for endpoint_id="
                  << from_endpoint_id << ", aborting receipt.";
     // Send the error to the remote endpoint.
-    SendControlMessage({from_endpoint_id}, payload_header,
+    SendControlMessage(to_client, {from_endpoint_id}, payload_header,
                        payload_chunk.offset(),
                        PayloadTransferFrame::ControlMessage::PAYLOAD_ERROR);
     return;
   }
   Payload::Id payload_id = payload_header.id();
+  bool is_compressed = (payload_chunk.flags() &
+                        PayloadTransferFrame::PayloadChunk::COMPRESSED) != 0;
+  std::int64_t wire_body_size = payload_chunk.body().size();
   PendingPayloadHandle pending_payload;
   if (payload_chunk.offset() == 0) {
+    // The first chunk is inflated before the payload is created from it.
+    std::unique_ptr<PayloadDecompressor> decompressor;
+    if (is_compressed) {
+      decompressor = PayloadDecompressor::Create();
+      if (decompressor == nullptr ||
+          !InflateChunk(*decompressor, payload_header, payload_chunk)) {
+        LOG(WARNING) << "Failed to inflate the first chunk of payload_id="
+                     << payload_id << " from endpoint_id="
+                     << from_endpoint_id << ", aborting receipt.";
+        SendControlMessage(
+            to_client, {from_endpoint_id}, payload_header,
+            payload_chunk.offset(),
+            PayloadTransferFrame::ControlMessage::PAYLOAD_ERROR);
+        return;
+      }
+    }
     ThroughputRecorderContainer::GetInstance()
         .GetTPRecorder(payload_id, PayloadDirection::INCOMING_PAYLOAD)
         ->Start((PayloadType)payload_header.type(),
@@ -1364,27 +1795,35 @@ void PayloadManager::ProcessDataPacket(
               });
 
       // Send the error to the remote endpoint.
-      SendControlMessage({from_endpoint_id}, payload_header,
+      SendControlMessage(to_client, {from_endpoint_id}, payload_header,
                          payload_chunk.offset(),
                          PayloadTransferFrame::ControlMessage::PAYLOAD_ERROR);
       return;
     } else {
       pending_payload = std::move(result.value());
     }
+    if (decompressor != nullptr) {
+      pending_payload->SetDecompressor(std::move(decompressor));
+    }
     // Also, let the client know of this new incoming payload.
-    RunOnStatusUpdateThread(
-        "process-data-packet",
-        [to_client, from_endpoint_id,
-         pending_payload = GetPayload(payload_id)]()
-            RUN_ON_PAYLOAD_STATUS_UPDATE_THREAD() {
-              if (!pending_payload) return;
-              LOG(INFO) << "PayloadManager received new payload_id="
-                        << pending_payload->GetInternalPayload()->GetId()
-                        << " from endpoint_id=" << from_endpoint_id;
-              to_client->OnPayload(
-                  from_endpoint_id,
-                  pending_payload->GetInternalPayload()->ReleasePayload());
-            });
+    if (!pending_payload->GetInternalPayload()->IsDeliveredOnCompletion()) {
+      NotifyClientOfIncomingPayload(to_client, from_endpoint_id, payload_id);
+    }
+    // Ask the sender to skip what an earlier transfer left us, if it has the
+    // same bytes.
+    std::int64_t resume_offset =
+        pending_payload->GetInternalPayload()->GetResumeOffset();
+    if (resume_offset > 0) {
+      PayloadTransferFrame::ControlMessage control_message;
+      control_message.set_event(
+          PayloadTransferFrame::ControlMessage::PAYLOAD_RESUME);
+      control_message.set_offset(resume_offset);
+      control_message.set_prefix_hash(
+          pending_payload->GetInternalPayload()->GetResumeHash());
+      endpoint_manager_->SendControlMessage(to_client, payload_header,
+                                            control_message,
+                                            {from_endpoint_id});
+    }
   } else {
     pending_payload = GetPayload(payload_header.id());
   }
@@ -1405,6 +1844,20 @@ void PayloadManager::ProcessDataPacket(
         OperationResultCode::CLIENT_CANCELLATION_LOCAL_CANCEL_PAYLOAD);
     return;
   }
+  if (is_compressed && payload_chunk.offset() != 0 &&
+      (pending_payload->GetDecompressor() == nullptr ||
+       !InflateChunk(*pending_payload->GetDecompressor(), payload_header,
+                     payload_chunk))) {
+    LOG(ERROR) << "ProcessDataPacket: [inflate: error] endpoint_id="
+               << from_endpoint_id
+               << "; payload_id=" << pending_payload->GetId();
+    HandleFinishedIncomingPayload(
+        to_client, from_endpoint_id, payload_header, payload_chunk.offset(),
+        PayloadStatus::LOCAL_ERROR,
+        OperationResultCode::
+            NEARBY_GENERIC_INCOMING_PAYLOAD_DECOMPRESSION_FAILURE);
+    return;
+  }
 
   // Update the offset for this payload. An endpoint disconnection might occur
   // from another thread and we would need to know the current offset to
@@ -1418,7 +1871,9 @@ void PayloadManager::ProcessDataPacket(
   std::int64_t payload_body_size = payload_chunk.body().size();
 
   packet_meta_data.StartFileIo();
-  if (pending_payload->GetInternalPayload()
+  InternalPayload* internal_payload = pending_payload->GetInternalPayload();
+  if (internal_payload->FillTo(payload_chunk.offset()).Raised() ||
+      internal_payload
           ->AttachNextChunk(ByteArray(std::move(*payload_chunk.mutable_body())))
           .Raised()) {
     LOG(ERROR) << "ProcessDataPacket: [data: error] endpoint_id="
@@ -1432,12 +1887,18 @@ void PayloadManager::ProcessDataPacket(
   packet_meta_data.StopFileIo();
   bool is_last_chunk = (payload_chunk.flags() &
                         PayloadTransferFrame::PayloadChunk::LAST_CHUNK) != 0;
+  if (is_last_chunk &&
+      pending_payload->GetInternalPayload()->IsDeliveredOnCompletion()) {
+    NotifyClientOfIncomingPayload(to_client, from_endpoint_id, payload_id);
+  }
   SendPayloadReceivedAck(to_client, *pending_payload, from_endpoint_id,
                          is_last_chunk);
 
   HandleSuccessfulIncomingChunk(to_client, from_endpoint_id, payload_header,
                                 payload_chunk.flags(), payload_chunk.offset(),
                                 payload_body_size);
+  to_client->GetConnectionQualityRecorder().OnPayloadChunkReceived(
+      from_endpoint_id, payload_body_size, wire_body_size);
 
   ThroughputRecorderContainer::GetInstance()
       .GetTPRecorder(payload_header.id(), PayloadDirection::INCOMING_PAYLOAD)
@@ -1449,6 +1910,23 @@ void PayloadManager::ProcessDataPacket(
   }
 }
 
+void PayloadManager::NotifyClientOfIncomingPayload(
+    ClientProxy* to_client, const std::string& from_endpoint_id,
+    Payload::Id payload_id) {
+  RunOnStatusUpdateThread(
+      "process-data-packet",
+      [to_client, from_endpoint_id, pending_payload = GetPayload(payload_id)]()
+          RUN_ON_PAYLOAD_STATUS_UPDATE_THREAD() {
+            if (!pending_payload) return;
+            LOG(INFO) << "PayloadManager received new payload_id="
+                      << pending_payload->GetInternalPayload()->GetId()
+                      << " from endpoint_id=" << from_endpoint_id;
+            to_client->OnPayload(
+                from_endpoint_id,
+                pending_payload->GetInternalPayload()->ReleasePayload());
+          });
+}
+
 // @EndpointManagerDataPool
 void PayloadManager::ProcessControlPacket(
     ClientProxy* to_client, const std::string& from_endpoint_id,
@@ -1503,6 +1981,19 @@ void PayloadManager::ProcessControlPacket(
                                                              control_message);
       }
       break;
+    case PayloadTransferFrame::ControlMessage::PAYLOAD_RESUME:
+      if (!pending_payload->IsIncoming() &&
+          pending_payload->GetInternalPayload()->GetType() ==
+              PayloadTransferFrame::PayloadHeader::FILE &&
+          control_message.has_prefix_hash()) {
+        LOG(INFO) << "Outgoing PAYLOAD_RESUME: from endpoint_id="
+                  << from_endpoint_id << " at offset "
+                  << control_message.offset() << "; self=" << this;
+        pending_payload->RequestResume(
+            from_endpoint_id, {.offset = control_message.offset(),
+                               .prefix_hash = control_message.prefix_hash()});
+      }
+      break;
     default:
       LOG(INFO) << "Unhandled control message " << control_message.event()
                 << " for payload_id="
@@ -1512,7 +2003,7 @@ void PayloadManager::ProcessControlPacket(
 }
 
 void PayloadManager::ProcessPayloadAckPacket(
-    const std::string& from_endpoint_id,
+    ClientProxy* to_client, const std::string& from_endpoint_id,
     PayloadTransferFrame& payload_transfer_frame) {
   auto payload_header = payload_transfer_frame.payload_header();
   PendingPayloadHandle pending_payload = GetPayload(payload_header.id());
@@ -1532,6 +2023,8 @@ void PayloadManager::ProcessPayloadAckPacket(
   LOG(INFO)
       << "[safe-to-disconnect][PAYLOAD_RECEIVED_ACK] sender received payload "
       << payload_header.id() << " ack from " << from_endpoint_id;
+  to_client->GetConnectionQualityRecorder().OnPayloadAckReceived(
+      from_endpoint_id, payload_header.id());
   pending_payload->MarkReceivedAckFromEndpoint(from_endpoint_id);
 }
 
@@ -1728,6 +2221,26 @@ void PayloadManager::PendingPayload::SetOffsetForEndpoint(
   }
 }
 
+void PayloadManager::PendingPayload::RequestResume(
+    const std::string& endpoint_id, ResumeRequest request) {
+  MutexLock lock(&mutex_);
+  resume_endpoint_id_ = endpoint_id;
+  resume_request_ = request;
+}
+
+std::optional<PayloadManager::PendingPayload::ResumeRequest>
+PayloadManager::PendingPayload::TakeResumeRequest(
+    const std::string& endpoint_id) {
+  MutexLock lock(&mutex_);
+  if (!resume_request_.has_value() || resume_endpoint_id_ != endpoint_id) {
+    return std::nullopt;
+  }
+  std::optional<ResumeRequest> request = resume_request_;
+  resume_endpoint_id_.clear();
+  resume_request_.reset();
+  return request;
+}
+
 void PayloadManager::PendingPayload::Close() {
   bool was_closed = is_closed_.Set(true);
   if (was_closed) return;
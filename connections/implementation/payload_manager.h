@@ -18,6 +18,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
@@ -27,9 +28,12 @@
 #include "absl/functional/any_invocable.h"
 #include "absl/time/time.h"
 #include "connections/implementation/analytics/packet_meta_data.h"
+#include "connections/implementation/chunk_size_controller.h"
 #include "connections/implementation/client_proxy.h"
 #include "connections/implementation/endpoint_manager.h"
 #include "connections/implementation/internal_payload.h"
+#include "connections/implementation/payload_compression.h"
+#include "connections/implementation/payload_fan_out_window.h"
 #include "connections/listeners.h"
 #include "connections/payload.h"
 #include "connections/payload_type.h"
@@ -161,6 +165,32 @@ class PayloadManager : public EndpointManager::FrameProcessor {
     void SetOffsetForEndpoint(const std::string& endpoint_id,
                               std::int64_t offset) ABSL_LOCKS_EXCLUDED(mutex_);
 
+    // A receiver's request to continue from `offset`, having kept that much
+    // of an earlier transfer, with the PayloadHash of what it kept.
+    struct ResumeRequest {
+      std::int64_t offset = 0;
+      std::uint64_t prefix_hash = 0;
+    };
+
+    // Records that `endpoint_id` asked for this outgoing payload to resume.
+    void RequestResume(const std::string& endpoint_id, ResumeRequest request)
+        ABSL_LOCKS_EXCLUDED(mutex_);
+
+    // Returns what `endpoint_id` asked for, if anything, and forgets it.
+    std::optional<ResumeRequest> TakeResumeRequest(
+        const std::string& endpoint_id) ABSL_LOCKS_EXCLUDED(mutex_);
+
+    // Set from the first chunk of a payload that's sent or received
+    // compressed, and only used by the thread sending or receiving it.
+    PayloadCompressor* GetCompressor() { return compressor_.get(); }
+    void SetCompressor(std::unique_ptr<PayloadCompressor> compressor) {
+      compressor_ = std::move(compressor);
+    }
+    PayloadDecompressor* GetDecompressor() { return decompressor_.get(); }
+    void SetDecompressor(std::unique_ptr<PayloadDecompressor> decompressor) {
+      decompressor_ = std::move(decompressor);
+    }
+
     // Closes internal_payload_.
     // Close is called when a pending peyload does not have associated
     // endpoints.
@@ -182,6 +212,10 @@ class PayloadManager : public EndpointManager::FrameProcessor {
     DestroyCallback destroy_callback_;
     absl::flat_hash_map<std::string, EndpointInfo> endpoints_
         ABSL_GUARDED_BY(mutex_);
+    std::string resume_endpoint_id_ ABSL_GUARDED_BY(mutex_);
+    std::optional<ResumeRequest> resume_request_ ABSL_GUARDED_BY(mutex_);
+    std::unique_ptr<PayloadCompressor> compressor_;
+    std::unique_ptr<PayloadDecompressor> decompressor_;
     int refcount_ = 0;
   };
 
@@ -273,11 +307,40 @@ class PayloadManager : public EndpointManager::FrameProcessor {
   // Returns list of endpoint ids.
   static EndpointIds EndpointsToEndpointIds(const Endpoints& endpoints);
 
+  // Returns the offset `endpoint_id` asked to resume `pending_payload` from,
+  // if the bytes it kept are ours, or 0.
+  std::int64_t GetVerifiedResumeOffset(PendingPayload& pending_payload,
+                                       const std::string& endpoint_id);
   bool SendPayloadLoop(
       ClientProxy* client, PendingPayload& pending_payload,
       location::nearby::connections::PayloadTransferFrame::PayloadHeader&
           payload_header,
       std::int64_t& next_chunk_offset, size_t resume_offset, int index);
+  // Sends `pending_payload` to all its endpoints at once. Each chunk is read
+  // once into a PayloadFanOutWindow, and a writer per endpoint takes it from
+  // there at that endpoint's pace.
+  void SendPayloadFanOut(
+      ClientProxy* client, PendingPayload& pending_payload,
+      const location::nearby::connections::PayloadTransferFrame::PayloadHeader&
+          payload_header,
+      size_t resume_offset);
+  // Writes the chunks of a payload sent with SendPayloadFanOut() to
+  // `endpoint_id`, starting at `offset`. Returns true once the last chunk got
+  // through; otherwise the endpoint has been told why the payload stopped.
+  bool RunFanOutWriter(
+      ClientProxy* client, PendingPayload& pending_payload,
+      const location::nearby::connections::PayloadTransferFrame::PayloadHeader&
+          payload_header,
+      const std::string& endpoint_id, int writer, std::int64_t offset,
+      PayloadFanOutWindow& window);
+  // Returns whether `endpoint_id` still takes `pending_payload`. If it was
+  // canceled or the endpoint is gone, finishes the payload for it at `offset`
+  // and returns false.
+  bool IsFanOutEndpointActive(
+      ClientProxy* client, PendingPayload& pending_payload,
+      const location::nearby::connections::PayloadTransferFrame::PayloadHeader&
+          payload_header,
+      const std::string& endpoint_id, std::int64_t offset);
   void SendClientCallbacksForFinishedIncomingPayloadRunnable(
       ClientProxy* client, const std::string& endpoint_id,
       const location::nearby::connections::PayloadTransferFrame::PayloadHeader&
@@ -308,7 +371,11 @@ class PayloadManager : public EndpointManager::FrameProcessor {
   static PayloadProgressInfo::Status PayloadStatusToTransferUpdateStatus(
       location::nearby::proto::connections::PayloadStatus status);
 
-  int GetOptimalChunkSize(EndpointIds endpoint_ids);
+  int GetOptimalChunkSize(ClientProxy* client, EndpointIds endpoint_ids);
+  // The size of the next chunk of `pending_payload` to `endpoint_ids`, or 0
+  // if it has to go in a single chunk.
+  int GetOutgoingChunkSize(ClientProxy* client, PendingPayload& pending_payload,
+                           const EndpointIds& endpoint_ids);
 
   location::nearby::connections::PayloadTransferFrame::PayloadHeader
   CreatePayloadHeader(const InternalPayload& internal_payload, size_t offset,
@@ -317,6 +384,13 @@ class PayloadManager : public EndpointManager::FrameProcessor {
 
   location::nearby::connections::PayloadTransferFrame::PayloadChunk
   CreatePayloadChunk(std::int64_t offset, ByteArray body, int index);
+  // Like CreatePayloadChunk(), but compresses `body` if `pending_payload` is
+  // sent compressed.
+  location::nearby::connections::PayloadTransferFrame::PayloadChunk
+  CreateOutgoingPayloadChunk(ClientProxy* client,
+                             PendingPayload& pending_payload,
+                             const EndpointIds& endpoint_ids,
+                             std::int64_t offset, ByteArray body, int index);
   bool IsLastChunk(
       location::nearby::connections::PayloadTransferFrame::PayloadChunk
           payload_chunk) {
@@ -351,7 +425,7 @@ class PayloadManager : public EndpointManager::FrameProcessor {
           operation_result_code);
 
   void SendControlMessage(
-      const EndpointIds& endpoint_ids,
+      ClientProxy* client, const EndpointIds& endpoint_ids,
       const location::nearby::connections::PayloadTransferFrame::PayloadHeader&
           payload_header,
       std::int64_t num_bytes_successfully_transferred,
@@ -372,6 +446,14 @@ class PayloadManager : public EndpointManager::FrameProcessor {
   bool IsPayloadReceivedAckEnabled(ClientProxy* client,
                                    const std::string& endpoint_id,
                                    PendingPayload& pending_payload);
+  // Returns true if every endpoint in `endpoint_ids` can receive a BYTES
+  // payload split into several chunks.
+  bool IsChunkedBytesPayloadEnabled(ClientProxy* client,
+                                    const EndpointIds& endpoint_ids);
+  // Returns true if every endpoint in `endpoint_ids` can inflate compressed
+  // payload chunks.
+  bool IsPayloadCompressionEnabled(ClientProxy* client,
+                                   const EndpointIds& endpoint_ids);
 
   // Handles a finished outgoing payload for the given endpointIds. All
   // statuses except for SUCCESS are handled here.
@@ -412,12 +494,16 @@ class PayloadManager : public EndpointManager::FrameProcessor {
                              payload_transfer_frame,
                          location::nearby::proto::connections::Medium medium,
                          analytics::PacketMetaData& packet_meta_data);
+  // Hands the incoming payload to the client on the status update thread.
+  void NotifyClientOfIncomingPayload(ClientProxy* to_client,
+                                     const std::string& from_endpoint_id,
+                                     Payload::Id payload_id);
   void ProcessControlPacket(ClientProxy* to_client,
                             const std::string& from_endpoint_id,
                             location::nearby::connections::PayloadTransferFrame&
                                 payload_transfer_frame);
   void ProcessPayloadAckPacket(
-      const std::string& from_endpoint_id,
+      ClientProxy* to_client, const std::string& from_endpoint_id,
       location::nearby::connections::PayloadTransferFrame&
           payload_transfer_frame);
 
@@ -460,6 +546,8 @@ class PayloadManager : public EndpointManager::FrameProcessor {
   AtomicBoolean shutdown_{false};
   std::unique_ptr<CountDownLatch> shutdown_barrier_;
   int send_payload_count_ = 0;
+  // Declared before the executors that send payloads, so it outlives them.
+  ChunkSizeController chunk_size_controller_;
   SingleThreadExecutor bytes_payload_executor_;
   SingleThreadExecutor file_payload_executor_;
   SingleThreadExecutor stream_payload_executor_;
@@ -15,13 +15,17 @@
 #include "connections/implementation/payload_manager.h"
 
 #include <cstddef>
+#include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
 #include "connections/implementation/analytics/packet_meta_data.h"
+#include "connections/implementation/endpoint_channel.h"
+#include "connections/implementation/endpoint_channel_manager.h"
 #include "connections/implementation/offline_frames.h"
 #include "connections/implementation/simulation_user.h"
 #include "connections/listeners.h"
@@ -31,9 +35,11 @@
 #include "internal/platform/byte_array.h"
 #include "internal/platform/count_down_latch.h"
 #include "internal/platform/exception.h"
+#include "internal/platform/feature_flags.h"
 #include "internal/platform/input_stream.h"
 #include "internal/platform/logging.h"
 #include "internal/platform/medium_environment.h"
+#include "internal/platform/output_stream.h"
 #include "internal/platform/pipe.h"
 
 namespace nearby {
@@ -97,6 +103,11 @@ class PayloadSimulationUser : public SimulationUser {
     sender_payload_id_ = payload.GetId();
     pm_.SendPayload(&client_, {discovered_.endpoint_id}, std::move(payload));
   }
+  void SendPayload(Payload payload,
+                   const std::vector<std::string>& endpoint_ids) {
+    sender_payload_id_ = payload.GetId();
+    pm_.SendPayload(&client_, endpoint_ids, std::move(payload));
+  }
 
   void ReceivePayload(Payload payload, std::string from_payload_id) {
     PayloadTransferFrame::PayloadHeader header;
@@ -133,6 +144,12 @@ class PayloadSimulationUser : public SimulationUser {
     return client_.IsConnectedToEndpoint(discovered_.endpoint_id);
   }
 
+  // Counts `latch` down when the next connection is initiated, e.g. by a
+  // second discoverer after StartAdvertising()'s latch is used up.
+  void ExpectConnectionInitiated(CountDownLatch& latch) {
+    initiated_latch_ = &latch;
+  }
+
  protected:
   Payload::Id sender_payload_id_ = 0;
 };
@@ -431,6 +448,183 @@ TEST_P(PayloadManagerTest, OfflineFrame_BeforeConnected_ShouldDrop) {
 INSTANTIATE_TEST_SUITE_P(ParametrisedPayloadManagerTest, PayloadManagerTest,
                          ::testing::ValuesIn(kTestCases));
 
+// A payload sent to two endpoints at once, with a writer per endpoint.
+class PayloadManagerFanOutTest : public PayloadManagerTest {
+ protected:
+  PayloadManagerFanOutTest() {
+    FeatureFlags::Flags flags = FeatureFlags::GetInstance().GetFlags();
+    flags.enable_payload_fan_out = true;
+    scoped_flags_ =
+        std::make_unique<FeatureFlags::ScopedFlagsForTesting>(flags);
+  }
+
+  // Connects `receiver` to `sender`, which is already advertising, and
+  // returns the receiver's endpoint id on the sender.
+  std::string Connect(PayloadSimulationUser& sender,
+                      PayloadSimulationUser& receiver) {
+    CountDownLatch discovery_latch(1);
+    CountDownLatch initiated_latch(2);
+    CountDownLatch accept_latch(2);
+    receiver.StartDiscovery(std::string(kServiceId), &discovery_latch);
+    EXPECT_TRUE(discovery_latch.Await(kDefaultTimeout).result());
+    sender.ExpectConnectionInitiated(initiated_latch);
+    receiver.RequestConnection(&initiated_latch);
+    EXPECT_TRUE(initiated_latch.Await(kDefaultTimeout).result());
+    sender.AcceptConnection(&accept_latch);
+    receiver.AcceptConnection(&accept_latch);
+    EXPECT_TRUE(accept_latch.Await(kDefaultTimeout).result());
+    return sender.GetDiscovered().endpoint_id;
+  }
+
+  // Starts a stream from `sender` to both receivers and waits for `message`,
+  // its first chunk, to reach them.
+  void StartStream(PayloadSimulationUser& sender, PayloadSimulationUser& user_a,
+                   PayloadSimulationUser& user_b,
+                   const std::vector<std::string>& endpoint_ids,
+                   std::unique_ptr<InputStream> input, OutputStream& tx,
+                   const ByteArray& message) {
+    CountDownLatch payload_latch(2);
+    user_a.ExpectPayload(payload_latch);
+    user_b.ExpectPayload(payload_latch);
+    tx.Write(message);
+    sender.SendPayload(Payload(std::move(input)), endpoint_ids);
+    ASSERT_TRUE(payload_latch.Await(kDefaultTimeout).result());
+    for (PayloadSimulationUser* user : {&user_a, &user_b}) {
+      EXPECT_TRUE(user->WaitForProgress(
+          [&message](const PayloadProgressInfo& info) {
+            return info.bytes_transferred >= message.size();
+          },
+          kProgressTimeout));
+    }
+  }
+
+  std::unique_ptr<FeatureFlags::ScopedFlagsForTesting> scoped_flags_;
+};
+
+TEST_P(PayloadManagerFanOutTest, CancelReachesEveryEndpoint) {
+  env_.Start();
+  PayloadSimulationUser sender(kDeviceA, GetParam());
+  PayloadSimulationUser user_a("device-c", GetParam());
+  PayloadSimulationUser user_b(kDeviceB, GetParam());
+  sender.StartAdvertising(std::string(kServiceId), nullptr);
+  std::vector<std::string> endpoint_ids = {Connect(sender, user_a),
+                                           Connect(sender, user_b)};
+  ASSERT_NE(endpoint_ids[0], endpoint_ids[1]);
+  auto [input, tx] = CreatePipe();
+  const ByteArray message{std::string(kMessage)};
+  StartStream(sender, user_a, user_b, endpoint_ids, std::move(input), *tx,
+              message);
+
+  EXPECT_EQ(sender.CancelPayload(), Status{Status::kSuccess});
+
+  // The reader only sees the cancel once it has something to read.
+  int count = 0;
+  while (tx->Write(message).Ok() && count < 10) {
+    SystemClock::Sleep(kDefaultTimeout);
+    count++;
+  }
+  EXPECT_LT(count, 10);
+  for (PayloadSimulationUser* user : {&user_a, &user_b}) {
+    EXPECT_TRUE(user->WaitForProgress(
+        [](const PayloadProgressInfo& info) {
+          return info.status == PayloadProgressInfo::Status::kCanceled;
+        },
+        kProgressTimeout));
+  }
+
+  tx->Close();
+  sender.Stop();
+  user_a.Stop();
+  user_b.Stop();
+  env_.Stop();
+}
+
+TEST_P(PayloadManagerFanOutTest, FailedEndpointDoesNotStopOthers) {
+  env_.Start();
+  PayloadSimulationUser sender(kDeviceA, GetParam());
+  PayloadSimulationUser user_a("device-c", GetParam());
+  PayloadSimulationUser user_b(kDeviceB, GetParam());
+  sender.StartAdvertising(std::string(kServiceId), nullptr);
+  std::vector<std::string> endpoint_ids = {Connect(sender, user_a),
+                                           Connect(sender, user_b)};
+  auto [input, tx] = CreatePipe();
+  const ByteArray message{std::string(kMessage)};
+  StartStream(sender, user_a, user_b, endpoint_ids, std::move(input), *tx,
+              message);
+
+  // Writes to the first endpoint fail from now on.
+  std::shared_ptr<EndpointChannel> channel =
+      sender.GetEndpointChannelManager().GetChannelForEndpoint(
+          endpoint_ids[0]);
+  ASSERT_NE(channel, nullptr);
+  channel->Close();
+  tx->Write(message);
+
+  EXPECT_TRUE(user_b.WaitForProgress(
+      [&message](const PayloadProgressInfo& info) {
+        return info.bytes_transferred >= 2 * message.size();
+      },
+      kProgressTimeout));
+
+  tx->Close();
+  sender.Stop();
+  user_a.Stop();
+  user_b.Stop();
+  env_.Stop();
+}
+
+TEST_P(PayloadManagerFanOutTest, SlowEndpointDoesNotHoldBackOthers) {
+  env_.Start();
+  PayloadSimulationUser sender(kDeviceA, GetParam());
+  PayloadSimulationUser user_a("device-c", GetParam());
+  PayloadSimulationUser user_b(kDeviceB, GetParam());
+  sender.StartAdvertising(std::string(kServiceId), nullptr);
+  std::vector<std::string> endpoint_ids = {Connect(sender, user_a),
+                                           Connect(sender, user_b)};
+  auto [input, tx] = CreatePipe();
+  const ByteArray message{std::string(kMessage)};
+  StartStream(sender, user_a, user_b, endpoint_ids, std::move(input), *tx,
+              message);
+
+  // Writes to the first endpoint block until it's resumed.
+  std::shared_ptr<EndpointChannel> channel =
+      sender.GetEndpointChannelManager().GetChannelForEndpoint(
+          endpoint_ids[0]);
+  ASSERT_NE(channel, nullptr);
+  channel->Pause();
+  tx->Write(message);
+
+  EXPECT_TRUE(user_b.WaitForProgress(
+      [&message](const PayloadProgressInfo& info) {
+        return info.bytes_transferred >= 2 * message.size();
+      },
+      kProgressTimeout));
+  EXPECT_FALSE(user_a.WaitForProgress(
+      [&message](const PayloadProgressInfo& info) {
+        return info.bytes_transferred >= 2 * message.size();
+      },
+      kProgressTimeout));
+
+  channel->Resume();
+  EXPECT_TRUE(user_a.WaitForProgress(
+      [&message](const PayloadProgressInfo& info) {
+        return info.bytes_transferred >= 2 * message.size();
+      },
+      kProgressTimeout));
+
+  tx->Close();
+  sender.Stop();
+  user_a.Stop();
+  user_b.Stop();
+  env_.Stop();
+}
+
+// The writers work the same over any medium, so one is enough.
+INSTANTIATE_TEST_SUITE_P(FanOutPayloadManagerTest, PayloadManagerFanOutTest,
+                         ::testing::Values(BooleanMediumSelector{
+                             .wifi_lan = true,
+                         }));
+
 }  // namespace
 }  // namespace connections
 }  // namespace nearby
@@ -665,10 +665,11 @@ static nearby_platform_status OnWriteKeyBasedPairing(uint64_t peer_address,
     account_key_info.peer_address = peer_address;
 #endif /* NEARBY_FP_ENABLE_SASS */
   } else if (length == ENCRYPTED_REQUEST_LENGTH) {
-    // try each key in the persisted Account Key List
-    int num_keys = nearby_fp_GetAccountKeyCount();
-    int i;
-    for (i = 0; i < num_keys; i++) {
+    // Try each key in the persisted Account Key List. The list is kept in
+    // most recently used order, so the key of a returning seeker is usually
+    // the first one tried. Keys shared by several seekers are tried once.
+    int i = 0;
+    while ((i = nearby_fp_GetNextUniqueAccountKeyIndex(i)) != -1) {
       const nearby_platform_AccountKeyInfo* key = nearby_fp_GetAccountKey(i);
       status = nearby_platform_Aes128Decrypt(request, decrypted_request,
                                              key->account_key);
@@ -687,12 +688,14 @@ static nearby_platform_status OnWriteKeyBasedPairing(uint64_t peer_address,
         // add it again with the current peer address
         account_key_info.peer_address = peer_address;
 #endif /* NEARBY_FP_ENABLE_SASS */
+        // Moves the key to the top of the list.
         nearby_fp_AddAccountKey(&account_key_info);
         nearby_fp_SaveAccountKeys();
         break;
       }
+      i++;
     }
-    if (i == num_keys) {
+    if (i == -1) {
       NEARBY_TRACE(VERBOSE, "No key matched");
       AccountKeyRejected();
       return kNearbyStatusOK;
@@ -0,0 +1,91 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "fakes.h"
+#include "nearby.h"
+#include "nearby_fp_client.h"
+#include "nearby_fp_library.h"
+
+constexpr uint64_t kRemoteDevice = 0xB0B1B2B3B4B5;
+constexpr uint64_t kOtherDevice = 0x505050505050;
+
+// A full account key list. With `shared_keys`, every other entry is the same
+// account key saved for a second seeker, as happens when one account is
+// signed in on two phones.
+static void LoadAccountKeys(bool shared_keys) {
+  std::vector<AccountKeyPair> account_keys;
+  for (int i = 0; i < NEARBY_MAX_ACCOUNT_KEYS; i++) {
+    int key = shared_keys ? i / 2 : i;
+    std::vector<uint8_t> account_key(ACCOUNT_KEY_SIZE_BYTES, 0x11 * key);
+    account_key[0] = 0x04;
+    account_keys.emplace_back(i % 2 ? kOtherDevice : kRemoteDevice,
+                              account_key);
+  }
+  nearby_fp_client_Init(NULL);
+  nearby_test_fakes_SetAccountKeys(account_keys);
+  nearby_fp_LoadAccountKeys();
+}
+
+// Recomputes the bloom filter of a non-discoverable advertisement, as the
+// client does whenever the advertisement is refreshed. The salt is new on
+// every rebuild, so every key is hashed.
+static void BM_SetBloomFilter_NewSalt(benchmark::State& state) {
+  uint8_t advertisement[NON_DISCOVERABLE_ADV_SIZE_BYTES];
+  LoadAccountKeys(/*shared_keys=*/false);
+  nearby_fp_CreateNondiscoverableAdvertisement(advertisement,
+                                               sizeof(advertisement), false);
+  uint8_t* salt = (uint8_t*)nearby_fp_FindLtv(advertisement, SALT_FIELD_TYPE);
+  for (auto _ : state) {
+    salt[1]++;
+    nearby_fp_SetBloomFilter(advertisement, false, NULL);
+    benchmark::DoNotOptimize(advertisement);
+  }
+}
+BENCHMARK(BM_SetBloomFilter_NewSalt);
+
+// The bloom filter recomputed with the same salt after a key was added, which
+// only hashes the new key.
+static void BM_SetBloomFilter_KeyAdded(benchmark::State& state) {
+  uint8_t advertisement[NON_DISCOVERABLE_ADV_SIZE_BYTES];
+  LoadAccountKeys(/*shared_keys=*/false);
+  nearby_fp_CreateNondiscoverableAdvertisement(advertisement,
+                                               sizeof(advertisement), false);
+  nearby_platform_AccountKeyInfo new_key = {};
+  unsigned int key = 0;
+  for (auto _ : state) {
+    new_key.account_key[1] = key;
+    new_key.account_key[2] = key++ >> 8;
+    nearby_fp_AddAccountKey(&new_key);
+    nearby_fp_SetBloomFilter(advertisement, false, NULL);
+    benchmark::DoNotOptimize(advertisement);
+  }
+}
+BENCHMARK(BM_SetBloomFilter_KeyAdded);
+
+// Walks the unique account keys the way the Message Stream does to find the
+// key a message was signed with.
+static void BM_UniqueAccountKeyWalk(benchmark::State& state) {
+  LoadAccountKeys(/*shared_keys=*/state.range(0));
+  for (auto _ : state) {
+    int offset = 0;
+    while ((offset = nearby_fp_GetNextUniqueAccountKeyIndex(offset)) != -1) {
+      benchmark::DoNotOptimize(nearby_fp_GetAccountKey(offset));
+      offset++;
+    }
+  }
+}
+BENCHMARK(BM_UniqueAccountKeyWalk)->ArgName("shared_keys")->Arg(0)->Arg(1);
@@ -558,6 +558,147 @@ TEST(NearbyFpClient,
               ElementsAreArray(kExpectedResult, kBufferSize));
 }
 
+TEST(NearbyFpClient, AdvertisementNondiscoverable_keyAdded_hashesOnlyNewKey) {
+  uint8_t salt = 0xC7;
+  uint8_t account_key1[] = {0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88,
+                            0x99, 0x00, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF};
+  nearby_platform_AccountKeyInfo account_key2 = {
+      .account_key = {0x11, 0x11, 0x22, 0x22, 0x33, 0x33, 0x44, 0x44, 0x55,
+                      0x55, 0x66, 0x66, 0x77, 0x77, 0x88, 0x88}};
+  std::vector<AccountKeyPair> account_keys{
+      AccountKeyPair(kRemoteDevice, account_key1)};
+  // Same as AdvertisementNondiscoverable_twoKeys
+  const uint8_t kExpectedResult1[] = {12,   0x16, 0x2C, 0xFE,    0x00, 0x52,
+                                      0x2f, 0xba, 0x06, 0x42,    0x00, 0x11,
+                                      salt, 2,    0x0A, kTxPower};
+  const uint8_t kExpectedResult2[] = {13,   0x16, 0x2C, 0xFE, 0x00,    0x52,
+                                      0x4d, 0x08, 0x00, 0x5d, 0x1c,    0x21,
+                                      salt, salt, 2,    0x0A, kTxPower};
+  const uint8_t* kExpectedResult =
+      (NEARBY_FP_SALT_SIZE == 1) ? kExpectedResult1 : kExpectedResult2;
+  const int kBufferSize = (NEARBY_FP_SALT_SIZE == 1) ? sizeof(kExpectedResult1)
+                                                     : sizeof(kExpectedResult2);
+  uint8_t buffer[kBufferSize];
+  nearby_fp_client_Init(NULL);
+  nearby_test_fakes_SetAccountKeys(account_keys);
+  nearby_test_fakes_SetRandomNumber(salt);
+  nearby_fp_LoadAccountKeys();
+  nearby_fp_CreateNondiscoverableAdvertisement(buffer, kBufferSize, false);
+  nearby_fp_SetBloomFilter(buffer, kRegularBloomFormat, kNoInUseKey);
+
+  nearby_fp_AddAccountKey(&account_key2);
+  size_t written =
+      nearby_fp_CreateNondiscoverableAdvertisement(buffer, kBufferSize, false);
+  nearby_fp_SetBloomFilter(buffer, kRegularBloomFormat, kNoInUseKey);
+  written += nearby_fp_AppendTxPower(buffer + written, kBufferSize - written,
+                                     kTxPower);
+
+  ASSERT_EQ(kBufferSize, written);
+  ASSERT_THAT(std::vector<uint8_t>(buffer, buffer + kBufferSize),
+              ElementsAreArray(kExpectedResult, kBufferSize));
+}
+
+TEST(NearbyFpClient,
+     AdvertisementNondiscoverable_keyEvicted_matchesReloadedKeys) {
+  uint8_t salt = 0xC7;
+  std::vector<AccountKeyPair> account_keys;
+  for (uint8_t i = 0; i < NEARBY_MAX_ACCOUNT_KEYS; i++) {
+    account_keys.push_back(AccountKeyPair(
+        kRemoteDevice, std::vector<uint8_t>(ACCOUNT_KEY_SIZE_BYTES, 0x10 + i)));
+  }
+  nearby_platform_AccountKeyInfo new_key = {};
+  memset(new_key.account_key, 0x42, ACCOUNT_KEY_SIZE_BYTES);
+  uint8_t buffer[64];
+  nearby_fp_client_Init(NULL);
+  nearby_test_fakes_SetAccountKeys(account_keys);
+  nearby_test_fakes_SetRandomNumber(salt);
+  nearby_fp_LoadAccountKeys();
+  nearby_fp_CreateNondiscoverableAdvertisement(buffer, sizeof(buffer), false);
+  nearby_fp_SetBloomFilter(buffer, kRegularBloomFormat, kNoInUseKey);
+
+  // The list is full, so the last key falls off.
+  nearby_fp_AddAccountKey(&new_key);
+  size_t written = nearby_fp_CreateNondiscoverableAdvertisement(
+      buffer, sizeof(buffer), false);
+  nearby_fp_SetBloomFilter(buffer, kRegularBloomFormat, kNoInUseKey);
+
+  // The same keys loaded from storage, hashed from scratch.
+  account_keys.pop_back();
+  account_keys.insert(account_keys.begin(),
+                      AccountKeyPair(kRemoteDevice, new_key.account_key));
+  nearby_test_fakes_SetAccountKeys(account_keys);
+  nearby_fp_LoadAccountKeys();
+  uint8_t expected[64];
+  size_t expected_written = nearby_fp_CreateNondiscoverableAdvertisement(
+      expected, sizeof(expected), false);
+  nearby_fp_SetBloomFilter(expected, kRegularBloomFormat, kNoInUseKey);
+
+  ASSERT_EQ(expected_written, written);
+  ASSERT_THAT(std::vector<uint8_t>(buffer, buffer + written),
+              ElementsAreArray(expected, expected_written));
+}
+
+TEST(NearbyFpClient, UniqueAccountKeys_followKeyListChanges) {
+  constexpr uint64_t kOtherAddress = 0x505050505050;
+  uint8_t account_key1[] = {0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88,
+                            0x99, 0x00, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF};
+  uint8_t account_key2[] = {0x11, 0x11, 0x22, 0x22, 0x33, 0x33, 0x44, 0x44,
+                            0x55, 0x55, 0x66, 0x66, 0x77, 0x77, 0x88, 0x88};
+  nearby_platform_AccountKeyInfo account_key3 = {
+      .account_key = {0x03, 0x13, 0x23, 0x33, 0x43, 0x53, 0x63, 0x73, 0x83,
+                      0x93, 0xA3, 0xB3, 0xC3, 0xD3, 0xE3, 0xF3}};
+  std::vector<AccountKeyPair> account_keys{
+      AccountKeyPair(kRemoteDevice, account_key1),
+      AccountKeyPair(kRemoteDevice, account_key2),
+      AccountKeyPair(kOtherAddress, account_key1),
+  };
+  nearby_fp_client_Init(NULL);
+  nearby_test_fakes_SetAccountKeys(account_keys);
+  nearby_fp_LoadAccountKeys();
+
+  ASSERT_EQ(2, nearby_fp_GetUniqueAccountKeyCount());
+  ASSERT_EQ(0, nearby_fp_GetNextUniqueAccountKeyIndex(0));
+  ASSERT_EQ(1, nearby_fp_GetNextUniqueAccountKeyIndex(1));
+  ASSERT_EQ(-1, nearby_fp_GetNextUniqueAccountKeyIndex(2));
+
+  // account_key1, account_key1, account_key2
+  nearby_fp_MarkAccountKeyAsActive(2);
+  ASSERT_EQ(2, nearby_fp_GetUniqueAccountKeyCount());
+  ASSERT_EQ(0, nearby_fp_GetNextUniqueAccountKeyIndex(0));
+  ASSERT_EQ(2, nearby_fp_GetNextUniqueAccountKeyIndex(1));
+  ASSERT_EQ(-1, nearby_fp_GetNextUniqueAccountKeyIndex(3));
+
+  nearby_fp_AddAccountKey(&account_key3);
+  ASSERT_EQ(3, nearby_fp_GetUniqueAccountKeyCount());
+  ASSERT_EQ(3, nearby_fp_GetNextUniqueAccountKeyIndex(2));
+}
+
+TEST(NearbyFpClient, KeyBasedPairing_MatchingKey_BecomesMostRecentlyUsed) {
+  uint8_t account_key3[] = {0x03, 0x13, 0x23, 0x33, 0x43, 0x53, 0x63, 0x73,
+                            0x83, 0x93, 0xA3, 0xB3, 0xC3, 0xD3, 0xE3, 0xF3};
+  nearby_fp_client_Init(NULL);
+  Set5AccountKeys();
+  nearby_fp_LoadAccountKeys();
+  uint8_t request[16] = {
+      // key-based pairing request
+      0x00, 0x00,
+      // Provider's public address
+      0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5,
+      // Seeker's address
+      0xB0, 0xB1, 0xB2, 0xB3, 0xB4, 0xB5,
+      // salt
+      0xCD, 0xEF};
+  uint8_t encrypted[16];
+  nearby_test_fakes_Aes128Encrypt(request, encrypted, account_key3);
+
+  ASSERT_EQ(kNearbyStatusOK, nearby_fp_fakes_ReceiveKeyBasedPairingRequest(
+                                 encrypted, sizeof(encrypted)));
+
+  auto keys = nearby_test_fakes_GetAccountKeys();
+  ASSERT_EQ(5, keys.size());
+  ASSERT_THAT(keys.GetKey(0), ElementsAreArray(account_key3));
+}
+
 TEST(NearbyFpClient, GattReadModelId) {
   uint8_t buffer[3];
   size_t length = sizeof(buffer);
@@ -95,7 +95,55 @@ static const uint8_t kSassRrdKey[] = {'S', 'A', 'S', 'S', '-', 'R',
 
 static AccountKeyList account_key_list;
 
-static uint8_t sha_buffer[32];
+// Indices of the first occurrence of every account key in the key list, in
+// list order. Rebuilt on first use after the list changes.
+static uint8_t unique_key_index[NEARBY_MAX_ACCOUNT_KEYS];
+static uint8_t unique_key_count;
+static bool unique_key_index_valid;
+
+// Longest input hashed after the account key in the bloom filter: salt,
+// battery info and random resolvable field, each at most a full LTV.
+#define MAX_BLOOM_FILTER_SALT_SIZE (3 * (0x0F + 1))
+
+// The SHA256 hash of one account key, as used in the bloom filter.
+typedef struct {
+  // The first byte of the key with the SASS flags applied.
+  uint8_t flags;
+  uint8_t account_key[ACCOUNT_KEY_SIZE_BYTES];
+  uint8_t hash[SHA256_KEY_SIZE];
+} BloomFilterHash;
+
+// Hashes of the unique account keys from the last bloom filter. They stay
+// valid for as long as the rest of the hashed input is the same, so that a
+// filter rebuilt after adding or reordering keys only hashes the keys that
+// changed.
+static struct {
+  uint8_t salt[MAX_BLOOM_FILTER_SALT_SIZE];
+  size_t salt_length;
+  size_t num_hashes;
+  BloomFilterHash hashes[NEARBY_MAX_ACCOUNT_KEYS];
+} bloom_filter_cache;
+
+// Drops every cached hash, wiping the account keys kept with them.
+static void ClearBloomFilterCache() {
+  memset(&bloom_filter_cache, 0, sizeof(bloom_filter_cache));
+}
+
+// Drops the cached hashes of |key|, e.g. after it fell off the key list.
+static void DropBloomFilterHashes(const uint8_t* key) {
+  size_t i = 0;
+  while (i < bloom_filter_cache.num_hashes) {
+    BloomFilterHash* entry = &bloom_filter_cache.hashes[i];
+    if (memcmp(entry->account_key, key, ACCOUNT_KEY_SIZE_BYTES)) {
+      i++;
+      continue;
+    }
+    BloomFilterHash* last =
+        &bloom_filter_cache.hashes[--bloom_filter_cache.num_hashes];
+    if (entry != last) *entry = *last;
+    memset(last, 0, sizeof(*last));
+  }
+}
 
 #define RETURN_IF_ERROR(X)                        \
   do {                                            \
@@ -135,28 +183,29 @@ static bool IsAccountKeyInRange(const uint8_t* account_key, size_t end_offset) {
   return false;
 }
 
+static void UpdateUniqueKeyIndex() {
+  if (unique_key_index_valid) return;
+  unique_key_count = 0;
+  for (size_t i = 0; i < nearby_fp_GetAccountKeyCount(); i++) {
+    if (!IsAccountKeyInRange(nearby_fp_GetAccountKey(i)->account_key, i)) {
+      unique_key_index[unique_key_count++] = i;
+    }
+  }
+  unique_key_index_valid = true;
+}
+
 size_t nearby_fp_GetAccountKeyCount() { return account_key_list.num_keys; }
 
 size_t nearby_fp_GetUniqueAccountKeyCount() {
-  size_t count = 0;
-  int offset = 0;
-  while (true) {
-    offset = nearby_fp_GetNextUniqueAccountKeyIndex(offset);
-    if (offset == -1) break;
-    count++;
-    offset++;
-  }
-  return count;
+  UpdateUniqueKeyIndex();
+  return unique_key_count;
 }
 
 int nearby_fp_GetNextUniqueAccountKeyIndex(int offset) {
-  while (offset < nearby_fp_GetAccountKeyCount()) {
-    const nearby_platform_AccountKeyInfo* account_key_info =
-        nearby_fp_GetAccountKey(offset);
-    if (IsAccountKeyInRange(account_key_info->account_key, offset)) {
-      offset++;
-    } else {
-      return offset;
+  UpdateUniqueKeyIndex();
+  for (size_t i = 0; i < unique_key_count; i++) {
+    if (unique_key_index[i] >= offset) {
+      return unique_key_index[i];
     }
   }
   return -1;
@@ -177,6 +226,7 @@ void nearby_fp_MarkAccountKeyAsActive(unsigned key_number) {
     account_key_list.key[i] = account_key_list.key[i - 1];
   }
   account_key_list.key[0] = tmp;
+  unique_key_index_valid = false;
 }
 
 void nearby_fp_CopyAccountKey(nearby_platform_AccountKeyInfo* dest,
@@ -216,6 +266,9 @@ void nearby_fp_AddAccountKey(const nearby_platform_AccountKeyInfo* key) {
   size_t keys_to_copy = key_count < NEARBY_MAX_ACCOUNT_KEYS
                             ? key_count
                             : NEARBY_MAX_ACCOUNT_KEYS - 1;
+  if (keys_to_copy < key_count) {
+    DropBloomFilterHashes(account_key_list.key[keys_to_copy].account_key);
+  }
   for (i = keys_to_copy; i > 0; i--) {
     account_key_list.key[i] = account_key_list.key[i - 1];
   }
@@ -223,6 +276,7 @@ void nearby_fp_AddAccountKey(const nearby_platform_AccountKeyInfo* key) {
   if (key_count < NEARBY_MAX_ACCOUNT_KEYS) {
     account_key_list.num_keys++;
   }
+  unique_key_index_valid = false;
 }
 size_t nearby_fp_CreateDiscoverableAdvertisement(uint8_t* output,
                                                  size_t length) {
@@ -374,65 +428,128 @@ static const uint8_t* FindBatteryInfoLt(const uint8_t* advertisement) {
   return battery_info;
 }
 
+// Appends |length| bytes of |data| to the bloom filter salt.
+static void AppendBloomFilterSalt(uint8_t* salt, size_t* salt_length,
+                                  const uint8_t* data, size_t length) {
+  NEARBY_ASSERT(*salt_length + length <= MAX_BLOOM_FILTER_SALT_SIZE);
+  if (length == 0) return;
+  memcpy(salt + *salt_length, data, length);
+  *salt_length += length;
+}
+
+// Drops the cached key hashes unless they were computed with |salt|.
+static void SetBloomFilterSalt(const uint8_t* salt, size_t salt_length) {
+  if (bloom_filter_cache.salt_length == salt_length &&
+      !memcmp(bloom_filter_cache.salt, salt, salt_length)) {
+    return;
+  }
+  ClearBloomFilterCache();
+  memcpy(bloom_filter_cache.salt, salt, salt_length);
+  bloom_filter_cache.salt_length = salt_length;
+}
+
+// Returns the index of the cached hash of |key| with |flags|, or -1.
+static int FindBloomFilterHash(const uint8_t* key, uint8_t flags) {
+  for (size_t i = 0; i < bloom_filter_cache.num_hashes; i++) {
+    const BloomFilterHash* entry = &bloom_filter_cache.hashes[i];
+    if (entry->flags == flags &&
+        !memcmp(entry->account_key, key, ACCOUNT_KEY_SIZE_BYTES)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static void ComputeBloomFilterHash(BloomFilterHash* entry, const uint8_t* key,
+                                   uint8_t flags) {
+  entry->flags = flags;
+  memcpy(entry->account_key, key, ACCOUNT_KEY_SIZE_BYTES);
+  nearby_platform_Sha256Start();
+  nearby_platform_Sha256Update(&flags, sizeof(flags));
+  nearby_platform_Sha256Update(key + sizeof(flags),
+                               ACCOUNT_KEY_SIZE_BYTES - sizeof(flags));
+  nearby_platform_Sha256Update(bloom_filter_cache.salt,
+                               bloom_filter_cache.salt_length);
+  nearby_platform_Sha256Finish(entry->hash);
+}
+
 size_t nearby_fp_SetBloomFilter(uint8_t* advertisement, bool use_sass_format,
                                 const uint8_t* in_use_key) {
-  unsigned key_offset = 0;
   if (advertisement[ACCOUNT_KEY_DATA_OFFSET] == 0) {
     NEARBY_TRACE(INFO, "Empty account key filter");
     return 0;
   }
-  // Salt is mandatory and is included in the calculation without the LT header
+  // Everything hashed after the account key. Salt is mandatory and is included
+  // without the LT header. Battery info and random resolvable field are
+  // optional and are included with the LT header.
+  uint8_t salt[MAX_BLOOM_FILTER_SALT_SIZE];
+  size_t salt_length = 0;
   const uint8_t* salt_field = nearby_fp_FindLtv(advertisement, SALT_FIELD_TYPE);
   NEARBY_ASSERT(salt_field != NULL);
-  const uint8_t* salt = salt_field + LTV_HEADER_SIZE;
-  int salt_length = GetLtLength(*salt_field);
-  // Battery info is optional and is included in the calculation with the LT
-  // header
+  AppendBloomFilterSalt(salt, &salt_length, salt_field + LTV_HEADER_SIZE,
+                        GetLtLength(*salt_field));
   const uint8_t* battery_info_field = FindBatteryInfoLt(advertisement);
-  int battery_info_field_length =
-      battery_info_field != NULL
-          ? GetLtLength(*battery_info_field) + LTV_HEADER_SIZE
-          : 0;
-  // Random resolvable field is optional and is included in the calculation with
-  // the LT header
+  if (battery_info_field != NULL) {
+    AppendBloomFilterSalt(salt, &salt_length, battery_info_field,
+                          GetLtLength(*battery_info_field) + LTV_HEADER_SIZE);
+  }
   const uint8_t* random_resolvable_field =
       nearby_fp_FindLtv(advertisement, RANDOM_RESOLVABLE_FIELD_TYPE);
-  int random_resolvable_field_length =
-      random_resolvable_field != NULL
-          ? GetLtLength(*random_resolvable_field) + LTV_HEADER_SIZE
-          : 0;
+  if (random_resolvable_field != NULL) {
+    AppendBloomFilterSalt(
+        salt, &salt_length, random_resolvable_field,
+        GetLtLength(*random_resolvable_field) + LTV_HEADER_SIZE);
+  }
+  SetBloomFilterSalt(salt, salt_length);
+
   const size_t n = nearby_fp_GetUniqueAccountKeyCount();
   const size_t s = (6 * n + 15) / 5;
   NEARBY_ASSERT(s == GetLtLength(advertisement[ACCOUNT_KEY_DATA_OFFSET]));
-  uint8_t* output = advertisement + ACCOUNT_KEY_DATA_OFFSET + LTV_HEADER_SIZE;
-  memset(output, 0, s);
+  uint8_t flags[NEARBY_MAX_ACCOUNT_KEYS];
+  int hash_index[NEARBY_MAX_ACCOUNT_KEYS];
+  bool hash_in_use[NEARBY_MAX_ACCOUNT_KEYS] = {false};
+  // Find the keys whose hashes are still cached first, so that the ones that
+  // need hashing don't overwrite them.
   for (size_t k = 0; k < n; k++) {
-    key_offset = nearby_fp_GetNextUniqueAccountKeyIndex(key_offset);
-    NEARBY_ASSERT(key_offset >= 0);
-    const uint8_t* key = nearby_fp_GetAccountKey(key_offset)->account_key;
-    uint8_t flags = key[0];
+    const uint8_t* key =
+        nearby_fp_GetAccountKey(unique_key_index[k])->account_key;
+    flags[k] = key[0];
     if (use_sass_format) {
       if (in_use_key != NULL) {
         if (!memcmp(key, in_use_key, ACCOUNT_KEY_SIZE_BYTES)) {
-          flags |= IN_USE_ACCOUNT_KEY_BIT;
+          flags[k] |= IN_USE_ACCOUNT_KEY_BIT;
         }
       } else if (k == 0) {
         // The first key is the most recently used one
-        flags |= MOST_RECENTLY_USED_ACCOUNT_KEY_BIT;
+        flags[k] |= MOST_RECENTLY_USED_ACCOUNT_KEY_BIT;
       }
     }
-    key_offset++;
-    nearby_platform_Sha256Start();
-    nearby_platform_Sha256Update(&flags, sizeof(flags));
-    nearby_platform_Sha256Update(key + sizeof(flags),
-                                 ACCOUNT_KEY_SIZE_BYTES - sizeof(flags));
-    nearby_platform_Sha256Update(salt, salt_length);
-    nearby_platform_Sha256Update(battery_info_field, battery_info_field_length);
-    nearby_platform_Sha256Update(random_resolvable_field,
-                                 random_resolvable_field_length);
-    nearby_platform_Sha256Finish(sha_buffer);
+    hash_index[k] = FindBloomFilterHash(key, flags[k]);
+    if (hash_index[k] != -1) {
+      hash_in_use[hash_index[k]] = true;
+    }
+  }
+  size_t free_slot = 0;
+  for (size_t k = 0; k < n; k++) {
+    if (hash_index[k] != -1) continue;
+    while (hash_in_use[free_slot]) free_slot++;
+    NEARBY_ASSERT(free_slot < NEARBY_MAX_ACCOUNT_KEYS);
+    ComputeBloomFilterHash(
+        &bloom_filter_cache.hashes[free_slot],
+        nearby_fp_GetAccountKey(unique_key_index[k])->account_key, flags[k]);
+    hash_in_use[free_slot] = true;
+    hash_index[k] = free_slot;
+    if (free_slot >= bloom_filter_cache.num_hashes) {
+      bloom_filter_cache.num_hashes = free_slot + 1;
+    }
+  }
+
+  uint8_t* output = advertisement + ACCOUNT_KEY_DATA_OFFSET + LTV_HEADER_SIZE;
+  memset(output, 0, s);
+  for (size_t k = 0; k < n; k++) {
+    uint8_t* hash = bloom_filter_cache.hashes[hash_index[k]].hash;
     for (unsigned j = 0; j < 8; j++) {
-      uint32_t x = nearby_utils_GetBigEndian32(sha_buffer + 4 * j);
+      uint32_t x = nearby_utils_GetBigEndian32(hash + 4 * j);
       uint32_t m = x % (s * 8);
       output[m / 8] |= (1 << (m % 8));
     }
@@ -461,6 +578,8 @@ size_t nearby_fp_AppendTxPower(uint8_t* advertisement, size_t length,
 nearby_platform_status nearby_fp_LoadAccountKeys() {
   size_t length = sizeof(account_key_list);
   memset(&account_key_list, 0, length);
+  unique_key_index_valid = false;
+  ClearBloomFilterCache();
   return nearby_platform_LoadValue(kStoredKeyAccountKeyList,
                                    (uint8_t*)&account_key_list, &length);
 }
@@ -120,3 +120,36 @@ tests: $(TEST_BINARIES)
 
 run_tests : tests
 .PHONY : tests run_tests
+
+# Host-side benchmarks. Build with OPTIMIZED_BUILD=1 for meaningful numbers.
+BENCHMARK_SRCS := $(wildcard client/tests/benchmarks/*.cc)
+BENCHMARK_OBJS := $(patsubst %.cc,$(OUT_DIR)/%.o,$(BENCHMARK_SRCS))
+BENCHMARK_BINARIES = $(patsubst %.cc,$(OUT_DIR)/%,$(BENCHMARK_SRCS))
+BENCHMARKS_TO_RUN = $(patsubst %.cc,$(OUT_DIR)/%_run,$(BENCHMARK_SRCS))
+.PHONY: $(BENCHMARKS_TO_RUN)
+
+$(BENCHMARK_OBJS) : $(OUT_DIR)/%.o: %.cc
+	$(call compile_c,$(TEST_INCLUDES) -I. -std=c++14 $(CFLAGS))
+
+ALL_OBJS += $(BENCHMARK_OBJS)
+-include $(BENCHMARK_OBJS:.o=.d)
+
+$(BENCHMARK_BINARIES) : $(NAME) $(TARGET_OS_OBJS)
+$(BENCHMARK_BINARIES) : % : %.o
+	mkdir -p $(dir $@)
+	$(CC) -o $@ $< \
+		$(CFLAGS) \
+		$(TARGET_OS_OBJS) \
+		-L /usr/local/lib \
+		-std=c++14 \
+		-lbenchmark_main -lbenchmark \
+		$(LIBS)
+
+$(BENCHMARKS_TO_RUN) : %_run : %
+	./$<
+
+benchmarks: $(BENCHMARK_BINARIES)
+
+run_benchmarks: $(BENCHMARKS_TO_RUN)
+
+.PHONY : benchmarks run_benchmarks
@@ -58,10 +58,21 @@ class DataSet {
       absl::string_view key,
       absl::AnyInvocable<void(bool, std::unique_ptr<T>) &&> callback) = 0;
 
+  // Asynchronously visits, in key order, the entries whose key starts with
+  // `key_prefix` and invokes `callback` when complete. Only keys after
+  // `start_after` are visited when it's non-empty, so a scan that stopped
+  // early can resume from the last key it saw. `visitor` returns false to stop
+  // the scan; the value it's passed is only valid for the duration of the
+  // call.
+  virtual void VisitEntries(
+      absl::string_view key_prefix, absl::string_view start_after,
+      absl::AnyInvocable<bool(absl::string_view key, const T& value)> visitor,
+      absl::AnyInvocable<void(bool) &&> callback) = 0;
+
   // Asynchronously saves `entries_to_save` and deletes entries from
-  // `keys_to_remove` from the database. `callback` will be invoked on the
-  // calling thread when complete. `entries_to_save` and `keys_to_remove` must
-  // be non-null.
+  // `keys_to_remove` from the database, as a single atomic write. `callback`
+  // will be invoked on the calling thread when complete. `entries_to_save` and
+  // `keys_to_remove` must be non-null.
   virtual void UpdateEntries(
       std::unique_ptr<KeyEntryVector> entries_to_save,
       std::unique_ptr<std::vector<std::string>> keys_to_remove,
@@ -22,12 +22,14 @@
 #include <vector>
 
 #include "absl/functional/any_invocable.h"
+#include "absl/strings/match.h"
 #include "absl/strings/string_view.h"
 #include "third_party/leveldb/include/db.h"
 #include "third_party/leveldb/include/iterator.h"
 #include "third_party/leveldb/include/options.h"
 #include "third_party/leveldb/include/slice.h"
 #include "third_party/leveldb/include/status.h"
+#include "third_party/leveldb/include/write_batch.h"
 #include "internal/data/data_set.h"
 #include "internal/platform/logging.h"
 #include "google/protobuf/message_lite.h"
@@ -58,12 +60,19 @@ class LeveldbDataSet : public DataSet<T> {
           void(bool,
                std::unique_ptr<std::vector<std::pair<std::string, T>>>) &&>
           callback);
+  void VisitEntries(
+      absl::string_view key_prefix, absl::string_view start_after,
+      absl::AnyInvocable<bool(absl::string_view key, const T& value)> visitor,
+      absl::AnyInvocable<void(bool) &&> callback) override;
   void UpdateEntries(std::unique_ptr<KeyEntryVector> entries_to_save,
                      std::unique_ptr<std::vector<std::string>> keys_to_remove,
                      absl::AnyInvocable<void(bool) &&> callback) override;
   void Destroy(absl::AnyInvocable<void(bool) &&> callback) override;
 
  private:
+  static absl::string_view ToStringView(const leveldb::Slice& slice) {
+    return absl::string_view(slice.data(), slice.size());
+  }
   void Serialize(T const& value, std::string& str);
   void Deserialize(absl::string_view str, T& value);
 
@@ -115,9 +124,7 @@ void LeveldbDataSet<T, isMessageLite>::LoadEntries(
       db_->NewIterator(leveldb::ReadOptions()));
 
   for (it->SeekToFirst(); it->Valid(); it->Next()) {
-    T value;
-    Deserialize(it->value().ToString(), value);
-    result->push_back(value);
+    Deserialize(ToStringView(it->value()), result->emplace_back());
   }
 
   if (it->status().ok()) {
@@ -169,9 +176,9 @@ void LeveldbDataSet<T, isMessageLite>::LoadEntriesWithKeys(
       db_->NewIterator(leveldb::ReadOptions()));
 
   for (it->SeekToFirst(); it->Valid(); it->Next()) {
-    T value;
-    Deserialize(it->value().ToString(), value);
-    result->push_back({it->key().ToString(), value});
+    auto& [key, value] = result->emplace_back();
+    key.assign(it->key().data(), it->key().size());
+    Deserialize(ToStringView(it->value()), value);
   }
 
   if (it->status().ok()) {
@@ -184,6 +191,47 @@ void LeveldbDataSet<T, isMessageLite>::LoadEntriesWithKeys(
   }
 }
 
+template <typename T,
+          std::enable_if_t<std::is_base_of<proto2::MessageLite, T>::value, bool>
+              isMessageLite>
+void LeveldbDataSet<T, isMessageLite>::VisitEntries(
+    absl::string_view key_prefix, absl::string_view start_after,
+    absl::AnyInvocable<bool(absl::string_view key, const T& value)> visitor,
+    absl::AnyInvocable<void(bool) &&> callback) {
+  if (status_ != InitStatus::kOK) {
+    std::move(callback)(false);
+    return;
+  }
+
+  std::unique_ptr<leveldb::Iterator> it(
+      db_->NewIterator(leveldb::ReadOptions()));
+
+  if (start_after.empty() || start_after < key_prefix) {
+    it->Seek(leveldb::Slice(key_prefix.data(), key_prefix.size()));
+  } else {
+    it->Seek(leveldb::Slice(start_after.data(), start_after.size()));
+    if (it->Valid() && ToStringView(it->key()) == start_after) {
+      it->Next();
+    }
+  }
+
+  // Reused across entries so that visiting doesn't allocate a message per
+  // entry.
+  T value;
+  for (; it->Valid(); it->Next()) {
+    absl::string_view key = ToStringView(it->key());
+    if (!absl::StartsWith(key, key_prefix)) break;
+    value.Clear();
+    Deserialize(ToStringView(it->value()), value);
+    if (!visitor(key, value)) break;
+  }
+
+  if (!it->status().ok()) {
+    LOG(INFO) << "Failed to visit entries in database.";
+  }
+  std::move(callback)(it->status().ok());
+}
+
 template <typename T,
           std::enable_if_t<std::is_base_of<proto2::MessageLite, T>::value, bool>
               isMessageLite>
@@ -197,21 +245,26 @@ void LeveldbDataSet<T, isMessageLite>::UpdateEntries(
     return;
   }
 
+  leveldb::WriteBatch batch;
   if (entries_to_save != nullptr) {
+    std::string str;
     for (const auto& [key, value] : *entries_to_save) {
-      std::string str;
       Serialize(value, str);
-      db_->Put(leveldb::WriteOptions(), key, leveldb::Slice(str));
+      batch.Put(key, leveldb::Slice(str));
     }
   }
 
   if (keys_to_remove != nullptr) {
     for (const auto& it : *keys_to_remove) {
-      db_->Delete(leveldb::WriteOptions(), it);
+      batch.Delete(it);
     }
   }
 
-  std::move(callback)(true);
+  leveldb::Status status = db_->Write(leveldb::WriteOptions(), &batch);
+  if (!status.ok()) {
+    LOG(INFO) << "Failed to update entries in database.";
+  }
+  std::move(callback)(status.ok());
 }
 
 template <typename T,
@@ -0,0 +1,164 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>  // NOLINT(build/c++17)
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "third_party/leveldb/include/db.h"
+#include "third_party/leveldb/include/options.h"
+#include "third_party/leveldb/include/slice.h"
+#include "internal/data/data_set.h"
+#include "internal/data/leveldb_data_set.h"
+#include "internal/data/leveldb_data_set_test.proto.h"
+
+namespace nearby::data {
+namespace {
+
+constexpr int kCertificateCount = 10000;
+constexpr absl::string_view kCertificatePrefix = "certificate_";
+
+std::filesystem::path BenchmarkPath(absl::string_view name) {
+  return std::filesystem::temp_directory_path() /
+         absl::StrCat("nearby_db_benchmark_", name);
+}
+
+TestCertificate MakeCertificate(int index) {
+  TestCertificate certificate;
+  certificate.set_secret_id(absl::StrCat("secret_id_", index));
+  certificate.set_secret_key(std::string(32, 'k'));
+  certificate.set_public_key(std::string(91, 'p'));
+  certificate.set_start_time_millis(1700000000000 + index);
+  certificate.set_end_time_millis(1700000000000 + index + 86400000);
+  certificate.set_encrypted_metadata_bytes(std::string(200, 'm'));
+  certificate.set_metadata_encryption_key_tag(std::string(32, 't'));
+  return certificate;
+}
+
+std::unique_ptr<LeveldbDataSet<TestCertificate>::KeyEntryVector>
+MakeCertificates() {
+  auto certificates =
+      std::make_unique<LeveldbDataSet<TestCertificate>::KeyEntryVector>();
+  certificates->reserve(kCertificateCount);
+  for (int i = 0; i < kCertificateCount; ++i) {
+    certificates->push_back(
+        {absl::StrCat(kCertificatePrefix, i), MakeCertificate(i)});
+  }
+  return certificates;
+}
+
+// LeveldbDataSet calls its callbacks synchronously.
+std::unique_ptr<LeveldbDataSet<TestCertificate>> CreateStore(
+    const std::filesystem::path& path, bool populate) {
+  std::filesystem::remove_all(path);
+  auto store = std::make_unique<LeveldbDataSet<TestCertificate>>(path.string());
+  store->Initialize([](InitStatus) {});
+  if (populate) {
+    store->UpdateEntries(MakeCertificates(),
+                         std::make_unique<std::vector<std::string>>(),
+                         [](bool) {});
+  }
+  return store;
+}
+
+void DestroyStore(std::unique_ptr<LeveldbDataSet<TestCertificate>> store,
+                  const std::filesystem::path& path) {
+  store->Destroy([](bool) {});
+  store.reset();
+  std::filesystem::remove_all(path);
+}
+
+// Replacing the whole certificate store, as a single batch.
+void BM_UpdateEntries(benchmark::State& state) {
+  std::filesystem::path path = BenchmarkPath("update");
+  auto store = CreateStore(path, /*populate=*/false);
+  for (auto _ : state) {
+    store->UpdateEntries(MakeCertificates(),
+                         std::make_unique<std::vector<std::string>>(),
+                         [](bool success) { benchmark::DoNotOptimize(success); });
+  }
+  state.SetItemsProcessed(state.iterations() * kCertificateCount);
+  DestroyStore(std::move(store), path);
+}
+
+// The same update written one Put() at a time, as UpdateEntries() used to.
+void BM_UpdateEntriesPerEntry(benchmark::State& state) {
+  std::filesystem::path path = BenchmarkPath("update_per_entry");
+  std::filesystem::remove_all(path);
+  leveldb::Options options;
+  options.create_if_missing = true;
+  leveldb::DB* db;
+  leveldb::DB::Open(options, path.string(), &db);
+  std::unique_ptr<leveldb::DB> db_owner(db);
+  for (auto _ : state) {
+    auto certificates = MakeCertificates();
+    std::string str;
+    for (const auto& [key, value] : *certificates) {
+      value.SerializeToString(&str);
+      db->Put(leveldb::WriteOptions(), key, leveldb::Slice(str));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kCertificateCount);
+  db_owner.reset();
+  leveldb::DestroyDB(path.string(), leveldb::Options());
+  std::filesystem::remove_all(path);
+}
+
+void BM_LoadEntriesWithKeys(benchmark::State& state) {
+  std::filesystem::path path = BenchmarkPath("load");
+  auto store = CreateStore(path, /*populate=*/true);
+  for (auto _ : state) {
+    store->LoadEntriesWithKeys(
+        [](bool success,
+           std::unique_ptr<std::vector<std::pair<std::string, TestCertificate>>>
+               entries) { benchmark::DoNotOptimize(entries->size()); });
+  }
+  state.SetItemsProcessed(state.iterations() * kCertificateCount);
+  DestroyStore(std::move(store), path);
+}
+
+void BM_VisitEntries(benchmark::State& state) {
+  std::filesystem::path path = BenchmarkPath("visit");
+  auto store = CreateStore(path, /*populate=*/true);
+  for (auto _ : state) {
+    std::int64_t end_time_millis = 0;
+    store->VisitEntries(
+        kCertificatePrefix, /*start_after=*/"",
+        [&end_time_millis](absl::string_view key,
+                           const TestCertificate& certificate) {
+          end_time_millis =
+              std::max(end_time_millis, certificate.end_time_millis());
+          return true;
+        },
+        [](bool success) { benchmark::DoNotOptimize(success); });
+    benchmark::DoNotOptimize(end_time_millis);
+  }
+  state.SetItemsProcessed(state.iterations() * kCertificateCount);
+  DestroyStore(std::move(store), path);
+}
+
+BENCHMARK(BM_UpdateEntries)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_UpdateEntriesPerEntry)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LoadEntriesWithKeys)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_VisitEntries)->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace nearby::data
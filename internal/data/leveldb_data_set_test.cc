@@ -14,6 +14,7 @@
 
 #include "internal/data/leveldb_data_set.h"
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include <filesystem>  // NOLINT(build/c++17)
@@ -29,6 +30,8 @@
 #include "protobuf-matchers/protocol-buffer-matchers.h"
 #include "gtest/gtest.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 #include "absl/synchronization/notification.h"
 #include "absl/time/time.h"
 #include "internal/data/data_set.h"
@@ -127,6 +130,23 @@ absl::flat_hash_map<std::string, T> LoadEntriesWithKeysAndWait(
   return entry_map;
 }
 
+template <typename T>
+std::vector<std::pair<std::string, T>> VisitEntriesAndWait(
+    std::unique_ptr<LeveldbDataSet<T>>& dataset, absl::string_view key_prefix,
+    absl::string_view start_after, size_t max_entries) {
+  std::vector<std::pair<std::string, T>> result;
+  absl::Notification notification;
+  dataset->VisitEntries(
+      key_prefix, start_after,
+      [&result, max_entries](absl::string_view key, const T& value) {
+        result.push_back({std::string(key), value});
+        return result.size() < max_entries;
+      },
+      [&notification](bool) { notification.Notify(); });
+  notification.WaitForNotificationWithTimeout(absl::Seconds(5));
+  return result;
+}
+
 template <typename T>
 void WipeCleanAndWait(std::unique_ptr<LeveldbDataSet<T>>& dataset,
                       std::filesystem::path path) {
@@ -283,5 +303,58 @@ TEST(LeveldbDataSet, RemoveEntriesDiceRoll) {
   EXPECT_EQ(result["id4"].nickname(), diceroll4.nickname());
 }
 
+TEST(LeveldbDataSet, VisitEntriesWithPrefix) {
+  std::filesystem::path path = GenerateLeveldbPath();
+  std::unique_ptr<LeveldbDataSet<DiceRoll>> diceroll_set =
+      CreateDataSet<DiceRoll>(path);
+
+  InitializeAndWait(diceroll_set);
+
+  auto entries = std::make_unique<LeveldbDataSet<DiceRoll>::KeyEntryVector>(
+      LeveldbDataSet<DiceRoll>::KeyEntryVector({{"a1", GenerateDiceRoll(2)},
+                                                {"b1", GenerateDiceRoll(5)},
+                                                {"b2", GenerateDiceRoll(12)},
+                                                {"c1", GenerateDiceRoll(7)}}));
+  UpdateEntriesAndWait(diceroll_set, std::move(entries), nullptr);
+
+  auto result = VisitEntriesAndWait(diceroll_set, "b", "", 10);
+  WipeCleanAndWait(diceroll_set, path);
+
+  ASSERT_THAT(result, SizeIs(2));
+  EXPECT_EQ(result[0].first, "b1");
+  EXPECT_EQ(result[0].second.value(), 5);
+  EXPECT_FALSE(result[0].second.has_nickname());
+  EXPECT_EQ(result[1].first, "b2");
+  EXPECT_EQ(result[1].second.value(), 12);
+  EXPECT_EQ(result[1].second.nickname(), "boxcars");
+}
+
+TEST(LeveldbDataSet, VisitEntriesInPages) {
+  std::filesystem::path path = GenerateLeveldbPath();
+  std::unique_ptr<LeveldbDataSet<DiceRoll>> diceroll_set =
+      CreateDataSet<DiceRoll>(path);
+
+  InitializeAndWait(diceroll_set);
+
+  auto entries = std::make_unique<LeveldbDataSet<DiceRoll>::KeyEntryVector>();
+  for (int i = 0; i < 5; ++i) {
+    entries->push_back({absl::StrCat("id", i), GenerateDiceRoll(i + 2)});
+  }
+  UpdateEntriesAndWait(diceroll_set, std::move(entries), nullptr);
+
+  auto first_page = VisitEntriesAndWait(diceroll_set, "id", "", 3);
+  ASSERT_THAT(first_page, SizeIs(3));
+  auto second_page =
+      VisitEntriesAndWait(diceroll_set, "id", first_page.back().first, 3);
+  WipeCleanAndWait(diceroll_set, path);
+
+  EXPECT_EQ(first_page[0].first, "id0");
+  EXPECT_EQ(first_page[2].first, "id2");
+  ASSERT_THAT(second_page, SizeIs(2));
+  EXPECT_EQ(second_page[0].first, "id3");
+  EXPECT_EQ(second_page[1].first, "id4");
+  EXPECT_EQ(second_page[1].second.value(), 6);
+}
+
 }  // namespace
 }  // namespace nearby::data
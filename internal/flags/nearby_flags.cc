@@ -14,8 +14,12 @@
 
 #include "internal/flags/nearby_flags.h"
 
+#include <atomic>
 #include <cstdint>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
@@ -29,98 +33,135 @@ NearbyFlags& NearbyFlags::GetInstance() {
   return *sharing_flags;
 }
 
-bool NearbyFlags::GetBoolFlag(const flags::Flag<bool>& flag) {
+NearbyFlags::NearbyFlags() {
+  snapshots_.push_back(std::make_unique<const Snapshot>());
+  snapshot_.store(snapshots_.back().get(), std::memory_order_release);
+}
+
+template <typename Update>
+void NearbyFlags::UpdateSnapshot(Update update) {
   absl::MutexLock lock(&mutex_);
+  Snapshot snapshot = GetSnapshot();
+  update(snapshot);
+  // Readers don't say when they're done with a snapshot, so none is freed.
+  // Republishing an equal one keeps them to one per distinct set of overrides,
+  // however often a test sets and resets the same values.
+  for (const std::unique_ptr<const Snapshot>& published : snapshots_) {
+    if (*published == snapshot) {
+      snapshot_.store(published.get(), std::memory_order_release);
+      return;
+    }
+  }
+  snapshots_.push_back(std::make_unique<const Snapshot>(std::move(snapshot)));
+  snapshot_.store(snapshots_.back().get(), std::memory_order_release);
+}
+
+bool NearbyFlags::GetBoolFlag(const flags::Flag<bool>& flag) {
+  const Snapshot& snapshot = GetSnapshot();
 
-  const auto& it = overrided_bool_flag_values_.find(flag.name());
-  if (it != overrided_bool_flag_values_.end()) {
-    return it->second;
+  if (!snapshot.overrided_bool_flag_values.empty()) {
+    const auto& it = snapshot.overrided_bool_flag_values.find(flag.name());
+    if (it != snapshot.overrided_bool_flag_values.end()) {
+      return it->second;
+    }
   }
 
-  if (flag_reader_ != nullptr) {
-    return flag_reader_->GetBoolFlag(flag);
+  if (snapshot.flag_reader != nullptr) {
+    return snapshot.flag_reader->GetBoolFlag(flag);
   }
   return default_flag_reader_.GetBoolFlag(flag);
 }
 
 int64_t NearbyFlags::GetInt64Flag(const flags::Flag<int64_t>& flag) {
-  absl::MutexLock lock(&mutex_);
+  const Snapshot& snapshot = GetSnapshot();
 
-  const auto& it = overrided_int64_flag_values_.find(flag.name());
-  if (it != overrided_int64_flag_values_.end()) {
-    return it->second;
+  if (!snapshot.overrided_int64_flag_values.empty()) {
+    const auto& it = snapshot.overrided_int64_flag_values.find(flag.name());
+    if (it != snapshot.overrided_int64_flag_values.end()) {
+      return it->second;
+    }
   }
 
-  if (flag_reader_ != nullptr) {
-    return flag_reader_->GetInt64Flag(flag);
+  if (snapshot.flag_reader != nullptr) {
+    return snapshot.flag_reader->GetInt64Flag(flag);
   }
   return default_flag_reader_.GetInt64Flag(flag);
 }
 
 double NearbyFlags::GetDoubleFlag(const flags::Flag<double>& flag) {
-  absl::MutexLock lock(&mutex_);
+  const Snapshot& snapshot = GetSnapshot();
 
-  const auto& it = overrided_double_flag_values_.find(flag.name());
-  if (it != overrided_double_flag_values_.end()) {
-    return it->second;
+  if (!snapshot.overrided_double_flag_values.empty()) {
+    const auto& it = snapshot.overrided_double_flag_values.find(flag.name());
+    if (it != snapshot.overrided_double_flag_values.end()) {
+      return it->second;
+    }
   }
 
-  if (flag_reader_ != nullptr) {
-    return flag_reader_->GetDoubleFlag(flag);
+  if (snapshot.flag_reader != nullptr) {
+    return snapshot.flag_reader->GetDoubleFlag(flag);
   }
   return default_flag_reader_.GetDoubleFlag(flag);
 }
 
 std::string NearbyFlags::GetStringFlag(
     const flags::Flag<absl::string_view>& flag) {
-  absl::MutexLock lock(&mutex_);
+  const Snapshot& snapshot = GetSnapshot();
 
-  const auto& it = overrided_string_flag_values_.find(flag.name());
-  if (it != overrided_string_flag_values_.end()) {
-    return it->second;
+  if (!snapshot.overrided_string_flag_values.empty()) {
+    const auto& it = snapshot.overrided_string_flag_values.find(flag.name());
+    if (it != snapshot.overrided_string_flag_values.end()) {
+      return it->second;
+    }
   }
 
-  if (flag_reader_ != nullptr) {
-    return flag_reader_->GetStringFlag(flag);
+  if (snapshot.flag_reader != nullptr) {
+    return snapshot.flag_reader->GetStringFlag(flag);
   }
   return default_flag_reader_.GetStringFlag(flag);
 }
 
 void NearbyFlags::SetFlagReader(flags::FlagReader& flag_reader) {
-  absl::MutexLock lock(&mutex_);
-  flag_reader_ = &flag_reader;
+  UpdateSnapshot(
+      [&](Snapshot& snapshot) { snapshot.flag_reader = &flag_reader; });
 }
 
 void NearbyFlags::OverrideBoolFlagValue(const flags::Flag<bool>& flag,
                                         bool new_value) {
-  absl::MutexLock lock(&mutex_);
-  overrided_bool_flag_values_[flag.name()] = new_value;
+  UpdateSnapshot([&](Snapshot& snapshot) {
+    snapshot.overrided_bool_flag_values[flag.name()] = new_value;
+  });
 }
 
 void NearbyFlags::OverrideInt64FlagValue(const flags::Flag<int64_t>& flag,
                                          int64_t new_value) {
-  absl::MutexLock lock(&mutex_);
-  overrided_int64_flag_values_[flag.name()] = new_value;
+  UpdateSnapshot([&](Snapshot& snapshot) {
+    snapshot.overrided_int64_flag_values[flag.name()] = new_value;
+  });
 }
 
 void NearbyFlags::OverrideDoubleFlagValue(const flags::Flag<double>& flag,
                                           double new_value) {
-  absl::MutexLock lock(&mutex_);
-  overrided_double_flag_values_[flag.name()] = new_value;
+  UpdateSnapshot([&](Snapshot& snapshot) {
+    snapshot.overrided_double_flag_values[flag.name()] = new_value;
+  });
 }
 
 void NearbyFlags::OverrideStringFlagValue(
     const flags::Flag<absl::string_view>& flag, absl::string_view new_value) {
-  absl::MutexLock lock(&mutex_);
-  overrided_string_flag_values_[flag.name()] = std::string(new_value);
+  UpdateSnapshot([&](Snapshot& snapshot) {
+    snapshot.overrided_string_flag_values[flag.name()] =
+        std::string(new_value);
+  });
 }
 
 void NearbyFlags::ResetOverridedValues() {
-  absl::MutexLock lock(&mutex_);
-  overrided_bool_flag_values_.clear();
-  overrided_int64_flag_values_.clear();
-  overrided_double_flag_values_.clear();
-  overrided_string_flag_values_.clear();
+  UpdateSnapshot([](Snapshot& snapshot) {
+    snapshot.overrided_bool_flag_values.clear();
+    snapshot.overrided_int64_flag_values.clear();
+    snapshot.overrided_double_flag_values.clear();
+    snapshot.overrided_string_flag_values.clear();
+  });
 }
 
 }  // namespace nearby
@@ -15,8 +15,11 @@
 #ifndef THIRD_PARTY_NEARBY_INTERNAL_FLAGS_NEARBY_FLAGS_H_
 #define THIRD_PARTY_NEARBY_INTERNAL_FLAGS_NEARBY_FLAGS_H_
 
+#include <atomic>
 #include <cstdint>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_map.h"
@@ -28,6 +31,12 @@
 
 namespace nearby {
 
+// Flag reads don't take the writer mutex: they load the current immutable
+// snapshot of the overrides and the installed FlagReader, which writers
+// replace as a whole. Values still come from the overrides and the reader on
+// every call; nothing is resolved once and cached.
+// Since reads may then run concurrently, an installed FlagReader must be
+// thread-safe.
 class NearbyFlags final : public nearby::flags::FlagReader {
  public:
   ~NearbyFlags() override = default;
@@ -72,22 +81,34 @@ class NearbyFlags final : public nearby::flags::FlagReader {
   void ResetOverridedValues() ABSL_LOCKS_EXCLUDED(mutex_);
 
  private:
-  NearbyFlags() = default;
+  struct Snapshot {
+    flags::FlagReader* flag_reader = nullptr;
+    absl::flat_hash_map<std::string, bool> overrided_bool_flag_values;
+    absl::flat_hash_map<std::string, int64_t> overrided_int64_flag_values;
+    absl::flat_hash_map<std::string, double> overrided_double_flag_values;
+    absl::flat_hash_map<std::string, std::string>
+        overrided_string_flag_values;
 
-  flags::FlagReader* flag_reader_ = nullptr;
-  flags::DefaultFlagReader default_flag_reader_;
+    bool operator==(const Snapshot&) const = default;
+  };
 
-  mutable absl::Mutex mutex_;
-  absl::flat_hash_map<std::string, bool> overrided_bool_flag_values_
-      ABSL_GUARDED_BY(mutex_);
+  NearbyFlags();
 
-  absl::flat_hash_map<std::string, int64_t> overrided_int64_flag_values_
-      ABSL_GUARDED_BY(mutex_);
+  const Snapshot& GetSnapshot() const {
+    return *snapshot_.load(std::memory_order_acquire);
+  }
 
-  absl::flat_hash_map<std::string, double> overrided_double_flag_values_
-      ABSL_GUARDED_BY(mutex_);
+  // Publishes a copy of the current snapshot with `update` applied.
+  template <typename Update>
+  void UpdateSnapshot(Update update) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  flags::DefaultFlagReader default_flag_reader_;
 
-  absl::flat_hash_map<std::string, std::string> overrided_string_flag_values_
+  // Serializes writers.
+  absl::Mutex mutex_;
+  std::atomic<const Snapshot*> snapshot_;
+  // Every snapshot ever published, as in FeatureFlags::SetFlags().
+  std::vector<std::unique_ptr<const Snapshot>> snapshots_
       ABSL_GUARDED_BY(mutex_);
 };
 
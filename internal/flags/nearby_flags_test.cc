@@ -18,6 +18,8 @@
 #include <memory>
 #include <string>
 #include <string_view>
+#include <thread>  // NOLINT
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "protobuf-matchers/protocol-buffer-matchers.h"
@@ -85,6 +87,28 @@ TEST(NearbyFlags, OverrideDefaultValues) {
   NearbyFlags::GetInstance().ResetOverridedValues();
 }
 
+TEST(NearbyFlags, ReadWhileOverriding) {
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([]() {
+      for (int j = 0; j < 1000; ++j) {
+        int64_t value =
+            NearbyFlags::GetInstance().GetInt64Flag(kTestInt64Flag);
+        EXPECT_TRUE(value == kTestInt64Flag.default_value() || value == 777);
+      }
+    });
+  }
+  for (int i = 0; i < 100; ++i) {
+    NearbyFlags::GetInstance().OverrideInt64FlagValue(kTestInt64Flag, 777);
+    NearbyFlags::GetInstance().ResetOverridedValues();
+  }
+  for (std::thread& reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(NearbyFlags::GetInstance().GetInt64Flag(kTestInt64Flag),
+            kTestInt64Flag.default_value());
+}
+
 TEST(NearbyFlags, SetFlagReader) {
   auto flag_reader = std::make_unique<::testing::NiceMock<MockFlagReader>>();
   NearbyFlags::GetInstance().SetFlagReader(*flag_reader.get());
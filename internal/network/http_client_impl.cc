@@ -14,15 +14,20 @@
 
 #include "internal/network/http_client_impl.h"
 
+#include <algorithm>
 #include <memory>
+#include <optional>
 #include <ostream>
 #include <sstream>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/functional/any_invocable.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
 #include "internal/network/debug.h"
 #include "internal/network/http_request.h"
 #include "internal/network/http_response.h"
@@ -30,7 +35,6 @@
 #include "internal/platform/implementation/http_loader.h"
 #include "internal/platform/logging.h"
 #include "internal/platform/mutex_lock.h"
-#include "internal/platform/single_thread_executor.h"
 
 namespace nearby {
 namespace network {
@@ -39,27 +43,25 @@ void NearbyHttpClient::StartRequest(
     const HttpRequest& request,
     absl::AnyInvocable<void(const absl::StatusOr<HttpResponse>&)> callback) {
   MutexLock lock(&mutex_);
-  executor_.Execute(
-      [request = std::move(request), callback = std::move(callback)]() mutable {
-        NEARBY_LOGS(INFO) << __func__ << ": Start async request to url="
-                          << request.GetUrl().GetUrlPath();
-        absl::StatusOr<HttpResponse> response = InternalGetResponse(request);
-        if (response.ok()) {
-          NEARBY_LOGS(INFO)
-              << __func__
-              << ": Got response from url=" << request.GetUrl().GetUrlPath();
-        } else {
-          NEARBY_LOGS(ERROR) << __func__ << ": Failed to get response from url="
-                             << request.GetUrl().GetUrlPath() << ", status"
-                             << response.status();
-        }
-
-        if (callback) {
-          callback(response);
-        }
-        NEARBY_LOGS(INFO) << __func__ << ": Completed request to url="
-                          << request.GetUrl().GetUrlPath();
-      });
+  std::string coalescing_key = GetCoalescingKey(request);
+  if (!coalescing_key.empty()) {
+    auto it = coalescable_jobs_.find(coalescing_key);
+    if (it != coalescable_jobs_.end()) {
+      NEARBY_LOGS(INFO) << __func__ << ": Join in-flight request to url="
+                        << request.GetUrl().GetUrlPath();
+      it->second->callbacks.push_back(std::move(callback));
+      return;
+    }
+  }
+  auto job = std::make_shared<Job>();
+  job->host = GetHostKey(request.GetUrl());
+  job->coalescing_key = std::move(coalescing_key);
+  job->request = std::make_unique<CancellableRequest>(request);
+  job->callbacks.push_back(std::move(callback));
+  if (!job->coalescing_key.empty()) {
+    coalescable_jobs_.emplace(job->coalescing_key, job);
+  }
+  Enqueue(std::move(job));
 }
 
 void NearbyHttpClient::StartCancellableRequest(
@@ -71,48 +73,103 @@ void NearbyHttpClient::StartCancellableRequest(
     callback(absl::InvalidArgumentError("invalid cancellable request"));
     return;
   }
-  executor_
-      .Execute(
-          [cancellable_request = std::move(cancellable_request),
-           callback = std::move(callback)]() mutable {
-            NEARBY_LOGS(INFO)
-                << __func__ << ": Start async request to url="
-                << cancellable_request->http_request().GetUrl().GetUrlPath();
-            if (cancellable_request->is_cancelled()) {
-              NEARBY_LOGS(WARNING)
-                  << __func__ << ": Async request to url="
-                  << cancellable_request->http_request().GetUrl().GetUrlPath()
-                  << " is cancelled.";
-              return;
-            }
-            absl::StatusOr<HttpResponse> response =
-                InternalGetResponse(cancellable_request->http_request());
-            if (response.ok()) {
-              NEARBY_LOGS(INFO)
-                  << __func__ << ": Got response from url="
-                  << cancellable_request->http_request().GetUrl().GetUrlPath();
-            } else {
-              NEARBY_LOGS(ERROR)
-                  << __func__ << ": Failed to get response from url="
-                  << cancellable_request->http_request().GetUrl().GetUrlPath()
-                  << ", status" << response.status();
-            }
-
-            if (cancellable_request->is_cancelled()) {
-              NEARBY_LOGS(WARNING)
-                  << __func__ << ": Async request to url="
-                  << cancellable_request->http_request().GetUrl().GetUrlPath()
-                  << " is cancelled.";
-              return;
-            }
-
-            if (callback) {
-              callback(response);
-            }
-            NEARBY_LOGS(INFO)
-                << __func__ << ": Completed request to url="
-                << cancellable_request->http_request().GetUrl().GetUrlPath();
-          });
+  auto job = std::make_shared<Job>();
+  job->host = GetHostKey(cancellable_request->http_request().GetUrl());
+  job->request = std::move(cancellable_request);
+  job->callbacks.push_back(std::move(callback));
+  Enqueue(std::move(job));
+}
+
+std::string NearbyHttpClient::GetHostKey(const Url& url) {
+  return absl::StrCat(url.GetScheme(), "://", url.GetHostName(), ":",
+                      url.GetPort());
+}
+
+std::string NearbyHttpClient::GetCoalescingKey(const HttpRequest& request) {
+  if (request.GetMethod() != HttpRequestMethod::kGet ||
+      !request.GetBody().GetRawData().empty()) {
+    return "";
+  }
+  // Headers are kept in a hash map, so sort them for a stable key.
+  std::vector<std::string> headers;
+  for (const auto& header : request.GetAllHeaders()) {
+    for (const auto& value : header.second) {
+      headers.push_back(absl::StrCat(header.first, ": ", value));
+    }
+  }
+  std::sort(headers.begin(), headers.end());
+  return absl::StrCat(request.GetUrl().GetUrlPath(), "\n",
+                      absl::StrJoin(headers, "\n"));
+}
+
+void NearbyHttpClient::Enqueue(std::shared_ptr<Job> job) {
+  HostQueue& host = hosts_[job->host];
+  if (host.running >= kMaxRequestsPerHost) {
+    host.waiting.push_back(std::move(job));
+    return;
+  }
+  ++host.running;
+  executor_.Execute(
+      [this, job = std::move(job)]() mutable { RunJob(std::move(job)); });
+}
+
+void NearbyHttpClient::RunJob(std::shared_ptr<Job> job) {
+  const HttpRequest& request = job->request->http_request();
+  std::optional<absl::StatusOr<HttpResponse>> response;
+  if (job->request->is_cancelled()) {
+    NEARBY_LOGS(WARNING) << __func__ << ": Async request to url="
+                         << request.GetUrl().GetUrlPath() << " is cancelled.";
+  } else {
+    NEARBY_LOGS(INFO) << __func__ << ": Start async request to url="
+                      << request.GetUrl().GetUrlPath();
+    response = InternalGetResponse(request);
+    if (response->ok()) {
+      NEARBY_LOGS(INFO) << __func__ << ": Got response from url="
+                        << request.GetUrl().GetUrlPath();
+    } else {
+      NEARBY_LOGS(ERROR) << __func__ << ": Failed to get response from url="
+                         << request.GetUrl().GetUrlPath() << ", status"
+                         << response->status();
+    }
+  }
+
+  std::vector<Callback> callbacks;
+  {
+    MutexLock lock(&mutex_);
+    // Requests started from here on go out again rather than reusing this
+    // response.
+    if (!job->coalescing_key.empty()) {
+      coalescable_jobs_.erase(job->coalescing_key);
+    }
+    callbacks = std::move(job->callbacks);
+    // Hand this job's slot to the next request to the same host.
+    auto it = hosts_.find(job->host);
+    if (!it->second.waiting.empty()) {
+      std::shared_ptr<Job> next = std::move(it->second.waiting.front());
+      it->second.waiting.pop_front();
+      executor_.Execute([this, next = std::move(next)]() mutable {
+        RunJob(std::move(next));
+      });
+    } else if (--it->second.running == 0) {
+      hosts_.erase(it);
+    }
+  }
+
+  if (!response.has_value()) {
+    return;
+  }
+  if (job->request->is_cancelled()) {
+    NEARBY_LOGS(WARNING) << __func__ << ": Async request to url="
+                         << request.GetUrl().GetUrlPath() << " is cancelled.";
+    return;
+  }
+  for (Callback& callback : callbacks) {
+    if (callback) {
+      callback(*response);
+    }
+  }
+  NEARBY_LOGS(INFO) << __func__ << ": Completed request to url="
+                    << request.GetUrl().GetUrlPath();
 }
 
 absl::StatusOr<HttpResponse> NearbyHttpClient::GetResponse(
@@ -15,20 +15,41 @@
 #ifndef THIRD_PARTY_NEARBY_INTERNAL_NETWORK_HTTP_CLIENT_IMPL_H_
 #define THIRD_PARTY_NEARBY_INTERNAL_NETWORK_HTTP_CLIENT_IMPL_H_
 
+#include <deque>
 #include <functional>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/status/statusor.h"
 #include "internal/network/http_client.h"
 #include "internal/network/http_request.h"
+#include "internal/network/http_response.h"
+#include "internal/network/url.h"
+#include "internal/platform/multi_thread_executor.h"
 #include "internal/platform/mutex.h"
-#include "internal/platform/single_thread_executor.h"
 
 namespace nearby {
 namespace network {
 
+// Runs asynchronous requests through a per-host pipeline: up to
+// kMaxRequestsPerHost requests to a host run at once and the rest wait in line
+// for one of them to finish, so a burst of requests to one server doesn't
+// starve the others, and the platform loader can keep reusing a few
+// keep-alive connections per server instead of opening one per request.
+//
+// Identical GET requests without a body that are started while one of them
+// is still in flight share its response rather than going out again.
 class NearbyHttpClient : public HttpClient {
  public:
+  // The most requests to a single host that run at once.
+  static constexpr int kMaxRequestsPerHost = 4;
+  // The most requests that run at once across all hosts.
+  static constexpr int kMaxConcurrentRequests = 8;
+
   NearbyHttpClient() = default;
   ~NearbyHttpClient() override = default;
 
@@ -51,11 +72,44 @@ class NearbyHttpClient : public HttpClient {
   absl::StatusOr<HttpResponse> GetResponse(const HttpRequest& request) override;
 
  private:
+  using Callback =
+      absl::AnyInvocable<void(const absl::StatusOr<HttpResponse>&)>;
+
+  // An asynchronous request, queued or running.
+  struct Job {
+    // The server the request goes to, as returned by GetHostKey().
+    std::string host;
+    // Identifies the requests that can share this one's response. Empty if
+    // the request can't be shared.
+    std::string coalescing_key;
+    std::unique_ptr<CancellableRequest> request;
+    // Only the first callback belongs to a cancellable request.
+    std::vector<Callback> callbacks;
+  };
+
+  struct HostQueue {
+    int running = 0;
+    std::deque<std::shared_ptr<Job>> waiting;
+  };
+
+  // Identifies a server by scheme, host name and port, so servers on different
+  // ports of the same host get their own queues.
+  static std::string GetHostKey(const Url& url);
+  static std::string GetCoalescingKey(const HttpRequest& request);
   static absl::StatusOr<HttpResponse> InternalGetResponse(
       const HttpRequest& request);
 
+  void Enqueue(std::shared_ptr<Job> job) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void RunJob(std::shared_ptr<Job> job) ABSL_LOCKS_EXCLUDED(mutex_);
+
   Mutex mutex_;
-  SingleThreadExecutor executor_;
+  absl::flat_hash_map<std::string, HostQueue> hosts_ ABSL_GUARDED_BY(mutex_);
+  // GET requests in flight that later identical ones can join, by coalescing
+  // key.
+  absl::flat_hash_map<std::string, std::shared_ptr<Job>> coalescable_jobs_
+      ABSL_GUARDED_BY(mutex_);
+  // Last, so that running jobs finish before the state they use goes away.
+  MultiThreadExecutor executor_{kMaxConcurrentRequests};
 };
 
 }  // namespace network
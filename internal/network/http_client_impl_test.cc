@@ -14,10 +14,12 @@
 
 #include "internal/network/http_client_impl.h"
 
+#include <algorithm>
 #include <map>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "protobuf-matchers/protocol-buffer-matchers.h"
@@ -27,6 +29,8 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/synchronization/notification.h"
 #include "absl/time/time.h"
 #include "internal/network/http_client.h"
@@ -43,6 +47,12 @@ struct HttpTestContext {
   WebResponse web_response;
   absl::Status status;
   absl::Duration api_time;
+
+  // Requests sent to the platform, and how many of them ran at once.
+  absl::Mutex mutex;
+  int sent_requests ABSL_GUARDED_BY(mutex) = 0;
+  int running_requests ABSL_GUARDED_BY(mutex) = 0;
+  int max_running_requests ABSL_GUARDED_BY(mutex) = 0;
 };
 
 HttpTestContext* GetContext() {
@@ -55,10 +65,22 @@ HttpTestContext* GetContext() {
 // Mock web implementation of the platform
 absl::StatusOr<WebResponse> ImplementationPlatform::SendRequest(
     const WebRequest& request) {
-  GetContext()->web_request = request;
+  HttpTestContext* context = GetContext();
+  {
+    absl::MutexLock lock(&context->mutex);
+    context->web_request = request;
+    ++context->sent_requests;
+    ++context->running_requests;
+    context->max_running_requests =
+        std::max(context->max_running_requests, context->running_requests);
+  }
   if (GetContext()->api_time != absl::ZeroDuration()) {
     absl::SleepFor(GetContext()->api_time);
   }
+  {
+    absl::MutexLock lock(&context->mutex);
+    --context->running_requests;
+  }
   if (GetContext()->status.ok()) {
     return GetContext()->web_response;
   }
@@ -78,6 +100,9 @@ class NearbyHttpClientTest : public ::testing::Test {
     api::GetContext()->web_response = api::WebResponse();
     api::GetContext()->status = absl::Status();
     api::GetContext()->api_time = absl::ZeroDuration();
+    absl::MutexLock lock(&api::GetContext()->mutex);
+    api::GetContext()->sent_requests = 0;
+    api::GetContext()->max_running_requests = 0;
   }
 
   void MockFailedResponse(absl::Status status) {
@@ -96,7 +121,40 @@ class NearbyHttpClientTest : public ::testing::Test {
     api::GetContext()->web_response = web_response;
   }
 
-  api::WebRequest GetWebRequest() { return api::GetContext()->web_request; }
+  api::WebRequest GetWebRequest() {
+    absl::MutexLock lock(&api::GetContext()->mutex);
+    return api::GetContext()->web_request;
+  }
+
+  int GetSentRequests() {
+    absl::MutexLock lock(&api::GetContext()->mutex);
+    return api::GetContext()->sent_requests;
+  }
+
+  int GetMaxRunningRequests() {
+    absl::MutexLock lock(&api::GetContext()->mutex);
+    return api::GetContext()->max_running_requests;
+  }
+
+  // Starts all `urls` at once and waits for every response.
+  std::vector<absl::StatusOr<HttpResponse>> GetResponsesAsync(
+      const std::vector<std::string>& urls, HttpRequestMethod method) {
+    std::vector<absl::StatusOr<HttpResponse>> results(urls.size());
+    absl::BlockingCounter pending(urls.size());
+    for (size_t i = 0; i < urls.size(); ++i) {
+      absl::StatusOr<HttpRequest> request =
+          MakeHttpRequest(urls[i], method, {{"Accept", "*/*"}}, "");
+      EXPECT_TRUE(request.ok());
+      client_.StartRequest(*request,
+                           [&results, &pending, i](
+                               const absl::StatusOr<HttpResponse>& response) {
+                             results[i] = response;
+                             pending.DecrementCount();
+                           });
+    }
+    pending.Wait();
+    return results;
+  }
 
   absl::StatusOr<HttpRequest> MakeHttpRequest(
       absl::string_view url, HttpRequestMethod method,
@@ -324,6 +382,82 @@ TEST_F(NearbyHttpClientTest, TestRequestWithCleanThreadsAsync) {
   ASSERT_TRUE(result.ok());
 }
 
+TEST_F(NearbyHttpClientTest, IdenticalGetsInFlightShareOneRequest) {
+  MockResponse(HttpStatusCode::kHttpOk, "OK", {}, "web content");
+  api::GetContext()->api_time = absl::Milliseconds(200);
+
+  std::vector<absl::StatusOr<HttpResponse>> results = GetResponsesAsync(
+      {"http://www.google.com/a", "http://www.google.com/a",
+       "http://www.google.com/a"},
+      HttpRequestMethod::kGet);
+
+  EXPECT_EQ(GetSentRequests(), 1);
+  for (const absl::StatusOr<HttpResponse>& result : results) {
+    ASSERT_TRUE(result.ok());
+    EXPECT_EQ(result->GetBody().GetRawData(), "web content");
+  }
+}
+
+TEST_F(NearbyHttpClientTest, PostsAreNeverShared) {
+  MockResponse(HttpStatusCode::kHttpOk, "OK", {}, "");
+  api::GetContext()->api_time = absl::Milliseconds(200);
+
+  std::vector<absl::StatusOr<HttpResponse>> results = GetResponsesAsync(
+      {"http://www.google.com/a", "http://www.google.com/a"},
+      HttpRequestMethod::kPost);
+
+  EXPECT_EQ(GetSentRequests(), 2);
+  EXPECT_TRUE(results[0].ok());
+  EXPECT_TRUE(results[1].ok());
+}
+
+TEST_F(NearbyHttpClientTest, LimitsRequestsPerHost) {
+  MockResponse(HttpStatusCode::kHttpOk, "OK", {}, "");
+  api::GetContext()->api_time = absl::Milliseconds(50);
+  std::vector<std::string> urls;
+  for (int i = 0; i < 3 * NearbyHttpClient::kMaxRequestsPerHost; ++i) {
+    urls.push_back(absl::StrCat("http://www.google.com/", i));
+  }
+
+  std::vector<absl::StatusOr<HttpResponse>> results =
+      GetResponsesAsync(urls, HttpRequestMethod::kGet);
+
+  EXPECT_EQ(GetSentRequests(), static_cast<int>(urls.size()));
+  EXPECT_GT(GetMaxRunningRequests(), 1);
+  EXPECT_LE(GetMaxRunningRequests(), NearbyHttpClient::kMaxRequestsPerHost);
+  for (const absl::StatusOr<HttpResponse>& result : results) {
+    EXPECT_TRUE(result.ok());
+  }
+}
+
+TEST_F(NearbyHttpClientTest, HostsDoNotWaitForEachOther) {
+  MockResponse(HttpStatusCode::kHttpOk, "OK", {}, "");
+  api::GetContext()->api_time = absl::Milliseconds(50);
+  std::vector<std::string> urls;
+  for (int i = 0; i < NearbyHttpClient::kMaxRequestsPerHost; ++i) {
+    urls.push_back(absl::StrCat("http://www.google.com/", i));
+    urls.push_back(absl::StrCat("http://www.youtube.com/", i));
+  }
+
+  GetResponsesAsync(urls, HttpRequestMethod::kGet);
+
+  EXPECT_GT(GetMaxRunningRequests(), NearbyHttpClient::kMaxRequestsPerHost);
+}
+
+TEST_F(NearbyHttpClientTest, PortsOfOneHostDoNotWaitForEachOther) {
+  MockResponse(HttpStatusCode::kHttpOk, "OK", {}, "");
+  api::GetContext()->api_time = absl::Milliseconds(50);
+  std::vector<std::string> urls;
+  for (int i = 0; i < NearbyHttpClient::kMaxRequestsPerHost; ++i) {
+    urls.push_back(absl::StrCat("http://www.google.com:8080/", i));
+    urls.push_back(absl::StrCat("http://www.google.com:8081/", i));
+  }
+
+  GetResponsesAsync(urls, HttpRequestMethod::kGet);
+
+  EXPECT_GT(GetMaxRunningRequests(), NearbyHttpClient::kMaxRequestsPerHost);
+}
+
 TEST_F(NearbyHttpClientTest, TestCancellableRequestAsync) {
   absl::StatusOr<HttpRequest> request =
       MakeHttpRequest("http://www.google.com", HttpRequestMethod::kGet, {}, "");
@@ -15,12 +15,14 @@
 #ifndef PLATFORM_PUBLIC_ARRAY_BLOCKING_QUEUE_H_
 #define PLATFORM_PUBLIC_ARRAY_BLOCKING_QUEUE_H_
 
+#include <atomic>
 #include <cstddef>
 #include <optional>
-#include <queue>
+#include <utility>
+#include <vector>
 
 #include "internal/platform/condition_variable.h"
-#include "internal/platform/logging.h"
+#include "internal/platform/mpmc_queue.h"
 #include "internal/platform/mutex.h"
 #include "internal/platform/mutex_lock.h"
 
@@ -31,72 +33,134 @@ namespace nearby {
  * ArrayBlockingQueue before sending to ensure each client has equal chance to
  * send its data. Since C++ doesn't provide ArrayBlockingQueue as Java, we
  * implement one here.
+ *
+ * Values are kept in a lock-free MpmcQueue. A blocked Put() or Take() spins
+ * on it for a little while before parking on a condition variable; the mutex
+ * is only taken to park and to wake parked threads up.
  */
 template <typename T>
 class ArrayBlockingQueue {
  public:
-  explicit ArrayBlockingQueue(size_t capacity) : capacity_(capacity) {}
+  explicit ArrayBlockingQueue(size_t capacity) : queue_(capacity) {}
 
-  void Put(const T& value) {
-    MutexLock lock(&queue_mutex_);
-    if (queue_.size() >= capacity_) {
-      has_space_.Wait();
+  void Put(const T& value) { Put(T(value)); }
+
+  void Put(T&& value) {
+    for (int spin = 0; spin < kSpins; ++spin) {
+      if (TryPut(std::move(value))) {
+        return;
+      }
+    }
+    {
+      MutexLock lock(&park_mutex_);
+      ++parked_putters_;
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      while (!queue_.TryPush(std::move(value))) {
+        has_space_.Wait();
+      }
+      --parked_putters_;
     }
-    queue_.push(value);
-    NEARBY_LOGS(INFO) << "ArrayBlockingQueue::Put()";
-    has_data_.Notify();
+    WakeTakers();
   }
 
   T Take() {
-    MutexLock lock(&queue_mutex_);
-    if (queue_.empty()) {
-      has_data_.Wait();
+    for (int spin = 0; spin < kSpins; ++spin) {
+      std::optional<T> value = TryTake();
+      if (value.has_value()) {
+        return *std::move(value);
+      }
     }
-    T front = queue_.front();
-    queue_.pop();
-    NEARBY_LOGS(INFO) << "ArrayBlockingQueue::Take()";
-    has_space_.Notify();
-    return front;
+    std::optional<T> value = ParkUntilTaken();
+    WakePutters();
+    return *std::move(value);
   }
 
-  bool TryPut(const T& value) {
-    MutexLock lock(&queue_mutex_);
-    if (queue_.size() < capacity_) {
-      queue_.push(value);
-      has_data_.Notify();
-      return true;
+  bool TryPut(const T& value) { return TryPut(T(value)); }
+
+  // `value` is left alone if the queue is full.
+  bool TryPut(T&& value) {
+    if (!queue_.TryPush(std::move(value))) {
+      return false;
     }
-    return false;
+    WakeTakers();
+    return true;
   }
 
   // Returns std::nullopt if the queue is empty.
   std::optional<T> TryTake() {
-    MutexLock lock(&queue_mutex_);
-    if (!queue_.empty()) {
-      T front = queue_.front();
-      queue_.pop();
-      has_space_.Notify();
-      return front;
+    std::optional<T> value = queue_.TryPop();
+    if (value.has_value()) {
+      WakePutters();
     }
-    return std::nullopt;
+    return value;
   }
 
-  size_t Size() const {
-    MutexLock lock(&queue_mutex_);
-    return queue_.size();
+  // Moves up to `max_items` values to the end of `items` without blocking, and
+  // returns how many were moved.
+  size_t DrainTo(std::vector<T>& items, size_t max_items) {
+    size_t drained = 0;
+    while (drained < max_items) {
+      std::optional<T> value = queue_.TryPop();
+      if (!value.has_value()) {
+        break;
+      }
+      items.push_back(*std::move(value));
+      ++drained;
+    }
+    if (drained > 0) {
+      WakePutters();
+    }
+    return drained;
   }
 
-  bool Empty() const {
-    MutexLock lock(&queue_mutex_);
-    return queue_.empty();
-  }
+  size_t Size() const { return queue_.Size(); }
+
+  bool Empty() const { return queue_.Empty(); }
 
  private:
-  std::queue<T> queue_;
-  mutable Mutex queue_mutex_;
-  ConditionVariable has_data_{&queue_mutex_};
-  ConditionVariable has_space_{&queue_mutex_};
-  const size_t capacity_;
+  // TryPut()/TryTake() attempts before parking. Enough to ride out another
+  // thread's push or pop, well short of a context switch.
+  static constexpr int kSpins = 64;
+
+  // Parked threads register under park_mutex_ before checking the queue a
+  // last time; the fences pair up with those in Put()/Take() so that either
+  // they see the new value or the waker sees them.
+  std::optional<T> ParkUntilTaken() {
+    MutexLock lock(&park_mutex_);
+    ++parked_takers_;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    while (true) {
+      std::optional<T> value = queue_.TryPop();
+      if (value.has_value()) {
+        --parked_takers_;
+        return value;
+      }
+      has_data_.Wait();
+    }
+  }
+
+  void WakeTakers() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (parked_takers_.load(std::memory_order_relaxed) > 0) {
+      MutexLock lock(&park_mutex_);
+      has_data_.Notify();
+    }
+  }
+
+  void WakePutters() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (parked_putters_.load(std::memory_order_relaxed) > 0) {
+      MutexLock lock(&park_mutex_);
+      has_space_.Notify();
+    }
+  }
+
+  MpmcQueue<T> queue_;
+  mutable Mutex park_mutex_;
+  ConditionVariable has_data_{&park_mutex_};
+  ConditionVariable has_space_{&park_mutex_};
+  std::atomic<int> parked_takers_ = 0;
+  std::atomic<int> parked_putters_ = 0;
 };
 
 }  // namespace nearby
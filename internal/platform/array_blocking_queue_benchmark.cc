@@ -0,0 +1,99 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstddef>
+#include <deque>
+#include <utility>
+
+#include "benchmark/benchmark.h"
+#include "absl/synchronization/mutex.h"
+#include "internal/platform/array_blocking_queue.h"
+#include "internal/platform/byte_array.h"
+
+namespace nearby {
+namespace {
+
+// Frames the size of a multiplexed payload chunk.
+constexpr size_t kFrameSize = 1024;
+// Small enough that producers regularly find the queue full.
+constexpr size_t kCapacity = 16;
+
+// The queue as it was before it was backed by MpmcQueue: a deque under one
+// mutex, with a condition variable per direction.
+class LockedQueue {
+ public:
+  explicit LockedQueue(size_t capacity) : capacity_(capacity) {}
+
+  void Put(ByteArray value) {
+    absl::MutexLock lock(&mutex_);
+    while (queue_.size() >= capacity_) {
+      not_full_.Wait(&mutex_);
+    }
+    queue_.push_back(std::move(value));
+    not_empty_.Signal();
+  }
+
+  ByteArray Take() {
+    absl::MutexLock lock(&mutex_);
+    while (queue_.empty()) {
+      not_empty_.Wait(&mutex_);
+    }
+    ByteArray value = std::move(queue_.front());
+    queue_.pop_front();
+    not_full_.Signal();
+    return value;
+  }
+
+ private:
+  const size_t capacity_;
+  absl::Mutex mutex_;
+  absl::CondVar not_empty_;
+  absl::CondVar not_full_;
+  std::deque<ByteArray> queue_ ABSL_GUARDED_BY(mutex_);
+};
+
+// Every thread both puts and takes a frame per iteration, so each benchmark
+// thread is a producer and a consumer contending on the same queue, the way
+// the multiplex writer is fed by every virtual socket.
+template <typename Queue>
+void BM_PutTake(benchmark::State& state) {
+  static Queue* queue = nullptr;
+  if (state.thread_index() == 0) {
+    queue = new Queue(kCapacity);
+  }
+  ByteArray frame(kFrameSize);
+  for (auto _ : state) {
+    queue->Put(frame);
+    benchmark::DoNotOptimize(queue->Take());
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * kFrameSize);
+  if (state.thread_index() == 0) {
+    delete queue;
+    queue = nullptr;
+  }
+}
+BENCHMARK(BM_PutTake<ArrayBlockingQueue<ByteArray>>)
+    ->Threads(1)
+    ->Threads(4)
+    ->Threads(8)
+    ->UseRealTime();
+BENCHMARK(BM_PutTake<LockedQueue>)
+    ->Threads(1)
+    ->Threads(4)
+    ->Threads(8)
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace nearby
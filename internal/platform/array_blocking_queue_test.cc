@@ -0,0 +1,148 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/array_blocking_queue.h"
+
+#include <chrono>  // NOLINT
+#include <memory>
+#include <optional>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace nearby {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using ::testing::Optional;
+
+TEST(ArrayBlockingQueueTest, TakesInPutOrder) {
+  ArrayBlockingQueue<int> queue(4);
+
+  queue.Put(1);
+  queue.Put(2);
+
+  EXPECT_EQ(queue.Take(), 1);
+  EXPECT_EQ(queue.Take(), 2);
+  EXPECT_TRUE(queue.Empty());
+}
+
+TEST(ArrayBlockingQueueTest, TryPutFailsWhenFull) {
+  ArrayBlockingQueue<int> queue(1);
+
+  EXPECT_TRUE(queue.TryPut(1));
+  EXPECT_FALSE(queue.TryPut(2));
+  EXPECT_THAT(queue.TryTake(), Optional(1));
+  EXPECT_EQ(queue.TryTake(), std::nullopt);
+}
+
+TEST(ArrayBlockingQueueTest, HoldsMoveOnlyValues) {
+  ArrayBlockingQueue<std::unique_ptr<int>> queue(2);
+
+  queue.Put(std::make_unique<int>(1));
+  EXPECT_TRUE(queue.TryPut(std::make_unique<int>(2)));
+
+  EXPECT_EQ(*queue.Take(), 1);
+  EXPECT_EQ(**queue.TryTake(), 2);
+}
+
+TEST(ArrayBlockingQueueTest, DrainToTakesUpToMaxItems) {
+  ArrayBlockingQueue<int> queue(4);
+  std::vector<int> items = {0};
+  queue.Put(1);
+  queue.Put(2);
+  queue.Put(3);
+
+  EXPECT_EQ(queue.DrainTo(items, 2), 2);
+  EXPECT_THAT(items, ElementsAre(0, 1, 2));
+  EXPECT_EQ(queue.DrainTo(items, 2), 1);
+  EXPECT_THAT(items, ElementsAre(0, 1, 2, 3));
+  EXPECT_EQ(queue.DrainTo(items, 2), 0);
+}
+
+TEST(ArrayBlockingQueueTest, TakeWaitsForPut) {
+  ArrayBlockingQueue<int> queue(1);
+
+  std::thread putter([&queue]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    queue.Put(1);
+  });
+
+  EXPECT_EQ(queue.Take(), 1);
+  putter.join();
+}
+
+TEST(ArrayBlockingQueueTest, PutWaitsForTake) {
+  ArrayBlockingQueue<int> queue(1);
+  queue.Put(1);
+
+  std::thread taker([&queue]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    queue.Take();
+  });
+
+  queue.Put(2);
+  taker.join();
+  EXPECT_THAT(queue.TryTake(), Optional(2));
+}
+
+// Many producers and consumers on a queue much smaller than the number of
+// threads, so most Put() and Take() calls end up parked.
+TEST(ArrayBlockingQueueTest, DeliversEveryValueUnderContention) {
+  constexpr int kProducers = 8;
+  constexpr int kConsumers = 4;
+  constexpr int kValuesPerProducer = 5000;
+  constexpr int kValues = kProducers * kValuesPerProducer;
+  ArrayBlockingQueue<int> queue(2);
+  std::vector<std::vector<int>> taken(kConsumers);
+  std::vector<std::thread> threads;
+
+  for (int p = 0; p < kProducers; ++p) {
+    threads.emplace_back([&queue, p]() {
+      for (int i = 0; i < kValuesPerProducer; ++i) {
+        queue.Put(p * kValuesPerProducer + i);
+      }
+    });
+  }
+  for (int c = 0; c < kConsumers; ++c) {
+    threads.emplace_back([&queue, &taken, c]() {
+      for (int i = 0; i < kValues / kConsumers; ++i) {
+        taken[c].push_back(queue.Take());
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  std::vector<int> taken_count(kValues);
+  for (const std::vector<int>& values : taken) {
+    for (int value : values) {
+      ++taken_count[value];
+    }
+  }
+  for (int count : taken_count) {
+    EXPECT_EQ(count, 1);
+  }
+  std::vector<int> left;
+  queue.DrainTo(left, kValues);
+  EXPECT_THAT(left, IsEmpty());
+}
+
+}  // namespace
+}  // namespace nearby
@@ -44,7 +44,8 @@ ExceptionOr<ByteArray> BlockingQueueStream::Read(std::int64_t size) {
     return ExceptionOr<ByteArray>(Exception::kIo);
   }
 
-  ByteArray bytes = queue_head_.Empty() ? blocking_queue_.Take() : queue_head_;
+  ByteArray bytes =
+      queue_head_.Empty() ? blocking_queue_.Take() : std::move(queue_head_);
   if (bytes == queue_end_) {
     LOG(INFO) << "BlockingQueueStream is Interrupted.";
     return ExceptionOr<ByteArray>(Exception::kIo);
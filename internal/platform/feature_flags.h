@@ -15,7 +15,10 @@
 #ifndef PLATFORM_BASE_FEATURE_FLAGS_H_
 #define PLATFORM_BASE_FEATURE_FLAGS_H_
 
+#include <atomic>
 #include <cstdint>
+#include <memory>
+#include <vector>
 
 #include "absl/base/thread_annotations.h"
 #include "absl/synchronization/mutex.h"
@@ -44,6 +47,29 @@ class FeatureFlags {
     absl::Duration bwu_retry_exp_backoff_maximum_delay = absl::Seconds(300);
     // Support sending file and stream payloads starting from a non-zero offset.
     bool enable_send_payload_offset = true;
+    // Split BYTES payloads larger than the medium's max transmit size into
+    // chunks like FILE payloads, and accept them chunked. Advertised in the
+    // connection response, and only used when the remote advertises it too.
+    bool enable_chunked_bytes_payload = false;
+    // Seal encrypted frames with the AES-GCM record layer instead of UKEY2
+    // SecureMessages. Advertised in the connection response, and only used
+    // when the remote advertises it too.
+    bool enable_aes_gcm_record_layer = false;
+    // Deflate BYTES and FILE payloads chunk by chunk on slow links, and accept
+    // them deflated. Advertised in the connection response, and only used
+    // when the remote advertises it too.
+    bool enable_payload_compression = false;
+    // Keep a checkpoint journal for incoming files, so a file that's sent
+    // again after an interrupted transfer continues from the last checkpoint.
+    bool enable_payload_checkpoints = false;
+    // Size outgoing payload chunks from how long the previous ones took to
+    // write, up to the channel's max transmit packet size, instead of always
+    // using the max.
+    bool enable_adaptive_chunk_size = false;
+    // Send a payload addressed to several endpoints with a writer per
+    // endpoint, so a slow endpoint doesn't hold back the others, instead of
+    // writing each chunk to every endpoint in turn.
+    bool enable_payload_fan_out = false;
     // Provide better bookkeeping for bandwidth upgrade initiation. This is
     // necessary to properly support multiple BWU mediums, multiple service, and
     // multiple endpoints.
@@ -53,6 +79,12 @@ class FeatureFlags {
     // If the feature is enabled, medium connection will timeout when cannot
     // create connection with remote device in a duration.
     bool enable_connection_timeout = true;
+    // Race connection attempts across an endpoint's discovered mediums instead
+    // of trying them one at a time. The next medium is tried whenever the ones
+    // already in flight haven't connected within the stagger delay, and the
+    // first to connect is kept.
+    bool enable_connection_racing = false;
+    absl::Duration connection_racing_stagger_delay = absl::Milliseconds(300);
     // Controls enable or disable to track the status of Bluetooth classic
     // connection.
     bool enable_bluetooth_connection_status_track = true;
@@ -70,6 +102,20 @@ class FeatureFlags {
     // Enable legacy device discovered callback being used inside ble v2
     // DiscoverPeripheralTracker flow.
     bool enable_invoking_legacy_device_discovered_cb = false;
+    // Lets DiscoveredPeripheralTracker drop a scan result without taking its
+    // lock when the same peripheral reported the same service data within
+    // the window and nothing the result depends on has changed since.
+    bool enable_scan_result_dedup = true;
+    absl::Duration scan_result_dedup_window = absl::Seconds(2);
+
+    // Keeps BasePcpHandler's alarms in a timing wheel instead of the
+    // platform's scheduled executor.
+    bool enable_timing_wheel_alarms = false;
+
+    // Reads outgoing files on Linux through a read-only memory mapping
+    // instead of IOFile. Only for apps that don't truncate files while
+    // they're sent: touching the mapping past a new end raises SIGBUS.
+    bool enable_mapped_input_file = false;
 
     // Enable 1. safe-to-disconnect check 2. reserved 3. auto-reconnect 4.
     // auto-resume 5. non-distance-constraint-recovery 6. payload_ack
@@ -87,6 +133,9 @@ class FeatureFlags {
     // in near future, so change "payload_received_ack" version from "2" to "5"
     // after auto-reconnect and auto-resume.
     std::int32_t min_nc_version_supports_payload_received_ack = 6;
+    // The largest chunked BYTES payload we'll preallocate a receive buffer
+    // for, to avoid a remote device from triggering an OutOfMemory error.
+    std::int64_t max_chunked_bytes_payload_length = 64 * 1024 * 1024;
     // If the other part doesn't ack the safe_to_disconnect request, the
     // initiator will end the connection in 30s.
     absl::Duration safe_to_disconnect_ack_delay_millis =
@@ -118,6 +167,8 @@ class FeatureFlags {
     std::uint32_t connection_max_frame_length = 1048576;
     std::uint32_t blocking_queue_stream_queue_capacity = 10;
     bool support_web_rtc_non_cellular_medium = false;
+
+    bool operator==(const Flags&) const = default;
   };
 
   static const FeatureFlags& GetInstance() {
@@ -125,25 +176,53 @@ class FeatureFlags {
     return *instance;
   }
 
-  const Flags& GetFlags() const ABSL_LOCKS_EXCLUDED(mutex_) {
-    absl::ReaderMutexLock lock(&mutex_);
-    return flags_;
-  }
+  // Publishes `flags` until it goes out of scope, then puts back the flags
+  // that were there before. Lets a test change flags without touching the
+  // snapshot other threads may be reading.
+  class ScopedFlagsForTesting {
+   public:
+    explicit ScopedFlagsForTesting(const Flags& flags)
+        : saved_flags_(GetInstance().GetFlags()) {
+      const_cast<FeatureFlags&>(GetInstance()).SetFlags(flags);
+    }
+    ~ScopedFlagsForTesting() {
+      const_cast<FeatureFlags&>(GetInstance()).SetFlags(saved_flags_);
+    }
+    ScopedFlagsForTesting(const ScopedFlagsForTesting&) = delete;
+    ScopedFlagsForTesting& operator=(const ScopedFlagsForTesting&) = delete;
 
-  static Flags& GetMutableFlagsForTesting() {
-    return const_cast<FeatureFlags&>(GetInstance()).flags_;
+   private:
+    const Flags saved_flags_;
+  };
+
+  // Doesn't lock. The returned flags are a snapshot that SetFlags() doesn't
+  // change; it publishes another one instead.
+  const Flags& GetFlags() const {
+    return *flags_.load(std::memory_order_acquire);
   }
 
   // SetFlags for feature controlling
   void SetFlags(const Flags& flags) ABSL_LOCKS_EXCLUDED(mutex_) {
     absl::MutexLock lock(&mutex_);
-    flags_ = flags;
+    // Readers hold on to snapshots without saying when they're done, so none
+    // is freed. Republishing an equal one instead of adding a copy keeps them
+    // to one per distinct set of flags, however often the same flags are set.
+    for (const std::unique_ptr<const Flags>& snapshot : snapshots_) {
+      if (*snapshot == flags) {
+        flags_.store(snapshot.get(), std::memory_order_release);
+        return;
+      }
+    }
+    snapshots_.push_back(std::make_unique<const Flags>(flags));
+    flags_.store(snapshots_.back().get(), std::memory_order_release);
   }
 
  private:
-  FeatureFlags() = default;
-  Flags flags_ ABSL_GUARDED_BY(mutex_);
+  FeatureFlags() { SetFlags(Flags()); }
+
+  std::atomic<const Flags*> flags_;
   mutable absl::Mutex mutex_;
+  std::vector<std::unique_ptr<const Flags>> snapshots_ ABSL_GUARDED_BY(mutex_);
 };
 }  // namespace nearby
 
@@ -49,5 +49,35 @@ TEST(FeatureFlagsTest, ToSetFeatureWorks) {
   EXPECT_FALSE(another_features_ref.GetFlags().enable_cancellation_flag);
 }
 
+TEST(FeatureFlagsTest, ScopedFlagsRestoreEarlierFlags) {
+  const FeatureFlags& features = FeatureFlags::GetInstance();
+  const FeatureFlags::Flags* earlier_flags = &features.GetFlags();
+  bool earlier_value = earlier_flags->enable_payload_fan_out;
+  {
+    FeatureFlags::Flags flags = features.GetFlags();
+    flags.enable_payload_fan_out = !earlier_value;
+    FeatureFlags::ScopedFlagsForTesting scoped_flags(flags);
+
+    EXPECT_EQ(features.GetFlags().enable_payload_fan_out, !earlier_value);
+    // The earlier snapshot wasn't changed.
+    EXPECT_EQ(earlier_flags->enable_payload_fan_out, earlier_value);
+  }
+  EXPECT_EQ(features.GetFlags().enable_payload_fan_out, earlier_value);
+}
+
+TEST(FeatureFlagsTest, SettingEqualFlagsReusesSnapshot) {
+  FeatureFlags& features =
+      const_cast<FeatureFlags&>(FeatureFlags::GetInstance());
+  FeatureFlags::Flags flags = features.GetFlags();
+  flags.enable_ble_v2_async_scanning = !flags.enable_ble_v2_async_scanning;
+
+  features.SetFlags(flags);
+  const FeatureFlags::Flags* snapshot = &features.GetFlags();
+  features.SetFlags(FeatureFlags::Flags());
+  features.SetFlags(flags);
+
+  EXPECT_EQ(&features.GetFlags(), snapshot);
+}
+
 }  // namespace
 }  // namespace nearby
@@ -26,6 +26,7 @@
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "internal/base/files.h"
+#include "internal/platform/feature_flags.h"
 #include "internal/platform/implementation/atomic_boolean.h"
 #include "internal/platform/implementation/atomic_reference.h"
 #include "internal/platform/implementation/awdl.h"
@@ -80,6 +81,7 @@
 #include "internal/platform/implementation/g3/wifi_hotspot.h"
 #include "internal/platform/implementation/g3/wifi_lan.h"
 #include "internal/platform/implementation/shared/file.h"
+#include "internal/platform/implementation/shared/mapped_file.h"
 #include "internal/platform/implementation/wifi.h"
 #include "internal/platform/medium_environment.h"
 
@@ -149,6 +151,15 @@ std::unique_ptr<InputFile> ImplementationPlatform::CreateInputFile(
 
 std::unique_ptr<InputFile> ImplementationPlatform::CreateInputFile(
     const std::string& file_path, size_t size) {
+#if defined(__linux__)
+  if (FeatureFlags::GetInstance().GetFlags().enable_mapped_input_file) {
+    std::unique_ptr<shared::MappedInputFile> mapped_file =
+        shared::MappedInputFile::Create(file_path, size);
+    if (mapped_file != nullptr) {
+      return mapped_file;
+    }
+  }
+#endif  // defined(__linux__)
   return shared::IOFile::CreateInputFile(file_path, size);
 }
 
@@ -85,6 +85,10 @@ class PreferencesManager {
 
   // Removes preferences
   virtual void Remove(absl::string_view key) = 0;
+
+  // Writes any changes that haven't been fully persisted yet. Implementations
+  // that persist every change as it's made don't need to override this.
+  virtual void Flush() {}
 };
 
 }  // namespace api
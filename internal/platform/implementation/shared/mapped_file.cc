@@ -0,0 +1,190 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/implementation/shared/mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "internal/platform/byte_array.h"
+#include "internal/platform/exception.h"
+
+namespace nearby {
+namespace shared {
+namespace {
+
+// How far ahead of the reader pages are prefetched, and how much is read
+// before the pages behind it are released. Both are multiples of any page
+// size, so the advised ranges stay page aligned.
+constexpr size_t kReadAheadSize = 8 * 1024 * 1024;
+constexpr size_t kReleaseSize = 64 * 1024 * 1024;
+
+}  // namespace
+
+std::unique_ptr<MappedInputFile> MappedInputFile::Create(
+    absl::string_view file_path, std::int64_t size) {
+  int fd = open(std::string(file_path).c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 || !S_ISREG(file_stat.st_mode) ||
+      file_stat.st_size <= 0) {
+    close(fd);
+    return nullptr;
+  }
+  size_t mapped_size = static_cast<size_t>(file_stat.st_size);
+  void* mapping = mmap(nullptr, mapped_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (mapping == MAP_FAILED) {
+    close(fd);
+    return nullptr;
+  }
+  madvise(mapping, mapped_size, MADV_SEQUENTIAL);
+#if defined(__linux__)
+  // Widens the kernel's read-ahead for the pread() fallback too.
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif  // defined(__linux__)
+  return absl::WrapUnique(new MappedInputFile(
+      file_path, size, fd, static_cast<char*>(mapping), mapped_size));
+}
+
+MappedInputFile::MappedInputFile(absl::string_view file_path,
+                                 std::int64_t total_size, int fd,
+                                 char* mapping, size_t mapped_size)
+    : path_(file_path),
+      total_size_(total_size),
+      fd_(fd),
+      mapping_(mapping),
+      mapped_size_(mapped_size) {}
+
+MappedInputFile::~MappedInputFile() { Close(); }
+
+ExceptionOr<ByteArray> MappedInputFile::Read(std::int64_t size) {
+  if (fd_ < 0) {
+    return ExceptionOr<ByteArray>{Exception::kIo};
+  }
+  if (mapping_ != nullptr && !MappedSizeUnchanged()) {
+    Unmap();
+  }
+  if (mapping_ == nullptr) {
+    return ReadFromFile(size);
+  }
+
+  size_t length =
+      std::min(static_cast<size_t>(std::max<std::int64_t>(size, 0)),
+               mapped_size_ - position_);
+  if (length == 0) {
+    return ExceptionOr<ByteArray>{ByteArray{}};
+  }
+  AdviseAround(position_ + length);
+  ByteArray bytes(mapping_ + position_, length);
+  position_ += length;
+  return ExceptionOr<ByteArray>(std::move(bytes));
+}
+
+ExceptionOr<size_t> MappedInputFile::Skip(size_t offset) {
+  if (fd_ < 0) {
+    return ExceptionOr<size_t>{Exception::kIo};
+  }
+  struct stat file_stat;
+  if (fstat(fd_, &file_stat) != 0) {
+    return ExceptionOr<size_t>{Exception::kIo};
+  }
+  size_t file_size = static_cast<size_t>(file_stat.st_size);
+  if (mapping_ != nullptr && file_size != mapped_size_) {
+    Unmap();
+  }
+  size_t skipped =
+      position_ < file_size ? std::min(offset, file_size - position_) : 0;
+  position_ += skipped;
+  if (mapping_ != nullptr) {
+    // Don't prefetch the skipped pages on the next read.
+    prefetched_until_ = std::max(
+        prefetched_until_, position_ / kReadAheadSize * kReadAheadSize);
+  }
+  return ExceptionOr<size_t>(skipped);
+}
+
+Exception MappedInputFile::Close() {
+  Unmap();
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+  }
+  return {Exception::kSuccess};
+}
+
+bool MappedInputFile::MappedSizeUnchanged() const {
+  struct stat file_stat;
+  return fstat(fd_, &file_stat) == 0 &&
+         static_cast<size_t>(file_stat.st_size) == mapped_size_;
+}
+
+void MappedInputFile::Unmap() {
+  if (mapping_ != nullptr) {
+    munmap(mapping_, mapped_size_);
+    mapping_ = nullptr;
+  }
+}
+
+void MappedInputFile::AdviseAround(size_t end) {
+  if (end > prefetched_until_ && prefetched_until_ < mapped_size_) {
+    size_t prefetch_end = std::min(end + kReadAheadSize, mapped_size_);
+    madvise(mapping_ + prefetched_until_, prefetch_end - prefetched_until_,
+            MADV_WILLNEED);
+    // Rounded down so the next range starts on a page boundary.
+    prefetched_until_ =
+        prefetch_end == mapped_size_
+            ? mapped_size_
+            : prefetch_end / kReadAheadSize * kReadAheadSize;
+  }
+  if (position_ - released_until_ >= kReleaseSize) {
+    size_t release_end = position_ / kReleaseSize * kReleaseSize;
+    madvise(mapping_ + released_until_, release_end - released_until_,
+            MADV_DONTNEED);
+    released_until_ = release_end;
+  }
+}
+
+ExceptionOr<ByteArray> MappedInputFile::ReadFromFile(std::int64_t size) {
+  if (size <= 0) {
+    return ExceptionOr<ByteArray>{ByteArray{}};
+  }
+  std::string buffer(size, '\0');
+  ssize_t num_bytes_read;
+  do {
+    num_bytes_read = pread(fd_, buffer.data(), buffer.size(), position_);
+  } while (num_bytes_read < 0 && errno == EINTR);
+  if (num_bytes_read < 0) {
+    return ExceptionOr<ByteArray>{Exception::kIo};
+  }
+  buffer.resize(num_bytes_read);
+  position_ += num_bytes_read;
+  return ExceptionOr<ByteArray>(ByteArray(std::move(buffer)));
+}
+
+}  // namespace shared
+}  // namespace nearby
@@ -0,0 +1,92 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLATFORM_IMPL_SHARED_MAPPED_FILE_H_
+#define PLATFORM_IMPL_SHARED_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "internal/platform/byte_array.h"
+#include "internal/platform/exception.h"
+#include "internal/platform/implementation/input_file.h"
+
+namespace nearby {
+namespace shared {
+
+// An InputFile that maps the whole file read-only and copies every chunk
+// straight out of the page cache, instead of read()ing it into a stream
+// buffer and copying it again. The kernel is told the file is read
+// sequentially, pages ahead of the reader are prefetched and pages behind it
+// are released, so a multi-GB file doesn't stay resident.
+//
+// The size is checked before every read; once it changed, the rest of the
+// file is read with pread() from the current position, the way IOFile reads
+// a file that grows or shrinks under it. A file truncated between the check
+// and the copy still raises SIGBUS, so this is only for files nothing
+// truncates while they're read, and platforms only use it when
+// FeatureFlags::Flags::enable_mapped_input_file is set.
+class MappedInputFile final : public api::InputFile {
+ public:
+  // Returns nullptr if the file can't be opened or mapped, e.g. because it's
+  // empty or not a regular file. Callers fall back to IOFile then.
+  static std::unique_ptr<MappedInputFile> Create(absl::string_view file_path,
+                                                 std::int64_t size);
+
+  MappedInputFile(const MappedInputFile&) = delete;
+  MappedInputFile& operator=(const MappedInputFile&) = delete;
+  ~MappedInputFile() override;
+
+  ExceptionOr<ByteArray> Read(std::int64_t size) override;
+  // Moves the position without reading the skipped bytes.
+  ExceptionOr<size_t> Skip(size_t offset) override;
+
+  std::string GetFilePath() const override { return path_; }
+
+  std::int64_t GetTotalSize() const override { return total_size_; }
+  Exception Close() override;
+
+  // Whether reads are still served from the mapping.
+  bool IsMapped() const { return mapping_ != nullptr; }
+
+ private:
+  MappedInputFile(absl::string_view file_path, std::int64_t total_size, int fd,
+                  char* mapping, size_t mapped_size);
+
+  bool MappedSizeUnchanged() const;
+  void Unmap();
+  // Prefetches the pages up to a window past `end`, and releases the ones
+  // already read.
+  void AdviseAround(size_t end);
+  ExceptionOr<ByteArray> ReadFromFile(std::int64_t size);
+
+  const std::string path_;
+  const std::int64_t total_size_;
+  int fd_;
+  char* mapping_;
+  size_t mapped_size_;
+  // The offset of the next byte to read.
+  size_t position_ = 0;
+  // Page aligned ends of the ranges already prefetched and released.
+  size_t prefetched_until_ = 0;
+  size_t released_until_ = 0;
+};
+
+}  // namespace shared
+}  // namespace nearby
+
+#endif  // PLATFORM_IMPL_SHARED_MAPPED_FILE_H_
@@ -0,0 +1,84 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "file/util/temp_path.h"
+#include "internal/platform/byte_array.h"
+#include "internal/platform/exception.h"
+#include "internal/platform/implementation/input_file.h"
+#include "internal/platform/implementation/shared/file.h"
+#include "internal/platform/implementation/shared/mapped_file.h"
+
+namespace nearby {
+namespace shared {
+namespace {
+
+// The chunk size outgoing FILE payloads are read with.
+constexpr std::int64_t kChunkSize = 512 * 1024;
+
+std::string CreateFile(const TempPath& temp_path, std::int64_t size) {
+  std::string path = temp_path.path() + "/payload.bin";
+  std::ofstream file(path, std::ios::binary);
+  std::string block(1024 * 1024, 'x');
+  for (std::int64_t written = 0; written < size; written += block.size()) {
+    file.write(block.data(), block.size());
+  }
+  return path;
+}
+
+// Reads a whole file of state.range(0) MiB the way an outgoing FILE payload
+// is read. The file is in the page cache after the first iteration, which
+// leaves the cost of getting the bytes into userspace.
+template <bool kMapped>
+void BM_ReadFile(benchmark::State& state) {
+  std::int64_t size = state.range(0) * 1024 * 1024;
+  TempPath temp_path(TempPath::Local);
+  std::string path = CreateFile(temp_path, size);
+  for (auto _ : state) {
+    std::unique_ptr<api::InputFile> file;
+    if (kMapped) {
+      file = MappedInputFile::Create(path, size);
+    } else {
+      file = IOFile::CreateInputFile(path, size);
+    }
+    while (true) {
+      ExceptionOr<ByteArray> chunk = file->Read(kChunkSize);
+      if (!chunk.ok() || chunk.result().Empty()) break;
+      benchmark::DoNotOptimize(chunk.result().data());
+    }
+    file->Close();
+  }
+  state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_ReadFile</*kMapped=*/false>)
+    ->ArgName("MiB")
+    ->Arg(64)
+    ->Arg(1024)
+    ->Arg(4096)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ReadFile</*kMapped=*/true>)
+    ->ArgName("MiB")
+    ->Arg(64)
+    ->Arg(1024)
+    ->Arg(4096)
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace shared
+}  // namespace nearby
@@ -0,0 +1,149 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/implementation/shared/mapped_file.h"
+
+#include <filesystem>  // NOLINT(build/c++17)
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include "file/util/temp_path.h"
+#include "gtest/gtest.h"
+#include "absl/strings/string_view.h"
+#include "internal/platform/byte_array.h"
+#include "internal/platform/exception.h"
+
+namespace nearby {
+namespace shared {
+namespace {
+
+class MappedInputFileTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    temp_path_ = std::make_unique<TempPath>(TempPath::Local);
+    path_ = temp_path_->path() + "/file.txt";
+  }
+
+  void WriteToFile(absl::string_view text,
+                   std::ios::openmode mode = std::ios::trunc) {
+    std::ofstream file(path_, std::ios::binary | std::ios::out | mode);
+    file << text;
+  }
+
+  void AssertEquals(const ExceptionOr<ByteArray>& bytes,
+                    const std::string& expected) {
+    ASSERT_TRUE(bytes.ok());
+    EXPECT_EQ(std::string(bytes.result()), expected);
+  }
+
+  std::unique_ptr<TempPath> temp_path_;
+  std::string path_;
+};
+
+TEST_F(MappedInputFileTest, FailsToMapNonExistentFile) {
+  EXPECT_EQ(MappedInputFile::Create("/not/a/valid/path.txt", 0), nullptr);
+}
+
+TEST_F(MappedInputFileTest, FailsToMapEmptyFile) {
+  WriteToFile("");
+
+  EXPECT_EQ(MappedInputFile::Create(path_, 0), nullptr);
+}
+
+TEST_F(MappedInputFileTest, ReadsInChunksUntilEOF) {
+  WriteToFile("abcde");
+  auto file = MappedInputFile::Create(path_, 5);
+  ASSERT_NE(file, nullptr);
+
+  EXPECT_EQ(file->GetFilePath(), path_);
+  EXPECT_EQ(file->GetTotalSize(), 5);
+  AssertEquals(file->Read(2), "ab");
+  AssertEquals(file->Read(2), "cd");
+  AssertEquals(file->Read(2), "e");
+  AssertEquals(file->Read(2), "");
+  EXPECT_TRUE(file->IsMapped());
+}
+
+TEST_F(MappedInputFileTest, ReadAfterCloseFails) {
+  WriteToFile("abc");
+  auto file = MappedInputFile::Create(path_, 3);
+  ASSERT_NE(file, nullptr);
+
+  file->Close();
+
+  ExceptionOr<ByteArray> result = file->Read(3);
+  EXPECT_FALSE(result.ok());
+  EXPECT_TRUE(result.GetException().Raised(Exception::kIo));
+}
+
+TEST_F(MappedInputFileTest, ReadsAppendedBytesAfterFileGrows) {
+  WriteToFile("abc");
+  auto file = MappedInputFile::Create(path_, 3);
+  ASSERT_NE(file, nullptr);
+  AssertEquals(file->Read(2), "ab");
+
+  WriteToFile("def", std::ios::app);
+
+  AssertEquals(file->Read(10), "cdef");
+  EXPECT_FALSE(file->IsMapped());
+  AssertEquals(file->Read(10), "");
+}
+
+TEST_F(MappedInputFileTest, StopsAtNewEndAfterFileShrinks) {
+  WriteToFile(std::string(10000, 'a'));
+  auto file = MappedInputFile::Create(path_, 10000);
+  ASSERT_NE(file, nullptr);
+  AssertEquals(file->Read(2), "aa");
+
+  std::filesystem::resize_file(path_, 3);
+
+  AssertEquals(file->Read(10000), "a");
+  EXPECT_FALSE(file->IsMapped());
+  AssertEquals(file->Read(10000), "");
+}
+
+TEST_F(MappedInputFileTest, SkipsWithoutReading) {
+  WriteToFile("abcdef");
+  auto file = MappedInputFile::Create(path_, 6);
+  ASSERT_NE(file, nullptr);
+
+  ExceptionOr<size_t> skipped = file->Skip(2);
+  ASSERT_TRUE(skipped.ok());
+  EXPECT_EQ(skipped.result(), 2);
+  AssertEquals(file->Read(2), "cd");
+  skipped = file->Skip(10);
+  ASSERT_TRUE(skipped.ok());
+  EXPECT_EQ(skipped.result(), 2);
+  AssertEquals(file->Read(2), "");
+  EXPECT_TRUE(file->IsMapped());
+}
+
+TEST_F(MappedInputFileTest, SkipStopsAtNewEndAfterFileShrinks) {
+  WriteToFile(std::string(10000, 'a'));
+  auto file = MappedInputFile::Create(path_, 10000);
+  ASSERT_NE(file, nullptr);
+
+  std::filesystem::resize_file(path_, 3);
+
+  ExceptionOr<size_t> skipped = file->Skip(10000);
+  ASSERT_TRUE(skipped.ok());
+  EXPECT_EQ(skipped.result(), 3);
+  EXPECT_FALSE(file->IsMapped());
+  AssertEquals(file->Read(10000), "");
+}
+
+}  // namespace
+}  // namespace shared
+}  // namespace nearby
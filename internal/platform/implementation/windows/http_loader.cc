@@ -23,6 +23,7 @@
 #include "absl/strings/numbers.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "internal/platform/implementation/http_loader.h"
 #include "internal/platform/logging.h"
 
@@ -35,8 +36,35 @@ constexpr DWORD kHostNameMaximumLength = 256;
 
 using ::nearby::api::WebResponse;
 
+// WinInet keeps idle keep-alive connections per session, so all loaders share
+// one session for the life of the process and requests to the same server
+// reuse its connections instead of setting up new ones. The session is only
+// kept once it opens, so a failure is retried by the next request.
+absl::StatusOr<HINTERNET> GetInternetSession() {
+  static absl::Mutex* mutex = new absl::Mutex();
+  // Guarded by `mutex`.
+  static HINTERNET session = nullptr;
+  absl::MutexLock lock(mutex);
+  if (session == nullptr) {
+    session = InternetOpenA("Mozilla/5.0", /*Agent*/
+                            INTERNET_OPEN_TYPE_PRECONFIG,
+                            /*Access Type*/
+                            nullptr, /*Proxy*/
+                            nullptr, /*Proxy bypass*/
+                            0);      /*Flags*/
+    if (session == nullptr) {
+      DWORD error = GetLastError();
+      LOG(ERROR) << "Failed to open internet with error " << error << ".";
+      return absl::FailedPreconditionError(absl::StrCat(error));
+    }
+  }
+  return session;
+}
+
 }  // namespace
 
+HttpLoader::~HttpLoader() { DisconnectWebServer(); }
+
 absl::StatusOr<WebResponse> HttpLoader::GetResponse() {
   absl::Status status;
 
@@ -197,19 +225,12 @@ absl::Status HttpLoader::ParseUrl() {
 }
 
 absl::Status HttpLoader::ConnectWebServer() {
-  internet_handle_ = InternetOpenA("Mozilla/5.0",                /*Agent*/
-                                   INTERNET_OPEN_TYPE_PRECONFIG, /*Access Type*/
-                                   nullptr,                      /*Proxy*/
-                                   nullptr, /*Proxy bypass*/
-                                   0);      /*Flags*/
-
-  if (internet_handle_ == nullptr) {
-    LOG(ERROR) << "Failed to open internet with error " << GetLastError()
-               << ".";
-    return absl::FailedPreconditionError(absl::StrCat(GetLastError()));
+  absl::StatusOr<HINTERNET> internet_handle = GetInternetSession();
+  if (!internet_handle.ok()) {
+    return internet_handle.status();
   }
 
-  connect_handle_ = InternetConnectA(internet_handle_,      /*Internet*/
+  connect_handle_ = InternetConnectA(*internet_handle,      /*Internet*/
                                      host_.c_str(),         /*Server name*/
                                      port_,                 /*Port*/
                                      nullptr,               /*User name*/
@@ -221,7 +242,6 @@ absl::Status HttpLoader::ConnectWebServer() {
   if (connect_handle_ == nullptr) {
     LOG(ERROR) << "Failed to connect remote web server with error "
                << GetLastError() << ".";
-    InternetCloseHandle(internet_handle_);
     return absl::FailedPreconditionError(absl::StrCat(GetLastError()));
   }
 
@@ -229,7 +249,7 @@ absl::Status HttpLoader::ConnectWebServer() {
 }
 
 absl::Status HttpLoader::SendRequest() {
-  DWORD flags = INTERNET_FLAG_NO_AUTO_REDIRECT;
+  DWORD flags = INTERNET_FLAG_NO_AUTO_REDIRECT | INTERNET_FLAG_KEEP_CONNECTION;
   if (is_secure_) {
     flags |= INTERNET_FLAG_SECURE;
   }
@@ -246,9 +266,6 @@ absl::Status HttpLoader::SendRequest() {
   if (request_handle_ == nullptr) {
     LOG(ERROR) << "Failed to open request to remote web server with error "
                << GetLastError() << ".";
-    InternetCloseHandle(internet_handle_);
-    InternetCloseHandle(connect_handle_);
-
     return absl::FailedPreconditionError(absl::StrCat(GetLastError()));
   }
 
@@ -287,10 +304,6 @@ absl::Status HttpLoader::SendRequest() {
   if (result == FALSE) {
     LOG(ERROR) << "Failed to send request to remote web server with error "
                << GetLastError() << ".";
-    InternetCloseHandle(request_handle_);
-    InternetCloseHandle(connect_handle_);
-    InternetCloseHandle(internet_handle_);
-
     return absl::FailedPreconditionError(absl::StrCat(GetLastError()));
   }
 
@@ -336,9 +349,6 @@ absl::StatusOr<WebResponse> HttpLoader::ProcessResponse() {
     } else {
       LOG(ERROR) << "Failed to read response from remote web server with error "
                  << GetLastError() << ".";
-      InternetCloseHandle(request_handle_);
-      InternetCloseHandle(connect_handle_);
-      InternetCloseHandle(internet_handle_);
       return absl::FailedPreconditionError(absl::StrCat(GetLastError()));
     }
   }
@@ -361,11 +371,6 @@ void HttpLoader::DisconnectWebServer() {
     InternetCloseHandle(connect_handle_);
     connect_handle_ = nullptr;
   }
-
-  if (internet_handle_ != nullptr) {
-    InternetCloseHandle(internet_handle_);
-    internet_handle_ = nullptr;
-  }
 }
 
 absl::Status HttpLoader::HTTPCodeToStatus(int status_code,
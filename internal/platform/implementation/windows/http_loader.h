@@ -31,12 +31,13 @@ namespace windows {
 // HttpLoader is used to get HTTP response from remote server.
 //
 // HttpLoader gets HTTP request information from caller, and calling Windows
-// WinInet APIs to get HTTP response. The platform handles HTTP/HTTPS sessions.
+// WinInet APIs to get HTTP response. The platform handles HTTP/HTTPS sessions;
+// connections are kept alive and reused across loaders.
 class HttpLoader {
  public:
   explicit HttpLoader(const nearby::api::WebRequest& request)
       : request_(request) {}
-  ~HttpLoader() = default;
+  ~HttpLoader();
 
   absl::StatusOr<nearby::api::WebResponse> GetResponse();
 
@@ -74,7 +75,6 @@ class HttpLoader {
   bool is_secure_ = false;
   int port_ = 80;
 
-  HINTERNET internet_handle_ = nullptr;
   HINTERNET connect_handle_ = nullptr;
   HINTERNET request_handle_ = nullptr;
 };
@@ -39,6 +39,9 @@ namespace nearby {
 namespace windows {
 namespace {
 using json = ::nlohmann::json;
+
+// Journaled changes to allow before compacting them into the preferences file.
+constexpr int kMaxJournalSize = 64;
 }  // namespace
 
 PreferencesManager::PreferencesManager(absl::string_view file_path)
@@ -57,6 +60,8 @@ PreferencesManager::PreferencesManager(absl::string_view file_path)
   value_ = preferences_repository_->LoadPreferences();
 }
 
+PreferencesManager::~PreferencesManager() { Flush(); }
+
 bool PreferencesManager::Set(absl::string_view key, const json& value) {
   absl::MutexLock lock(&mutex_);
   return SetValue(key, value);
@@ -116,7 +121,7 @@ bool PreferencesManager::SetTime(absl::string_view key, absl::Time value) {
   }
 
   value_[absl::StrCat(key)] = tt;
-  return Commit();
+  return Commit(key, tt);
 }
 
 // Get JSON value.
@@ -188,13 +193,36 @@ absl::Time PreferencesManager::GetTime(absl::string_view key,
 // Removes preferences
 void PreferencesManager::Remove(absl::string_view key) {
   absl::MutexLock lock(&mutex_);
-  value_.erase(absl::StrCat(key));
+  if (value_.erase(absl::StrCat(key)) > 0) {
+    Commit(key, std::nullopt);
+  }
+}
+
+void PreferencesManager::Flush() {
+  absl::MutexLock lock(&mutex_);
+  if (preferences_repository_->GetJournalSize() > 0) {
+    Compact();
+  }
 }
 
 // Private methods
 
+bool PreferencesManager::Commit(absl::string_view key,
+                                const std::optional<json>& value) {
+  if (!preferences_repository_->AppendToJournal(key, value)) {
+    // Without the journal, the change is only safe once the whole file has
+    // been written.
+    return Compact();
+  }
+  if (preferences_repository_->GetJournalSize() >= kMaxJournalSize) {
+    // The change is already journaled, so a failure here loses nothing.
+    Compact();
+  }
+  return true;
+}
+
 // Writes data to storage.
-bool PreferencesManager::Commit() {
+bool PreferencesManager::Compact() {
   if (!preferences_repository_->SavePreferences(value_)) {
     LOG(ERROR) << "Failed to save preference." << std::endl;
     return false;
@@ -214,7 +242,7 @@ bool PreferencesManager::SetValue(absl::string_view key, const json& value) {
   }
 
   value_[absl::StrCat(key)] = value;
-  return Commit();
+  return Commit(key, value);
 }
 
 template <typename T>
@@ -252,7 +280,7 @@ bool PreferencesManager::SetArrayValue(absl::string_view key,
   }
 
   value_[absl::StrCat(key)] = array_value;
-  return Commit();
+  return Commit(key, array_value);
 }
 
 template <typename T>
@@ -18,6 +18,7 @@
 #include <stdint.h>
 
 #include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -41,6 +42,7 @@ namespace windows {
 class PreferencesManager : public api::PreferencesManager {
  public:
   explicit PreferencesManager(absl::string_view path);
+  ~PreferencesManager() override;
 
   // Sets values
 
@@ -108,9 +110,19 @@ class PreferencesManager : public api::PreferencesManager {
   // Removes preferences
   void Remove(absl::string_view key) override ABSL_LOCKS_EXCLUDED(mutex_);
 
+  // Rewrites the preferences file if there are journaled changes.
+  void Flush() override ABSL_LOCKS_EXCLUDED(mutex_);
+
  private:
-  // Writes data to storage.
-  bool Commit() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Journals a change to `key`, or its removal if `value` is std::nullopt.
+  // Every `kMaxJournalSize` changes the journal is compacted into the
+  // preferences file, so a burst of changes rewrites the file once.
+  bool Commit(absl::string_view key,
+              const std::optional<nlohmann::json>& value)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Writes all preferences to storage.
+  bool Compact() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
   bool SetValue(absl::string_view key, const nlohmann::json& value)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
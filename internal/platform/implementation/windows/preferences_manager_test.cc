@@ -182,5 +182,21 @@ TEST(PreferencesManager, RemoveKey) {
   EXPECT_EQ(result, "default key");
 }
 
+TEST(PreferencesManager, ChangesArePersisted) {
+  std::string int_key = "persisted_int_key";
+  std::string string_key = "persisted_string_key";
+  {
+    PreferencesManager pm(kPreferencesFilePath);
+    pm.SetInteger(int_key, 42);
+    pm.SetString(string_key, "removed");
+    pm.Remove(string_key);
+  }
+
+  PreferencesManager pm(kPreferencesFilePath);
+  EXPECT_EQ(pm.GetInteger(int_key, 0), 42);
+  EXPECT_EQ(pm.GetString(string_key, "default"), "default");
+  pm.Remove(int_key);
+}
+
 }  // namespace windows
 }  // namespace nearby
@@ -18,7 +18,9 @@
 #include <filesystem>  // NOLINT(build/c++17)
 #include <fstream>
 #include <optional>
+#include <string>
 
+#include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
 #include "nlohmann/json.hpp"
 #include "nlohmann/json_fwd.hpp"
@@ -32,11 +34,23 @@ using json = ::nlohmann::json;
 
 constexpr char kPreferencesFileName[] = "preferences.json";
 constexpr char kPreferencesBackupFileName[] = "preferences_bak.json";
+constexpr char kPreferencesJournalFileName[] = "preferences_journal.json";
+
+// Journal entries are one JSON object per line, {"k": key, "v": value}, with
+// no value for a removal.
+constexpr char kJournalKey[] = "k";
+constexpr char kJournalValue[] = "v";
 
 }  // namespace
 
 json PreferencesRepository::LoadPreferences() {
   absl::MutexLock lock(&mutex_);
+  json preferences = LoadSnapshot();
+  ReplayJournal(preferences);
+  return preferences;
+}
+
+json PreferencesRepository::LoadSnapshot() {
   std::optional<json> preferences = AttemptLoad();
   if (preferences.has_value()) {
     // The top level root should be an object, if it's not then something went
@@ -100,7 +114,18 @@ bool PreferencesRepository::SavePreferences(json preferences) {
         LOG(ERROR) << "Failed to restore preferences file.";
         return false;
       }
+      // The backup doesn't have the journaled changes, so keep the journal.
+      return true;
     }
+
+    std::filesystem::path journal_name = path / kPreferencesJournalFileName;
+    if (nearby::sharing::FileExists(journal_name) &&
+        !nearby::sharing::RemoveFile(journal_name)) {
+      // Replaying the journal over the new snapshot is harmless, so this
+      // isn't a failure.
+      LOG(WARNING) << "Failed to remove preferences journal.";
+    }
+    journal_size_ = 0;
   } catch (const std::exception& e) {
     LOG(ERROR) << "Failed to save preferences file: " << e.what();
     return false;
@@ -112,6 +137,88 @@ bool PreferencesRepository::SavePreferences(json preferences) {
   return true;
 }
 
+bool PreferencesRepository::AppendToJournal(absl::string_view key,
+                                            const std::optional<json>& value) {
+  absl::MutexLock lock(&mutex_);
+  try {
+    std::filesystem::path path = path_;
+    if (!nearby::sharing::FileExists(path) &&
+        !nearby::sharing::CreateDirectories(path)) {
+      LOG(ERROR) << "Failed to create preferences path.";
+      return false;
+    }
+
+    json entry = {{kJournalKey, std::string(key)}};
+    if (value.has_value()) {
+      entry[kJournalValue] = *value;
+    }
+
+    std::ofstream journal_file(path / kPreferencesJournalFileName,
+                               std::ios::app);
+    // Entries start rather than end with a newline, so an entry that a crash
+    // left half written can't swallow the next one.
+    journal_file << '\n' << entry.dump();
+    journal_file.flush();
+    if (!journal_file.good()) {
+      LOG(ERROR) << "Failed to append to preferences journal.";
+      return false;
+    }
+  } catch (const std::exception& e) {
+    LOG(ERROR) << "Failed to append to preferences journal: " << e.what();
+    return false;
+  } catch (...) {
+    LOG(ERROR) << __func__ << ": Unknown exception.";
+    return false;
+  }
+
+  ++journal_size_;
+  return true;
+}
+
+int PreferencesRepository::GetJournalSize() {
+  absl::MutexLock lock(&mutex_);
+  return journal_size_;
+}
+
+void PreferencesRepository::ReplayJournal(json& preferences) {
+  journal_size_ = 0;
+  std::filesystem::path full_name =
+      std::filesystem::path(path_) / kPreferencesJournalFileName;
+  if (!nearby::sharing::FileExists(full_name)) {
+    return;
+  }
+
+  try {
+    std::ifstream journal_file(full_name);
+    std::string line;
+    while (std::getline(journal_file, line)) {
+      if (line.empty()) continue;
+      json entry = json::parse(line, nullptr, false);
+      // A crash while appending leaves a partial last line. That change was
+      // never acknowledged, so it's skipped.
+      if (entry.is_discarded() || !entry.is_object() ||
+          !entry.contains(kJournalKey) || !entry[kJournalKey].is_string()) {
+        LOG(WARNING) << "Skipping malformed preferences journal entry.";
+        continue;
+      }
+
+      std::string key = entry[kJournalKey].get<std::string>();
+      auto value = entry.find(kJournalValue);
+      if (value == entry.end()) {
+        preferences.erase(key);
+      } else {
+        preferences[key] = *value;
+      }
+      ++journal_size_;
+    }
+  } catch (const std::exception& e) {
+    LOG(ERROR) << "Exception while replaying preferences journal: "
+               << e.what();
+  } catch (...) {
+    LOG(ERROR) << __func__ << ": Unknown exception.";
+  }
+}
+
 std::optional<json> PreferencesRepository::AttemptLoad() {
   std::filesystem::path path = path_;
   std::filesystem::path full_name = path / kPreferencesFileName;
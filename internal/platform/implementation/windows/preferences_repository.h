@@ -27,19 +27,38 @@
 namespace nearby {
 namespace windows {
 
+// Preferences are stored as a full snapshot plus an append-only journal of
+// the changes made since. Appending a change is cheap, so it's done for every
+// change; rewriting the snapshot (which empties the journal) is left to the
+// caller to do now and then.
 class PreferencesRepository {
  public:
   explicit PreferencesRepository(absl::string_view path) : path_(path) {}
 
+  // Loads the snapshot and replays the journal on top of it.
   nlohmann::json LoadPreferences() ABSL_LOCKS_EXCLUDED(&mutex_);
+  // Rewrites the snapshot and, once it's safely on disk, empties the journal.
   bool SavePreferences(nlohmann::json preferences) ABSL_LOCKS_EXCLUDED(&mutex_);
 
+  // Records that `key` was set to `value`, or removed if `value` is
+  // std::nullopt. The change is flushed to disk before returning.
+  bool AppendToJournal(absl::string_view key,
+                       const std::optional<nlohmann::json>& value)
+      ABSL_LOCKS_EXCLUDED(&mutex_);
+  // Number of changes in the journal.
+  int GetJournalSize() ABSL_LOCKS_EXCLUDED(&mutex_);
+
   std::optional<nlohmann::json> AttemptLoad();
   std::optional<nlohmann::json> RestoreFromBackup();
 
  private:
+  nlohmann::json LoadSnapshot() ABSL_EXCLUSIVE_LOCKS_REQUIRED(&mutex_);
+  void ReplayJournal(nlohmann::json& preferences)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(&mutex_);
+
   absl::Mutex mutex_;
   const std::string path_;
+  int journal_size_ ABSL_GUARDED_BY(&mutex_) = 0;
 };
 
 }  // namespace windows
@@ -32,6 +32,7 @@ using json = ::nlohmann::json;
 
 constexpr char kPreferencesFileName[] = "preferences.json";
 constexpr char kPreferencesBackupFileName[] = "preferences_bak.json";
+constexpr char kPreferencesJournalFileName[] = "preferences_journal.json";
 constexpr char kPreferencesPath[] = "Google/Nearby/Sharing";
 
 TEST(PreferencesRepository, LoadWithBadPath) {
@@ -156,6 +157,53 @@ TEST(PreferencesRepository, RecoverFromCorruption) {
   EXPECT_FALSE(std::filesystem::exists(full_name_backup));
 }
 
+TEST(PreferencesRepository, ReplayJournalUntilSaved) {
+  std::optional<std::filesystem::path> app_data_path =
+      api::ImplementationPlatform::CreateDeviceInfo()->GetLocalAppDataPath();
+  ASSERT_TRUE(app_data_path.has_value());
+  std::filesystem::path full_path = *app_data_path / kPreferencesPath;
+  std::filesystem::path full_name = full_path / kPreferencesFileName;
+  std::filesystem::path full_name_journal =
+      full_path / kPreferencesJournalFileName;
+
+  if (std::filesystem::exists(full_name)) {
+    std::filesystem::remove(full_name);
+  }
+
+  if (std::filesystem::exists(full_name_journal)) {
+    std::filesystem::remove(full_name_journal);
+  }
+
+  PreferencesRepository preferences_repository{full_path.string()};
+  json data;
+  data["key1"] = "value1";
+  data["key2"] = "value2";
+  EXPECT_TRUE(preferences_repository.SavePreferences(data));
+  EXPECT_TRUE(preferences_repository.AppendToJournal("key1", "new value1"));
+  EXPECT_TRUE(preferences_repository.AppendToJournal("key2", std::nullopt));
+  EXPECT_TRUE(preferences_repository.AppendToJournal("key3", 3));
+
+  // A change that was being appended when the process died.
+  std::ofstream journal_file(full_name_journal.c_str(), std::ios::app);
+  journal_file << "\n{\"k\":\"key4\",\"v";
+  journal_file.close();
+  EXPECT_TRUE(preferences_repository.AppendToJournal("key5", 5));
+
+  PreferencesRepository reloaded_repository{full_path.string()};
+  json result = reloaded_repository.LoadPreferences();
+  EXPECT_EQ(reloaded_repository.GetJournalSize(), 4);
+  EXPECT_EQ(result.size(), 3);
+  EXPECT_EQ(result["key1"], "new value1");
+  EXPECT_EQ(result["key3"], 3);
+  EXPECT_EQ(result["key5"], 5);
+
+  EXPECT_TRUE(reloaded_repository.SavePreferences(result));
+  EXPECT_EQ(reloaded_repository.GetJournalSize(), 0);
+  EXPECT_FALSE(std::filesystem::exists(full_name_journal));
+  EXPECT_EQ(reloaded_repository.LoadPreferences(), result);
+  std::filesystem::remove(full_name);
+}
+
 }  // namespace
 }  // namespace windows
 }  // namespace nearby
@@ -0,0 +1,137 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLATFORM_PUBLIC_MPMC_QUEUE_H_
+#define PLATFORM_PUBLIC_MPMC_QUEUE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+
+namespace nearby {
+
+// A bounded lock-free queue for any number of producers and consumers.
+//
+// The values live in a ring of `capacity` cells allocated up front, so pushing
+// and popping never allocate. Every cell carries a sequence number telling
+// whose turn it is: a producer may fill the cell when its sequence equals
+// twice the producer's ticket, a consumer may empty it when it equals twice
+// the ticket plus one. (Doubling keeps "full" and "empty for the next lap"
+// apart even when the ring has a single cell.) Claiming a ticket is one
+// compare-and-swap on the shared head or tail, and values are moved in and
+// out, never copied.
+//
+// TryPush() and TryPop() never block; callers that want to wait build that on
+// top, as ArrayBlockingQueue does.
+template <typename T>
+class MpmcQueue {
+ public:
+  explicit MpmcQueue(std::size_t capacity)
+      : capacity_(std::max<std::size_t>(capacity, 1)),
+        cells_(new Cell[capacity_]) {
+    for (std::size_t i = 0; i < capacity_; ++i) {
+      cells_[i].sequence.store(2 * i, std::memory_order_relaxed);
+    }
+  }
+  MpmcQueue(const MpmcQueue&) = delete;
+  MpmcQueue& operator=(const MpmcQueue&) = delete;
+  ~MpmcQueue() {
+    while (TryPop().has_value()) {
+    }
+  }
+
+  // Moves `value` into the queue, unless it's full. `value` is left alone if
+  // the push fails.
+  bool TryPush(T&& value) {
+    std::size_t ticket = tail_.load(std::memory_order_relaxed);
+    while (true) {
+      Cell& cell = cells_[ticket % capacity_];
+      std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+      if (sequence == 2 * ticket) {
+        if (tail_.compare_exchange_weak(ticket, ticket + 1,
+                                        std::memory_order_relaxed)) {
+          new (cell.value()) T(std::move(value));
+          cell.sequence.store(2 * ticket + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (sequence < 2 * ticket) {
+        // The cell still holds the value from the previous lap.
+        return false;
+      } else {
+        ticket = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Returns std::nullopt if the queue is empty.
+  std::optional<T> TryPop() {
+    std::size_t ticket = head_.load(std::memory_order_relaxed);
+    while (true) {
+      Cell& cell = cells_[ticket % capacity_];
+      std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+      if (sequence == 2 * ticket + 1) {
+        if (head_.compare_exchange_weak(ticket, ticket + 1,
+                                        std::memory_order_relaxed)) {
+          std::optional<T> value(std::move(*cell.value()));
+          cell.value()->~T();
+          cell.sequence.store(2 * (ticket + capacity_),
+                             std::memory_order_release);
+          return value;
+        }
+      } else if (sequence < 2 * ticket + 1) {
+        // Nothing has been pushed into the cell yet.
+        return std::nullopt;
+      } else {
+        ticket = head_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // The number of values in the queue. Only a snapshot while other threads
+  // push or pop.
+  std::size_t Size() const {
+    std::size_t head = head_.load(std::memory_order_acquire);
+    std::size_t tail = tail_.load(std::memory_order_acquire);
+    return tail > head ? tail - head : 0;
+  }
+
+  bool Empty() const { return Size() == 0; }
+
+  std::size_t capacity() const { return capacity_; }
+
+ private:
+  static constexpr std::size_t kCacheLineSize = 64;
+
+  struct Cell {
+    T* value() { return std::launder(reinterpret_cast<T*>(storage)); }
+
+    std::atomic<std::size_t> sequence;
+    alignas(T) unsigned char storage[sizeof(T)];
+  };
+
+  const std::size_t capacity_;
+  const std::unique_ptr<Cell[]> cells_;
+  // Producers and consumers each hammer their own end; keep them on separate
+  // cache lines.
+  alignas(kCacheLineSize) std::atomic<std::size_t> tail_ = 0;
+  alignas(kCacheLineSize) std::atomic<std::size_t> head_ = 0;
+};
+
+}  // namespace nearby
+
+#endif  // PLATFORM_PUBLIC_MPMC_QUEUE_H_
@@ -0,0 +1,153 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/mpmc_queue.h"
+
+#include <memory>
+#include <optional>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace nearby {
+namespace {
+
+using ::testing::Optional;
+
+TEST(MpmcQueueTest, PopsInPushOrder) {
+  MpmcQueue<int> queue(4);
+
+  EXPECT_TRUE(queue.TryPush(1));
+  EXPECT_TRUE(queue.TryPush(2));
+  EXPECT_TRUE(queue.TryPush(3));
+
+  EXPECT_EQ(queue.Size(), 3);
+  EXPECT_THAT(queue.TryPop(), Optional(1));
+  EXPECT_THAT(queue.TryPop(), Optional(2));
+  EXPECT_THAT(queue.TryPop(), Optional(3));
+  EXPECT_TRUE(queue.Empty());
+}
+
+TEST(MpmcQueueTest, PopFromEmptyQueueFails) {
+  MpmcQueue<int> queue(4);
+
+  EXPECT_EQ(queue.TryPop(), std::nullopt);
+}
+
+TEST(MpmcQueueTest, PushToFullQueueFails) {
+  MpmcQueue<int> queue(2);
+
+  EXPECT_TRUE(queue.TryPush(1));
+  EXPECT_TRUE(queue.TryPush(2));
+  EXPECT_FALSE(queue.TryPush(3));
+
+  EXPECT_THAT(queue.TryPop(), Optional(1));
+  EXPECT_TRUE(queue.TryPush(3));
+  EXPECT_THAT(queue.TryPop(), Optional(2));
+  EXPECT_THAT(queue.TryPop(), Optional(3));
+}
+
+TEST(MpmcQueueTest, WrapsAroundManyTimes) {
+  MpmcQueue<int> queue(3);
+
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_TRUE(queue.TryPush(std::move(i)));
+    ASSERT_THAT(queue.TryPop(), Optional(i));
+  }
+  EXPECT_TRUE(queue.Empty());
+}
+
+TEST(MpmcQueueTest, ZeroCapacityHoldsOneValue) {
+  MpmcQueue<int> queue(0);
+
+  EXPECT_EQ(queue.capacity(), 1);
+  EXPECT_TRUE(queue.TryPush(1));
+  EXPECT_FALSE(queue.TryPush(2));
+}
+
+TEST(MpmcQueueTest, MovesValuesInAndOut) {
+  MpmcQueue<std::unique_ptr<int>> queue(1);
+  auto value = std::make_unique<int>(7);
+  auto other = std::make_unique<int>(8);
+
+  EXPECT_TRUE(queue.TryPush(std::move(value)));
+  EXPECT_FALSE(queue.TryPush(std::move(other)));
+
+  // A failed push leaves the value with the caller.
+  ASSERT_NE(other, nullptr);
+  std::optional<std::unique_ptr<int>> popped = queue.TryPop();
+  ASSERT_TRUE(popped.has_value());
+  EXPECT_EQ(**popped, 7);
+}
+
+TEST(MpmcQueueTest, DestroysValuesLeftInQueue) {
+  auto value = std::make_shared<int>(1);
+  {
+    MpmcQueue<std::shared_ptr<int>> queue(4);
+    queue.TryPush(std::shared_ptr<int>(value));
+    queue.TryPush(std::shared_ptr<int>(value));
+    EXPECT_EQ(value.use_count(), 3);
+  }
+
+  EXPECT_EQ(value.use_count(), 1);
+}
+
+TEST(MpmcQueueTest, EveryValueIsPoppedOnceAcrossThreads) {
+  constexpr int kThreads = 4;
+  constexpr int kValuesPerThread = 10000;
+  MpmcQueue<int> queue(8);
+  std::vector<int> popped_count(kThreads * kValuesPerThread);
+  std::vector<std::vector<int>> popped(kThreads);
+  std::vector<std::thread> threads;
+
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&queue, t]() {
+      for (int i = 0; i < kValuesPerThread; ++i) {
+        int value = t * kValuesPerThread + i;
+        while (!queue.TryPush(std::move(value))) {
+          std::this_thread::yield();
+        }
+      }
+    });
+    threads.emplace_back([&queue, &popped, t]() {
+      while (popped[t].size() < kValuesPerThread) {
+        std::optional<int> value = queue.TryPop();
+        if (value.has_value()) {
+          popped[t].push_back(*value);
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  for (const std::vector<int>& values : popped) {
+    for (int value : values) {
+      ++popped_count[value];
+    }
+  }
+  for (int count : popped_count) {
+    EXPECT_EQ(count, 1);
+  }
+  EXPECT_TRUE(queue.Empty());
+}
+
+}  // namespace
+}  // namespace nearby
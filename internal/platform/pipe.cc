@@ -14,9 +14,10 @@
 
 #include "internal/platform/pipe.h"
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
-#include <deque>
+#include <cstring>
 #include <memory>
 #include <utility>
 
@@ -32,9 +33,27 @@
 namespace nearby {
 
 namespace {
+
+size_t RoundUpToPowerOfTwo(size_t value) {
+  size_t result = 1;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+// A single-producer/single-consumer byte ring that grows on demand.
+//
+// Nothing is allocated until the first write, which allocates
+// `initial_capacity` bytes (rounded up to a power of two). A write that does
+// not fit doubles the ring rather than waiting for the reader, so `Write()`
+// never blocks; once the reader has drained a grown ring it is released, and
+// the next write starts over at `initial_capacity`.
 class Pipe {
  public:
-  Pipe() = default;
+  explicit Pipe(size_t initial_capacity)
+      : initial_capacity_(
+            RoundUpToPowerOfTwo(std::max<size_t>(initial_capacity, 1))) {}
 
   class PipeInputStream : public InputStream {
    public:
@@ -80,105 +99,142 @@ class Pipe {
   void MarkInputStreamClosed() ABSL_LOCKS_EXCLUDED(mutex_);
   void MarkOutputStreamClosed() ABSL_LOCKS_EXCLUDED(mutex_);
 
-  Exception WriteLocked(const ByteArray& data)
+  // Makes room for `size` more bytes, moving the buffered ones to the start
+  // of a bigger ring if they don't fit.
+  void ReserveLocked(size_t size) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void CopyFromRingLocked(std::uint64_t position, char* dest,
+                          size_t size) const
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void CopyToRingLocked(std::uint64_t position, const char* source,
+                        size_t size) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
-  bool input_stream_closed_ ABSL_GUARDED_BY(mutex_) = false;
-  bool output_stream_closed_ ABSL_GUARDED_BY(mutex_) = false;
-  bool read_all_chunks_ ABSL_GUARDED_BY(mutex_) = false;
+  const size_t initial_capacity_;
 
-  std::deque<ByteArray> ABSL_GUARDED_BY(mutex_) buffer_;
   // Order of declaration matters:
   // - mutex must be defined before condvar;
   Mutex mutex_;
   ConditionVariable cond_{&mutex_};
+
+  std::unique_ptr<char[]> ring_ ABSL_GUARDED_BY(mutex_);
+  size_t capacity_ ABSL_GUARDED_BY(mutex_) = 0;
+  // Total number of bytes ever consumed (`head_`) and produced (`tail_`).
+  std::uint64_t head_ ABSL_GUARDED_BY(mutex_) = 0;
+  std::uint64_t tail_ ABSL_GUARDED_BY(mutex_) = 0;
+
+  bool input_stream_closed_ ABSL_GUARDED_BY(mutex_) = false;
+  bool output_stream_closed_ ABSL_GUARDED_BY(mutex_) = false;
 };
 
-ExceptionOr<ByteArray> Pipe::Read(size_t size) {
-  MutexLock lock(&mutex_);
+void Pipe::ReserveLocked(size_t size) {
+  size_t buffered = tail_ - head_;
+  if (buffered + size <= capacity_) return;
 
-  // We're done reading all the chunks that were written before the OutputStream
-  // was closed, so there's nothing to do here other than return an empty chunk
-  // to serve as an EOF indication to callers.
-  if (read_all_chunks_) {
-    return ExceptionOr<ByteArray>{ByteArray{}};
+  size_t capacity = RoundUpToPowerOfTwo(
+      std::max(buffered + size, std::max(capacity_ * 2, initial_capacity_)));
+  auto ring = std::make_unique_for_overwrite<char[]>(capacity);
+  if (buffered > 0) {
+    CopyFromRingLocked(head_, ring.get(), buffered);
   }
+  ring_ = std::move(ring);
+  capacity_ = capacity;
+  head_ = 0;
+  tail_ = buffered;
+}
 
-  while (buffer_.empty() && !input_stream_closed_) {
-    Exception wait_exception = cond_.Wait();
+void Pipe::CopyFromRingLocked(std::uint64_t position, char* dest,
+                              size_t size) const {
+  size_t offset = position & (capacity_ - 1);
+  size_t first_part = std::min(size, capacity_ - offset);
+  std::memcpy(dest, ring_.get() + offset, first_part);
+  std::memcpy(dest + first_part, ring_.get(), size - first_part);
+}
 
+void Pipe::CopyToRingLocked(std::uint64_t position, const char* source,
+                            size_t size) {
+  size_t offset = position & (capacity_ - 1);
+  size_t first_part = std::min(size, capacity_ - offset);
+  std::memcpy(ring_.get() + offset, source, first_part);
+  std::memcpy(ring_.get(), source + first_part, size - first_part);
+}
+
+ExceptionOr<ByteArray> Pipe::Read(size_t size) {
+  MutexLock lock(&mutex_);
+
+  while (head_ == tail_ && !input_stream_closed_ && !output_stream_closed_) {
+    Exception wait_exception = cond_.Wait();
     if (wait_exception.Raised()) {
       return ExceptionOr<ByteArray>{wait_exception};
     }
   }
-
-  // If we received our sentinel chunk, mark the fact that there cannot
-  // possibly be any more chunks to read here on in, and return an empty chunk
-  // to serve as an EOF indication to callers.
-  if (buffer_.empty() || buffer_.front().Empty()) {
-    read_all_chunks_ = true;
+  // Either end was closed and everything written before that has already been
+  // read, so return an empty chunk to serve as an EOF indication to callers.
+  if (head_ == tail_ || size == 0) {
     return ExceptionOr<ByteArray>{ByteArray{}};
   }
 
-  ByteArray first_chunk{buffer_.front()};
-  buffer_.pop_front();
-
-  // If first_chunk is small enough to not overshoot the requested 'size', just
-  // return that.
-  if (first_chunk.size() <= size) {
-    return ExceptionOr<ByteArray>{first_chunk};
-  } else {
-    // Break first_chunk into 2 parts -- the first one of which (next_chunk)
-    // will be 'size' bytes long, and will be returned, and the second one of
-    // which (overflow_chunk) will be re-inserted into buffer_, at the head of
-    // the queue, to be served up in the next call to read().
-    ByteArray next_chunk(first_chunk.data(), size);
-    buffer_.push_front(
-        ByteArray(first_chunk.data() + size, first_chunk.size() - size));
-    return ExceptionOr<ByteArray>{next_chunk};
+  size_t read_size = std::min<std::uint64_t>(size, tail_ - head_);
+  ByteArray chunk(read_size);
+  CopyFromRingLocked(head_, chunk.data(), read_size);
+  head_ += read_size;
+
+  // Don't hang on to the memory of a burst once it has been read.
+  if (head_ == tail_ && capacity_ > initial_capacity_) {
+    ring_.reset();
+    capacity_ = 0;
+    head_ = tail_ = 0;
   }
+  return ExceptionOr<ByteArray>{std::move(chunk)};
 }
 
 Exception Pipe::Write(const ByteArray& data) {
   MutexLock lock(&mutex_);
 
-  return WriteLocked(data);
+  if (input_stream_closed_ || output_stream_closed_) {
+    return {Exception::kIo};
+  }
+  if (data.Empty()) {
+    return {Exception::kSuccess};
+  }
+
+  ReserveLocked(data.size());
+  CopyToRingLocked(tail_, data.data(), data.size());
+  tail_ += data.size();
+  // Trigger cond_ to unblock a potentially-blocked call to read(), now that
+  // there's more data for it to consume.
+  cond_.Notify();
+  return {Exception::kSuccess};
 }
 
 void Pipe::MarkInputStreamClosed() {
   MutexLock lock(&mutex_);
   if (input_stream_closed_) return;
   input_stream_closed_ = true;
-  // Trigger cond_ to unblock a potentially-blocked call to read(), and to let
-  // it know to return Exception::IO.
+  // Nothing will read the buffered bytes anymore.
+  ring_.reset();
+  capacity_ = 0;
+  head_ = tail_ = 0;
+  // Unblock a potentially-blocked Read() so it returns EOF.
   cond_.Notify();
 }
 
 void Pipe::MarkOutputStreamClosed() {
   MutexLock lock(&mutex_);
   if (output_stream_closed_) return;
-  // Write a sentinel null chunk before marking output_stream_closed as true.
-  WriteLocked(ByteArray{});
   output_stream_closed_ = true;
-}
-
-Exception Pipe::WriteLocked(const ByteArray& data) {
-  if (input_stream_closed_ || output_stream_closed_) {
-    return {Exception::kIo};
-  }
-
-  buffer_.push_back(data);
-  // Trigger cond_ to unblock a potentially-blocked call to read(), now that
-  // there's more data for it to consume.
+  // Let a blocked Read() drain whatever is left in the ring and then see EOF.
   cond_.Notify();
-  return {Exception::kSuccess};
 }
 
 }  // namespace
 
 std::pair<std::unique_ptr<InputStream>, std::unique_ptr<OutputStream>>
 CreatePipe() {
-  auto pipe = std::make_shared<Pipe>();
+  return CreatePipe(kDefaultPipeInitialCapacity);
+}
+
+std::pair<std::unique_ptr<InputStream>, std::unique_ptr<OutputStream>>
+CreatePipe(size_t initial_capacity) {
+  auto pipe = std::make_shared<Pipe>(initial_capacity);
   return std::make_pair(std::make_unique<Pipe::PipeInputStream>(pipe),
                         std::make_unique<Pipe::PipeOutputStream>(pipe));
 }
@@ -15,6 +15,7 @@
 #ifndef PLATFORM_PUBLIC_PIPE_H_
 #define PLATFORM_PUBLIC_PIPE_H_
 
+#include <cstddef>
 #include <memory>
 #include <utility>
 
@@ -23,6 +24,9 @@
 
 namespace nearby {
 
+// Default size of the buffer a pipe allocates on its first write.
+inline constexpr size_t kDefaultPipeInitialCapacity = 64 * 1024;
+
 // Creates a pipe for streaming data between threads.
 // ```
 //  auto [input, output] = CreatePipe();
@@ -30,8 +34,15 @@ namespace nearby {
 //  WriterThread(std::move(output));
 //  ```
 //  Pipe stays valid as long as either `input` or `output` exist.
+//
+// The pipe buffers bytes in a ring that is allocated on the first write and
+// grows as needed, starting at `initial_capacity` bytes. `Write()` never
+// blocks, so a writer can't be held up by a slow reader. `Read(size)` returns
+// up to `size` of the buffered bytes, which may span several writes.
 std::pair<std::unique_ptr<InputStream>, std::unique_ptr<OutputStream>>
 CreatePipe();
+std::pair<std::unique_ptr<InputStream>, std::unique_ptr<OutputStream>>
+CreatePipe(size_t initial_capacity);
 
 }  // namespace nearby
 
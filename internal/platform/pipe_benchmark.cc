@@ -0,0 +1,144 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <thread>  // NOLINT
+#include <utility>
+
+#include "benchmark/benchmark.h"
+#include "absl/base/thread_annotations.h"
+#include "internal/platform/byte_array.h"
+#include "internal/platform/condition_variable.h"
+#include "internal/platform/exception.h"
+#include "internal/platform/input_stream.h"
+#include "internal/platform/mutex.h"
+#include "internal/platform/mutex_lock.h"
+#include "internal/platform/output_stream.h"
+#include "internal/platform/pipe.h"
+
+namespace nearby {
+namespace {
+
+constexpr std::int64_t kBytesPerIteration = 16 * 1024 * 1024;
+
+// The deque-of-chunks pipe that `CreatePipe()` used before it became a ring
+// buffer, kept as a baseline.
+class DequePipe {
+ public:
+  ExceptionOr<ByteArray> Read(size_t size) ABSL_LOCKS_EXCLUDED(mutex_) {
+    MutexLock lock(&mutex_);
+    while (buffer_.empty() && !closed_) {
+      cond_.Wait();
+    }
+    if (buffer_.empty()) return ExceptionOr<ByteArray>{ByteArray{}};
+
+    ByteArray first_chunk{buffer_.front()};
+    buffer_.pop_front();
+    if (first_chunk.size() <= size) {
+      return ExceptionOr<ByteArray>{first_chunk};
+    }
+    ByteArray next_chunk(first_chunk.data(), size);
+    buffer_.push_front(
+        ByteArray(first_chunk.data() + size, first_chunk.size() - size));
+    return ExceptionOr<ByteArray>{next_chunk};
+  }
+
+  Exception Write(const ByteArray& data) ABSL_LOCKS_EXCLUDED(mutex_) {
+    MutexLock lock(&mutex_);
+    buffer_.push_back(data);
+    cond_.Notify();
+    return {Exception::kSuccess};
+  }
+
+  void Close() ABSL_LOCKS_EXCLUDED(mutex_) {
+    MutexLock lock(&mutex_);
+    closed_ = true;
+    cond_.Notify();
+  }
+
+ private:
+  std::deque<ByteArray> buffer_ ABSL_GUARDED_BY(mutex_);
+  bool closed_ ABSL_GUARDED_BY(mutex_) = false;
+  Mutex mutex_;
+  ConditionVariable cond_{&mutex_};
+};
+
+// Streams `kBytesPerIteration` from a writer thread to the benchmark thread,
+// with writes of `write_size` and reads of `read_size` bytes.
+template <typename ReadFn, typename WriteFn, typename CloseFn>
+void Transfer(size_t write_size, size_t read_size, ReadFn read,
+              WriteFn write, CloseFn close) {
+  std::thread writer([&]() {
+    ByteArray chunk(write_size);
+    for (std::int64_t sent = 0; sent < kBytesPerIteration;
+         sent += write_size) {
+      write(chunk);
+    }
+    close();
+  });
+  std::int64_t received = 0;
+  while (true) {
+    ExceptionOr<ByteArray> result = read(read_size);
+    if (!result.ok() || result.result().Empty()) break;
+    received += result.result().size();
+  }
+  writer.join();
+  benchmark::DoNotOptimize(received);
+}
+
+void BM_RingPipe(benchmark::State& state) {
+  size_t write_size = state.range(0);
+  size_t read_size = state.range(1);
+  for (auto _ : state) {
+    auto [input, output] = CreatePipe();
+    Transfer(
+        write_size, read_size,
+        [&input = input](size_t size) { return input->Read(size); },
+        [&output = output](const ByteArray& data) { output->Write(data); },
+        [&output = output]() { output->Close(); });
+  }
+  state.SetBytesProcessed(state.iterations() * kBytesPerIteration);
+}
+
+void BM_DequePipe(benchmark::State& state) {
+  size_t write_size = state.range(0);
+  size_t read_size = state.range(1);
+  for (auto _ : state) {
+    DequePipe pipe;
+    Transfer(
+        write_size, read_size,
+        [&pipe](size_t size) { return pipe.Read(size); },
+        [&pipe](const ByteArray& data) { pipe.Write(data); },
+        [&pipe]() { pipe.Close(); });
+  }
+  state.SetBytesProcessed(state.iterations() * kBytesPerIteration);
+}
+
+// {write size, read size}: matched chunks, reads smaller than writes (the
+// partial read path), and small framed writes.
+void PipeArgs(benchmark::internal::Benchmark* benchmark) {
+  benchmark->Args({64 * 1024, 64 * 1024})
+      ->Args({64 * 1024, 4 * 1024})
+      ->Args({512, 64 * 1024})
+      ->UseRealTime();
+}
+
+BENCHMARK(BM_RingPipe)->Apply(PipeArgs);
+BENCHMARK(BM_DequePipe)->Apply(PipeArgs);
+
+}  // namespace
+}  // namespace nearby
@@ -119,6 +119,33 @@ TEST(PipeTest, SizedReadLessThanFirstChunkSize) {
   EXPECT_EQ(data_second_part, std::string(second_read_data.result()));
 }
 
+TEST(PipeTest, ReadSpansMultipleWrites) {
+  auto [input_stream, output_stream] = CreatePipe();
+  EXPECT_TRUE(output_stream->Write(ByteArray(std::string("ABCD"))).Ok());
+  EXPECT_TRUE(output_stream->Write(ByteArray(std::string("EFGH"))).Ok());
+
+  // Buffered bytes are not tied to write boundaries.
+  ExceptionOr<ByteArray> read_data = input_stream->Read(6);
+  EXPECT_TRUE(read_data.ok());
+  EXPECT_EQ(std::string(read_data.result()), "ABCDEF");
+
+  read_data = input_stream->Read(kChunkSize);
+  EXPECT_TRUE(read_data.ok());
+  EXPECT_EQ(std::string(read_data.result()), "GH");
+}
+
+TEST(PipeTest, ReadWrapsAroundRing) {
+  auto [input_stream, output_stream] = CreatePipe(/*initial_capacity=*/8);
+  EXPECT_TRUE(output_stream->Write(ByteArray(std::string("ABCDEF"))).Ok());
+  EXPECT_EQ(std::string(input_stream->Read(4).result()), "ABCD");
+
+  // This write wraps past the end of the 8 byte ring.
+  EXPECT_TRUE(output_stream->Write(ByteArray(std::string("GHIJKL"))).Ok());
+  ExceptionOr<ByteArray> read_data = input_stream->Read(kChunkSize);
+  EXPECT_TRUE(read_data.ok());
+  EXPECT_EQ(std::string(read_data.result()), "EFGHIJKL");
+}
+
 TEST(PipeTest, ReadAfterInputStreamClosed) {
   auto [input_stream, output_stream] = CreatePipe();
 
@@ -337,4 +364,40 @@ TEST(PipeTest, ConcurrentWriteAndRead) {
   reader_thread.Join();
 }
 
+TEST(PipeTest, WriteGrowsRingInsteadOfBlocking) {
+  auto [input_stream, output_stream] = CreatePipe(/*initial_capacity=*/16);
+  EXPECT_TRUE(output_stream->Write(ByteArray(std::string("ABCDEFGHIJ"))).Ok());
+  EXPECT_EQ(std::string(input_stream->Read(8).result()), "ABCDEFGH");
+
+  // Nobody is reading, yet a write many times the ring size still returns,
+  // and lands after the bytes that were already buffered.
+  std::string data(100, 'x');
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = 'A' + (i % 26);
+  }
+  EXPECT_TRUE(output_stream->Write(ByteArray(data)).Ok());
+  EXPECT_TRUE(output_stream->Close().Ok());
+
+  std::string actual_data;
+  while (true) {
+    ExceptionOr<ByteArray> read_data = input_stream->Read(7);
+    ASSERT_TRUE(read_data.ok());
+    if (read_data.result().Empty()) break;
+    EXPECT_LE(read_data.result().size(), 7);
+    actual_data += std::string(read_data.result());
+  }
+  EXPECT_EQ(actual_data, "IJ" + data);
+}
+
+TEST(PipeTest, WriteAfterDrainingGrownRing) {
+  auto [input_stream, output_stream] = CreatePipe(/*initial_capacity=*/8);
+  EXPECT_TRUE(output_stream->Write(ByteArray(std::string(64, 'x'))).Ok());
+  EXPECT_EQ(input_stream->Read(kChunkSize).result().size(), 64);
+
+  EXPECT_TRUE(output_stream->Write(ByteArray(std::string("ABCD"))).Ok());
+  ExceptionOr<ByteArray> read_data = input_stream->Read(kChunkSize);
+  EXPECT_TRUE(read_data.ok());
+  EXPECT_EQ(std::string(read_data.result()), "ABCD");
+}
+
 }  // namespace nearby
@@ -31,6 +31,7 @@
 #include "internal/platform/mutex_lock.h"
 #include "internal/platform/runnable.h"
 #include "internal/platform/thread_check_runnable.h"
+#include "internal/platform/timing_wheel_scheduled_executor.h"
 
 namespace nearby {
 
@@ -40,8 +41,20 @@ namespace nearby {
 // https://docs.oracle.com/javase/8/docs/api/java/util/concurrent/ScheduledExecutorService.html
 class ABSL_LOCKABLE ScheduledExecutor final : public Lockable {
  public:
-  ScheduledExecutor()
-      : impl_(api::ImplementationPlatform::CreateScheduledExecutor()) {}
+  // Where delayed tasks are kept until they're due.
+  enum class TimerBackend {
+    // The platform's scheduled executor.
+    kPlatform,
+    // A TimingWheelScheduledExecutor, for executors that schedule and cancel
+    // many alarms.
+    kTimingWheel,
+  };
+
+  ScheduledExecutor() : ScheduledExecutor(TimerBackend::kPlatform) {}
+  explicit ScheduledExecutor(TimerBackend backend)
+      : impl_(backend == TimerBackend::kTimingWheel
+                  ? std::make_unique<TimingWheelScheduledExecutor>()
+                  : api::ImplementationPlatform::CreateScheduledExecutor()) {}
   ScheduledExecutor(ScheduledExecutor&& other) { *this = std::move(other); }
   ~ScheduledExecutor() { DoShutdown(); }
 
@@ -98,6 +98,19 @@ TEST(ScheduledExecutorTest, CanCancel) {
   EXPECT_EQ(value, 0);
 }
 
+TEST(ScheduledExecutorTest, TimingWheelBackendCanScheduleAndCancel) {
+  ScheduledExecutor executor(ScheduledExecutor::TimerBackend::kTimingWheel);
+  std::atomic_int value = 0;
+  CountDownLatch latch(1);
+  Cancelable canceled =
+      executor.Schedule([&value]() { value += 1; }, kShortDelay);
+  executor.Schedule([&latch]() { latch.CountDown(); }, kShortDelay);
+
+  EXPECT_TRUE(canceled.Cancel());
+  EXPECT_TRUE(latch.Await(kLongDelay).result());
+  EXPECT_EQ(value, 0);
+}
+
 TEST(ScheduledExecutorTest, CanCancelTwice) {
   ScheduledExecutor executor;
   std::atomic_int value = 0;
@@ -0,0 +1,246 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLATFORM_PUBLIC_TIMING_WHEEL_H_
+#define PLATFORM_PUBLIC_TIMING_WHEEL_H_
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace nearby {
+
+// A hierarchical timing wheel holding values of type T until their deadline,
+// measured in ticks.
+//
+// There are kLevels wheels of kSlots slots each; a slot of level L covers
+// kSlots^L ticks. A timer is filed in the lowest level whose span covers its
+// deadline, and moves down a level each time that level turns over, so
+// scheduling and canceling are O(1) and each timer is touched at most kLevels
+// times before it expires. All timers due at the same tick expire as one
+// batch.
+//
+// Deadlines further out than kRange ticks are parked in the last level and
+// re-filed whenever it turns over.
+//
+// Not thread safe.
+template <typename T>
+class TimingWheel {
+ public:
+  static constexpr int kLevels = 4;
+  static constexpr int kSlotBits = 6;
+  static constexpr int kSlots = 1 << kSlotBits;
+  static constexpr std::int64_t kRange = std::int64_t{1}
+                                         << (kLevels * kSlotBits);
+
+  // Handle of a scheduled timer. It's valid until the timer expires or is
+  // canceled.
+  class Timer;
+
+  explicit TimingWheel(std::int64_t now = 0) : now_(now) {}
+  TimingWheel(const TimingWheel&) = delete;
+  TimingWheel& operator=(const TimingWheel&) = delete;
+  ~TimingWheel() {
+    Clear();
+    while (free_timers_ != nullptr) {
+      Timer* timer = free_timers_;
+      free_timers_ = static_cast<Timer*>(timer->next);
+      delete timer;
+    }
+  }
+
+  // The tick up to which all timers have expired.
+  std::int64_t now() const { return now_; }
+
+  // Number of timers waiting to expire.
+  std::size_t size() const { return size_; }
+
+  // Schedules `value` to expire at `deadline`. A deadline that isn't after
+  // now() expires on the next tick.
+  Timer* Schedule(std::int64_t deadline, T value) {
+    Timer* timer = NewTimer();
+    timer->deadline = std::max(deadline, now_ + 1);
+    timer->value = std::move(value);
+    Insert(timer);
+    ++size_;
+    return timer;
+  }
+
+  // Removes a timer that hasn't expired yet.
+  void Cancel(Timer* timer) {
+    Unlink(timer);
+    --size_;
+    FreeTimer(timer);
+  }
+
+  // Moves time forward to `now`, appending the values of all timers due by
+  // then to `expired` in deadline order.
+  void Advance(std::int64_t now, std::vector<T>& expired) {
+    while (now_ < now) {
+      std::optional<std::int64_t> next_event = NextEventTick();
+      if (!next_event.has_value() || *next_event > now) {
+        now_ = now;
+        return;
+      }
+      now_ = *next_event;
+      ProcessTick(expired);
+    }
+  }
+
+  // Returns the next tick at which Advance() has anything to do, or nullopt
+  // if the wheel is empty. At that tick either timers expire or a higher
+  // level turns over, which may or may not make anything due, so it's a safe
+  // point to wake up at rather than an exact deadline.
+  std::optional<std::int64_t> NextEventTick() const {
+    std::optional<std::int64_t> next_event;
+    for (int level = 0; level < kLevels; ++level) {
+      if (occupied_[level] == 0) continue;
+      int shift = level * kSlotBits;
+      std::int64_t turn = now_ >> shift;
+      // Bit k of `pending` is the slot that comes up k + 1 turns from now.
+      std::uint64_t pending =
+          std::rotr(occupied_[level], static_cast<int>((turn + 1) % kSlots));
+      std::int64_t tick = (turn + 1 + std::countr_zero(pending)) << shift;
+      if (!next_event.has_value() || tick < *next_event) {
+        next_event = tick;
+      }
+    }
+    return next_event;
+  }
+
+  // Drops all timers.
+  void Clear() {
+    for (int level = 0; level < kLevels; ++level) {
+      for (Link& head : slots_[level]) {
+        while (head.next != &head) {
+          Timer* timer = static_cast<Timer*>(head.next);
+          Unlink(timer);
+          FreeTimer(timer);
+        }
+      }
+    }
+    size_ = 0;
+  }
+
+ private:
+  // Timer nodes are recycled up to this many, so that steady churn of
+  // schedules and cancels doesn't go through the allocator.
+  static constexpr std::size_t kMaxFreeTimers = 1024;
+
+  struct Link {
+    Link* prev = this;
+    Link* next = this;
+  };
+
+ public:
+  class Timer : private Link {
+   private:
+    friend class TimingWheel;
+    std::int64_t deadline = 0;
+    int level = 0;
+    int slot = 0;
+    T value = {};
+  };
+
+ private:
+  void Insert(Timer* timer) {
+    std::int64_t delta = timer->deadline - now_;
+    int level = 0;
+    while (level < kLevels - 1 &&
+           delta >= (std::int64_t{1} << ((level + 1) * kSlotBits))) {
+      ++level;
+    }
+    std::int64_t slot_tick =
+        delta < kRange ? timer->deadline : now_ + kRange - 1;
+    timer->level = level;
+    timer->slot = static_cast<int>((slot_tick >> (level * kSlotBits)) &
+                                   (kSlots - 1));
+    Link& head = slots_[level][timer->slot];
+    timer->prev = head.prev;
+    timer->next = &head;
+    head.prev->next = timer;
+    head.prev = timer;
+    occupied_[level] |= std::uint64_t{1} << timer->slot;
+  }
+
+  void Unlink(Timer* timer) {
+    timer->prev->next = timer->next;
+    timer->next->prev = timer->prev;
+    Link& head = slots_[timer->level][timer->slot];
+    if (head.next == &head) {
+      occupied_[timer->level] &= ~(std::uint64_t{1} << timer->slot);
+    }
+  }
+
+  // Re-files the timers of the slots whose turn starts at now_, then expires
+  // the level 0 slot of now_.
+  void ProcessTick(std::vector<T>& expired) {
+    for (int level = kLevels - 1; level > 0; --level) {
+      int shift = level * kSlotBits;
+      if ((now_ & ((std::int64_t{1} << shift) - 1)) != 0) continue;
+      Link& head = slots_[level][(now_ >> shift) & (kSlots - 1)];
+      while (head.next != &head) {
+        Timer* timer = static_cast<Timer*>(head.next);
+        Unlink(timer);
+        Insert(timer);
+      }
+    }
+    Link& head = slots_[0][now_ & (kSlots - 1)];
+    while (head.next != &head) {
+      Timer* timer = static_cast<Timer*>(head.next);
+      Unlink(timer);
+      --size_;
+      expired.push_back(std::move(timer->value));
+      FreeTimer(timer);
+    }
+  }
+
+  Timer* NewTimer() {
+    if (free_timers_ == nullptr) {
+      return new Timer();
+    }
+    Timer* timer = free_timers_;
+    free_timers_ = static_cast<Timer*>(timer->next);
+    --free_timer_count_;
+    return timer;
+  }
+
+  void FreeTimer(Timer* timer) {
+    timer->value = T();
+    if (free_timer_count_ >= kMaxFreeTimers) {
+      delete timer;
+      return;
+    }
+    timer->next = free_timers_;
+    free_timers_ = timer;
+    ++free_timer_count_;
+  }
+
+  std::int64_t now_;
+  std::size_t size_ = 0;
+  std::array<std::array<Link, kSlots>, kLevels> slots_;
+  // Bit i of occupied_[level] is set when slots_[level][i] isn't empty.
+  std::array<std::uint64_t, kLevels> occupied_ = {};
+  Timer* free_timers_ = nullptr;
+  std::size_t free_timer_count_ = 0;
+};
+
+}  // namespace nearby
+
+#endif  // PLATFORM_PUBLIC_TIMING_WHEEL_H_
@@ -0,0 +1,129 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "absl/container/btree_map.h"
+#include "absl/time/time.h"
+#include "internal/platform/cancelable.h"
+#include "internal/platform/runnable.h"
+#include "internal/platform/scheduled_executor.h"
+#include "internal/platform/timing_wheel.h"
+
+namespace nearby {
+namespace {
+
+// Alarm delays in ticks, spread like the lost, retry and timeout alarms of a
+// busy discovery session: mostly seconds, some minutes.
+std::vector<std::int64_t> MakeDelays(int count) {
+  std::mt19937 random(7);
+  std::uniform_int_distribution<std::int64_t> delay(100, 30000);
+  std::vector<std::int64_t> delays(count);
+  for (std::int64_t& d : delays) d = delay(random);
+  return delays;
+}
+
+// `pending` alarms are outstanding; each iteration cancels the oldest one and
+// schedules a new one, the way alarms are re-armed on every scan result. The
+// clock moves one tick per round over all alarms, so none of them fires.
+void BM_TimingWheelChurn(benchmark::State& state) {
+  int pending = state.range(0);
+  std::vector<std::int64_t> delays = MakeDelays(pending);
+  TimingWheel<Runnable> wheel;
+  std::vector<TimingWheel<Runnable>::Timer*> timers;
+  for (int i = 0; i < pending; ++i) {
+    timers.push_back(wheel.Schedule(delays[i], []() {}));
+  }
+  std::vector<Runnable> expired;
+  std::int64_t now = 0;
+  int i = 0;
+  for (auto _ : state) {
+    int slot = i % pending;
+    wheel.Cancel(timers[slot]);
+    timers[slot] = wheel.Schedule(now + delays[slot], []() {});
+    if (++i % pending == 0) {
+      wheel.Advance(++now, expired);
+      expired.clear();
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TimingWheelChurn)->Arg(100)->Arg(10000);
+
+// The same churn the way the g3 ScheduledExecutor handles it: every alarm is
+// inserted into a btree_multimap, and canceling only flags the task, which
+// stays in the map until it's due.
+void BM_BtreeChurn(benchmark::State& state) {
+  int pending = state.range(0);
+  std::vector<std::int64_t> delays = MakeDelays(pending);
+  absl::btree_multimap<std::int64_t, std::unique_ptr<Runnable>> tasks;
+  for (int i = 0; i < pending; ++i) {
+    tasks.insert({delays[i], std::make_unique<Runnable>([]() {})});
+  }
+  std::int64_t now = 0;
+  int i = 0;
+  for (auto _ : state) {
+    int slot = i % pending;
+    tasks.insert({now + delays[slot], std::make_unique<Runnable>([]() {})});
+    if (++i % pending == 0) {
+      ++now;
+      while (!tasks.empty() && tasks.begin()->first <= now) {
+        tasks.erase(tasks.begin());
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["tasks_in_map"] = tasks.size();
+}
+BENCHMARK(BM_BtreeChurn)->Arg(100)->Arg(10000);
+
+// End to end: threads scheduling alarms on one executor and canceling them
+// before they fire, with either backend.
+ScheduledExecutor* shared_executor = nullptr;
+
+void BM_ScheduledExecutorAlarmStorm(benchmark::State& state) {
+  if (state.thread_index() == 0) {
+    shared_executor = new ScheduledExecutor(
+        static_cast<ScheduledExecutor::TimerBackend>(state.range(0)));
+  }
+  std::vector<Cancelable> alarms(256);
+  int i = 0;
+  for (auto _ : state) {
+    Cancelable& alarm = alarms[i++ % alarms.size()];
+    alarm.Cancel();
+    alarm = shared_executor->Schedule([]() {}, absl::Seconds(10));
+  }
+  for (Cancelable& alarm : alarms) {
+    alarm.Cancel();
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0) {
+    delete shared_executor;
+    shared_executor = nullptr;
+  }
+}
+BENCHMARK(BM_ScheduledExecutorAlarmStorm)
+    ->ArgName("timing_wheel")
+    ->Arg(static_cast<int>(ScheduledExecutor::TimerBackend::kPlatform))
+    ->Arg(static_cast<int>(ScheduledExecutor::TimerBackend::kTimingWheel))
+    ->Threads(1)
+    ->Threads(4);
+
+}  // namespace
+}  // namespace nearby
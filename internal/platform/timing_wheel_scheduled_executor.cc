@@ -0,0 +1,203 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/timing_wheel_scheduled_executor.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "internal/platform/implementation/cancelable.h"
+#include "internal/platform/implementation/platform.h"
+#include "internal/platform/implementation/submittable_executor.h"
+#include "internal/platform/runnable.h"
+#include "internal/platform/timing_wheel.h"
+
+namespace nearby {
+
+class TimingWheelScheduledExecutor::Task : public api::Cancelable {
+ public:
+  Task(std::weak_ptr<State> state, Runnable&& runnable)
+      : state_(std::move(state)), runnable_(std::move(runnable)) {}
+
+  bool Cancel() override;
+
+  void Run() {
+    Status expected = kNotRun;
+    if (status_.compare_exchange_strong(expected, kExecuted)) {
+      runnable_();
+    }
+  }
+
+  // The task's place in the wheel while it's pending. Guarded by
+  // State::mutex.
+  TimingWheel<std::shared_ptr<Task>>::Timer* timer = nullptr;
+
+ private:
+  enum Status {
+    kNotRun,
+    kExecuted,
+    kCanceled,
+  };
+
+  // Weak, so that a task the caller holds on to doesn't keep a shut down
+  // executor's state alive, and the wheel holding its tasks isn't a cycle.
+  const std::weak_ptr<State> state_;
+  Runnable runnable_;
+  std::atomic<Status> status_ = kNotRun;
+};
+
+struct TimingWheelScheduledExecutor::State {
+  explicit State(absl::Duration tick)
+      : tick(tick),
+        start(absl::Now()),
+        executor(api::ImplementationPlatform::CreateSingleThreadExecutor()) {}
+
+  // The tick that `time` falls in.
+  std::int64_t TickAt(absl::Time time) const {
+    absl::Duration remainder;
+    return absl::IDivDuration(time - start, tick, &remainder);
+  }
+
+  // The first tick at or after `time`, so delays are never cut short.
+  std::int64_t TickNotBefore(absl::Time time) const {
+    absl::Duration remainder;
+    std::int64_t ticks = absl::IDivDuration(time - start, tick, &remainder);
+    return remainder > absl::ZeroDuration() ? ticks + 1 : ticks;
+  }
+
+  const absl::Duration tick;
+  const absl::Time start;
+  // Runs the due tasks.
+  const std::unique_ptr<api::SubmittableExecutor> executor;
+
+  absl::Mutex mutex;
+  absl::CondVar wakeup;
+  bool shutdown ABSL_GUARDED_BY(mutex) = false;
+  TimingWheel<std::shared_ptr<Task>> wheel ABSL_GUARDED_BY(mutex);
+  // The tick the timer thread sleeps until, or nullopt while it's busy or
+  // waits for the first task.
+  std::optional<std::int64_t> wakeup_tick ABSL_GUARDED_BY(mutex);
+};
+
+bool TimingWheelScheduledExecutor::Task::Cancel() {
+  Status expected = kNotRun;
+  if (!status_.compare_exchange_strong(expected, kCanceled)) {
+    return false;
+  }
+  std::shared_ptr<State> state = state_.lock();
+  if (state == nullptr) {
+    return true;
+  }
+  absl::MutexLock lock(&state->mutex);
+  // The wheel has already dropped its timers on shutdown.
+  if (timer != nullptr && !state->shutdown) {
+    state->wheel.Cancel(timer);
+  }
+  timer = nullptr;
+  return true;
+}
+
+TimingWheelScheduledExecutor::TimingWheelScheduledExecutor(
+    absl::Duration tick)
+    : state_(std::make_shared<State>(tick)),
+      timer_thread_(api::ImplementationPlatform::CreateSingleThreadExecutor()) {
+  timer_thread_->Execute([state = state_]() { RunTimerLoop(state); });
+}
+
+TimingWheelScheduledExecutor::~TimingWheelScheduledExecutor() { Shutdown(); }
+
+void TimingWheelScheduledExecutor::Execute(Runnable&& runnable) {
+  state_->executor->Execute(std::move(runnable));
+}
+
+std::shared_ptr<api::Cancelable> TimingWheelScheduledExecutor::Schedule(
+    Runnable&& runnable, absl::Duration delay) {
+  auto task = std::make_shared<Task>(state_, std::move(runnable));
+  std::int64_t deadline = state_->TickNotBefore(absl::Now() + delay);
+  absl::MutexLock lock(&state_->mutex);
+  if (state_->shutdown) {
+    return task;
+  }
+  task->timer = state_->wheel.Schedule(deadline, task);
+  // Only wake the timer thread up early if it would oversleep the new task.
+  if (!state_->wakeup_tick.has_value() ||
+      *state_->wheel.NextEventTick() < *state_->wakeup_tick) {
+    state_->wakeup.Signal();
+  }
+  return task;
+}
+
+void TimingWheelScheduledExecutor::Shutdown() {
+  {
+    absl::MutexLock lock(&state_->mutex);
+    if (state_->shutdown) {
+      return;
+    }
+    state_->shutdown = true;
+    state_->wheel.Clear();
+    state_->wakeup.Signal();
+  }
+  timer_thread_->Shutdown();
+  state_->executor->Shutdown();
+}
+
+void TimingWheelScheduledExecutor::RunTimerLoop(
+    const std::shared_ptr<State>& state) {
+  std::vector<std::shared_ptr<Task>> due;
+  while (true) {
+    {
+      absl::MutexLock lock(&state->mutex);
+      while (!state->shutdown) {
+        std::optional<std::int64_t> next = state->wheel.NextEventTick();
+        if (next.has_value() && *next <= state->TickAt(absl::Now())) {
+          break;
+        }
+        state->wakeup_tick = next;
+        if (next.has_value()) {
+          state->wakeup.WaitWithDeadline(&state->mutex,
+                                         state->start + *next * state->tick);
+        } else {
+          state->wakeup.Wait(&state->mutex);
+        }
+        state->wakeup_tick = std::nullopt;
+      }
+      if (state->shutdown) {
+        return;
+      }
+      state->wheel.Advance(state->TickAt(absl::Now()), due);
+      for (const std::shared_ptr<Task>& task : due) {
+        task->timer = nullptr;
+      }
+    }
+    // Everything due at once goes to the executor as a single batch.
+    if (!due.empty()) {
+      state->executor->Execute([due = std::move(due)]() {
+        for (const std::shared_ptr<Task>& task : due) {
+          task->Run();
+        }
+      });
+      due.clear();
+    }
+  }
+}
+
+}  // namespace nearby
@@ -0,0 +1,62 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLATFORM_PUBLIC_TIMING_WHEEL_SCHEDULED_EXECUTOR_H_
+#define PLATFORM_PUBLIC_TIMING_WHEEL_SCHEDULED_EXECUTOR_H_
+
+#include <memory>
+
+#include "absl/time/time.h"
+#include "internal/platform/implementation/cancelable.h"
+#include "internal/platform/implementation/scheduled_executor.h"
+#include "internal/platform/implementation/submittable_executor.h"
+#include "internal/platform/runnable.h"
+
+namespace nearby {
+
+// A ScheduledExecutor that keeps its delayed tasks in a TimingWheel instead
+// of the platform's timer queue, for executors that schedule and cancel many
+// short-lived alarms. Scheduling and canceling are O(1), and a canceled task
+// is dropped right away rather than when it would have been due.
+//
+// Delays are rounded up to whole ticks. A dedicated thread sleeps until the
+// next tick with anything due and hands every task due at that tick, as one
+// batch, to the thread that runs them.
+//
+// The wheel follows the real clock, not MediumEnvironment's simulated one.
+class TimingWheelScheduledExecutor final : public api::ScheduledExecutor {
+ public:
+  static constexpr absl::Duration kDefaultTick = absl::Milliseconds(10);
+
+  explicit TimingWheelScheduledExecutor(absl::Duration tick = kDefaultTick);
+  ~TimingWheelScheduledExecutor() override;
+
+  void Execute(Runnable&& runnable) override;
+  std::shared_ptr<api::Cancelable> Schedule(Runnable&& runnable,
+                                            absl::Duration delay) override;
+  void Shutdown() override;
+
+ private:
+  struct State;
+  class Task;
+
+  static void RunTimerLoop(const std::shared_ptr<State>& state);
+
+  std::shared_ptr<State> state_;
+  std::unique_ptr<api::SubmittableExecutor> timer_thread_;
+};
+
+}  // namespace nearby
+
+#endif  // PLATFORM_PUBLIC_TIMING_WHEEL_SCHEDULED_EXECUTOR_H_
@@ -0,0 +1,153 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/timing_wheel_scheduled_executor.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "internal/platform/implementation/cancelable.h"
+
+namespace nearby {
+namespace {
+
+using ::testing::ElementsAre;
+
+constexpr absl::Duration kShortDelay = absl::Milliseconds(100);
+constexpr absl::Duration kLongDelay = absl::Seconds(1);
+
+TEST(TimingWheelScheduledExecutorTest, CanExecute) {
+  TimingWheelScheduledExecutor executor;
+  absl::Notification done;
+
+  executor.Execute([&done]() { done.Notify(); });
+
+  EXPECT_TRUE(done.WaitForNotificationWithTimeout(kLongDelay));
+}
+
+TEST(TimingWheelScheduledExecutorTest, RunsTasksInDeadlineOrder) {
+  TimingWheelScheduledExecutor executor;
+  absl::Mutex mutex;
+  std::vector<int> order;
+  absl::Notification done;
+
+  executor.Schedule(
+      [&]() {
+        absl::MutexLock lock(&mutex);
+        order.push_back(2);
+        done.Notify();
+      },
+      2 * kShortDelay);
+  executor.Schedule(
+      [&]() {
+        absl::MutexLock lock(&mutex);
+        order.push_back(1);
+      },
+      kShortDelay);
+
+  ASSERT_TRUE(done.WaitForNotificationWithTimeout(kLongDelay));
+  absl::MutexLock lock(&mutex);
+  EXPECT_THAT(order, ElementsAre(1, 2));
+}
+
+TEST(TimingWheelScheduledExecutorTest, DoesNotRunEarly) {
+  TimingWheelScheduledExecutor executor(/*tick=*/absl::Milliseconds(50));
+  absl::Notification done;
+  absl::Time start = absl::Now();
+  absl::Time ran_at;
+
+  executor.Schedule(
+      [&]() {
+        ran_at = absl::Now();
+        done.Notify();
+      },
+      kShortDelay);
+
+  ASSERT_TRUE(done.WaitForNotificationWithTimeout(kLongDelay));
+  EXPECT_GE(ran_at - start, kShortDelay);
+}
+
+TEST(TimingWheelScheduledExecutorTest, CanCancel) {
+  TimingWheelScheduledExecutor executor;
+  std::atomic_int value = 0;
+
+  std::shared_ptr<api::Cancelable> cancelable =
+      executor.Schedule([&value]() { value += 1; }, kShortDelay);
+
+  EXPECT_TRUE(cancelable->Cancel());
+  EXPECT_FALSE(cancelable->Cancel());
+  absl::SleepFor(2 * kShortDelay);
+  EXPECT_EQ(value, 0);
+}
+
+TEST(TimingWheelScheduledExecutorTest, FailsToCancelTaskThatRan) {
+  TimingWheelScheduledExecutor executor;
+  absl::Notification done;
+
+  std::shared_ptr<api::Cancelable> cancelable =
+      executor.Schedule([&done]() { done.Notify(); }, absl::ZeroDuration());
+
+  ASSERT_TRUE(done.WaitForNotificationWithTimeout(kLongDelay));
+  EXPECT_FALSE(cancelable->Cancel());
+}
+
+TEST(TimingWheelScheduledExecutorTest, ShutdownDropsPendingTasks) {
+  std::atomic_int value = 0;
+  std::shared_ptr<api::Cancelable> cancelable;
+  {
+    TimingWheelScheduledExecutor executor;
+    cancelable = executor.Schedule([&value]() { value += 1; }, kShortDelay);
+    executor.Shutdown();
+    executor.Schedule([&value]() { value += 1; }, absl::ZeroDuration());
+  }
+
+  absl::SleepFor(2 * kShortDelay);
+  EXPECT_EQ(value, 0);
+  // Canceling outlives the executor.
+  EXPECT_TRUE(cancelable->Cancel());
+}
+
+TEST(TimingWheelScheduledExecutorTest, RunsEveryTaskNotCanceled) {
+  constexpr int kTasks = 1000;
+  TimingWheelScheduledExecutor executor;
+  std::atomic_int ran = 0;
+  int canceled = 0;
+  std::vector<std::shared_ptr<api::Cancelable>> cancelables;
+
+  for (int i = 0; i < kTasks; ++i) {
+    cancelables.push_back(executor.Schedule(
+        [&ran]() { ran += 1; }, absl::Milliseconds(i % 50)));
+  }
+  for (int i = 0; i < kTasks; i += 2) {
+    if (cancelables[i]->Cancel()) {
+      canceled += 1;
+    }
+  }
+
+  absl::Time deadline = absl::Now() + kLongDelay;
+  while (ran + canceled < kTasks && absl::Now() < deadline) {
+    absl::SleepFor(absl::Milliseconds(10));
+  }
+  EXPECT_EQ(ran + canceled, kTasks);
+}
+
+}  // namespace
+}  // namespace nearby
@@ -0,0 +1,159 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/timing_wheel.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace nearby {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using Wheel = TimingWheel<int>;
+
+TEST(TimingWheelTest, EmptyWheelHasNoEvents) {
+  Wheel wheel;
+  std::vector<int> expired;
+
+  wheel.Advance(1000, expired);
+
+  EXPECT_THAT(expired, IsEmpty());
+  EXPECT_EQ(wheel.now(), 1000);
+  EXPECT_EQ(wheel.NextEventTick(), std::nullopt);
+}
+
+TEST(TimingWheelTest, ExpiresAtDeadline) {
+  Wheel wheel;
+  std::vector<int> expired;
+  wheel.Schedule(5, 1);
+
+  wheel.Advance(4, expired);
+  EXPECT_THAT(expired, IsEmpty());
+  EXPECT_EQ(wheel.NextEventTick(), 5);
+
+  wheel.Advance(5, expired);
+  EXPECT_THAT(expired, ElementsAre(1));
+  EXPECT_EQ(wheel.size(), 0u);
+}
+
+TEST(TimingWheelTest, PastDeadlineExpiresOnNextTick) {
+  Wheel wheel(/*now=*/100);
+  std::vector<int> expired;
+  wheel.Schedule(10, 1);
+
+  EXPECT_EQ(wheel.NextEventTick(), 101);
+  wheel.Advance(101, expired);
+  EXPECT_THAT(expired, ElementsAre(1));
+}
+
+TEST(TimingWheelTest, ExpiresInDeadlineOrderAcrossLevels) {
+  Wheel wheel;
+  std::vector<int> expired;
+  wheel.Schedule(5000, 4);
+  wheel.Schedule(70, 2);
+  wheel.Schedule(3, 1);
+  wheel.Schedule(300, 3);
+  wheel.Schedule(70, 5);
+
+  wheel.Advance(10000, expired);
+
+  EXPECT_THAT(expired, ElementsAre(1, 2, 5, 3, 4));
+}
+
+TEST(TimingWheelTest, CanceledTimerDoesNotExpire) {
+  Wheel wheel;
+  std::vector<int> expired;
+  Wheel::Timer* first = wheel.Schedule(10, 1);
+  wheel.Schedule(10, 2);
+  Wheel::Timer* far = wheel.Schedule(100000, 3);
+
+  wheel.Cancel(first);
+  wheel.Cancel(far);
+  wheel.Advance(200000, expired);
+
+  EXPECT_THAT(expired, ElementsAre(2));
+  EXPECT_EQ(wheel.size(), 0u);
+}
+
+TEST(TimingWheelTest, DeadlineBeyondRangeExpires) {
+  Wheel wheel;
+  std::vector<int> expired;
+  std::int64_t deadline = 3 * Wheel::kRange + 17;
+  wheel.Schedule(deadline, 1);
+
+  wheel.Advance(deadline - 1, expired);
+  EXPECT_THAT(expired, IsEmpty());
+  wheel.Advance(deadline, expired);
+  EXPECT_THAT(expired, ElementsAre(1));
+}
+
+TEST(TimingWheelTest, MatchesSortedScheduleUnderChurn) {
+  std::mt19937 random(42);
+  Wheel wheel;
+  std::multimap<std::int64_t, int> reference;
+  std::map<int, std::pair<Wheel::Timer*, std::int64_t>> pending;
+  std::vector<int> expired;
+  std::int64_t now = 0;
+
+  for (int id = 0; id < 20000; ++id) {
+    std::int64_t delay =
+        std::uniform_int_distribution<std::int64_t>(0, 1 << 20)(random) >>
+        std::uniform_int_distribution<int>(0, 20)(random);
+    std::int64_t deadline = std::max(now + delay, now + 1);
+    pending[id] = {wheel.Schedule(deadline, id), deadline};
+    reference.insert({deadline, id});
+    if (id % 3 == 0) {
+      auto it = pending.begin();
+      std::advance(it, random() % pending.size());
+      wheel.Cancel(it->second.first);
+      auto range = reference.equal_range(it->second.second);
+      for (auto ref = range.first; ref != range.second; ++ref) {
+        if (ref->second == it->first) {
+          reference.erase(ref);
+          break;
+        }
+      }
+      pending.erase(it);
+    }
+    if (id % 7 == 0) {
+      now += std::uniform_int_distribution<std::int64_t>(0, 5000)(random);
+      expired.clear();
+      wheel.Advance(now, expired);
+      std::vector<int> expected;
+      while (!reference.empty() && reference.begin()->first <= now) {
+        expected.push_back(reference.begin()->second);
+        pending.erase(reference.begin()->second);
+        reference.erase(reference.begin());
+      }
+      std::sort(expired.begin(), expired.end());
+      std::sort(expected.begin(), expected.end());
+      ASSERT_EQ(expired, expected) << "at tick " << now;
+    }
+  }
+  EXPECT_EQ(wheel.size(), reference.size());
+}
+
+}  // namespace
+}  // namespace nearby
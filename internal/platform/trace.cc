@@ -0,0 +1,285 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/trace.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+
+namespace nearby {
+
+namespace {
+
+// One recorded event. Every field is atomic so that a dump can read a buffer
+// while its thread keeps writing to it; `sequence` tells the reader whether
+// what it read is a single consistent event.
+struct Slot {
+  // Index of the event in the slot plus one, or zero while it's written.
+  std::atomic<std::uint64_t> sequence = 0;
+  std::atomic<std::int64_t> timestamp_nanos = 0;
+  std::atomic<const TraceEvent*> event = nullptr;
+  std::atomic<Trace::Phase> phase = Trace::Phase::kInstant;
+  std::array<std::atomic<std::int64_t>, TraceEvent::kMaxArgs> args = {};
+};
+
+// The ring buffer of a single thread. Only the owning thread writes to it.
+struct ThreadBuffer {
+  // Number of events ever written to the buffer.
+  std::atomic<std::uint64_t> size = 0;
+  // Events before this one were dropped by Trace::Clear() or belonged to a
+  // thread that has exited. Guarded by the registry mutex, like the fields
+  // below.
+  std::uint64_t begin = 0;
+  // Used for the trace viewer's thread id.
+  int thread_id = 0;
+  std::array<Slot, Trace::kBufferSize> slots;
+};
+
+struct RecordedEvent {
+  std::int64_t timestamp_nanos;
+  const TraceEvent* event;
+  Trace::Phase phase;
+  std::array<std::int64_t, TraceEvent::kMaxArgs> args;
+};
+
+// Buffers outlive their threads so that their events can still be dumped.
+// Once there are kMaxBuffers of them, the buffer of the thread that exited
+// first is handed to the next new thread, dropping its events. Memory is
+// then bounded by the peak number of threads that recorded events at once.
+class Registry {
+ public:
+  static Registry& GetInstance() {
+    static Registry* registry = new Registry();
+    return *registry;
+  }
+
+  ThreadBuffer* Acquire() ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    ThreadBuffer* buffer;
+    if (buffers_.size() < kMaxBuffers || released_.empty()) {
+      buffers_.push_back(std::make_unique<ThreadBuffer>());
+      buffer = buffers_.back().get();
+    } else {
+      buffer = released_.front();
+      released_.pop_front();
+      buffer->begin = buffer->size.load(std::memory_order_acquire);
+    }
+    buffer->thread_id = next_thread_id_++;
+    return buffer;
+  }
+
+  void Release(ThreadBuffer* buffer) ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    released_.push_back(buffer);
+  }
+
+  void Clear() ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    for (const auto& buffer : buffers_) {
+      buffer->begin = buffer->size.load(std::memory_order_acquire);
+    }
+  }
+
+  // Calls `visitor` with the thread id and a consistent copy of the events in
+  // each buffer.
+  template <typename Visitor>
+  void ForEachBuffer(Visitor visitor) ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    std::vector<RecordedEvent> events;
+    for (const auto& buffer : buffers_) {
+      events.clear();
+      std::uint64_t end = buffer->size.load(std::memory_order_acquire);
+      std::uint64_t begin = std::max(
+          buffer->begin,
+          end > Trace::kBufferSize ? end - Trace::kBufferSize : 0);
+      for (std::uint64_t i = begin; i < end; ++i) {
+        const Slot& slot = buffer->slots[i % Trace::kBufferSize];
+        if (slot.sequence.load(std::memory_order_acquire) != i + 1) continue;
+        RecordedEvent event = {
+            .timestamp_nanos =
+                slot.timestamp_nanos.load(std::memory_order_relaxed),
+            .event = slot.event.load(std::memory_order_relaxed),
+            .phase = slot.phase.load(std::memory_order_relaxed),
+        };
+        for (int arg = 0; arg < TraceEvent::kMaxArgs; ++arg) {
+          event.args[arg] = slot.args[arg].load(std::memory_order_relaxed);
+        }
+        // The writer may have wrapped around and started on this slot while
+        // it was copied.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != i + 1) continue;
+        events.push_back(event);
+      }
+      visitor(buffer->thread_id, events);
+    }
+  }
+
+ private:
+  static constexpr std::size_t kMaxBuffers = 32;
+
+  absl::Mutex mutex_;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers_ ABSL_GUARDED_BY(mutex_);
+  // Buffers of threads that have exited, oldest first.
+  std::deque<ThreadBuffer*> released_ ABSL_GUARDED_BY(mutex_);
+  int next_thread_id_ ABSL_GUARDED_BY(mutex_) = 1;
+};
+
+// Returns the calling thread's buffer to the registry when the thread exits.
+class ThreadBufferHolder {
+ public:
+  ~ThreadBufferHolder() {
+    if (buffer_ != nullptr) {
+      Registry::GetInstance().Release(buffer_);
+    }
+  }
+
+  ThreadBuffer& Get() {
+    if (buffer_ == nullptr) {
+      buffer_ = Registry::GetInstance().Acquire();
+    }
+    return *buffer_;
+  }
+
+ private:
+  ThreadBuffer* buffer_ = nullptr;
+};
+
+void AppendJsonString(std::string& json, absl::string_view value) {
+  json.push_back('"');
+  for (char c : value) {
+    switch (c) {
+      case '"':
+        json.append("\\\"");
+        break;
+      case '\\':
+        json.append("\\\\");
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          absl::StrAppendFormat(&json, "\\u%04x", c);
+        } else {
+          json.push_back(c);
+        }
+    }
+  }
+  json.push_back('"');
+}
+
+absl::string_view ToChromePhase(Trace::Phase phase) {
+  switch (phase) {
+    case Trace::Phase::kInstant:
+      return "i";
+    case Trace::Phase::kBegin:
+      return "B";
+    case Trace::Phase::kEnd:
+      return "E";
+  }
+  return "i";
+}
+
+}  // namespace
+
+std::atomic<bool> Trace::enabled_ = false;
+
+void Trace::Enable() { enabled_.store(true, std::memory_order_relaxed); }
+
+void Trace::Disable() { enabled_.store(false, std::memory_order_relaxed); }
+
+void Trace::Clear() { Registry::GetInstance().Clear(); }
+
+void Trace::Append(const TraceEvent& event, Phase phase,
+                   const std::array<std::int64_t, TraceEvent::kMaxArgs>& args) {
+  thread_local ThreadBufferHolder holder;
+  ThreadBuffer& buffer = holder.Get();
+  std::uint64_t index = buffer.size.load(std::memory_order_relaxed);
+  Slot& slot = buffer.slots[index % kBufferSize];
+
+  slot.sequence.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.timestamp_nanos.store(absl::GetCurrentTimeNanos(),
+                             std::memory_order_relaxed);
+  slot.event.store(&event, std::memory_order_relaxed);
+  slot.phase.store(phase, std::memory_order_relaxed);
+  for (int arg = 0; arg < TraceEvent::kMaxArgs; ++arg) {
+    slot.args[arg].store(args[arg], std::memory_order_relaxed);
+  }
+  slot.sequence.store(index + 1, std::memory_order_release);
+  buffer.size.store(index + 1, std::memory_order_release);
+}
+
+std::string Trace::DumpChromeTrace() {
+  std::string json = "{\"traceEvents\":[";
+  bool first = true;
+  Registry::GetInstance().ForEachBuffer(
+      [&json, &first](int thread_id, const std::vector<RecordedEvent>& events) {
+        for (const RecordedEvent& recorded : events) {
+          const TraceEvent& event = *recorded.event;
+          if (!first) json.push_back(',');
+          first = false;
+          json.append("{\"name\":");
+          AppendJsonString(json, event.name);
+          json.append(",\"cat\":");
+          AppendJsonString(json, event.category);
+          // Timestamps are in microseconds.
+          absl::StrAppendFormat(
+              &json, ",\"ph\":\"%s\",\"ts\":%d.%03d,\"pid\":1,\"tid\":%d",
+              ToChromePhase(recorded.phase), recorded.timestamp_nanos / 1000,
+              recorded.timestamp_nanos % 1000, thread_id);
+          if (recorded.phase == Phase::kInstant) {
+            json.append(",\"s\":\"t\"");
+          }
+          if (recorded.phase != Phase::kEnd && event.arg_names[0] != nullptr) {
+            json.append(",\"args\":{");
+            for (int arg = 0; arg < TraceEvent::kMaxArgs &&
+                              event.arg_names[arg] != nullptr;
+                 ++arg) {
+              if (arg > 0) json.push_back(',');
+              AppendJsonString(json, event.arg_names[arg]);
+              absl::StrAppend(&json, ":", recorded.args[arg]);
+            }
+            json.push_back('}');
+          }
+          json.push_back('}');
+        }
+      });
+  json.append("]}");
+  return json;
+}
+
+bool Trace::DumpChromeTraceToFile(const std::string& path) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    return false;
+  }
+  file << DumpChromeTrace();
+  file.close();
+  return !file.fail();
+}
+
+}  // namespace nearby
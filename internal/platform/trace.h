@@ -0,0 +1,143 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLATFORM_BASE_TRACE_H_
+#define PLATFORM_BASE_TRACE_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+namespace nearby {
+
+// A trace event definition. Definitions are compile time constants, and a
+// recorded event only stores a pointer to its definition, so names are never
+// copied or formatted on the hot path.
+//
+//   constexpr TraceEvent kPayloadChunkReceived = {
+//       "connections", "PayloadChunkReceived", {"payload_id", "offset"}};
+//
+//   NEARBY_TRACE(kPayloadChunkReceived, payload_id, offset);
+struct TraceEvent {
+  static constexpr int kMaxArgs = 3;
+
+  const char* category;
+  const char* name;
+  // Names of the integer arguments recorded with the event, unused ones left
+  // null.
+  std::array<const char*, kMaxArgs> arg_names = {};
+};
+
+// Records trace events into per-thread, fixed size ring buffers. Recording an
+// event is a handful of relaxed stores into the calling thread's buffer and
+// never blocks; when a buffer is full the oldest events are overwritten.
+//
+// Tracing is off by default, in which case NEARBY_TRACE costs a single
+// relaxed load. Buffers are only read when they are dumped, which is the only
+// point at which anything is formatted.
+class Trace {
+ public:
+  // Number of events kept per thread.
+  static constexpr std::size_t kBufferSize = 2048;
+
+  enum class Phase : std::int8_t {
+    kInstant,
+    kBegin,
+    kEnd,
+  };
+
+  static bool IsEnabled() {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  // Starts or stops recording. Events already recorded are kept until
+  // Clear() is called.
+  static void Enable();
+  static void Disable();
+
+  // Drops all recorded events.
+  static void Clear();
+
+  template <typename... Args>
+  static void Record(const TraceEvent& event, Args... args) {
+    static_assert(sizeof...(Args) <= TraceEvent::kMaxArgs,
+                  "Too many trace event arguments.");
+    static_assert(((std::is_integral_v<Args> || std::is_enum_v<Args>) && ...),
+                  "Trace event arguments must be integers or enums.");
+    std::array<std::int64_t, TraceEvent::kMaxArgs> values = {
+        static_cast<std::int64_t>(args)...};
+    Append(event, Phase::kInstant, values);
+  }
+
+  // Returns everything recorded so far, across all threads, in the Chrome
+  // trace event JSON format, which chrome://tracing and Perfetto can load.
+  static std::string DumpChromeTrace();
+
+  // Writes DumpChromeTrace() to `path`. Returns false if the file can't be
+  // written.
+  static bool DumpChromeTraceToFile(const std::string& path);
+
+ private:
+  friend class TraceScope;
+
+  static void Append(const TraceEvent& event, Phase phase,
+                     const std::array<std::int64_t, TraceEvent::kMaxArgs>&
+                         args);
+
+  static std::atomic<bool> enabled_;
+};
+
+// Records a begin event when constructed and the matching end event when
+// destroyed, which shows up as a slice in the trace viewer. The arguments
+// are recorded with the begin event.
+class TraceScope {
+ public:
+  template <typename... Args>
+  explicit TraceScope(const TraceEvent& event, Args... args)
+      : event_(Trace::IsEnabled() ? &event : nullptr) {
+    static_assert(sizeof...(Args) <= TraceEvent::kMaxArgs,
+                  "Too many trace event arguments.");
+    if (event_ != nullptr) {
+      std::array<std::int64_t, TraceEvent::kMaxArgs> values = {
+          static_cast<std::int64_t>(args)...};
+      Trace::Append(*event_, Trace::Phase::kBegin, values);
+    }
+  }
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+  ~TraceScope() {
+    if (event_ != nullptr) {
+      Trace::Append(*event_, Trace::Phase::kEnd, {});
+    }
+  }
+
+ private:
+  const TraceEvent* event_;
+};
+
+}  // namespace nearby
+
+// Records an instant event. The arguments aren't evaluated unless tracing is
+// enabled.
+#define NEARBY_TRACE(...)                   \
+  do {                                      \
+    if (::nearby::Trace::IsEnabled()) {     \
+      ::nearby::Trace::Record(__VA_ARGS__); \
+    }                                       \
+  } while (0)
+
+#endif  // PLATFORM_BASE_TRACE_H_
@@ -0,0 +1,155 @@
+// Copyright 2025 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/trace.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nlohmann/json.hpp"
+
+namespace nearby {
+namespace {
+
+using ::nlohmann::json;
+
+constexpr TraceEvent kChunkReceived = {
+    "test", "ChunkReceived", {"payload_id", "offset"}};
+constexpr TraceEvent kProcess = {"test", "Process\"Chunk\"", {"size"}};
+constexpr TraceEvent kNoArgs = {"test", "NoArgs"};
+
+class TraceTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    Trace::Clear();
+    Trace::Enable();
+  }
+
+  void TearDown() override {
+    Trace::Disable();
+    Trace::Clear();
+  }
+
+  static std::vector<json> GetEvents() {
+    json trace = json::parse(Trace::DumpChromeTrace());
+    return trace["traceEvents"].get<std::vector<json>>();
+  }
+};
+
+TEST_F(TraceTest, RecordsNothingWhenDisabled) {
+  Trace::Disable();
+  int evaluated = 0;
+
+  NEARBY_TRACE(kChunkReceived, ++evaluated, 2);
+  { TraceScope scope(kProcess, 3); }
+
+  EXPECT_EQ(evaluated, 0);
+  EXPECT_TRUE(GetEvents().empty());
+}
+
+TEST_F(TraceTest, RecordsInstantEvent) {
+  std::int64_t offset = 1LL << 40;
+
+  NEARBY_TRACE(kChunkReceived, 7, offset);
+  NEARBY_TRACE(kNoArgs);
+
+  std::vector<json> events = GetEvents();
+  ASSERT_EQ(events.size(), 2);
+  EXPECT_EQ(events[0]["name"], "ChunkReceived");
+  EXPECT_EQ(events[0]["cat"], "test");
+  EXPECT_EQ(events[0]["ph"], "i");
+  EXPECT_EQ(events[0]["args"]["payload_id"], 7);
+  EXPECT_EQ(events[0]["args"]["offset"], offset);
+  EXPECT_EQ(events[1]["name"], "NoArgs");
+  EXPECT_FALSE(events[1].contains("args"));
+  EXPECT_LE(events[0]["ts"].get<double>(), events[1]["ts"].get<double>());
+}
+
+TEST_F(TraceTest, ScopeRecordsBeginAndEnd) {
+  { TraceScope scope(kProcess, 1024); }
+
+  std::vector<json> events = GetEvents();
+  ASSERT_EQ(events.size(), 2);
+  EXPECT_EQ(events[0]["name"], "Process\"Chunk\"");
+  EXPECT_EQ(events[0]["ph"], "B");
+  EXPECT_EQ(events[0]["args"]["size"], 1024);
+  EXPECT_EQ(events[1]["ph"], "E");
+  EXPECT_EQ(events[0]["tid"], events[1]["tid"]);
+}
+
+TEST_F(TraceTest, KeepsNewestEventsWhenFull) {
+  for (std::size_t i = 0; i < Trace::kBufferSize + 10; ++i) {
+    NEARBY_TRACE(kChunkReceived, i, 0);
+  }
+
+  std::vector<json> events = GetEvents();
+  ASSERT_EQ(events.size(), Trace::kBufferSize);
+  EXPECT_EQ(events.front()["args"]["payload_id"], 10);
+  EXPECT_EQ(events.back()["args"]["payload_id"], Trace::kBufferSize + 9);
+}
+
+TEST_F(TraceTest, ClearDropsEvents) {
+  NEARBY_TRACE(kNoArgs);
+  Trace::Clear();
+  NEARBY_TRACE(kChunkReceived, 1, 2);
+
+  std::vector<json> events = GetEvents();
+  ASSERT_EQ(events.size(), 1);
+  EXPECT_EQ(events[0]["name"], "ChunkReceived");
+}
+
+TEST_F(TraceTest, RecordsEachThreadSeparately) {
+  constexpr int kThreads = 4;
+  constexpr int kEventsPerThread = 100;
+  std::atomic<bool> done = false;
+  // Dump while the threads are writing, which must only ever see complete
+  // events.
+  std::thread dumper([&done]() {
+    while (!done) {
+      for (const json& event : GetEvents()) {
+        EXPECT_EQ(event["name"], "ChunkReceived");
+      }
+    }
+  });
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; ++i) {
+    threads.emplace_back([i]() {
+      for (int j = 0; j < kEventsPerThread; ++j) {
+        NEARBY_TRACE(kChunkReceived, i, j);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  done = true;
+  dumper.join();
+
+  std::vector<json> events = GetEvents();
+  ASSERT_EQ(events.size(), kThreads * kEventsPerThread);
+  std::set<int> thread_ids;
+  for (const json& event : events) {
+    thread_ids.insert(event["tid"].get<int>());
+  }
+  EXPECT_EQ(thread_ids.size(), kThreads);
+}
+
+}  // namespace
+}  // namespace nearby
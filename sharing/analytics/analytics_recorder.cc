@@ -213,6 +213,12 @@ void SetAttachmentInfo(SharingLog::AttachmentsInfo* attachments_info,
   }
 }
 
+void SetDuration(::google::protobuf::Duration* proto, absl::Duration duration) {
+  proto->set_seconds(absl::ToInt64Seconds(duration));
+  proto->set_nanos(absl::ToInt64Nanoseconds(
+      duration - absl::Seconds(absl::ToInt64Seconds(duration))));
+}
+
 }  // namespace
 
 void AnalyticsRecorder::NewEstablishConnection(
@@ -524,13 +530,28 @@ void AnalyticsRecorder::NewDismissPrivacyNotification() {
   LogEvent(*sharing_log);
 }
 
-void AnalyticsRecorder::NewScanForShareTargetsEnd(int64_t session_id) {
+void AnalyticsRecorder::NewScanForShareTargetsEnd(
+    int64_t session_id, int num_share_targets_discovered,
+    std::optional<absl::Duration> duration_to_first_share_target,
+    std::optional<absl::Duration> duration_to_all_share_targets) {
   std::unique_ptr<SharingLog> sharing_log = CreateSharingLog(
       EventCategory::SENDING_EVENT, EventType::SCAN_FOR_SHARE_TARGETS_END);
 
   auto* scan_for_share_targets_end =
       sharing_log->mutable_scan_for_share_targets_end();
   scan_for_share_targets_end->set_session_id(session_id);
+  scan_for_share_targets_end->set_num_share_targets_discovered(
+      num_share_targets_discovered);
+  if (duration_to_first_share_target.has_value()) {
+    SetDuration(
+        scan_for_share_targets_end->mutable_duration_to_first_share_target(),
+        *duration_to_first_share_target);
+  }
+  if (duration_to_all_share_targets.has_value()) {
+    SetDuration(
+        scan_for_share_targets_end->mutable_duration_to_all_share_targets(),
+        *duration_to_all_share_targets);
+  }
 
   LogEvent(*sharing_log);
 }
@@ -120,7 +120,12 @@ class AnalyticsRecorder {
 
   void NewDismissPrivacyNotification();
 
-  void NewScanForShareTargetsEnd(int64_t session_id);
+  // Records the end of a scanning session, with how many share targets it
+  // discovered and how long it took to discover the first and all of them.
+  void NewScanForShareTargetsEnd(
+      int64_t session_id, int num_share_targets_discovered,
+      std::optional<absl::Duration> duration_to_first_share_target,
+      std::optional<absl::Duration> duration_to_all_share_targets);
 
   void NewScanForShareTargetsStart(
       int64_t session_id,
@@ -543,9 +543,38 @@ TEST_F(AnalyticsRecorderTest, NewScanForShareTargetsEnd) {
         EXPECT_EQ(log.event_type(), EventType::SCAN_FOR_SHARE_TARGETS_END);
         EXPECT_EQ(log.event_category(), EventCategory::SENDING_EVENT);
         EXPECT_EQ(log.scan_for_share_targets_end().session_id(), 100);
+        EXPECT_EQ(
+            log.scan_for_share_targets_end().num_share_targets_discovered(),
+            0);
+        EXPECT_FALSE(log.scan_for_share_targets_end()
+                         .has_duration_to_first_share_target());
+        EXPECT_FALSE(log.scan_for_share_targets_end()
+                         .has_duration_to_all_share_targets());
+      });
+
+  analytics_recoder().NewScanForShareTargetsEnd(
+      100, /*num_share_targets_discovered=*/0,
+      /*duration_to_first_share_target=*/std::nullopt,
+      /*duration_to_all_share_targets=*/std::nullopt);
+}
+
+TEST_F(AnalyticsRecorderTest, NewScanForShareTargetsEndWithLatency) {
+  EXPECT_CALL(event_logger(), Log(An<const SharingLog&>()))
+      .WillOnce([](const SharingLog& log) {
+        const SharingLog::ScanForShareTargetsEnd& scan_end =
+            log.scan_for_share_targets_end();
+        EXPECT_EQ(scan_end.session_id(), 100);
+        EXPECT_EQ(scan_end.num_share_targets_discovered(), 3);
+        EXPECT_EQ(scan_end.duration_to_first_share_target().seconds(), 1);
+        EXPECT_EQ(scan_end.duration_to_first_share_target().nanos(),
+                  200000000);
+        EXPECT_EQ(scan_end.duration_to_all_share_targets().seconds(), 4);
+        EXPECT_EQ(scan_end.duration_to_all_share_targets().nanos(), 0);
       });
 
-  analytics_recoder().NewScanForShareTargetsEnd(100);
+  analytics_recoder().NewScanForShareTargetsEnd(
+      100, /*num_share_targets_discovered=*/3, absl::Milliseconds(1200),
+      absl::Seconds(4));
 }
 
 TEST_F(AnalyticsRecorderTest, NewScanForShareTargetsStart) {
@@ -91,18 +91,29 @@ Contact CreateLocalContact(absl::string_view profile_user_name) {
 }
 
 // Creates a hex-encoded hash of the contact data, implicitly including the
-// allowlist, to be sent to the Nearby Share server. This hash is persisted and
-// used to detect any changes to the user's contact list or allowlist since the
-// last successful upload to the server. The hash is invariant under the
-// ordering of |contacts|.
-std::string ComputeHash(const std::vector<Contact>& contacts) {
-  // To ensure that the hash is invariant under ordering of input |contacts|,
-  // add all serialized protos to an ordered set. Then, incrementally calculate
-  // the hash as we iterate through the set.
+// allowlist, to be sent to the Nearby Share server: the Contact protos that
+// ContactRecordsToContacts() makes of |contact_records|, plus |local_contact|.
+// It's computed from the records so that the Contact list is only built when
+// it's actually uploaded.
+// This hash is persisted and used to detect any changes to the user's contact
+// list or allowlist since the last successful upload to the server. The hash
+// is invariant under the ordering of |contact_records|.
+std::string ComputeHash(const std::vector<ContactRecord>& contact_records,
+                        const Contact& local_contact) {
+  // To ensure that the hash is invariant under ordering of input
+  // |contact_records|, add all serialized protos to an ordered set. Then,
+  // incrementally calculate the hash as we iterate through the set.
   std::set<std::string> serialized_contacts_set;
-  for (const Contact& contact : contacts) {
-    serialized_contacts_set.insert(contact.SerializeAsString());
+  Contact contact;
+  contact.set_is_selected(/*is_selected=*/true);
+  for (const ContactRecord& contact_record : contact_records) {
+    for (const proto::Contact_Identifier& identifier :
+         contact_record.identifiers()) {
+      *contact.mutable_identifier() = identifier;
+      serialized_contacts_set.insert(contact.SerializeAsString());
+    }
   }
+  serialized_contacts_set.insert(local_contact.SerializeAsString());
 
   std::unique_ptr<crypto::SecureHash> hasher =
       crypto::SecureHash::Create(crypto::SecureHash::Algorithm::SHA256);
@@ -321,26 +332,30 @@ void NearbyShareContactManagerImpl::OnContactsDownloadSuccess(
   NotifyAllObserversContactsDownloaded(contacts,
                                        num_unreachable_contacts_filtered_out);
 
-  std::vector<Contact> contacts_to_upload = ContactRecordsToContacts(contacts);
-  // Enable self-share by adding your account to the list of contacts.
-  contacts_to_upload.push_back(CreateLocalContact(account->email));
+  Contact local_contact = CreateLocalContact(account->email);
 
   std::string last_contact_upload_hash = preference_manager_.GetString(
       prefs::kNearbySharingContactUploadHashName, "");
   int64_t last_contact_upload_time = preference_manager_.GetInt64(
       prefs::kNearbySharingContactUploadTimeName, 0);
   absl::Time now = clock_->Now();
-  std::string contact_upload_hash = ComputeHash(contacts_to_upload);
+  std::string contact_upload_hash = ComputeHash(contacts, local_contact);
   bool did_contacts_change_since_last_upload =
       (contact_upload_hash != last_contact_upload_hash) ||
       (now - absl::FromUnixSeconds(last_contact_upload_time) >=
        kMaxContactUploadInterval);
 
   // Request a contacts upload if the contact list or allowlist has changed
-  // since the last successful upload or max upload interval has passed.
+  // since the last successful upload or max upload interval has passed. The
+  // server replaces the whole list on upload, so all contacts are sent.
   if (did_contacts_change_since_last_upload) {
     LOG(INFO) << "Contact list changed since last successful upload at "
               << absl::FromUnixSeconds(last_contact_upload_time);
+    std::vector<Contact> contacts_to_upload =
+        ContactRecordsToContacts(contacts);
+    // Enable self-share by adding your account to the list of contacts.
+    contacts_to_upload.push_back(std::move(local_contact));
+
     absl::Notification notification;
     bool upload_success = false;
     local_device_data_manager_->UploadContacts(std::move(contacts_to_upload),
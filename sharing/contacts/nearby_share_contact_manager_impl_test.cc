@@ -218,6 +218,21 @@ class NearbyShareContactManagerImplTest
     client()->SetListContactPeopleResponses(responses);
   }
 
+  void SetPagedDownloadSuccessResult(
+      const std::vector<std::vector<ContactRecord>>& pages) {
+    std::vector<absl::StatusOr<proto::ListContactPeopleResponse>> responses;
+    for (size_t i = 0; i < pages.size(); ++i) {
+      proto::ListContactPeopleResponse response;
+      if (i + 1 < pages.size()) {
+        response.set_next_page_token(absl::StrCat("page_", i + 1));
+      }
+      response.mutable_contact_records()->Add(pages[i].begin(),
+                                              pages[i].end());
+      responses.push_back(response);
+    }
+    client()->SetListContactPeopleResponses(responses);
+  }
+
   void SetDownloadFailureResult() {
     std::vector<absl::StatusOr<proto::ListContactPeopleResponse>> responses;
     responses.push_back(absl::InternalError(""));
@@ -620,6 +635,103 @@ TEST_F(NearbyShareContactManagerImplTest, ContactUploadHash) {
   }
 }
 
+TEST_F(NearbyShareContactManagerImplTest,
+       DownloadContacts_DetectChangedContactWithoutId) {
+  std::vector<ContactRecord> contact_records =
+      TestContactRecordList(/*num_contacts=*/2u);
+  contact_records[0].clear_id();
+
+  SetDownloadSuccessResult(contact_records);
+  SetUploadResult(true);
+  DownloadContacts(/*download_success=*/true, /*expect_upload=*/true,
+                   /*upload_success=*/true,
+                   /*contacts=*/contact_records,
+                   /*expect_contacts_changed=*/true);
+
+  contact_records[0].mutable_identifiers(0)->set_account_name("new_email");
+  SetDownloadSuccessResult(contact_records);
+  DownloadContacts(/*download_success=*/true, /*expect_upload=*/true,
+                   /*upload_success=*/true,
+                   /*contacts=*/contact_records,
+                   /*expect_contacts_changed=*/true);
+}
+
+TEST_F(NearbyShareContactManagerImplTest,
+       DownloadContacts_IgnoresChangesThatAreNotUploaded) {
+  std::vector<ContactRecord> contact_records =
+      TestContactRecordList(/*num_contacts=*/3u);
+
+  SetDownloadSuccessResult(contact_records);
+  SetUploadResult(true);
+  DownloadContacts(/*download_success=*/true, /*expect_upload=*/true,
+                   /*upload_success=*/true,
+                   /*contacts=*/contact_records,
+                   /*expect_contacts_changed=*/true);
+
+  // Names and images aren't part of the upload.
+  contact_records[0].set_person_name("ZZZ ZZZ");
+  contact_records[1].set_image_url("https://www.google.com/other");
+  SetDownloadSuccessResult(contact_records);
+  DownloadContacts(/*download_success=*/true, /*expect_upload=*/false,
+                   /*upload_success=*/true,
+                   /*contacts=*/contact_records,
+                   /*expect_contacts_changed=*/false);
+}
+
+TEST_F(NearbyShareContactManagerImplTest,
+       DownloadContacts_DetectChangedAndRemovedContacts) {
+  std::vector<ContactRecord> contact_records =
+      TestContactRecordList(/*num_contacts=*/4u);
+
+  SetDownloadSuccessResult(contact_records);
+  SetUploadResult(true);
+  DownloadContacts(/*download_success=*/true, /*expect_upload=*/true,
+                   /*upload_success=*/true,
+                   /*contacts=*/contact_records,
+                   /*expect_contacts_changed=*/true);
+
+  // A changed identifier is uploaded.
+  contact_records[2].mutable_identifiers(0)->set_account_name("new_email");
+  SetDownloadSuccessResult(contact_records);
+  DownloadContacts(/*download_success=*/true, /*expect_upload=*/true,
+                   /*upload_success=*/true,
+                   /*contacts=*/contact_records,
+                   /*expect_contacts_changed=*/true);
+
+  // So is a removed contact.
+  contact_records.pop_back();
+  SetDownloadSuccessResult(contact_records);
+  DownloadContacts(/*download_success=*/true, /*expect_upload=*/true,
+                   /*upload_success=*/true,
+                   /*contacts=*/contact_records,
+                   /*expect_contacts_changed=*/true);
+}
+
+TEST_F(NearbyShareContactManagerImplTest,
+       DownloadContacts_MultiplePagesMatchSinglePage) {
+  std::vector<ContactRecord> contact_records =
+      TestContactRecordList(/*num_contacts=*/6u);
+
+  SetPagedDownloadSuccessResult(
+      {{contact_records.begin(), contact_records.begin() + 2},
+       {contact_records.begin() + 2, contact_records.begin() + 5},
+       {contact_records.begin() + 5, contact_records.end()}});
+  SetUploadResult(true);
+  DownloadContacts(/*download_success=*/true, /*expect_upload=*/true,
+                   /*upload_success=*/true,
+                   /*contacts=*/contact_records,
+                   /*expect_contacts_changed=*/true);
+
+  // The same contacts split differently are not a change.
+  SetPagedDownloadSuccessResult(
+      {{contact_records.begin(), contact_records.begin() + 3},
+       {contact_records.begin() + 3, contact_records.end()}});
+  DownloadContacts(/*download_success=*/true, /*expect_upload=*/false,
+                   /*upload_success=*/true,
+                   /*contacts=*/contact_records,
+                   /*expect_contacts_changed=*/false);
+}
+
 }  // namespace
 }  // namespace sharing
 }  // namespace nearby
@@ -14,8 +14,11 @@
 
 #include "sharing/file_attachment.h"
 
+#include <cstddef>
 #include <cstdint>
 #include <filesystem>  // NOLINT(build/c++17)
+#include <fstream>
+#include <ios>
 #include <optional>
 #include <string>
 #include <utility>
@@ -49,11 +52,33 @@ FileAttachment::Type FileAttachmentTypeFromMimeType(
   return service::proto::FileMetadata::UNKNOWN;
 }
 
+std::string SniffMimeTypeFromFile(const std::filesystem::path& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    return "";
+  }
+  char header[nearby::utils::kMimeSniffLength];
+  file.read(header, sizeof(header));
+  return std::string(nearby::utils::SniffMimeType(
+      absl::string_view(header, static_cast<size_t>(file.gcount()))));
+}
+
 std::string MimeTypeFromPath(const std::filesystem::path& path) {
   std::string extension = path.extension().string();
-  return extension.empty() ? "application/octet-stream"
-                           : nearby::utils::GetWellKnownMimeTypeFromExtension(
-                                 extension.substr(1));
+  if (!extension.empty()) {
+    absl::string_view mime_type =
+        nearby::utils::GetWellKnownMimeTypeFromExtension(extension.substr(1));
+    if (!mime_type.empty()) {
+      return std::string(mime_type);
+    }
+  }
+  // Only files whose extension tells nothing are opened, so attaching a large
+  // folder doesn't read the start of every file in it.
+  std::string mime_type = SniffMimeTypeFromFile(path);
+  if (!mime_type.empty()) {
+    return mime_type;
+  }
+  return extension.empty() ? "application/octet-stream" : "";
 }
 
 }  // namespace
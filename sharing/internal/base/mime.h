@@ -15,14 +15,25 @@
 #ifndef THIRD_PARTY_NEARBY_SHARING_INTERNAL_BASE_MIME_H_
 #define THIRD_PARTY_NEARBY_SHARING_INTERNAL_BASE_MIME_H_
 
-#include <string>
+#include <cstddef>
 
 #include "absl/strings/string_view.h"
 
 namespace nearby {
 namespace utils {
 
-std::string GetWellKnownMimeTypeFromExtension(absl::string_view extension);
+// How many leading bytes of a file SniffMimeType() looks at.
+inline constexpr size_t kMimeSniffLength = 16;
+
+// Returns the MIME type of files with `extension` (without the dot, in any
+// case), or an empty string_view if the extension isn't well known.
+absl::string_view GetWellKnownMimeTypeFromExtension(
+    absl::string_view extension);
+
+// Guesses the MIME type of a file from its first kMimeSniffLength bytes (or
+// all of it, if it's shorter), for files with no extension or an unknown one.
+// Returns an empty string_view if the content isn't recognized.
+absl::string_view SniffMimeType(absl::string_view header);
 
 }  // namespace utils
 }  // namespace nearby
@@ -15,6 +15,7 @@
 #include "sharing/internal/base/mime.h"
 
 #include "gtest/gtest.h"
+#include "absl/strings/string_view.h"
 
 namespace nearby::utils {
 namespace {
@@ -43,5 +44,43 @@ TEST(MimeTest, GetWellKnownMimeTypeFromExtensionCaseInsensitive) {
   EXPECT_EQ(GetWellKnownMimeTypeFromExtension("PNG"), "image/png");
 }
 
+TEST(MimeTest, GetWellKnownMimeTypeFromUnknownExtension) {
+  EXPECT_EQ(GetWellKnownMimeTypeFromExtension(""), "");
+  EXPECT_EQ(GetWellKnownMimeTypeFromExtension("notanextension"), "");
+  EXPECT_EQ(GetWellKnownMimeTypeFromExtension("tx"), "");
+  EXPECT_EQ(GetWellKnownMimeTypeFromExtension("txt2"), "");
+}
+
+TEST(MimeTest, GetWellKnownMimeTypeFromFirstAndLastExtensions) {
+  EXPECT_EQ(GetWellKnownMimeTypeFromExtension("123"),
+            "application/vnd.lotus-1-2-3");
+  EXPECT_EQ(GetWellKnownMimeTypeFromExtension("zmm"),
+            "application/vnd.handheld-entertainment+xml");
+}
+
+TEST(MimeTest, SniffMimeType) {
+  EXPECT_EQ(SniffMimeType("\x89PNG\r\n\x1a\n"), "image/png");
+  EXPECT_EQ(SniffMimeType("\xff\xd8\xff\xe0"), "image/jpeg");
+  EXPECT_EQ(SniffMimeType("GIF89a"), "image/gif");
+  EXPECT_EQ(SniffMimeType("%PDF-1.7\n"), "application/pdf");
+  EXPECT_EQ(SniffMimeType("PK\x03\x04"), "application/zip");
+  EXPECT_EQ(SniffMimeType("RIFF\x24\x10\x20\x30WEBPVP8 "), "image/webp");
+  EXPECT_EQ(SniffMimeType("RIFF\x24\x10\x20\x30WAVEfmt "), "audio/x-wav");
+  EXPECT_EQ(SniffMimeType(absl::string_view("\0\0\0\x18" "ftypheic", 12)),
+            "image/heic");
+  EXPECT_EQ(SniffMimeType(absl::string_view("\0\0\0\x18" "ftypqt  ", 12)),
+            "video/quicktime");
+  EXPECT_EQ(SniffMimeType(absl::string_view("\0\0\0\x18" "ftypisom", 12)),
+            "video/mp4");
+}
+
+TEST(MimeTest, SniffMimeTypeUnknownContent) {
+  EXPECT_EQ(SniffMimeType(""), "");
+  EXPECT_EQ(SniffMimeType("hello world"), "");
+  EXPECT_EQ(SniffMimeType("RIFF\x24\x10\x20\x30AAAA"), "");
+  // Too short to hold the whole signature.
+  EXPECT_EQ(SniffMimeType("\x89PN"), "");
+}
+
 }  // namespace
 }  // namespace nearby::utils
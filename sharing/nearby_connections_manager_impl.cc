@@ -513,13 +513,15 @@ void NearbyConnectionsManagerImpl::Send(
               << payload->content.is_file() << ", is bytes "
               << payload->content.is_bytes();
     transfer_managers_.at(endpoint_id)
-        ->Send([&, endpoint_id = std::string(endpoint_id),
-                payload_copy = *payload]() {
-          LOG(INFO) << __func__ << ": Send payload " << payload_copy.id
-                    << " to " << endpoint_id;
-          auto sent_payload = std::make_unique<Payload>(payload_copy);
-          SendWithoutDelay(endpoint_id, std::move(sent_payload));
-        });
+        ->Send(
+            [&, endpoint_id = std::string(endpoint_id),
+             payload_copy = *payload]() {
+              LOG(INFO) << __func__ << ": Send payload " << payload_copy.id
+                        << " to " << endpoint_id;
+              auto sent_payload = std::make_unique<Payload>(payload_copy);
+              SendWithoutDelay(endpoint_id, std::move(sent_payload));
+            },
+            payload->content.file_payload.size);
     transfer_managers_.at(endpoint_id)->StartTransfer();
     return;
   }
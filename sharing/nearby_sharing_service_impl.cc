@@ -343,7 +343,8 @@ bool NearbySharingServiceImpl::IsShuttingDown() {
 void NearbySharingServiceImpl::Cleanup() {
   SetInHighVisibility(false);
 
-  endpoint_discovery_events_ = {};
+  endpoint_discovery_events_.clear();
+  ++endpoint_discovery_generation_;
 
   DisableAllOutgoingShareTargets();
   discovery_cache_.clear();
@@ -1381,10 +1382,12 @@ void NearbySharingServiceImpl::OnEndpointDiscovered(
       "on_endpoint_discovered",
       [this, start_time, endpoint_id = std::string(endpoint_id),
        endpoint_info_copy = std::move(endpoint_info_copy)]() {
-        AddEndpointDiscoveryEvent([this, start_time, endpoint_id,
-                                   endpoint_info_copy]() {
-          HandleEndpointDiscovered(start_time, endpoint_id, endpoint_info_copy);
-        });
+        AddEndpointDiscoveryEvent(
+            endpoint_id, /*is_discovered_event=*/true,
+            [this, start_time, endpoint_id, endpoint_info_copy]() {
+              HandleEndpointDiscovered(start_time, endpoint_id,
+                                       endpoint_info_copy);
+            });
       });
 }
 
@@ -1392,6 +1395,7 @@ void NearbySharingServiceImpl::OnEndpointLost(absl::string_view endpoint_id) {
   RunOnNearbySharingServiceThread(
       "on_endpoint_lost", [this, endpoint_id = std::string(endpoint_id)]() {
         AddEndpointDiscoveryEvent(
+            endpoint_id, /*is_discovered_event=*/false,
             [this, endpoint_id]() { HandleEndpointLost(endpoint_id); });
       });
 }
@@ -1639,17 +1643,31 @@ void NearbySharingServiceImpl::OnStopFastInitiationAdvertising() {
   VLOG(1) << __func__ << ": Stopped fast initiation advertising";
 }
 
-// Processes endpoint discovered/lost events. We queue up the events to ensure
-// each discovered or lost event is fully handled before the next is run. For
-// example, we don't want to start processing an endpoint-lost event before
-// the corresponding endpoint-discovered event is finished. This is especially
-// important because of the asynchronous steps required to process an
-// endpoint-discovered event.
+// Processes endpoint discovered/lost events. We queue up the events per
+// endpoint to ensure each discovered or lost event is fully handled before the
+// next one for the same endpoint is run. For example, we don't want to start
+// processing an endpoint-lost event before the corresponding
+// endpoint-discovered event is finished. This is especially important because
+// of the asynchronous steps required to process an endpoint-discovered event.
+// Different endpoints don't wait for each other, so a crowd of devices
+// appearing at once have their certificates decrypted in parallel.
 void NearbySharingServiceImpl::AddEndpointDiscoveryEvent(
+    absl::string_view endpoint_id, bool is_discovered_event,
     std::function<void()> event) {
-  endpoint_discovery_events_.push(std::move(event));
-  if (endpoint_discovery_events_.size() == 1u) {
-    auto discovery_event = std::move(endpoint_discovery_events_.front());
+  std::queue<EndpointDiscoveryEvent>& events =
+      endpoint_discovery_events_[endpoint_id];
+  // A discovered event that hasn't started yet is superseded by a newer one;
+  // the front event is the one being processed.
+  if (is_discovered_event && events.size() > 1u &&
+      events.back().is_discovered_event) {
+    VLOG(1) << __func__ << ": Coalescing discovered events for endpoint_id="
+            << endpoint_id;
+    events.back().handler = std::move(event);
+    return;
+  }
+  events.push({is_discovered_event, std::move(event)});
+  if (events.size() == 1u) {
+    auto discovery_event = std::move(events.front().handler);
     discovery_event();
   }
 }
@@ -1664,7 +1682,7 @@ void NearbySharingServiceImpl::HandleEndpointDiscovered(
     VLOG(1)
         << __func__
         << ": Ignoring discovered endpoint because we're no longer scanning";
-    FinishEndpointDiscoveryEvent();
+    FinishEndpointDiscoveryEvent(endpoint_id);
     return;
   }
 
@@ -1672,7 +1690,7 @@ void NearbySharingServiceImpl::HandleEndpointDiscovered(
       DecodeAdvertisement(endpoint_info);
   if (!advertisement) {
     LOG(WARNING) << __func__ << ": Failed to parse discovered advertisement.";
-    FinishEndpointDiscoveryEvent();
+    FinishEndpointDiscoveryEvent(endpoint_id);
     return;
   }
 
@@ -1691,17 +1709,26 @@ void NearbySharingServiceImpl::HandleEndpointDiscovered(
   GetCertificateManager()->GetDecryptedPublicCertificate(
       std::move(encrypted_metadata_key),
       [this, start_time, endpoint_id_copy, endpoint_info_copy,
-       advertisement_copy =
-           *advertisement](std::optional<NearbyShareDecryptedPublicCertificate>
-                               decrypted_public_certificate) {
+       advertisement_copy = *advertisement,
+       generation = endpoint_discovery_generation_](
+          std::optional<NearbyShareDecryptedPublicCertificate>
+              decrypted_public_certificate) {
         RunOnNearbySharingServiceThread(
             "outgoing_decrypted_certificate",
             [this, start_time, endpoint_id_copy, endpoint_info_copy,
-             advertisement_copy, decrypted_public_certificate]() {
+             advertisement_copy, generation, decrypted_public_certificate]() {
               absl::Time now = context_->GetClock()->Now();
               LOG(INFO) << "Decrypted public certificate, success: "
                         << decrypted_public_certificate.has_value()
                         << ", latency: " << now - start_time;
+              // The event this decryption belongs to was dropped on cleanup;
+              // the endpoint's queue may now hold newer events.
+              if (generation != endpoint_discovery_generation_) {
+                LOG(INFO) << "Ignoring decrypted public certificate of "
+                             "endpoint_id="
+                          << endpoint_id_copy << " from before cleanup.";
+                return;
+              }
               OnOutgoingDecryptedCertificate(
                   endpoint_id_copy, endpoint_info_copy, advertisement_copy,
                   decrypted_public_certificate);
@@ -1717,7 +1744,7 @@ void NearbySharingServiceImpl::HandleEndpointLost(
   if (!is_scanning_) {
     VLOG(1) << __func__
             << ": Ignoring lost endpoint because we're no longer scanning";
-    FinishEndpointDiscoveryEvent();
+    FinishEndpointDiscoveryEvent(endpoint_id);
     return;
   }
 
@@ -1727,20 +1754,44 @@ void NearbySharingServiceImpl::HandleEndpointLost(
                        NearbyFlags::GetInstance().GetInt64Flag(
                            config_package_nearby::nearby_sharing_feature::
                                kDiscoveryCacheLostExpiryMs));
-  FinishEndpointDiscoveryEvent();
+  FinishEndpointDiscoveryEvent(endpoint_id);
 }
 
-void NearbySharingServiceImpl::FinishEndpointDiscoveryEvent() {
-  DCHECK(!endpoint_discovery_events_.empty());
-  DCHECK(endpoint_discovery_events_.front() == nullptr);
-  endpoint_discovery_events_.pop();
+void NearbySharingServiceImpl::FinishEndpointDiscoveryEvent(
+    absl::string_view endpoint_id) {
+  auto it = endpoint_discovery_events_.find(endpoint_id);
+  // The queues are dropped on cleanup, which may run while an event is being
+  // handled.
+  if (it == endpoint_discovery_events_.end()) {
+    return;
+  }
+  std::queue<EndpointDiscoveryEvent>& events = it->second;
+  DCHECK(!events.empty());
+  DCHECK(events.front().handler == nullptr);
+  events.pop();
 
   // Handle the next queued up endpoint discovered/lost event.
-  if (!endpoint_discovery_events_.empty()) {
-    DCHECK(endpoint_discovery_events_.front() != nullptr);
-    auto discovery_event = std::move(endpoint_discovery_events_.front());
+  if (!events.empty()) {
+    DCHECK(events.front().handler != nullptr);
+    auto discovery_event = std::move(events.front().handler);
     discovery_event();
+    return;
+  }
+  endpoint_discovery_events_.erase(it);
+
+  if (endpoint_discovery_events_.empty() && share_targets_discovered_ > 0) {
+    all_share_targets_discovered_timestamp_ =
+        last_share_target_discovered_timestamp_;
+  }
+}
+
+void NearbySharingServiceImpl::RecordShareTargetDiscoveredLatency() {
+  last_share_target_discovered_timestamp_ = context_->GetClock()->Now();
+  if (share_targets_discovered_ == 0) {
+    first_share_target_discovered_timestamp_ =
+        last_share_target_discovered_timestamp_;
   }
+  ++share_targets_discovered_;
 }
 
 void NearbySharingServiceImpl::OnShareTargetDiscovered(
@@ -1788,7 +1839,7 @@ void NearbySharingServiceImpl::OnOutgoingDecryptedCertificate(
           << __func__
           << ": Don't try to download public certificates again for endpoint="
           << endpoint_id;
-      FinishEndpointDiscoveryEvent();
+      FinishEndpointDiscoveryEvent(endpoint_id);
       return;
     }
 
@@ -1800,19 +1851,19 @@ void NearbySharingServiceImpl::OnOutgoingDecryptedCertificate(
                                             endpoint_info.end());
 
     discovered_advertisements_to_retry_map_[endpoint_id] = endpoint_info_data;
-    FinishEndpointDiscoveryEvent();
+    FinishEndpointDiscoveryEvent(endpoint_id);
     return;
   }
   if (FindDuplicateInOutgoingShareTargets(endpoint_id, *share_target)) {
     DeduplicateInOutgoingShareTarget(*share_target, endpoint_id,
                                      std::move(certificate));
-    FinishEndpointDiscoveryEvent();
+    FinishEndpointDiscoveryEvent(endpoint_id);
     return;
   }
   if (FindDuplicateInDiscoveryCache(endpoint_id, *share_target)) {
     DeDuplicateInDiscoveryCache(*share_target, endpoint_id,
                                 std::move(certificate));
-    FinishEndpointDiscoveryEvent();
+    FinishEndpointDiscoveryEvent(endpoint_id);
     return;
   }
 
@@ -1847,12 +1898,13 @@ void NearbySharingServiceImpl::OnOutgoingDecryptedCertificate(
           << " discovery callbacks be called.";
 
   OnShareTargetDiscovered(*share_target);
+  RecordShareTargetDiscoveredLatency();
 
   VLOG(1) << __func__ << ": Reported OnShareTargetDiscovered: share_target: "
           << share_target->ToString() << " endpoint_id=" << endpoint_id
           << " to all send surfaces.";
 
-  FinishEndpointDiscoveryEvent();
+  FinishEndpointDiscoveryEvent(endpoint_id);
 }
 
 void NearbySharingServiceImpl::ScheduleCertificateDownloadDuringDiscovery(
@@ -2176,6 +2228,8 @@ void NearbySharingServiceImpl::StartScanning() {
   }
 
   scanning_start_timestamp_ = context_->GetClock()->Now();
+  share_targets_discovered_ = 0;
+  all_share_targets_discovered_timestamp_.reset();
   share_foreground_send_surface_start_timestamp_ = absl::InfinitePast();
   is_scanning_ = true;
   InvalidateReceiveSurfaceState();
@@ -2215,7 +2269,19 @@ NearbySharingService::StatusCodes NearbySharingServiceImpl::StopScanning() {
   }
 
   // Log analytics event of scanning end.
-  analytics_recorder_.NewScanForShareTargetsEnd(scanning_session_id_);
+  std::optional<absl::Duration> duration_to_first_share_target;
+  std::optional<absl::Duration> duration_to_all_share_targets;
+  if (share_targets_discovered_ > 0) {
+    duration_to_first_share_target =
+        first_share_target_discovered_timestamp_ - scanning_start_timestamp_;
+  }
+  if (all_share_targets_discovered_timestamp_.has_value()) {
+    duration_to_all_share_targets =
+        *all_share_targets_discovered_timestamp_ - scanning_start_timestamp_;
+  }
+  analytics_recorder_.NewScanForShareTargetsEnd(
+      scanning_session_id_, share_targets_discovered_,
+      duration_to_first_share_target, duration_to_all_share_targets);
 
   nearby_connections_manager_->StopDiscovery();
   is_scanning_ = false;
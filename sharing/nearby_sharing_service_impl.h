@@ -265,18 +265,26 @@ class NearbySharingServiceImpl
   void StopFastInitiationAdvertising();
   void OnStopFastInitiationAdvertising();
 
-  // Processes endpoint discovered/lost events. We queue up the events to ensure
-  // each discovered or lost event is fully handled before the next is run. For
-  // example, we don't want to start processing an endpoint-lost event before
-  // the corresponding endpoint-discovered event is finished. This is especially
-  // important because of the asynchronous steps required to process an
-  // endpoint-discovered event.
-  void AddEndpointDiscoveryEvent(std::function<void()> event);
+  // Processes endpoint discovered/lost events. We queue up the events per
+  // endpoint to ensure each discovered or lost event is fully handled before
+  // the next one for the same endpoint is run. For example, we don't want to
+  // start processing an endpoint-lost event before the corresponding
+  // endpoint-discovered event is finished. This is especially important
+  // because of the asynchronous steps required to process an
+  // endpoint-discovered event. Events for different endpoints are processed
+  // concurrently, and a discovered event still waiting in the queue is
+  // replaced by a newer one for the same endpoint.
+  void AddEndpointDiscoveryEvent(absl::string_view endpoint_id,
+                                 bool is_discovered_event,
+                                 std::function<void()> event);
   void HandleEndpointDiscovered(absl::Time start_time,
                                 absl::string_view endpoint_id,
                                 absl::Span<const uint8_t> endpoint_info);
   void HandleEndpointLost(absl::string_view endpoint_id);
-  void FinishEndpointDiscoveryEvent();
+  void FinishEndpointDiscoveryEvent(absl::string_view endpoint_id);
+  // Updates the discovery latency of the current scanning session, which is
+  // recorded when scanning stops.
+  void RecordShareTargetDiscoveredLatency();
   void OnOutgoingDecryptedCertificate(
       absl::string_view endpoint_id, absl::Span<const uint8_t> endpoint_info,
       const Advertisement& advertisement,
@@ -571,12 +579,31 @@ class NearbySharingServiceImpl
   // immediately after a completed share.
   std::unique_ptr<ThreadTimer> fast_initiation_scanner_cooldown_timer_;
 
-  // A queue of endpoint-discovered and endpoint-lost events that ensures the
-  // events are processed sequentially, in the order received from Nearby
-  // Connections. An event is processed either immediately, if there are no
-  // other events in the queue, or as soon as the previous event processing
-  // finishes. When processing finishes, the event is removed from the queue.
-  std::queue<std::function<void()>> endpoint_discovery_events_;
+  struct EndpointDiscoveryEvent {
+    bool is_discovered_event;
+    std::function<void()> handler;
+  };
+
+  // Queues of endpoint-discovered and endpoint-lost events, keyed by endpoint
+  // id, that ensure the events of an endpoint are processed sequentially, in
+  // the order received from Nearby Connections. An event is processed either
+  // immediately, if there are no other events in its endpoint's queue, or as
+  // soon as the previous event processing finishes. When processing finishes,
+  // the event is removed from the queue, and the queue once it's empty.
+  absl::flat_hash_map<std::string, std::queue<EndpointDiscoveryEvent>>
+      endpoint_discovery_events_;
+
+  // Bumped whenever the queues are dropped on cleanup, so that a decryption
+  // still in flight from before doesn't finish an event queued after it.
+  int64_t endpoint_discovery_generation_ = 0;
+
+  // Discovery latency of the current scanning session, recorded when it ends:
+  // the share targets found, when the first and the last of them were found,
+  // and when the last one was found before the event queues went idle.
+  int share_targets_discovered_ = 0;
+  absl::Time first_share_target_discovered_timestamp_;
+  absl::Time last_share_target_discovered_timestamp_;
+  std::optional<absl::Time> all_share_targets_discovered_timestamp_;
 
   // Shouldn't schedule new task after shutting down, and skip task if the
   // object is null.
@@ -689,10 +689,24 @@ class NearbySharingServiceImplTest : public testing::Test {
 
     ASSERT_FALSE(calls.empty());
     EXPECT_EQ(calls.size(), expected_num_calls);
+    ProcessPublicCertificateDecryption(/*call_index=*/calls.size() - 1,
+                                       success, for_self_share, vendor_id);
+  }
+
+  // Completes the `call_index`-th decryption request, for tests that have
+  // several endpoints being discovered at once.
+  void ProcessPublicCertificateDecryption(size_t call_index, bool success,
+                                          bool for_self_share = false,
+                                          uint8_t vendor_id = 0) {
+    std::vector<
+        FakeNearbyShareCertificateManager::GetDecryptedPublicCertificateCall>&
+        calls = certificate_manager()->get_decrypted_public_certificate_calls();
+
+    ASSERT_LT(call_index, calls.size());
     EXPECT_EQ(GetNearbyShareTestEncryptedMetadataKey().salt(),
-              calls.back().encrypted_metadata_key.salt());
+              calls[call_index].encrypted_metadata_key.salt());
     EXPECT_EQ(GetNearbyShareTestEncryptedMetadataKey().encrypted_key(),
-              calls.back().encrypted_metadata_key.encrypted_key());
+              calls[call_index].encrypted_metadata_key.encrypted_key());
 
     if (success) {
       nearby::sharing::proto::PublicCertificate cert =
@@ -700,11 +714,11 @@ class NearbySharingServiceImplTest : public testing::Test {
               DeviceVisibility::DEVICE_VISIBILITY_ALL_CONTACTS,
               GetNearbyShareTestNotBefore(), vendor_id);
       cert.set_for_self_share(for_self_share);
-      std::move(calls.back().callback)(
+      std::move(calls[call_index].callback)(
           NearbyShareDecryptedPublicCertificate::DecryptPublicCertificate(
               cert, GetNearbyShareTestEncryptedMetadataKey()));
     } else {
-      std::move(calls.back().callback)(std::nullopt);
+      std::move(calls[call_index].callback)(std::nullopt);
     }
     FlushTesting();
   }
@@ -4064,9 +4078,9 @@ TEST_F(NearbySharingServiceImplTest, OrderedEndpointDiscoveryEvents) {
   ScopedSendSurface s(service_.get(), &transfer_callback);
   EXPECT_TRUE(fake_nearby_connections_manager_->IsDiscovering());
 
-  // Ensure that the endpoint discovered and lost event are process
-  // sequentially. This is particularly important due to the asynchronous
-  // operations needed to handle endpoint discovery.
+  // Ensure that the endpoint discovered and lost event of an endpoint are
+  // processed sequentially. This is particularly important due to the
+  // asynchronous operations needed to handle endpoint discovery.
   //
   // Order of events:
   //   - Nearby Connections discovers endpoint 1
@@ -4077,7 +4091,8 @@ TEST_F(NearbySharingServiceImplTest, OrderedEndpointDiscoveryEvents) {
   //   - Nearby Connections discovers endpoint 3
   //   - Nearby Connections loses endpoint 3
   //   - Nearby Connections loses endpoint 2
-  //   - Nearby Share processes these 2 discovered events in order.
+  //   - Nearby Share processes these 2 discovered events concurrently, each
+  //     before the endpoint's lost event.
   //   - endpoints 2 and 3 moved to discovery cache.
   {
     absl::Notification notification;
@@ -4111,15 +4126,78 @@ TEST_F(NearbySharingServiceImplTest, OrderedEndpointDiscoveryEvents) {
     // Needed for discovery processing. Fail, then the ShareTarget device ID is
     // set to the endpoint ID, which we use above to verify the correct endpoint
     // ID processing order.
-    ProcessLatestPublicCertificateDecryption(/*expected_num_calls=*/2,
-                                             /*success=*/false);
-    ProcessLatestPublicCertificateDecryption(/*expected_num_calls=*/3,
-                                             /*success=*/false);
+    EXPECT_EQ(certificate_manager()->get_decrypted_public_certificate_calls()
+                  .size(),
+              3u);
+    ProcessPublicCertificateDecryption(/*call_index=*/1, /*success=*/false);
+    ProcessPublicCertificateDecryption(/*call_index=*/2, /*success=*/false);
 
     EXPECT_TRUE(notification.WaitForNotificationWithTimeout(kWaitTimeout));
   }
 }
 
+TEST_F(NearbySharingServiceImplTest, ConcurrentEndpointDiscoveryEvents) {
+  SetConnectionType(ConnectionType::kWifi);
+  MockTransferUpdateCallback transfer_callback;
+  MockShareTargetDiscoveredCallback discovery_callback;
+  EXPECT_EQ(RegisterSendSurface(&transfer_callback, &discovery_callback,
+                                SendSurfaceState::kForeground),
+            NearbySharingService::StatusCodes::kOk);
+  ScopedSendSurface s(service_.get(), &transfer_callback);
+  EXPECT_TRUE(fake_nearby_connections_manager_->IsDiscovering());
+
+  // Endpoint 2 doesn't wait for endpoint 1's certificate to be decrypted.
+  FindEndpoint(/*endpoint_id=*/"1");
+  FindEndpoint(/*endpoint_id=*/"2");
+  EXPECT_EQ(
+      certificate_manager()->get_decrypted_public_certificate_calls().size(),
+      2u);
+
+  absl::Notification notification;
+  InSequence seq;
+  EXPECT_CALL(discovery_callback, OnShareTargetDiscovered)
+      .WillOnce([](ShareTarget share_target) {
+        EXPECT_EQ(share_target.device_id, "2");
+      });
+  EXPECT_CALL(discovery_callback, OnShareTargetDiscovered)
+      .WillOnce([&](ShareTarget share_target) {
+        EXPECT_EQ(share_target.device_id, "1");
+        notification.Notify();
+      });
+  ProcessPublicCertificateDecryption(/*call_index=*/1, /*success=*/false);
+  ProcessPublicCertificateDecryption(/*call_index=*/0, /*success=*/false);
+  EXPECT_TRUE(notification.WaitForNotificationWithTimeout(kWaitTimeout));
+}
+
+TEST_F(NearbySharingServiceImplTest, CoalesceQueuedEndpointDiscoveredEvents) {
+  SetConnectionType(ConnectionType::kWifi);
+  MockTransferUpdateCallback transfer_callback;
+  MockShareTargetDiscoveredCallback discovery_callback;
+  EXPECT_EQ(RegisterSendSurface(&transfer_callback, &discovery_callback,
+                                SendSurfaceState::kForeground),
+            NearbySharingService::StatusCodes::kOk);
+  ScopedSendSurface s(service_.get(), &transfer_callback);
+  EXPECT_TRUE(fake_nearby_connections_manager_->IsDiscovering());
+
+  // The first event is being processed; the last two wait behind it and are
+  // merged into one.
+  FindEndpoint(/*endpoint_id=*/"1");
+  FindEndpoint(/*endpoint_id=*/"1");
+  FindEndpoint(/*endpoint_id=*/"1");
+  EXPECT_EQ(
+      certificate_manager()->get_decrypted_public_certificate_calls().size(),
+      1u);
+
+  EXPECT_CALL(discovery_callback, OnShareTargetDiscovered).Times(1);
+  ProcessLatestPublicCertificateDecryption(/*expected_num_calls=*/1,
+                                           /*success=*/false);
+  ProcessLatestPublicCertificateDecryption(/*expected_num_calls=*/2,
+                                           /*success=*/false);
+  EXPECT_EQ(
+      certificate_manager()->get_decrypted_public_certificate_calls().size(),
+      2u);
+}
+
 TEST_F(NearbySharingServiceImplTest,
        RetryDiscoveredEndpointsNoDownloadIfDecryption) {
   // Start discovery.
@@ -4427,10 +4505,12 @@ TEST_F(NearbySharingServiceImplTest, EndpointDedupBasedOnDeviceId) {
           share_target_updated = share_target;
           notification.Notify();
         });
-    ProcessLatestPublicCertificateDecryption(/*expected_num_calls=*/5,
-                                             /*success=*/true);
-    ProcessLatestPublicCertificateDecryption(/*expected_num_calls=*/6,
-                                             /*success=*/true);
+    // Both re-discovered endpoints are decrypting at once.
+    EXPECT_EQ(certificate_manager()->get_decrypted_public_certificate_calls()
+                  .size(),
+              6u);
+    ProcessPublicCertificateDecryption(/*call_index=*/4, /*success=*/true);
+    ProcessPublicCertificateDecryption(/*call_index=*/5, /*success=*/true);
     EXPECT_TRUE(notification.WaitForNotificationWithTimeout(kWaitTimeout));
   }
 
@@ -4568,11 +4648,15 @@ TEST_F(NearbySharingServiceImplTest, RetryDiscoveredEndpointsDownloadLimit) {
   for (size_t i = 1; i <= kMaxCertificateDownloadsDuringDiscovery; ++i) {
     FindInvalidEndpoint(/*endpoint_id=*/absl::StrCat(i));
   }
+  // The endpoints are decrypting at once.
+  EXPECT_EQ(
+      certificate_manager()->get_decrypted_public_certificate_calls().size(),
+      kMaxCertificateDownloadsDuringDiscovery);
 
   for (size_t i = 1; i <= kMaxCertificateDownloadsDuringDiscovery; ++i) {
     SCOPED_TRACE(i);
-    ProcessLatestPublicCertificateDecryption(/*expected_num_calls=*/i,
-                                             /*success=*/false);
+    ProcessPublicCertificateDecryption(/*call_index=*/i - 1,
+                                       /*success=*/false);
     FastForward(kCertificateDownloadDuringDiscoveryPeriod);
     EXPECT_EQ(certificate_manager()->num_download_public_certificates_calls(),
               1u + i);
@@ -4589,9 +4673,14 @@ TEST_F(NearbySharingServiceImplTest, RetryDiscoveredEndpointsDownloadLimit) {
   // is not related to the retry timer.
   EXPECT_EQ(certificate_manager()->num_download_public_certificates_calls(),
             2u + kMaxCertificateDownloadsDuringDiscovery);
+  // Each download retried the endpoint it was for. Endpoint 1 is found again
+  // while its retry is still decrypting, so it's handled after the retry.
+  EXPECT_EQ(
+      certificate_manager()->get_decrypted_public_certificate_calls().size(),
+      2u * kMaxCertificateDownloadsDuringDiscovery);
   FindInvalidEndpoint(/*endpoint_id=*/"1");
-  ProcessLatestPublicCertificateDecryption(
-      /*expected_num_calls=*/1u + kMaxCertificateDownloadsDuringDiscovery,
+  ProcessPublicCertificateDecryption(
+      /*call_index=*/kMaxCertificateDownloadsDuringDiscovery,
       /*success=*/false);
   FastForward(kCertificateDownloadDuringDiscoveryPeriod);
   EXPECT_EQ(certificate_manager()->num_download_public_certificates_calls(),
@@ -14,8 +14,10 @@
 
 #include "sharing/transfer_manager.h"
 
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -53,9 +55,27 @@ TransferManager::~TransferManager() {
   pending_tasks_.clear();
 }
 
-void TransferManager::Send(std::function<void()> task) {
+void TransferManager::Send(std::function<void()> task,
+                           std::optional<int64_t> payload_size) {
   absl::MutexLock lock(&mutex_);
 
+  // Payloads already waiting keep their order ahead of this one.
+  if (is_waiting_for_high_quality_medium_ && pending_tasks_.empty() &&
+      payload_size.has_value()) {
+    int64_t bytes = bytes_sent_before_upgrade_ + *payload_size;
+    absl::Duration estimated_send_time =
+        absl::Seconds(1) * bytes / kInitialMediumBytesPerSecond;
+    if (estimated_send_time <= kExpectedMediumUpgradeTime) {
+      LOG(INFO) << "Sending " << *payload_size << " bytes to endpoint "
+                << endpoint_id_
+                << " without waiting for a high quality medium, estimated "
+                << estimated_send_time << " over the current medium.";
+      bytes_sent_before_upgrade_ = bytes;
+      task();
+      return;
+    }
+  }
+
   if (is_waiting_for_high_quality_medium_) {
     LOG(INFO)
         << "Connection to endpoint " << endpoint_id_
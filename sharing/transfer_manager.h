@@ -15,8 +15,10 @@
 #ifndef THIRD_PARTY_NEARBY_SHARING_TRANSFER_MANAGER_H_
 #define THIRD_PARTY_NEARBY_SHARING_TRANSFER_MANAGER_H_
 
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -34,16 +36,31 @@ namespace sharing {
 // TransferManager is used to delay the payload transfer until the medium
 // quality is in high quality. If the quality doesn't change in a duration, it
 // will give up to wait for the medium change.
+//
+// Payloads small enough to be sent over the initial medium in about the time
+// an upgrade usually takes are sent right away instead; Nearby Connections
+// moves them to the upgraded medium if it arrives mid-transfer.
 class TransferManager {
  public:
   // Used to wait for the medium upgrade.
   static constexpr absl::Duration kMediumUpgradeTimeout = absl::Seconds(10);
+  // How long a bandwidth upgrade usually takes to complete.
+  static constexpr absl::Duration kExpectedMediumUpgradeTime =
+      absl::Seconds(3);
+  // A conservative estimate of the initial medium's (Bluetooth) throughput.
+  static constexpr int64_t kInitialMediumBytesPerSecond = 128 * 1024;
 
   TransferManager(Context* context, absl::string_view endpoint_id);
 
   ~TransferManager();
 
-  void Send(std::function<void()> task) ABSL_LOCKS_EXCLUDED(mutex_);
+  // Runs `task`, which sends a payload of `payload_size` bytes, once the
+  // medium is upgraded, unless the payloads sent so far including this one
+  // fit in what the initial medium can send in kExpectedMediumUpgradeTime.
+  // Payloads of unknown size always wait.
+  void Send(std::function<void()> task,
+            std::optional<int64_t> payload_size = std::nullopt)
+      ABSL_LOCKS_EXCLUDED(mutex_);
   void OnMediumQualityChanged(Medium current_medium)
       ABSL_LOCKS_EXCLUDED(mutex_);
   bool StartTransfer() ABSL_LOCKS_EXCLUDED(mutex_);
@@ -57,6 +74,8 @@ class TransferManager {
   absl::Mutex mutex_;
   bool is_waiting_for_high_quality_medium_ ABSL_GUARDED_BY(mutex_) = true;
   std::vector<std::function<void()>> pending_tasks_ ABSL_GUARDED_BY(mutex_);
+  // Bytes sent over the initial medium while waiting for the upgrade.
+  int64_t bytes_sent_before_upgrade_ ABSL_GUARDED_BY(mutex_) = 0;
   std::unique_ptr<ThreadTimer> timeout_timer_ ABSL_GUARDED_BY(mutex_) = nullptr;
 };
 
@@ -14,7 +14,9 @@
 
 #include "sharing/transfer_manager.h"
 
+#include <cstdint>
 #include <string>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "absl/strings/string_view.h"
@@ -176,6 +178,72 @@ TEST(TransferManager, MediumUpgradeBeforeStartTransfer) {
   ASSERT_TRUE(is_called);
 }
 
+TEST(TransferManager, SendSmallPayloadWithoutWaiting) {
+  FakeContext context;
+  bool is_called = false;
+
+  TransferManager transfer_manager{&context, kEndpointId};
+  transfer_manager.Send([&]() { is_called = true; },
+                        /*payload_size=*/1024);
+
+  ASSERT_TRUE(is_called);
+}
+
+TEST(TransferManager, LargePayloadWaitsForMediumUpgrade) {
+  FakeContext context;
+  absl::Notification notification;
+  bool is_called = false;
+  int64_t large_payload_size =
+      TransferManager::kInitialMediumBytesPerSecond *
+          absl::ToInt64Seconds(TransferManager::kExpectedMediumUpgradeTime) +
+      1;
+
+  TransferManager transfer_manager{&context, kEndpointId};
+  transfer_manager.Send(
+      [&]() {
+        is_called = true;
+        notification.Notify();
+      },
+      large_payload_size);
+
+  ASSERT_FALSE(is_called);
+  ASSERT_TRUE(transfer_manager.StartTransfer());
+  transfer_manager.OnMediumQualityChanged(Medium::kWifiLan);
+  ASSERT_TRUE(
+      notification.WaitForNotificationWithTimeout(kNotificationTimeout));
+  ASSERT_TRUE(is_called);
+}
+
+TEST(TransferManager, SmallPayloadsWaitOnceBudgetIsUsed) {
+  FakeContext context;
+  int calls = 0;
+  int64_t payload_size = TransferManager::kInitialMediumBytesPerSecond;
+
+  TransferManager transfer_manager{&context, kEndpointId};
+  for (int i = 0; i < 5; ++i) {
+    transfer_manager.Send([&]() { ++calls; }, payload_size);
+  }
+
+  // Three seconds' worth are sent right away, the rest waits.
+  EXPECT_EQ(calls, 3);
+  transfer_manager.OnMediumQualityChanged(Medium::kWifiLan);
+  EXPECT_EQ(calls, 5);
+}
+
+TEST(TransferManager, SmallPayloadQueuesBehindWaitingPayload) {
+  FakeContext context;
+  std::vector<int> order;
+
+  TransferManager transfer_manager{&context, kEndpointId};
+  transfer_manager.Send([&]() { order.push_back(1); });
+  transfer_manager.Send([&]() { order.push_back(2); },
+                        /*payload_size=*/1024);
+
+  EXPECT_TRUE(order.empty());
+  transfer_manager.OnMediumQualityChanged(Medium::kWifiLan);
+  EXPECT_EQ(order, std::vector<int>({1, 2}));
+}
+
 }  // namespace
 }  // namespace sharing
 }  // namespace nearby